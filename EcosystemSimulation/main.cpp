@@ -1,3141 +1,10609 @@
-﻿#include <iostream>
-#include <vector>
-#include <cstdlib>
-#include <ctime>
-#include <algorithm>
-#include <map>
-#include <conio.h>
-#include <windows.h>
-#include <locale>
-#include <cmath>
-#include <queue>
-#include <unordered_map>
-#include <set>
-#include <typeinfo>
-#include <iomanip>
-#include <fstream> // 用于保存历史数据
-
-using namespace std;
-
-// 设置控制台编码为GB2312以支持中文
-void SetConsoleToGB2312() {
-    SetConsoleOutputCP(936); // GB2312编码
-    SetConsoleCP(936);
-}
-
-// 控制台颜色枚举
-enum ConsoleColors {
-    COLOR_DEFAULT = 7,
-    COLOR_PLANT = 10,
-    COLOR_HERBIVORE = 14,
-    COLOR_CARNIVORE = 12,
-    COLOR_WATER = 9,
-    COLOR_MOUNTAIN = 8,
-    COLOR_DESERT = 6,
-    COLOR_FOREST = 2,
-    COLOR_MARSH = 11,
-    COLOR_VOLCANIC = 4,
-    COLOR_SNOW = 15,
-    COLOR_STATS = 11,
-    COLOR_TITLE = 14,
-    COLOR_WARNING = 12,
-    COLOR_HIGHLIGHTA = 13,
-    COLOR_GRASSLAND = 10,
-    COLOR_JUNGLE = 2,
-    COLOR_TUNDRA = 11,
-    COLOR_BEACH = 6,
-    COLOR_RAIN = 9,
-    COLOR_DROUGHT = 6
-};
-
-// 设置控制台颜色
-void SetColor(int color) {
-    SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), color);
-}
-
-// 天气类型枚举
-enum WeatherType {
-    SUNNY,      // 晴天
-    RAINY,      // 雨天
-    SNOWY,      // 雪天
-    CLOUDY,     // 多云
-    STORMY,     // 暴风雨
-    DROUGHT     // 干旱
-};
-
-// 地形类型枚举
-enum TerrainType {
-    PLAIN,      // 平原
-    FOREST,     // 森林
-    MOUNTAIN,   // 山脉
-    DESERT,     // 沙漠
-    WATER,      // 水域
-    MARSH,      // 沼泽
-    VOLCANIC,   // 火山
-    SNOW,       // 雪地
-    GRASSLAND,  // 草原
-    JUNGLE,     // 丛林
-    TUNDRA,     // 苔原
-    BEACH,      // 海滩
-    FLOODED     // 积水区
-};
-
-// 疾病类型
-enum DiseaseType {
-    NONE,
-    FUNGAL_INFECTION,  // 真菌感染
-    VIRAL_OUTBREAK,    // 病毒爆发
-    PARASITIC_INFESTATION // 寄生虫感染
-};
-
-// 地形结构体
-struct Terrain {
-    TerrainType type;
-    double height;      // 高度
-    double fertility;   // 肥沃度
-    double water_level; // 水位/湿度
-    double pollution_level; // 污染程度
-    double disease_level;   // 疾病程度
-    double water_accumulation; // 积水深度 (0-1.0)
-    double snow_depth;       // 积雪深度 (0-1.0)
-    double drought_level;    // 干旱程度 (0-1.0)
-    double original_height;  // 原始高度，用于洪水退去后恢复地形
-
-    Terrain() : type(PLAIN), height(0.0), fertility(0.5), water_level(0.5),
-        pollution_level(0.0), disease_level(0.0), water_accumulation(0.0),
-        snow_depth(0.0), drought_level(0.0), original_height(0.0) {
-    }
-};
-
-// 环境参数结构体
-struct Environment {
-    double temperature;    // 温度 (-20-50)
-    double humidity;       // 湿度 (0-100)
-    double disaster_chance;// 灾难概率 (0-0.1)
-    double pollution;      // 污染程度 (0-1.0)
-    double season_progress;// 季节进度 (0-1)
-    double rainfall;       // 降雨量 (0-100)
-    double daylight_hours; // 白天时长 (0-24)
-    DiseaseType disease;   // 当前流行疾病
-    int disease_duration;  // 疾病持续时间
-    WeatherType weather;   // 当前天气
-    int weather_duration;  // 天气持续时间
-    int consecutive_rain;  // 连续降雨天数
-    int consecutive_sunny; // 连续晴天天数
-
-    Environment() : temperature(25.0), humidity(50.0),
-        disaster_chance(0.01), pollution(0.1), season_progress(0.0),
-        rainfall(0.0), daylight_hours(12.0), disease(NONE), disease_duration(0),
-        weather(SUNNY), weather_duration(1), consecutive_rain(0), consecutive_sunny(0) {
-    }
-};
-
-// 前向声明所有生物类
-class Plant;
-class Herbivore;
-class Carnivore;
-class Omnivore;
-class Insect;
-class Decomposer;
-class ApexPredator;
-class Parasite;
-class Fish;
-class Bird;
-class Reptile;
-class Amphibian;
-class Scavenger;
-
-// 生物基类
-class Organism {
-protected:
-    int x, y;             // 位置
-    double energy;         // 能量值
-    int age;               // 年龄
-    int max_age;           // 最大寿命
-    double reproduction_threshold; // 繁殖所需能量阈值
-    double reproduction_chance;    // 繁殖概率
-    double mobility;       // 移动能力
-    double preferred_temp; // 偏好温度
-    double temp_tolerance; // 温度耐受范围
-    bool is_aquatic;       // 是否水生
-    bool is_hibernating;   // 是否在冬眠
-    bool has_disease;      // 是否患病
-    int disease_resistance; // 疾病抵抗力 (0-100)
-    int territory_size;    // 领地大小
-    int days_without_food; // 饥饿天数
-    double flood_resistance; // 抗洪能力 (0-1.0)
-    double drought_resistance; // 抗旱能力 (0-1.0)
-    double base_energy;    // 基础能量消耗
-
-    // 前一天的状态
-    struct PreviousState {
-        int x, y;
-        double energy;
-        int age;
-        bool is_dead;
-        string status;
-    } previous;
-
-public:
-    Organism(int x, int y, double energy)
-        : x(x), y(y), energy(energy), age(0), max_age(0),
-        reproduction_threshold(0.0), reproduction_chance(0.3),
-        mobility(1.0), preferred_temp(25.0), temp_tolerance(15.0),
-        is_aquatic(false), is_hibernating(false), has_disease(false),
-        disease_resistance(50), territory_size(1), days_without_food(0),
-        flood_resistance(0.2), drought_resistance(0.5), base_energy(0.1) {
-        save_previous_state("创建");
-    }
-
-    virtual ~Organism() {}
-
-    // 保存前一天状态
-    void save_previous_state(const string& status) {
-        previous.x = x;
-        previous.y = y;
-        previous.energy = energy;
-        previous.age = age;
-        previous.is_dead = (energy <= 0 || age >= max_age);
-        previous.status = status;
-    }
-
-    // 获取前一天状态
-    const PreviousState& get_previous_state() const {
-        return previous;
-    }
-
-    // 纯虚函数 - 需要在子类实现
-    virtual void move(vector<vector<Terrain>>& terrain, Environment& env) = 0;
-    virtual void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) = 0;
-    virtual Organism* reproduce() = 0;
-    virtual string getSymbol() const = 0;
-    virtual string getName() const = 0;
-    virtual bool canInhabit(TerrainType type) const = 0;
-    virtual void seasonal_effect(Environment& env) {}  // 添加默认实现
-    virtual void weather_effect(Environment& env, Terrain& terrain) {} // 天气影响
-
-    // 疾病相关函数
-    virtual void contract_disease(DiseaseType disease_type) {
-        if (rand() % 100 > disease_resistance) {
-            has_disease = true;
-            save_previous_state("感染疾病");
-        }
-    }
-
-    // 修改spread_disease函数签名
-    virtual void spread_disease(vector<Organism*>& nearby_organisms, DiseaseType disease_type) {
-        if (has_disease && rand() % 100 < 30) { // 30%几率传播疾病
-            for (Organism* org : nearby_organisms) {
-                // 使用typeid进行类型检查
-                if (org != this && typeid(*org) == typeid(*this)) {
-                    org->contract_disease(disease_type);
-                }
-            }
-        }
-    }
-
-    virtual void disease_effects() {
-        if (!has_disease) return;
-
-        // 疾病影响
-        lose_energy(0.5); // 每天损失能量
-        mobility *= 0.7;   // 移动能力降低
-
-        // 小概率死亡
-        if (rand() % 100 < 5) {
-            lose_energy(energy); // 直接死亡
-        }
-
-        // 小概率康复
-        if (rand() % 100 < disease_resistance / 10) {
-            has_disease = false;
-            save_previous_state("康复");
-        }
-    }
-
-    // 通用函数
-    void age_organism(Environment& env) {
-        age++;
-        // 基础能量消耗（与体型和活动相关）
-        double consumption = base_energy * (1.0 + mobility * 0.5);
-        energy -= consumption;
-
-        // 温度影响
-        double temp_diff = abs(env.temperature - preferred_temp);
-        if (temp_diff > temp_tolerance) {
-            lose_energy(temp_diff * 0.1);
-        }
-
-        // 疾病影响
-        disease_effects();
-
-        // 处理冬眠
-        handle_hibernation(env);
-
-        // 处理饥饿
-        handle_hunger();
-    }
-
-    // 将handle_hibernation改为虚函数
-    virtual void handle_hibernation(Environment& env) {
-        if (env.temperature < 5 && energy > 20 && !is_aquatic) {
-            is_hibernating = true;
-            lose_energy(0.1); // 冬眠时消耗少量能量
-        }
-        else if (env.temperature > 10 || energy < 10) {
-            is_hibernating = false;
-        }
-    }
-
-    void handle_hunger() {
-        if (energy < max_age / 10.0) { // 能量过低
-            days_without_food++;
-            if (days_without_food > 5) {
-                lose_energy(energy * 0.2); // 饥饿致死
-            }
-        }
-        else {
-            days_without_food = 0;
-        }
-    }
-
-    bool is_dead() const { return energy <= 0 || age >= max_age; }
-    void gain_energy(double amount) {
-        energy += amount;
-        // 能量上限
-        energy = min(energy, static_cast<double>(max_age * 2));
-    }
-    void lose_energy(double amount) {
-        energy -= amount;
-        if (energy < 0) energy = 0;
-    }
-
-    // 位置和能量访问
-    int getX() const { return x; }
-    int getY() const { return y; }
-    double getEnergy() const { return energy; }
-    bool getIsAquatic() const { return is_aquatic; }
-    bool isHibernating() const { return is_hibernating; }
-    double getMobility() const { return mobility; }  // 添加getMobility
-    void setPosition(int new_x, int new_y) { x = new_x; y = new_y; }  // 添加setPosition
-
-    // 繁殖机会检查
-    bool can_reproduce() const {
-        return energy > reproduction_threshold &&
-            (rand() / (double)RAND_MAX) < reproduction_chance &&
-            !is_hibernating && !has_disease && age > max_age / 4;
-    }
-
-    // 环境适应度
-    virtual double environment_fitness(Environment& env, Terrain& terrain) {
-        // 温度影响
-        double temp_diff = abs(env.temperature - preferred_temp);
-        double temp_fitness = 1.0 - min(1.0, temp_diff / temp_tolerance);
-
-        // 白天时长影响 (夜行性/昼行性)
-        double daylight_fitness = (preferred_temp > 30) ?
-            min(1.0, env.daylight_hours / 12.0) :  // 喜热生物偏好白天
-            min(1.0, (24 - env.daylight_hours) / 12.0); // 喜冷生物偏好夜晚
-
-        // 地形适应度
-        double terrain_fitness = 0.0;
-        switch (terrain.type) {
-        case PLAIN: terrain_fitness = 0.8; break;
-        case FOREST: terrain_fitness = 0.9; break;
-        case MOUNTAIN: terrain_fitness = 0.4; break;
-        case DESERT: terrain_fitness = 0.3; break;
-        case WATER: terrain_fitness = is_aquatic ? 1.0 : 0.1; break;
-        case MARSH: terrain_fitness = 0.7; break;
-        case VOLCANIC: terrain_fitness = 0.2; break;
-        case SNOW: terrain_fitness = 0.5; break;
-        case GRASSLAND: terrain_fitness = 0.85; break;
-        case JUNGLE: terrain_fitness = 0.95; break;
-        case TUNDRA: terrain_fitness = 0.4; break;
-        case BEACH: terrain_fitness = is_aquatic ? 0.7 : 0.6; break;
-        case FLOODED: terrain_fitness = is_aquatic ? 0.9 : 0.3; break;
-        }
-
-        // 污染影响
-        double pollution_fitness = 1.0 - max(env.pollution, terrain.pollution_level);
-
-        // 疾病影响
-        double disease_fitness = 1.0 - terrain.disease_level;
-
-        // 积水影响
-        double flood_fitness = 1.0 - terrain.water_accumulation * (1.0 - flood_resistance);
-
-        // 干旱影响
-        double drought_fitness = 1.0 - terrain.drought_level * (1.0 - drought_resistance);
-
-        // 综合适应度
-        return (temp_fitness * 0.3 +
-            daylight_fitness * 0.15 +
-            terrain_fitness * 0.15 +
-            pollution_fitness * 0.1 +
-            disease_fitness * 0.1 +
-            flood_fitness * 0.1 +
-            drought_fitness * 0.1);
-    }
-
-    // 寻找附近同类
-    vector<Organism*> find_nearby_species(vector<Organism*>& organisms, int range) {
-        vector<Organism*> nearby;
-        for (Organism* org : organisms) {
-            if (typeid(*org) == typeid(*this)) {
-                int dx = abs(x - org->getX());
-                int dy = abs(y - org->getY());
-                if (dx <= range && dy <= range && !org->is_dead()) {
-                    nearby.push_back(org);
-                }
-            }
-        }
-        return nearby;
-    }
-};
-
-// 植物类
-class Plant : public Organism {
-protected:
-    double growth_rate; // 生长速率
-    double water_need;  // 水分需求
-    int growth_stage;   // 0=种子, 1=幼苗, 2=成熟, 3=开花, 4=结果
-    int days_to_mature; // 成熟所需天数
-    double seed_spread_range; // 种子传播范围
-    double flood_tolerance; // 抗洪能力
-    double drought_tolerance; // 抗旱能力
-
-public:
-    Plant(int x, int y, double energy = 10.0) : Organism(x, y, energy) {
-        max_age = 50;
-        reproduction_threshold = 15.0;
-        reproduction_chance = 0.4;
-        growth_rate = 0.2;
-        water_need = 0.6;
-        preferred_temp = 22.0;
-        temp_tolerance = 20.0;
-        growth_stage = 0;
-        days_to_mature = 20;
-        seed_spread_range = 5.0;
-        disease_resistance = 30;
-        flood_resistance = 0.3;
-        drought_resistance = 0.6;
-        flood_tolerance = 0.4;
-        drought_tolerance = 0.7;
-        base_energy = 0.05;
-    }
-
-    void move(vector<vector<Terrain>>& terrain, Environment& env) override {
-        // 植物不移动，但种子可以传播
-        if (growth_stage >= 3) { // 开花或结果阶段可以传播种子
-            if (rand() % 100 < 5) { // 5%几率传播种子
-                int new_x = x + rand() % static_cast<int>(seed_spread_range * 2) - static_cast<int>(seed_spread_range);
-                int new_y = y + rand() % static_cast<int>(seed_spread_range * 2) - static_cast<int>(seed_spread_range);
-
-                // 边界检查
-                new_x = max(0, min(static_cast<int>(terrain[0].size()) - 1, new_x));
-                new_y = max(0, min(static_cast<int>(terrain.size()) - 1, new_y));
-
-                // 创建新植物（种子）
-                if (canInhabit(terrain[new_y][new_x].type)) {
-                    Organism* new_plant = new Plant(new_x, new_y, 5.0);
-                    // 添加到全局生物列表
-                    // 需要World类的上下文，暂时注释
-                    // organisms.push_back(new_plant);
-                }
-            }
-        }
-    }
-
-    void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) override {
-        // 检查地形是否适合
-        if (!canInhabit(terrain[y][x].type)) {
-            lose_energy(0.5);
-            return;
-        }
-
-        // 植物生长阶段推进
-        if (growth_stage < 4 && age > days_to_mature * (growth_stage + 1) / 4) {
-            growth_stage++;
-            if (growth_stage == 2) { // 成熟期
-                reproduction_chance += 0.1;
-            }
-        }
-
-        // 植物通过光合作用获取能量
-        double light_factor = min(1.0, env.daylight_hours / 12.0);
-        double fertility_factor = terrain[y][x].fertility;
-        double water_factor = min(1.0, terrain[y][x].water_level / water_need);
-
-        // 降雨影响
-        water_factor = min(1.0, water_factor + env.rainfall / 100.0);
-
-        // 干旱影响
-        if (terrain[y][x].drought_level > 0.5) {
-            water_factor *= (1.0 - terrain[y][x].drought_level);
-        }
-
-        double growth = growth_rate * light_factor *
-            water_factor * fertility_factor *
-            environment_fitness(env, terrain[y][x]);
-
-        // 生长阶段影响生长速度
-        growth *= (1.0 + growth_stage * 0.2);
-
-        // 积水影响
-        if (terrain[y][x].water_accumulation > flood_tolerance) {
-            growth *= 0.5; // 积水过多会抑制生长
-        }
-
-        gain_energy(growth);
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce() && growth_stage >= 2) { // 只有成熟期以上植物可以繁殖
-            energy /= 2;
-            Plant* child = new Plant(x + rand() % 5 - 2, y + rand() % 5 - 2);
-            // 遗传变异
-            child->growth_rate = max(0.1, min(0.3, growth_rate + (rand() % 11 - 5) * 0.01));
-            child->drought_resistance = max(0.3, min(0.8, drought_resistance + (rand() % 11 - 5) * 0.02));
-            return child;
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override {
-        if (growth_stage == 0) return "s"; // 种子
-        if (growth_stage == 1) return "p"; // 幼苗
-        return "P"; // 成熟植物
-    }
-    string getName() const override {
-        switch (growth_stage) {
-        case 0: return "种子";
-        case 1: return "幼苗";
-        case 2: return "植物";
-        case 3: return "开花植物";
-        default: return "结果植物";
-        }
-    }
-
-    bool canInhabit(TerrainType type) const override {
-        return type != WATER && type != VOLCANIC && type != FLOODED;
-    }
-
-    void disease_effects() override {
-        if (!has_disease) return;
-
-        // 植物疾病影响更大
-        lose_energy(1.0);
-        growth_rate *= 0.5;
-
-        // 较高概率死亡
-        if (rand() % 100 < 10) {
-            lose_energy(energy);
-        }
-
-        // 较低概率康复
-        if (rand() % 100 < disease_resistance / 5) {
-            has_disease = false;
-        }
-    }
-
-    void weather_effect(Environment& env, Terrain& terrain) override {
-        // 干旱天气影响
-        if (env.weather == DROUGHT && terrain.drought_level > drought_tolerance) {
-            lose_energy(0.8);
-        }
-
-        // 暴雨天气影响
-        if (env.weather == STORMY && terrain.water_accumulation > flood_tolerance) {
-            lose_energy(1.0);
-        }
-    }
-};
-
-// 树木类 - 森林植物
-class Tree : public Plant {
-public:
-    Tree(int x, int y, double energy = 20.0) : Plant(x, y, energy) {
-        max_age = 200;
-        reproduction_threshold = 30.0;
-        reproduction_chance = 0.3;
-        growth_rate = 0.15;
-        water_need = 0.7;
-        preferred_temp = 20.0;
-        temp_tolerance = 15.0;
-        days_to_mature = 50;
-        seed_spread_range = 10.0;
-        flood_resistance = 0.2;
-        drought_resistance = 0.8;
-        base_energy = 0.03;
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce() && growth_stage >= 3) { // 只有开花期以上树木可以繁殖
-            energy /= 2;
-            Tree* child = new Tree(x + rand() % 3 - 1, y + rand() % 3 - 1);
-            // 遗传变异
-            child->growth_rate = max(0.1, min(0.2, growth_rate + (rand() % 11 - 5) * 0.005));
-            return child;
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override {
-        if (growth_stage < 2) return "t";
-        return "T";
-    }
-    string getName() const override {
-        if (growth_stage < 2) return "小树苗";
-        return "树木";
-    }
-
-    bool canInhabit(TerrainType type) const override {
-        return type == FOREST || type == PLAIN || type == JUNGLE;
-    }
-
-    void weather_effect(Environment& env, Terrain& terrain) override {
-        // 暴风雨可能吹倒树木
-        if (env.weather == STORMY && growth_stage < 3 && rand() % 100 < 10) {
-            lose_energy(energy * 0.5);
-        }
-    }
-};
-
-// 水生植物类
-class AquaticPlant : public Plant {
-public:
-    AquaticPlant(int x, int y, double energy = 8.0) : Plant(x, y, energy) {
-        max_age = 40;
-        reproduction_threshold = 12.0;
-        reproduction_chance = 0.5;
-        growth_rate = 0.25;
-        water_need = 1.0;
-        preferred_temp = 18.0;
-        temp_tolerance = 10.0;
-        is_aquatic = true;
-        days_to_mature = 10;
-        seed_spread_range = 3.0;
-        flood_resistance = 0.9;
-        drought_resistance = 0.1;
-        base_energy = 0.04;
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce() && growth_stage >= 2) {
-            energy /= 2;
-            AquaticPlant* child = new AquaticPlant(x + rand() % 3 - 1, y + rand() % 3 - 1);
-            // 遗传变异
-            child->growth_rate = max(0.2, min(0.3, growth_rate + (rand() % 11 - 5) * 0.01));
-            return child;
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override {
-        if (growth_stage < 2) return "a";
-        return "A";
-    }
-    string getName() const override {
-        if (growth_stage < 2) return "幼年水生植物";
-        return "水生植物";
-    }
-
-    bool canInhabit(TerrainType type) const override {
-        return type == WATER || type == MARSH || type == FLOODED;
-    }
-
-    void weather_effect(Environment& env, Terrain& terrain) override {
-        // 干旱天气对水生植物影响很大
-        if (env.weather == DROUGHT) {
-            lose_energy(1.0);
-        }
-    }
-};
-
-// 动物移动函数增强
-void animal_move(Organism* org, vector<vector<Terrain>>& terrain, Environment& env, int base_range) {
-    if (org->isHibernating()) return; // 冬眠期间不移动
-
-    // 积雪影响移动能力
-    double snow_factor = 1.0 - min(0.5, terrain[org->getY()][org->getX()].snow_depth * 0.7);
-
-    // 积水影响移动能力
-    double flood_factor = 1.0;
-    if (!org->getIsAquatic() && terrain[org->getY()][org->getX()].water_accumulation > 0.3) {
-        flood_factor = 0.6;
-    }
-
-    int move_range = static_cast<int>(org->getMobility() * base_range * snow_factor * flood_factor);
-    int new_x = org->getX() + rand() % (move_range * 2 + 1) - move_range;
-    int new_y = org->getY() + rand() % (move_range * 2 + 1) - move_range;
-
-    // 边界检查
-    new_x = max(0, min(static_cast<int>(terrain[0].size()) - 1, new_x));
-    new_y = max(0, min(static_cast<int>(terrain.size()) - 1, new_y));
-
-    // 检查新位置是否适合栖息
-    if (org->canInhabit(terrain[new_y][new_x].type)) {
-        org->setPosition(new_x, new_y);
-        org->save_previous_state("移动");
-    }
-
-    org->lose_energy(0.2);
-}
-
-// 昆虫类
-class Insect : public Organism {
-protected:
-    bool is_flying;
-    bool is_nocturnal; // 是否夜行性
-
-public:
-    Insect(int x, int y, double energy = 5.0) : Organism(x, y, energy) {
-        max_age = 30;
-        reproduction_threshold = 8.0;
-        reproduction_chance = 0.5;
-        mobility = 1.5;
-        preferred_temp = 28.0;
-        temp_tolerance = 25.0;
-        is_flying = false;
-        is_nocturnal = (rand() % 2 == 0);
-        disease_resistance = 40;
-        flood_resistance = 0.1;
-        drought_resistance = 0.8;
-        base_energy = 0.08;
-    }
-
-    void move(vector<vector<Terrain>>& terrain, Environment& env) override {
-        // 如果是夜行性昆虫，白天活动减少
-        if (is_nocturnal && env.daylight_hours > 12) {
-            if (rand() % 100 < 70) return; // 70%几率不活动
-        }
-
-        // 雨天使昆虫活动减少
-        if (env.weather == RAINY || env.weather == STORMY) {
-            if (rand() % 100 < 60) return;
-        }
-
-        // 小范围移动
-        int move_range = is_flying ? 5 : 3;
-        animal_move(this, terrain, env, move_range);
-    }
-
-    void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) override {
-        // 检查地形是否适合
-        if (!canInhabit(terrain[y][x].type)) {
-            lose_energy(0.5);
-            return;
-        }
-
-        // 干旱天气影响食物获取
-        if (env.weather == DROUGHT && terrain[y][x].drought_level > 0.5) {
-            lose_energy(0.3);
-            return;
-        }
-
-        // 寻找附近的植物或腐肉
-        for (Organism* org : organisms) {
-            if (dynamic_cast<Plant*>(org) && !dynamic_cast<Tree*>(org)) {
-                int dx = abs(x - org->getX());
-                int dy = abs(y - org->getY());
-                if (dx <= 1 && dy <= 1) {
-                    // 吃植物
-                    gain_energy(org->getEnergy() * 0.7);
-                    org->lose_energy(org->getEnergy());
-                    save_previous_state("进食");
-                    return;
-                }
-            }
-        }
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce()) {
-            // 检查附近是否有配偶
-            vector<Organism*> nearby = find_nearby_species(organisms, 3);
-            if (nearby.size() > 1) { // 至少有一个配偶
-                energy /= 2;
-                Insect* child = new Insect(x + rand() % 2 - 1, y + rand() % 2 - 1);
-                // 遗传变异
-                child->mobility = max(1.0, min(2.0, mobility + (rand() % 11 - 5) * 0.05));
-                child->disease_resistance = max(30, min(50, disease_resistance + rand() % 11 - 5));
-                save_previous_state("繁殖");
-                return child;
-            }
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override { return "I"; }
-    string getName() const override { return "昆虫"; }
-
-    bool canInhabit(TerrainType type) const override {
-        return type != WATER && type != VOLCANIC && type != FLOODED;
-    }
-
-    double environment_fitness(Environment& env, Terrain& terrain) override {
-        double fitness = Organism::environment_fitness(env, terrain);
-
-        // 夜行性昆虫在夜晚更活跃
-        if (is_nocturnal && env.daylight_hours < 12) {
-            fitness *= 1.2;
-        }
-        return min(1.0, fitness);
-    }
-
-    void weather_effect(Environment& env, Terrain& terrain) override {
-        // 暴雨可能冲走昆虫
-        if (env.weather == STORMY && !is_flying && rand() % 100 < 30) {
-            lose_energy(1.0);
-        }
-    }
-};
-
-// 飞行昆虫类
-class FlyingInsect : public Insect {
-public:
-    FlyingInsect(int x, int y, double energy = 4.0) : Insect(x, y, energy) {
-        max_age = 20;
-        reproduction_threshold = 6.0;
-        reproduction_chance = 0.6;
-        mobility = 2.0;
-        preferred_temp = 30.0;
-        is_flying = true;
-        territory_size = 5;
-        flood_resistance = 0.8; // 飞行昆虫不怕积水
-        base_energy = 0.1;
-    }
-
-    void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) override {
-        // 检查地形是否适合
-        if (!canInhabit(terrain[y][x].type)) {
-            lose_energy(0.5);
-            return;
-        }
-
-        // 飞行昆虫可以吃花蜜和小型昆虫
-        for (Organism* org : organisms) {
-            if (dynamic_cast<Plant*>(org) || dynamic_cast<Insect*>(org)) {
-                int dx = abs(x - org->getX());
-                int dy = abs(y - org->getY());
-                if (dx <= 2 && dy <= 2) {
-                    // 吃植物或昆虫
-                    gain_energy(org->getEnergy() * 0.5);
-                    org->lose_energy(org->getEnergy() * 0.8);
-                    save_previous_state("进食");
-                    return;
-                }
-            }
-        }
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce()) {
-            // 检查附近是否有配偶
-            vector<Organism*> nearby = find_nearby_species(organisms, 5);
-            if (nearby.size() > 1) {
-                energy *= 0.5;
-                FlyingInsect* child = new FlyingInsect(x + rand() % 3 - 1, y + rand() % 3 - 1);
-                // 遗传变异
-                child->mobility = max(1.8, min(2.5, mobility + (rand() % 11 - 5) * 0.05));
-                save_previous_state("繁殖");
-                return child;
-            }
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override { return "F"; }
-    string getName() const override { return "飞行昆虫"; }
-
-    void weather_effect(Environment& env, Terrain& terrain) override {
-        // 暴雨影响飞行
-        if (env.weather == STORMY && rand() % 100 < 40) {
-            lose_energy(0.5);
-        }
-    }
-};
-
-// 食草动物类
-class Herbivore : public Organism {
-protected:
-    bool migrated; // 是否已迁徙
-
-public:
-    Herbivore(int x, int y, double energy = 20.0) : Organism(x, y, energy) {
-        max_age = 70;
-        reproduction_threshold = 30.0;
-        mobility = 1.2;
-        preferred_temp = 22.0;
-        temp_tolerance = 25.0;
-        territory_size = 10;
-        migrated = false;
-        disease_resistance = 60;
-        flood_resistance = 0.3;
-        drought_resistance = 0.7;
-        base_energy = 0.15;
-    }
-
-    void move(vector<vector<Terrain>>& terrain, Environment& env) override {
-        if (isHibernating()) return;
-
-        // 季节性迁徙
-        if (!migrated && (env.season_progress > 0.7 || env.season_progress < 0.3)) {
-            int move_range = static_cast<int>(mobility * 50); // 长距离迁徙
-            int new_x = x + rand() % (move_range * 2 + 1) - move_range;
-            int new_y = y + rand() % (move_range * 2 + 1) - move_range;
-
-            // 边界检查
-            new_x = max(0, min(static_cast<int>(terrain[0].size()) - 1, new_x));
-            new_y = max(0, min(static_cast<int>(terrain.size()) - 1, new_y));
-
-            if (canInhabit(terrain[new_y][new_x].type)) {
-                x = new_x;
-                y = new_y;
-                migrated = true;
-                save_previous_state("迁徙");
-                return;
-            }
-        }
-
-        animal_move(this, terrain, env, 3);
-    }
-
-    void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) override {
-        // 检查地形是否适合
-        if (!canInhabit(terrain[y][x].type)) {
-            lose_energy(1.0);
-            return;
-        }
-
-        // 干旱天气减少食物供应
-        double food_availability = 1.0;
-        if (env.weather == DROUGHT) {
-            food_availability = 0.7;
-        }
-
-        // 寻找附近的植物
-        vector<Organism*> nearby_plants;
-        for (Organism* org : organisms) {
-            if (dynamic_cast<Plant*>(org) && !dynamic_cast<Tree*>(org)) {
-                int dx = abs(x - org->getX());
-                int dy = abs(y - org->getY());
-                if (dx <= 2 && dy <= 2) {
-                    nearby_plants.push_back(org);
-                }
-            }
-        }
-
-        // 吃能量最高的植物
-        if (!nearby_plants.empty()) {
-            sort(nearby_plants.begin(), nearby_plants.end(),
-                [](Organism* a, Organism* b) {
-                    return a->getEnergy() > b->getEnergy();
-                });
-
-            Organism* target = nearby_plants[0];
-            gain_energy(target->getEnergy() * 0.6 * food_availability);
-            target->lose_energy(target->getEnergy());
-            save_previous_state("进食");
-            return;
-        }
-
-        // 食草动物需要消耗更多能量在寒冷环境中
-        if (env.temperature < 10) lose_energy(1.0);
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce()) {
-            // 检查附近是否有配偶
-            vector<Organism*> nearby = find_nearby_species(organisms, 5);
-            if (nearby.size() > 1) {
-                energy *= 0.4;
-                migrated = false; // 重置迁徙状态
-                Herbivore* child = new Herbivore(x + rand() % 3 - 1, y + rand() % 3 - 1);
-                // 遗传变异
-                child->max_age = max(50, min(80, max_age + rand() % 11 - 5));
-                child->reproduction_threshold = max(25.0, min(35.0, reproduction_threshold + (rand() % 11 - 5)));
-                save_previous_state("繁殖");
-                return child;
-            }
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override { return "H"; }
-    string getName() const override { return "食草动物"; }
-
-    bool canInhabit(TerrainType type) const override {
-        return type != WATER && type != VOLCANIC && type != MOUNTAIN && type != FLOODED;
-    }
-
-    void seasonal_effect(Environment& env) override {
-        // 秋季增加繁殖几率
-        if (fmod(env.season_progress, 1.0) > 0.6 && fmod(env.season_progress, 1.0) < 0.9) {
-            reproduction_chance = min(0.6, reproduction_chance * 1.2);
-        }
-    }
-
-    void weather_effect(Environment& env, Terrain& terrain) override {
-        // 暴风雨影响食草动物
-        if (env.weather == STORMY) {
-            lose_energy(1.0);
-        }
-    }
-};
-
-// 鱼类
-class Fish : public Organism {
-public:
-    Fish(int x, int y, double energy = 15.0) : Organism(x, y, energy) {
-        max_age = 40;
-        reproduction_threshold = 20.0;
-        reproduction_chance = 0.35;
-        mobility = 1.2;
-        preferred_temp = 18.0;
-        temp_tolerance = 10.0;
-        is_aquatic = true;
-        disease_resistance = 45;
-        flood_resistance = 0.9;
-        drought_resistance = 0.1;
-        base_energy = 0.12;
-    }
-
-    void move(vector<vector<Terrain>>& terrain, Environment& env) override {
-        // 在水中移动
-        int move_range = static_cast<int>(mobility * 3);
-        int new_x = x + rand() % (move_range * 2 + 1) - move_range;
-        int new_y = y + rand() % (move_range * 2 + 1) - move_range;
-
-        // 边界检查
-        new_x = max(0, min(static_cast<int>(terrain[0].size()) - 1, new_x));
-        new_y = max(0, min(static_cast<int>(terrain.size()) - 1, new_y));
-
-        // 只能在水中移动
-        if (terrain[new_y][new_x].type == WATER || terrain[new_y][new_x].type == FLOODED) {
-            x = new_x;
-            y = new_y;
-            save_previous_state("移动");
-        }
-
-        lose_energy(0.3);
-    }
-
-    void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) override {
-        // 只能在水域进食
-        if (terrain[y][x].type != WATER && terrain[y][x].type != FLOODED) {
-            lose_energy(1.0);
-            return;
-        }
-
-        // 寻找附近的水生植物或小型水生生物
-        for (Organism* org : organisms) {
-            if ((dynamic_cast<AquaticPlant*>(org) || dynamic_cast<Insect*>(org)) &&
-                org->getIsAquatic()) {
-                int dx = abs(x - org->getX());
-                int dy = abs(y - org->getY());
-                if (dx <= 2 && dy <= 2) {
-                    // 进食
-                    gain_energy(org->getEnergy() * 0.6);
-                    org->lose_energy(org->getEnergy());
-                    save_previous_state("进食");
-                    return;
-                }
-            }
-        }
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce()) {
-            // 检查附近是否有配偶
-            vector<Organism*> nearby = find_nearby_species(organisms, 3);
-            if (nearby.size() > 1) {
-                energy *= 0.5;
-                Fish* child = new Fish(x + rand() % 2 - 1, y + rand() % 2 - 1);
-                // 遗传变异
-                child->reproduction_chance = max(0.3, min(0.4, reproduction_chance + (rand() % 11 - 5) * 0.01));
-                save_previous_state("繁殖");
-                return child;
-            }
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override { return "~"; }
-    string getName() const override { return "鱼类"; }
-
-    bool canInhabit(TerrainType type) const override {
-        return type == WATER || type == FLOODED;
-    }
-
-    void seasonal_effect(Environment& env) override {
-        // 水温变化影响鱼类
-        double temp_diff = abs(env.temperature - preferred_temp);
-        if (temp_diff > 5) {
-            reproduction_chance *= 0.8;
-        }
-    }
-
-    void weather_effect(Environment& env, Terrain& terrain) override {
-        // 干旱对鱼类是灾难性的
-        if (env.weather == DROUGHT) {
-            lose_energy(2.0);
-        }
-        // 降雨有利鱼类
-        else if (env.weather == RAINY) {
-            gain_energy(0.2);
-        }
-    }
-};
-
-// 鸟类
-class Bird : public Organism {
-public:
-    Bird(int x, int y, double energy = 25.0) : Organism(x, y, energy) {
-        max_age = 50;
-        reproduction_threshold = 30.0;
-        reproduction_chance = 0.3;
-        mobility = 2.5;
-        preferred_temp = 22.0;
-        temp_tolerance = 20.0;
-        territory_size = 20;
-        disease_resistance = 50;
-        flood_resistance = 0.8; // 鸟类不怕洪水
-        drought_resistance = 0.6;
-        base_energy = 0.18;
-    }
-
-    void move(vector<vector<Terrain>>& terrain, Environment& env) override {
-        // 鸟类可以长距离移动
-        int move_range = static_cast<int>(mobility * 8);
-        int new_x = x + rand() % (move_range * 2 + 1) - move_range;
-        int new_y = y + rand() % (move_range * 2 + 1) - move_range;
-
-        // 边界检查
-        new_x = max(0, min(static_cast<int>(terrain[0].size()) - 1, new_x));
-        new_y = max(0, min(static_cast<int>(terrain.size()) - 1, new_y));
-
-        // 鸟类可以跨越大部分地形
-        if (terrain[new_y][new_x].type != WATER) {
-            x = new_x;
-            y = new_y;
-            save_previous_state("飞行");
-        }
-
-        lose_energy(0.8);
-    }
-
-    void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) override {
-        // 寻找附近的昆虫、鱼类或小型动物
-        for (Organism* org : organisms) {
-            if (dynamic_cast<Insect*>(org) || dynamic_cast<Fish*>(org)) {
-                int dx = abs(x - org->getX());
-                int dy = abs(y - org->getY());
-                if (dx <= 3 && dy <= 3) {
-                    // 捕食
-                    gain_energy(org->getEnergy() * 0.7);
-                    org->lose_energy(org->getEnergy());
-                    save_previous_state("进食");
-                    return;
-                }
-            }
-        }
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce()) {
-            // 检查附近是否有配偶
-            vector<Organism*> nearby = find_nearby_species(organisms, 10);
-            if (nearby.size() > 1) {
-                energy *= 0.5;
-                Bird* child = new Bird(x + rand() % 5 - 2, y + rand() % 5 - 2);
-                // 遗传变异
-                child->mobility = max(2.0, min(3.0, mobility + (rand() % 11 - 5) * 0.1));
-                save_previous_state("繁殖");
-                return child;
-            }
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override { return "B"; }  // 改为B避免与顶级掠食者冲突
-    string getName() const override { return "鸟类"; }
-
-    bool canInhabit(TerrainType type) const override {
-        return type != WATER && type != VOLCANIC;
-    }
-
-    void seasonal_effect(Environment& env) override {
-        // 春季增加繁殖几率
-        if (fmod(env.season_progress, 1.0) > 0.2 && fmod(env.season_progress, 1.0) < 0.5) {
-            reproduction_chance = min(0.5, reproduction_chance * 1.5);
-        }
-    }
-
-    void weather_effect(Environment& env, Terrain& terrain) override {
-        // 暴风雨影响鸟类飞行
-        if (env.weather == STORMY) {
-            lose_energy(1.0);
-        }
-    }
-};
-
-// 分解者类（分解死亡生物）
-class Decomposer : public Organism {
-public:
-    Decomposer(int x, int y, double energy = 3.0) : Organism(x, y, energy) {
-        max_age = 40;
-        reproduction_threshold = 6.0;
-        reproduction_chance = 0.45;
-        mobility = 0.5;
-        preferred_temp = 25.0;
-        disease_resistance = 80; // 分解者抵抗力强
-        flood_resistance = 0.4;
-        drought_resistance = 0.7;
-        base_energy = 0.06;
-    }
-
-    void move(vector<vector<Terrain>>& terrain, Environment& env) override {
-        // 缓慢移动
-        if (rand() % 5 == 0) {
-            animal_move(this, terrain, env, 2);
-        }
-        lose_energy(0.1);
-    }
-
-    void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) override {
-        // 检查地形是否适合
-        if (!canInhabit(terrain[y][x].type)) {
-            lose_energy(0.3);
-            return;
-        }
-
-        // 寻找附近死亡的生物
-        for (Organism* org : organisms) {
-            if (org->is_dead() && !dynamic_cast<Decomposer*>(org)) {
-                int dx = abs(x - org->getX());
-                int dy = abs(y - org->getY());
-                if (dx <= 1 && dy <= 1) {
-                    // 分解死亡生物
-                    gain_energy(org->getEnergy() * 0.8);
-                    org->lose_energy(org->getEnergy());
-
-                    // 增加土壤肥力
-                    terrain[y][x].fertility = min(1.0, terrain[y][x].fertility + 0.01);
-                    save_previous_state("分解");
-                    return;
-                }
-            }
-        }
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce()) {
-            energy /= 2;
-            Decomposer* child = new Decomposer(x + rand() % 2 - 1, y + rand() % 2 - 1);
-            // 遗传变异
-            child->disease_resistance = max(70, min(90, disease_resistance + rand() % 11 - 5));
-            save_previous_state("繁殖");
-            return child;
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override { return "D"; }
-    string getName() const override { return "分解者"; }
-
-    bool canInhabit(TerrainType type) const override {
-        return type != WATER && type != VOLCANIC && type != FLOODED;
-    }
-
-    void weather_effect(Environment& env, Terrain& terrain) override {
-        // 雨天有利于分解者
-        if (env.weather == RAINY) {
-            gain_energy(0.1);
-        }
-    }
-};
-
-// 杂食动物类（既吃植物又吃小动物）
-class Omnivore : public Organism {
-public:
-    Omnivore(int x, int y, double energy = 25.0) : Organism(x, y, energy) {
-        max_age = 65;
-        reproduction_threshold = 35.0;
-        reproduction_chance = 0.28;
-        mobility = 1.3;
-        preferred_temp = 24.0;
-        territory_size = 8;
-        disease_resistance = 55;
-        flood_resistance = 0.4;
-        drought_resistance = 0.6;
-        base_energy = 0.16;
-    }
-
-    void move(vector<vector<Terrain>>& terrain, Environment& env) override {
-        animal_move(this, terrain, env, 3);
-    }
-
-    void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) override {
-        // 检查地形是否适合
-        if (!canInhabit(terrain[y][x].type)) {
-            lose_energy(1.0);
-            return;
-        }
-
-        // 干旱天气减少食物供应
-        double food_availability = 1.0;
-        if (env.weather == DROUGHT) {
-            food_availability = 0.8;
-        }
-
-        // 寻找附近的植物或小动物
-        vector<Organism*> potential_food;
-        for (Organism* org : organisms) {
-            if (dynamic_cast<Plant*>(org) ||
-                dynamic_cast<Insect*>(org) ||
-                dynamic_cast<Fish*>(org)) {
-                int dx = abs(x - org->getX());
-                int dy = abs(y - org->getY());
-                if (dx <= 2 && dy <= 2) {
-                    potential_food.push_back(org);
-                }
-            }
-        }
-
-        // 选择最近的食物
-        if (!potential_food.empty()) {
-            sort(potential_food.begin(), potential_food.end(),
-                [this](Organism* a, Organism* b) {
-                    int dx1 = abs(x - a->getX());
-                    int dy1 = abs(y - a->getY());
-                    int dx2 = abs(x - b->getX());
-                    int dy2 = abs(y - b->getY());
-                    return (dx1 + dy1) < (dx2 + dy2);
-                });
-
-            Organism* target = potential_food[0];
-            gain_energy(target->getEnergy() * 0.5 * food_availability);
-            target->lose_energy(target->getEnergy());
-            save_previous_state("进食");
-            return;
-        }
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce()) {
-            // 检查附近是否有配偶
-            vector<Organism*> nearby = find_nearby_species(organisms, 5);
-            if (nearby.size() > 1) {
-                energy *= 0.4;
-                Omnivore* child = new Omnivore(x + rand() % 3 - 1, y + rand() % 3 - 1);
-                // 遗传变异
-                child->reproduction_threshold = max(30.0, min(40.0, reproduction_threshold + (rand() % 11 - 5)));
-                save_previous_state("繁殖");
-                return child;
-            }
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override { return "O"; }
-    string getName() const override { return "杂食动物"; }
-
-    bool canInhabit(TerrainType type) const override {
-        return type != WATER && type != VOLCANIC && type != FLOODED;
-    }
-
-    void weather_effect(Environment& env, Terrain& terrain) override {
-        // 暴风雨影响
-        if (env.weather == STORMY) {
-            lose_energy(1.0);
-        }
-    }
-};
-
-// 食肉动物类
-class Carnivore : public Organism {
-protected:
-    int hunting_skill; // 狩猎技能 (0-100)
-
-public:
-    Carnivore(int x, int y, double energy = 30.0) : Organism(x, y, energy) {
-        max_age = 60;
-        reproduction_threshold = 40.0;
-        reproduction_chance = 0.25;
-        mobility = 1.8;
-        preferred_temp = 20.0;
-        territory_size = 15;
-        hunting_skill = 50 + rand() % 40; // 50-90
-        disease_resistance = 65;
-        flood_resistance = 0.3;
-        drought_resistance = 0.5;
-        base_energy = 0.2;
-    }
-
-    void move(vector<vector<Terrain>>& terrain, Environment& env) override {
-        animal_move(this, terrain, env, 4);
-    }
-
-    void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) override {
-        // 检查地形是否适合
-        if (!canInhabit(terrain[y][x].type)) {
-            lose_energy(1.5);
-            return;
-        }
-
-        // 寻找附近的食草动物或杂食动物
-        vector<Organism*> prey_list;
-        for (Organism* org : organisms) {
-            if (dynamic_cast<Herbivore*>(org) ||
-                dynamic_cast<Omnivore*>(org) ||
-                dynamic_cast<Bird*>(org)) {
-                int dx = abs(x - org->getX());
-                int dy = abs(y - org->getY());
-                if (dx <= 3 && dy <= 3) {
-                    prey_list.push_back(org);
-                }
-            }
-        }
-
-        // 选择猎物
-        if (!prey_list.empty()) {
-            // 选择最弱的猎物
-            sort(prey_list.begin(), prey_list.end(),
-                [](Organism* a, Organism* b) {
-                    return a->getEnergy() < b->getEnergy();
-                });
-
-            Organism* target = prey_list[0];
-
-            // 狩猎成功概率取决于狩猎技能
-            if (rand() % 100 < hunting_skill) {
-                gain_energy(target->getEnergy() * 0.7);
-                target->lose_energy(target->getEnergy());
-                save_previous_state("捕猎成功");
-            }
-            else {
-                // 狩猎失败也消耗能量
-                lose_energy(2.0);
-                save_previous_state("捕猎失败");
-            }
-            return;
-        }
-
-        // 食肉动物在炎热环境中消耗更多能量
-        if (env.temperature > 35) lose_energy(2.0);
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce()) {
-            // 检查附近是否有配偶
-            vector<Organism*> nearby = find_nearby_species(organisms, 8);
-            if (nearby.size() > 1) {
-                energy *= 0.4;
-                Carnivore* child = new Carnivore(x + rand() % 2 - 1, y + rand() % 2 - 1);
-                // 后代继承部分狩猎技能
-                child->hunting_skill = max(20, min(100, hunting_skill - 10 + rand() % 20));
-                // 遗传变异
-                child->mobility = max(1.5, min(2.2, mobility + (rand() % 11 - 5) * 0.05));
-                save_previous_state("繁殖");
-                return child;
-            }
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override { return "C"; }
-    string getName() const override { return "食肉动物"; }
-
-    bool canInhabit(TerrainType type) const override {
-        return type != WATER && type != VOLCANIC && type != FLOODED;
-    }
-
-    void weather_effect(Environment& env, Terrain& terrain) override {
-        // 暴风雨影响狩猎
-        if (env.weather == STORMY) {
-            lose_energy(1.0);
-        }
-    }
-};
-
-// 顶级掠食者类
-class ApexPredator : public Organism {
-public:
-    ApexPredator(int x, int y, double energy = 50.0) : Organism(x, y, energy) {
-        max_age = 80;
-        reproduction_threshold = 60.0;
-        reproduction_chance = 0.15;
-        mobility = 2.0;
-        preferred_temp = 18.0;
-        territory_size = 50;
-        disease_resistance = 70;
-        flood_resistance = 0.5;
-        drought_resistance = 0.7;
-        base_energy = 0.25;
-    }
-
-    void move(vector<vector<Terrain>>& terrain, Environment& env) override {
-        animal_move(this, terrain, env, 5);
-    }
-
-    void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) override {
-        // 检查地形是否适合
-        if (!canInhabit(terrain[y][x].type)) {
-            lose_energy(2.0);
-            return;
-        }
-
-        // 寻找附近的食肉动物或杂食动物
-        for (Organism* org : organisms) {
-            if (dynamic_cast<Carnivore*>(org) ||
-                dynamic_cast<Omnivore*>(org) ||
-                dynamic_cast<Herbivore*>(org)) {
-                int dx = abs(x - org->getX());
-                int dy = abs(y - org->getY());
-                if (dx <= 4 && dy <= 4) {
-                    // 捕食
-                    gain_energy(org->getEnergy() * 0.8);
-                    org->lose_energy(org->getEnergy());
-                    save_previous_state("捕食");
-                    return;
-                }
-            }
-        }
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce()) {
-            // 检查附近是否有配偶
-            vector<Organism*> nearby = find_nearby_species(organisms, 15);
-            if (nearby.size() > 1) {
-                energy *= 0.3;
-                ApexPredator* child = new ApexPredator(x + rand() % 3 - 1, y + rand() % 3 - 1);
-                // 遗传变异
-                child->max_age = max(70, min(90, max_age + rand() % 11 - 5));
-                save_previous_state("繁殖");
-                return child;
-            }
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override { return "X"; } // 改为X避免与水生植物冲突
-    string getName() const override { return "顶级掠食者"; }
-
-    bool canInhabit(TerrainType type) const override {
-        return type != WATER && type != VOLCANIC && type != FLOODED;
-    }
-
-    void seasonal_effect(Environment& env) override {
-        // 冬季减少活动
-        if (fmod(env.season_progress, 1.0) > 0.7 || fmod(env.season_progress, 1.0) < 0.3) {
-            mobility *= 0.8;
-        }
-    }
-
-    void weather_effect(Environment& env, Terrain& terrain) override {
-        // 暴风雨影响顶级掠食者
-        if (env.weather == STORMY) {
-            lose_energy(1.5);
-        }
-    }
-};
-
-// 寄生生物类
-class Parasite : public Organism {
-public:
-    Parasite(int x, int y, double energy = 2.0) : Organism(x, y, energy) {
-        max_age = 20;
-        reproduction_threshold = 4.0;
-        reproduction_chance = 0.6;
-        mobility = 0.1;
-        disease_resistance = 90; // 寄生虫抵抗力强
-        flood_resistance = 0.7;
-        drought_resistance = 0.3;
-        base_energy = 0.03;
-    }
-
-    void move(vector<vector<Terrain>>& terrain, Environment& env) override {
-        // 寄生生物不主动移动，依附宿主移动
-    }
-
-    void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) override {
-        // 寄生在宿主身上获取能量
-        for (Organism* org : organisms) {
-            if (!dynamic_cast<Parasite*>(org) && !org->is_dead()) {
-                int dx = abs(x - org->getX());
-                int dy = abs(y - org->getY());
-                if (dx == 0 && dy == 0) {
-                    // 从宿主获取能量
-                    double energy_taken = min(0.1, org->getEnergy() * 0.05);
-                    gain_energy(energy_taken);
-                    org->lose_energy(energy_taken);
-
-                    // 传播疾病
-                    if (rand() % 100 < 20) {
-                        org->contract_disease(env.disease);
-                    }
-                    save_previous_state("寄生");
-                    return;
-                }
-            }
-        }
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce()) {
-            energy /= 2;
-            Parasite* child = new Parasite(x, y);
-            // 遗传变异
-            child->reproduction_chance = max(0.5, min(0.7, reproduction_chance + (rand() % 11 - 5) * 0.01));
-            save_previous_state("繁殖");
-            return child;
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override { return "*"; }
-    string getName() const override { return "寄生生物"; }
-
-    bool canInhabit(TerrainType type) const override {
-        return true; // 寄生生物可以存在于任何地形
-    }
-};
-
-// 爬行动物
-class Reptile : public Organism {
-public:
-    Reptile(int x, int y, double energy = 22.0) : Organism(x, y, energy) {
-        max_age = 60;
-        reproduction_threshold = 25.0;
-        reproduction_chance = 0.25;
-        mobility = 1.0;
-        preferred_temp = 30.0;
-        temp_tolerance = 15.0;
-        territory_size = 5;
-        disease_resistance = 55;
-        flood_resistance = 0.4;
-        drought_resistance = 0.8;
-        base_energy = 0.14;
-    }
-
-    void move(vector<vector<Terrain>>& terrain, Environment& env) override {
-        animal_move(this, terrain, env, 3);
-    }
-
-    void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) override {
-        // 检查地形是否适合
-        if (!canInhabit(terrain[y][x].type)) {
-            lose_energy(1.0);
-            return;
-        }
-
-        // 寻找附近的昆虫、小型哺乳动物或蛋
-        for (Organism* org : organisms) {
-            if (dynamic_cast<Insect*>(org) || dynamic_cast<Herbivore*>(org)) {
-                int dx = abs(x - org->getX());
-                int dy = abs(y - org->getY());
-                if (dx <= 2 && dy <= 2) {
-                    // 捕食
-                    gain_energy(org->getEnergy() * 0.6);
-                    org->lose_energy(org->getEnergy());
-                    save_previous_state("进食");
-                    return;
-                }
-            }
-        }
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce()) {
-            // 检查附近是否有配偶
-            vector<Organism*> nearby = find_nearby_species(organisms, 4);
-            if (nearby.size() > 1) {
-                energy *= 0.5;
-                Reptile* child = new Reptile(x + rand() % 2 - 1, y + rand() % 2 - 1);
-                // 遗传变异
-                child->preferred_temp = max(25.0, min(35.0, preferred_temp + (rand() % 11 - 5)));
-                save_previous_state("繁殖");
-                return child;
-            }
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override { return "R"; }
-    string getName() const override { return "爬行动物"; }
-
-    bool canInhabit(TerrainType type) const override {
-        return type != WATER && type != SNOW && type != VOLCANIC && type != FLOODED;
-    }
-
-    void handle_hibernation(Environment& env) override {
-        // 爬行动物更早开始冬眠
-        if (env.temperature < 10) {
-            is_hibernating = true;
-            lose_energy(0.05);
-        }
-        else if (env.temperature > 15) {
-            is_hibernating = false;
-        }
-    }
-
-    void weather_effect(Environment& env, Terrain& terrain) override {
-        // 雨天爬行动物更活跃
-        if (env.weather == RAINY) {
-            gain_energy(0.1);
-        }
-    }
-};
-
-// 两栖动物
-class Amphibian : public Organism {
-public:
-    Amphibian(int x, int y, double energy = 18.0) : Organism(x, y, energy) {
-        max_age = 45;
-        reproduction_threshold = 22.0;
-        reproduction_chance = 0.35;
-        mobility = 1.0;
-        preferred_temp = 25.0;
-        temp_tolerance = 15.0;
-        disease_resistance = 40;
-        flood_resistance = 0.8;
-        drought_resistance = 0.3;
-        base_energy = 0.12;
-    }
-
-    void move(vector<vector<Terrain>>& terrain, Environment& env) override {
-        animal_move(this, terrain, env, 3);
-    }
-
-    void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) override {
-        // 寻找附近的昆虫或小型水生生物
-        for (Organism* org : organisms) {
-            if (dynamic_cast<Insect*>(org) || dynamic_cast<Fish*>(org)) {
-                int dx = abs(x - org->getX());
-                int dy = abs(y - org->getY());
-                if (dx <= 2 && dy <= 2) {
-                    // 捕食
-                    gain_energy(org->getEnergy() * 0.7);
-                    org->lose_energy(org->getEnergy());
-                    save_previous_state("进食");
-                    return;
-                }
-            }
-        }
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce()) {
-            // 检查附近是否有配偶
-            vector<Organism*> nearby = find_nearby_species(organisms, 4);
-            if (nearby.size() > 1) {
-                energy *= 0.5;
-                Amphibian* child = new Amphibian(x + rand() % 2 - 1, y + rand() % 2 - 1);
-                // 遗传变异
-                child->flood_resistance = max(0.7, min(0.9, flood_resistance + (rand() % 11 - 5) * 0.01));
-                save_previous_state("繁殖");
-                return child;
-            }
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override { return "M"; }
-    string getName() const override { return "两栖动物"; }
-
-    bool canInhabit(TerrainType type) const override {
-        return type == WATER || type == MARSH || type == PLAIN || type == FOREST || type == FLOODED;
-    }
-
-    void seasonal_effect(Environment& env) override {
-        // 雨季增加活动
-        if (env.rainfall > 50) {
-            mobility *= 1.2;
-            reproduction_chance *= 1.3;
-        }
-    }
-
-    void weather_effect(Environment& env, Terrain& terrain) override {
-        // 雨天两栖动物更活跃
-        if (env.weather == RAINY) {
-            gain_energy(0.2);
-            reproduction_chance = min(0.5, reproduction_chance * 1.2);
-        }
-        // 干旱对两栖动物不利
-        else if (env.weather == DROUGHT) {
-            lose_energy(1.0);
-        }
-    }
-};
-
-// 食腐动物
-class Scavenger : public Organism {
-public:
-    Scavenger(int x, int y, double energy = 15.0) : Organism(x, y, energy) {
-        max_age = 55;
-        reproduction_threshold = 20.0;
-        reproduction_chance = 0.4;
-        mobility = 1.5;
-        preferred_temp = 22.0;
-        disease_resistance = 75; // 食腐动物抵抗力强
-        flood_resistance = 0.5;
-        drought_resistance = 0.6;
-        base_energy = 0.15;
-    }
-
-    void move(vector<vector<Terrain>>& terrain, Environment& env) override {
-        animal_move(this, terrain, env, 4);
-    }
-
-    void eat(Environment& env, vector<Organism*>& organisms, vector<vector<Terrain>>& terrain) override {
-        // 检查地形是否适合
-        if (!canInhabit(terrain[y][x].type)) {
-            lose_energy(0.8);
-            return;
-        }
-
-        // 寻找附近死亡的生物
-        for (Organism* org : organisms) {
-            if (org->is_dead() && !dynamic_cast<Decomposer*>(org)) {
-                int dx = abs(x - org->getX());
-                int dy = abs(y - org->getY());
-                if (dx <= 3 && dy <= 3) {
-                    // 吃腐肉
-                    gain_energy(org->getEnergy() * 0.7);
-                    org->lose_energy(org->getEnergy());
-
-                    // 可能感染疾病
-                    if (rand() % 100 < 20) {
-                        contract_disease(env.disease);
-                    }
-                    save_previous_state("食腐");
-                    return;
-                }
-            }
-        }
-    }
-
-    Organism* reproduce() override {
-        if (can_reproduce()) {
-            // 检查附近是否有配偶
-            vector<Organism*> nearby = find_nearby_species(organisms, 5);
-            if (nearby.size() > 1) {
-                energy *= 0.5;
-                Scavenger* child = new Scavenger(x + rand() % 3 - 1, y + rand() % 3 - 1);
-                // 遗传变异
-                child->disease_resistance = max(65, min(85, disease_resistance + rand() % 11 - 5));
-                save_previous_state("繁殖");
-                return child;
-            }
-        }
-        return nullptr;
-    }
-
-    string getSymbol() const override { return "S"; }
-    string getName() const override { return "食腐动物"; }
-
-    bool canInhabit(TerrainType type) const override {
-        return type != WATER && type != VOLCANIC && type != FLOODED;
-    }
-};
-
-// 世界模拟器类
-class World {
-private:
-    const int width = 1000;  // 世界宽度
-    const int height = 1000; // 世界高度
-    Environment env;
-    vector<Organism*> organisms;
-    vector<vector<Terrain>> terrain;
-    int day;
-    int season; // 0-春,1-夏,2-秋,3-冬
-    int viewport_x, viewport_y; // 视口位置
-    int viewport_width, viewport_height; // 视口尺寸
-    const int max_days = 730; // 最大模拟天数（两年）
-    int selected_x, selected_y; // 选中的生物位置
-    bool show_history; // 是否显示历史状态
-
-    // 禁止复制和赋值
-    World(const World&) = delete;
-    World& operator=(const World&) = delete;
-
-    // 平滑地图
-    void smooth_map(vector<vector<double>>& map, int iterations = 1) {
-        int h = map.size();
-        int w = map[0].size();
-        vector<vector<double>> new_map(h, vector<double>(w));
-
-        for (int iter = 0; iter < iterations; iter++) {
-            for (int y = 0; y < h; y++) {
-                for (int x = 0; x < w; x++) {
-                    double sum = 0.0;
-                    int count = 0;
-                    for (int dy = -1; dy <= 1; dy++) {
-                        for (int dx = -1; dx <= 1; dx++) {
-                            int nx = x + dx;
-                            int ny = y + dy;
-                            if (nx >= 0 && nx < w && ny >= 0 && ny < h) {
-                                sum += map[ny][nx];
-                                count++;
-                            }
-                        }
-                    }
-                    new_map[y][x] = sum / count;
-                }
-            }
-            map = new_map;
-        }
-    }
-
-    // 生成地形
-    void generate_terrain() {
-        terrain.resize(height, vector<Terrain>(width));
-
-        // 使用分形噪声生成高度图
-        vector<vector<double>> height_map(height, vector<double>(width, 0.0));
-        generate_fractal_noise(height_map, 8, 0.5); // 增加octaves，降低persistence
-
-        // 平滑高度图
-        smooth_map(height_map, 2);
-
-        // 生成湿度图
-        vector<vector<double>> moisture_map(height, vector<double>(width, 0.0));
-        generate_fractal_noise(moisture_map, 8, 0.5);
-
-        // 平滑湿度图
-        smooth_map(moisture_map, 2);
-
-        // 根据高度和湿度设置地形
-        for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-                double h = height_map[y][x];
-                double m = moisture_map[y][x];
-
-                // 计算纬度因子（0-1，0为赤道，1为两极）
-                double lat_factor = 2.0 * abs(y - height / 2.0) / height;
-
-                terrain[y][x].height = h;
-                terrain[y][x].original_height = h; // 保存原始高度
-                terrain[y][x].water_level = m;
-
-                if (h < 0.2) {
-                    terrain[y][x].type = WATER;
-                    terrain[y][x].water_level = 1.0;
-                    terrain[y][x].fertility = 0.3;
-                }
-                else if (h < 0.25) {
-                    terrain[y][x].type = BEACH;
-                    terrain[y][x].water_level = 0.9;
-                    terrain[y][x].fertility = 0.5;
-                }
-                else if (h < 0.3) {
-                    terrain[y][x].type = MARSH;
-                    terrain[y][x].water_level = 0.8;
-                    terrain[y][x].fertility = 0.7;
-                }
-                else if (h < 0.5) {
-                    if (m > 0.7) {
-                        if (lat_factor < 0.3) {
-                            terrain[y][x].type = JUNGLE;
-                        }
-                        else {
-                            terrain[y][x].type = FOREST;
-                        }
-                        terrain[y][x].fertility = 0.9;
-                    }
-                    else if (m > 0.4) {
-                        terrain[y][x].type = PLAIN;
-                        terrain[y][x].fertility = 0.7;
-                    }
-                    else {
-                        terrain[y][x].type = GRASSLAND;
-                        terrain[y][x].fertility = 0.8;
-                    }
-                    terrain[y][x].water_level = m * 0.5;
-                }
-                else if (h < 0.7) {
-                    if (m < 0.3) {
-                        terrain[y][x].type = DESERT;
-                        terrain[y][x].fertility = 0.2;
-                    }
-                    else if (m < 0.6) {
-                        terrain[y][x].type = GRASSLAND;
-                        terrain[y][x].fertility = 0.7;
-                    }
-                    else {
-                        terrain[y][x].type = PLAIN;
-                        terrain[y][x].fertility = 0.6;
-                    }
-                    terrain[y][x].water_level = m * 0.3;
-                }
-                else if (h < 0.9) {
-                    if (lat_factor > 0.6) {
-                        terrain[y][x].type = TUNDRA;
-                        terrain[y][x].fertility = 0.4;
-                    }
-                    else {
-                        terrain[y][x].type = MOUNTAIN;
-                        terrain[y][x].fertility = 0.4;
-                    }
-                    terrain[y][x].water_level = m * 0.2;
-                }
-                else {
-                    if (rand() % 100 < 10) {
-                        terrain[y][x].type = VOLCANIC;
-                        terrain[y][x].fertility = 0.1;
-                    }
-                    else {
-                        terrain[y][x].type = MOUNTAIN;
-                        terrain[y][x].fertility = 0.3;
-                    }
-                    terrain[y][x].water_level = m * 0.1;
-                }
-
-                // 添加雪地（基于高度和纬度）
-                if (h > 0.6 && lat_factor > 0.7) {
-                    terrain[y][x].type = SNOW;
-                }
-            }
-        }
-    }
-
-    // 生成分形噪声
-    void generate_fractal_noise(vector<vector<double>>& map, int octaves, double persistence) {
-        int w = map[0].size();
-        int h = map.size();
-
-        // 基础噪声
-        for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x++) {
-                map[y][x] = static_cast<double>(rand()) / RAND_MAX;
-            }
-        }
-
-        // 多次叠加噪声
-        double amplitude = 1.0;
-        double max_amplitude = 0.0;
-        vector<vector<double>> temp(h, vector<double>(w, 0.0));
-
-        for (int octave = 0; octave < octaves; octave++) {
-            int scale = 1 << octave;
-            double freq = 1.0 / scale;
-
-            for (int y = 0; y < h; y++) {
-                for (int x = 0; x < w; x++) {
-                    int sample_x = (x * scale) % w;
-                    int sample_y = (y * scale) % h;
-
-                    temp[y][x] += map[sample_y][sample_x] * amplitude;
-                }
-            }
-
-            max_amplitude += amplitude;
-            amplitude *= persistence;
-        }
-
-        // 归一化
-        for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x++) {
-                map[y][x] = temp[y][x] / max_amplitude;
-            }
-        }
-    }
-
-    // 季节变化影响
-    void update_season() {
-        // 两年共730天，每季约182.5天
-        env.season_progress = fmod(day / 182.5, 4.0);
-        season = static_cast<int>(env.season_progress) % 4;
-        env.season_progress = fmod(env.season_progress, 1.0); // 当前季节内的进度
-
-        // 季节影响环境
-        switch (season) {
-        case 0: // 春
-            env.temperature = 10.0 + 15.0 * sin(env.season_progress * 3.1416);
-            env.humidity = 70.0;
-            env.daylight_hours = 12.0 + 4.0 * sin(env.season_progress * 3.1416);
-            env.rainfall = 60.0;
-            break;
-        case 1: // 夏
-            env.temperature = 20.0 + 15.0 * sin(env.season_progress * 3.1416);
-            env.humidity = 60.0;
-            env.daylight_hours = 16.0 - 4.0 * sin(env.season_progress * 3.1416);
-            env.rainfall = 30.0;
-            break;
-        case 2: // 秋
-            env.temperature = 10.0 + 10.0 * sin(env.season_progress * 3.1416);
-            env.humidity = 50.0;
-            env.daylight_hours = 12.0 - 4.0 * sin(env.season_progress * 3.1416);
-            env.rainfall = 40.0;
-            break;
-        case 3: // 冬
-            env.temperature = -5.0 + 10.0 * sin(env.season_progress * 3.1416);
-            env.humidity = 40.0;
-            env.daylight_hours = 8.0 + 4.0 * sin(env.season_progress * 3.1416);
-            env.rainfall = 20.0;
-            break;
-        }
-
-        // 温度波动
-        env.temperature += (rand() % 7 - 3);
-
-        // 降雨量波动
-        env.rainfall = max(0.0, min(100.0, env.rainfall + (rand() % 20 - 10)));
-    }
-
-    // 更新天气
-    void update_weather() {
-        // 天气持续时间结束，生成新天气
-        if (--env.weather_duration <= 0) {
-            // 根据季节确定天气概率
-            vector<WeatherType> weather_options;
-            vector<double> weather_probs;
-
-            if (season == 0) { // 春
-                weather_options = { SUNNY, RAINY, CLOUDY, STORMY };
-                weather_probs = { 0.4, 0.3, 0.2, 0.1 };
-            }
-            else if (season == 1) { // 夏
-                weather_options = { SUNNY, CLOUDY, STORMY, DROUGHT };
-                weather_probs = { 0.5, 0.2, 0.2, 0.1 };
-            }
-            else if (season == 2) { // 秋
-                weather_options = { SUNNY, CLOUDY, RAINY };
-                weather_probs = { 0.4, 0.3, 0.3 };
-            }
-            else { // 冬
-                weather_options = { CLOUDY, SNOWY, SUNNY };
-                weather_probs = { 0.5, 0.4, 0.1 };
-            }
-
-            // 选择天气
-            double r = static_cast<double>(rand()) / RAND_MAX;
-            double cumulative = 0.0;
-            for (int i = 0; i < weather_options.size(); i++) {
-                cumulative += weather_probs[i];
-                if (r < cumulative) {
-                    env.weather = weather_options[i];
-                    break;
-                }
-            }
-
-            // 设置天气持续时间 (1-5天)
-            env.weather_duration = 1 + rand() % 5;
-        }
-
-        // 更新连续天气计数
-        if (env.weather == RAINY || env.weather == STORMY) {
-            env.consecutive_rain++;
-            env.consecutive_sunny = 0;
-        }
-        else if (env.weather == SUNNY || env.weather == DROUGHT) {
-            env.consecutive_sunny++;
-            env.consecutive_rain = 0;
-        }
-        else {
-            env.consecutive_rain = 0;
-            env.consecutive_sunny = 0;
-        }
-    }
-
-    // 更新积水、积雪和干旱
-    void update_terrain_hydrology() {
-        for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-                // 降雨增加积水
-                if (env.weather == RAINY) {
-                    terrain[y][x].water_accumulation = min(1.0,
-                        terrain[y][x].water_accumulation + 0.05 * (env.rainfall / 50.0));
-                }
-                // 暴雨大幅增加积水
-                else if (env.weather == STORMY) {
-                    terrain[y][x].water_accumulation = min(1.0,
-                        terrain[y][x].water_accumulation + 0.15 * (env.rainfall / 50.0));
-                }
-                // 晴天减少积水
-                else if (env.weather == SUNNY) {
-                    terrain[y][x].water_accumulation = max(0.0,
-                        terrain[y][x].water_accumulation - 0.03);
-                }
-                // 干旱大幅减少积水
-                else if (env.weather == DROUGHT) {
-                    terrain[y][x].water_accumulation = max(0.0,
-                        terrain[y][x].water_accumulation - 0.08);
-                    terrain[y][x].drought_level = min(1.0,
-                        terrain[y][x].drought_level + 0.05);
-                }
-
-                // 下雪增加积雪
-                if (env.weather == SNOWY && env.temperature < 0) {
-                    terrain[y][x].snow_depth = min(1.0,
-                        terrain[y][x].snow_depth + 0.1);
-                }
-                // 晴天减少积雪
-                else if (env.weather == SUNNY && env.temperature > 0) {
-                    terrain[y][x].snow_depth = max(0.0,
-                        terrain[y][x].snow_depth - 0.05);
-                }
-
-                // 连续晴天增加干旱
-                if (env.consecutive_sunny > 5) {
-                    terrain[y][x].drought_level = min(1.0,
-                        terrain[y][x].drought_level + 0.01 * env.consecutive_sunny);
-                }
-                // 降雨减少干旱
-                if (env.consecutive_rain > 0) {
-                    terrain[y][x].drought_level = max(0.0,
-                        terrain[y][x].drought_level - 0.02 * env.consecutive_rain);
-                }
-
-                // 积水过多形成洪水区
-                if (terrain[y][x].water_accumulation > 0.5 &&
-                    terrain[y][x].type != WATER && terrain[y][x].type != MARSH) {
-                    terrain[y][x].type = FLOODED;
-                }
-                // 积水减少恢复原状
-                else if (terrain[y][x].water_accumulation < 0.2 &&
-                    terrain[y][x].type == FLOODED) {
-                    // 根据原始高度恢复地形
-                    double h = terrain[y][x].original_height;
-                    if (h < 0.2) terrain[y][x].type = WATER;
-                    else if (h < 0.25) terrain[y][x].type = BEACH;
-                    else if (h < 0.3) terrain[y][x].type = MARSH;
-                    else if (h < 0.5) {
-                        if (terrain[y][x].water_level > 0.7) terrain[y][x].type = FOREST;
-                        else terrain[y][x].type = PLAIN;
-                    }
-                    else if (h < 0.7) terrain[y][x].type = GRASSLAND;
-                    else terrain[y][x].type = MOUNTAIN;
-                }
-
-                // 干旱导致水域缩小
-                if (terrain[y][x].type == WATER && terrain[y][x].drought_level > 0.6) {
-                    if (terrain[y][x].height > 0.15) {
-                        terrain[y][x].type = MARSH;
-                    }
-                }
-                else if (terrain[y][x].type == MARSH && terrain[y][x].drought_level > 0.7) {
-                    terrain[y][x].type = PLAIN;
-                }
-            }
-        }
-    }
-
-    // 处理环境灾难
-    void apply_disaster() {
-        if ((double)rand() / RAND_MAX < env.disaster_chance) {
-            cout << "\n!!! 发生环境灾难 !!!\n";
-            int disaster_type = rand() % 5;
-            int casualties = static_cast<int>(organisms.size()) / 5;
-
-            switch (disaster_type) {
-            case 0: // 火灾
-                cout << "森林火灾爆发!\n";
-                for (int i = 0; i < casualties; i++) {
-                    int index = rand() % static_cast<int>(organisms.size());
-                    if (dynamic_cast<Plant*>(organisms[index]) ||
-                        dynamic_cast<Tree*>(organisms[index])) {
-                        delete organisms[index];
-                        organisms.erase(organisms.begin() + index);
-                    }
-                }
-                env.pollution = min(1.0, env.pollution + 0.1);
-                break;
-
-            case 1: // 洪水
-                cout << "洪水泛滥!\n";
-                for (int i = 0; i < casualties; i++) {
-                    int index = rand() % static_cast<int>(organisms.size());
-                    if (!organisms[index]->getIsAquatic()) {
-                        delete organisms[index];
-                        organisms.erase(organisms.begin() + index);
-                    }
-                }
-                env.pollution = min(1.0, env.pollution + 0.05);
-                // 增加水位
-                for (int y = 0; y < height; y++) {
-                    for (int x = 0; x < width; x++) {
-                        terrain[y][x].water_accumulation = min(1.0,
-                            terrain[y][x].water_accumulation + 0.3);
-                    }
-                }
-                break;
-
-            case 2: // 瘟疫
-                cout << "瘟疫蔓延!\n";
-                env.disease = static_cast<DiseaseType>(1 + rand() % 3);
-                env.disease_duration = 30; // 持续30天
-                break;
-
-            case 3: // 火山喷发
-                cout << "火山喷发!\n";
-                for (int i = 0; i < casualties; i++) {
-                    int index = rand() % static_cast<int>(organisms.size());
-                    delete organisms[index];
-                    organisms.erase(organisms.begin() + index);
-                }
-                env.pollution = min(1.0, env.pollution + 0.3);
-                // 增加火山地形
-                for (int i = 0; i < 10; i++) {
-                    int x = rand() % width;
-                    int y = rand() % height;
-                    if (terrain[y][x].height > 0.8) {
-                        terrain[y][x].type = VOLCANIC;
-                    }
-                }
-                break;
-
-            case 4: // 干旱
-                cout << "严重干旱!\n";
-                env.weather = DROUGHT;
-                env.weather_duration = 10;
-                // 增加干旱程度
-                for (int y = 0; y < height; y++) {
-                    for (int x = 0; x < width; x++) {
-                        terrain[y][x].drought_level = min(1.0,
-                            terrain[y][x].drought_level + 0.2);
-                    }
-                }
-                break;
-            }
-        }
-
-        // 处理疾病传播
-        if (env.disease != NONE) {
-            env.disease_duration--;
-            if (env.disease_duration <= 0) {
-                env.disease = NONE;
-            }
-            else {
-                // 随机感染生物
-                for (int i = 0; i < organisms.size() / 20; i++) {
-                    int index = rand() % organisms.size();
-                    organisms[index]->contract_disease(env.disease);
-                }
-            }
-        }
-
-        // 污染自然减少
-        env.pollution = max(0.0, env.pollution - 0.005);
-
-        // 地形自然恢复
-        for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-                terrain[y][x].pollution_level = max(0.0, terrain[y][x].pollution_level - 0.001);
-                terrain[y][x].disease_level = max(0.0, terrain[y][x].disease_level - 0.002);
-
-                // 肥力缓慢恢复
-                if (terrain[y][x].fertility < 0.5) {
-                    terrain[y][x].fertility = min(0.5, terrain[y][x].fertility + 0.0001);
-                }
-            }
-        }
-    }
-
-    // 寄生关系处理
-    void handle_parasites() {
-        for (Organism* org : organisms) {
-            // 寄生生物寻找宿主
-            if (Parasite* parasite = dynamic_cast<Parasite*>(org)) {
-                bool found_host = false;
-                for (Organism* host : organisms) {
-                    if (host != parasite && !dynamic_cast<Parasite*>(host) && !host->is_dead()) {
-                        int dx = abs(parasite->getX() - host->getX());
-                        int dy = abs(parasite->getY() - host->getY());
-                        if (dx <= 1 && dy <= 1) {
-                            // 移动到宿主位置
-                            parasite->lose_energy(0.05); // 移动消耗能量
-                            parasite->gain_energy(0.1);  // 找到宿主获得能量
-                            found_host = true;
-                            break;
-                        }
-                    }
-                }
-
-                // 没找到宿主会死亡
-                if (!found_host) {
-                    parasite->lose_energy(0.5);
-                }
-            }
-        }
-    }
-
-public:
-    World() : day(0), season(0), viewport_x(0), viewport_y(0),
-        viewport_width(40), viewport_height(20), selected_x(-1), selected_y(-1), show_history(false) {
-        srand(static_cast<unsigned int>(time(0)));
-        // 初始化地形
-        generate_terrain();
-        // 初始化随机生物
-        initialize_organisms();
-    }
-
-    ~World() {
-        clear_organisms();
-    }
-
-    // 清空所有生物
-    void clear_organisms() {
-        for (Organism* org : organisms) {
-            delete org;
-        }
-        organisms.clear();
-    }
-
-    // 初始化生物种群
-    void initialize_organisms() {
-        clear_organisms();
-
-        // 植物
-        for (int i = 0; i < 500; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y)) {
-                organisms.push_back(new Plant(x, y));
-            }
-        }
-
-        // 树木
-        for (int i = 0; i < 300; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y)) {
-                organisms.push_back(new Tree(x, y));
-            }
-        }
-
-        // 水生植物
-        for (int i = 0; i < 200; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y) && terrain[y][x].type == WATER) {
-                organisms.push_back(new AquaticPlant(x, y));
-            }
-        }
-
-        // 食草动物
-        for (int i = 0; i < 80; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y)) {
-                organisms.push_back(new Herbivore(x, y));
-            }
-        }
-
-        // 食肉动物
-        for (int i = 0; i < 30; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y)) {
-                organisms.push_back(new Carnivore(x, y));
-            }
-        }
-
-        // 杂食动物
-        for (int i = 0; i < 40; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y)) {
-                organisms.push_back(new Omnivore(x, y));
-            }
-        }
-
-        // 昆虫
-        for (int i = 0; i < 200; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y)) {
-                organisms.push_back(new Insect(x, y));
-            }
-        }
-
-        // 飞行昆虫
-        for (int i = 0; i < 150; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y)) {
-                organisms.push_back(new FlyingInsect(x, y));
-            }
-        }
-
-        // 分解者
-        for (int i = 0; i < 150; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y)) {
-                organisms.push_back(new Decomposer(x, y));
-            }
-        }
-
-        // 顶级掠食者
-        for (int i = 0; i < 10; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y)) {
-                organisms.push_back(new ApexPredator(x, y));
-            }
-        }
-
-        // 寄生生物
-        for (int i = 0; i < 100; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y)) {
-                organisms.push_back(new Parasite(x, y));
-            }
-        }
-
-        // 鱼类
-        for (int i = 0; i < 100; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y) && terrain[y][x].type == WATER) {
-                organisms.push_back(new Fish(x, y));
-            }
-        }
-
-        // 鸟类
-        for (int i = 0; i < 50; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y)) {
-                organisms.push_back(new Bird(x, y));
-            }
-        }
-
-        // 爬行动物
-        for (int i = 0; i < 40; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y)) {
-                organisms.push_back(new Reptile(x, y));
-            }
-        }
-
-        // 两栖动物
-        for (int i = 0; i < 60; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y)) {
-                organisms.push_back(new Amphibian(x, y));
-            }
-        }
-
-        // 食腐动物
-        for (int i = 0; i < 70; i++) {
-            int x = rand() % width;
-            int y = rand() % height;
-            if (can_place_organism(x, y)) {
-                organisms.push_back(new Scavenger(x, y));
-            }
-        }
-    }
-
-    // 检查位置是否可以放置生物
-    bool can_place_organism(int x, int y) {
-        if (x < 0 || y < 0 || x >= width || y >= height)
-            return false;
-
-        // 检查地形是否适合
-        for (Organism* org : organisms) {
-            if (org->getX() == x && org->getY() == y) {
-                return false; // 位置已被占用
-            }
-        }
-
-        return true;
-    }
-
-    // 重置世界
-    void reset() {
-        day = 0;
-        season = 0;
-        env = Environment();
-        generate_terrain();
-        initialize_organisms();
-        selected_x = -1;
-        selected_y = -1;
-        show_history = false;
-    }
-
-    // 模拟一天的变化
-    void simulate_day() {
-        if (day >= max_days) return; // 达到最大天数
-
-        day++;
-
-        // 保存前一天状态
-        for (Organism* org : organisms) {
-            org->save_previous_state("存活");
-        }
-
-        // 更新季节
-        update_season();
-
-        // 更新天气
-        update_weather();
-
-        // 更新地形水文
-        update_terrain_hydrology();
-
-        // 环境灾难
-        apply_disaster();
-
-        // 生物行为
-        vector<Organism*> new_organisms;
-        for (Organism* org : organisms) {
-            if (!org->is_dead()) {
-                // 天气影响
-                org->weather_effect(env, terrain[org->getY()][org->getX()]);
-
-                org->move(terrain, env);
-                org->eat(env, organisms, terrain);
-                org->age_organism(env);
-
-                // 繁殖
-                Organism* child = org->reproduce();
-                if (child) {
-                    new_organisms.push_back(child);
-                }
-            }
-        }
-
-        // 添加新生物
-        for (Organism* org : new_organisms) {
-            organisms.push_back(org);
-        }
-
-        // 处理寄生关系
-        handle_parasites();
-
-        // 移除死亡的生物
-        auto it = remove_if(organisms.begin(), organisms.end(),
-            [](Organism* org) {
-                if (org->is_dead()) {
-                    delete org;
-                    return true;
-                }
-                return false;
-            });
-        organisms.erase(it, organisms.end());
-
-        // 自然演替 - 森林扩张
-        if (day % 30 == 0) {
-            for (int y = 0; y < height; y++) {
-                for (int x = 0; x < width; x++) {
-                    if (terrain[y][x].type == PLAIN && terrain[y][x].fertility > 0.6) {
-                        // 检查周围是否有森林
-                        for (int dy = -1; dy <= 1; dy++) {
-                            for (int dx = -1; dx <= 1; dx++) {
-                                int nx = x + dx;
-                                int ny = y + dy;
-                                if (nx >= 0 && ny >= 0 && nx < width && ny < height) {
-                                    if (terrain[ny][nx].type == FOREST) {
-                                        if (rand() % 100 < 5) {
-                                            terrain[y][x].type = FOREST;
-                                            break;
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-
-    // 显示当前世界状态
-    void display() const {
-        system("cls");
-
-        // 季节名称
-        string seasons[4] = { "春", "夏", "秋", "冬" };
-
-        // 天气名称
-        string weather_names[6] = {
-            "晴天", "雨天", "雪天", "多云", "暴风雨", "干旱"
-        };
-
-        // 天气颜色
-        int weather_colors[6] = {
-            COLOR_DEFAULT, COLOR_RAIN, COLOR_SNOW,
-            COLOR_DEFAULT, COLOR_WARNING, COLOR_DROUGHT
-        };
-
-        // 标题
-        SetColor(COLOR_TITLE);
-        cout << " 生态系统模拟器 - 复杂生物网络 (1000x1000) ";
-        SetColor(COLOR_DEFAULT);
-        cout << endl;
-        cout << "==================================================" << endl;
-
-        // 环境信息
-        SetColor(COLOR_STATS);
-        cout << "天数: " << day << "/730 (" << seasons[season] << "季) | ";
-        cout << "温度: " << fixed << setprecision(1) << env.temperature << "°C | ";
-        cout << "湿度: " << fixed << setprecision(1) << env.humidity << "%" << endl;
-        cout << "降雨: " << fixed << setprecision(1) << env.rainfall << "mm | ";
-        cout << "白天时长: " << fixed << setprecision(1) << env.daylight_hours << "小时 | ";
-        cout << "污染: " << fixed << setprecision(2) << env.pollution * 100 << "%" << endl;
-
-        // 显示天气
-        SetColor(weather_colors[env.weather]);
-        cout << "天气: " << weather_names[env.weather]
-            << " (剩余" << env.weather_duration << "天)";
-        SetColor(COLOR_DEFAULT);
-        cout << endl;
-
-        SetColor(COLOR_DEFAULT);
-
-        // 视口和生物信息
-        SetColor(COLOR_HIGHLIGHTA);
-        cout << "视口位置: (" << viewport_x << "," << viewport_y << ") | ";
-        cout << "生物总数: " << organisms.size() << endl;
-        SetColor(COLOR_DEFAULT);
-
-        // 显示疾病状态
-        if (env.disease != NONE) {
-            SetColor(COLOR_WARNING);
-            string disease_name;
-            switch (env.disease) {
-            case FUNGAL_INFECTION: disease_name = "真菌感染"; break;
-            case VIRAL_OUTBREAK: disease_name = "病毒爆发"; break;
-            case PARASITIC_INFESTATION: disease_name = "寄生虫感染"; break;
-            default: disease_name = "未知疾病";
-            }
-            cout << "当前疫情: " << disease_name << " (剩余" << env.disease_duration << "天)" << endl;
-            SetColor(COLOR_DEFAULT);
-        }
-
-        // 统计种群数量（改为int类型）
-        int plants = 0, trees = 0, aqua_plants = 0, herbs = 0, carns = 0, omnis = 0;
-        int insects = 0, fly_insects = 0, decomps = 0, apexes = 0, paras = 0;
-        int fishes = 0, birds = 0, reptiles = 0, amphibians = 0, scavengers = 0;
-
-        for (const Organism* org : organisms) {
-            if (dynamic_cast<const Plant*>(org)) plants++;
-            if (dynamic_cast<const Tree*>(org)) trees++;
-            if (dynamic_cast<const AquaticPlant*>(org)) aqua_plants++;
-            if (dynamic_cast<const Herbivore*>(org)) herbs++;
-            if (dynamic_cast<const Carnivore*>(org)) carns++;
-            if (dynamic_cast<const Omnivore*>(org)) omnis++;
-            if (dynamic_cast<const Insect*>(org)) insects++;
-            if (dynamic_cast<const FlyingInsect*>(org)) fly_insects++;
-            if (dynamic_cast<const Decomposer*>(org)) decomps++;
-            if (dynamic_cast<const ApexPredator*>(org)) apexes++;
-            if (dynamic_cast<const Parasite*>(org)) paras++;
-            if (dynamic_cast<const Fish*>(org)) fishes++;
-            if (dynamic_cast<const Bird*>(org)) birds++;
-            if (dynamic_cast<const Reptile*>(org)) reptiles++;
-            if (dynamic_cast<const Amphibian*>(org)) amphibians++;
-            if (dynamic_cast<const Scavenger*>(org)) scavengers++;
-        }
-
-        // 植物统计
-        SetColor(COLOR_PLANT);
-        cout << "植物: " << plants << " | 树木: " << trees << " | 水生植物: " << aqua_plants << endl;
-
-        // 动物统计
-        SetColor(COLOR_HERBIVORE);
-        cout << "食草动物: " << herbs << " | ";
-        SetColor(COLOR_CARNIVORE);
-        cout << "食肉动物: " << carns << " | ";
-        SetColor(COLOR_DEFAULT);
-        cout << "杂食动物: " << omnis << endl;
-
-        // 其他生物
-        SetColor(COLOR_DEFAULT);
-        cout << "昆虫: " << insects << " | 飞行昆虫: " << fly_insects << " | 分解者: " << decomps << endl;
-        cout << "顶级掠食者: " << apexes << " | 寄生生物: " << paras << " | 鱼类: " << fishes << endl;
-        cout << "鸟类: " << birds << " | 爬行动物: " << reptiles << " | 两栖动物: " << amphibians << endl;
-        cout << "食腐动物: " << scavengers << endl;
-
-        // 创建视口网格 - 改为存储地形符号和生物符号
-        vector<vector<string>> terrain_grid(viewport_height, vector<string>(viewport_width, " "));
-        vector<vector<string>> organism_grid(viewport_height, vector<string>(viewport_width, " "));
-        vector<vector<bool>> has_organism(viewport_height, vector<bool>(viewport_width, false));
-
-        // 放置地形符号
-        for (int y = 0; y < viewport_height; y++) {
-            for (int x = 0; x < viewport_width; x++) {
-                int world_x = viewport_x + x;
-                int world_y = viewport_y + y;
-
-                if (world_x < width && world_y < height) {
-                    switch (terrain[world_y][world_x].type) {
-                    case WATER:
-                        terrain_grid[y][x] = "~";
-                        break;
-                    case PLAIN:
-                        terrain_grid[y][x] = ".";
-                        break;
-                    case FOREST:
-                        terrain_grid[y][x] = "Y";
-                        break;
-                    case MOUNTAIN:
-                        terrain_grid[y][x] = "^";
-                        break;
-                    case DESERT:
-                        terrain_grid[y][x] = "d";
-                        break;
-                    case MARSH:
-                        terrain_grid[y][x] = "m";
-                        break;
-                    case VOLCANIC:
-                        terrain_grid[y][x] = "V";
-                        break;
-                    case SNOW:
-                        terrain_grid[y][x] = "*";
-                        break;
-                    case GRASSLAND:
-                        terrain_grid[y][x] = ",";
-                        break;
-                    case JUNGLE:
-                        terrain_grid[y][x] = "J";
-                        break;
-                    case TUNDRA:
-                        terrain_grid[y][x] = "T";
-                        break;
-                    case BEACH:
-                        terrain_grid[y][x] = "=";
-                        break;
-                    case FLOODED:
-                        terrain_grid[y][x] = "≈";
-                        break;
-                    }
-                }
-            }
-        }
-
-        // 放置生物符号
-        for (const Organism* org : organisms) {
-            int x = org->getX() - viewport_x;
-            int y = org->getY() - viewport_y;
-
-            if (x >= 0 && y >= 0 && x < viewport_width && y < viewport_height) {
-                organism_grid[y][x] = org->getSymbol();
-                has_organism[y][x] = true;
-            }
-        }
-
-        // 绘制世界 - 使用方格格式
-        for (int y = 0; y < viewport_height; y++) {
-            for (int x = 0; x < viewport_width; x++) {
-                int world_x = viewport_x + x;
-                int world_y = viewport_y + y;
-
-                // 高亮选中的生物
-                if (show_history && selected_x == world_x && selected_y == world_y) {
-                    SetColor(COLOR_HIGHLIGHTA);
-                }
-                else {
-                    // 绘制地形背景
-                    if (world_x < width && world_y < height) {
-                        switch (terrain[world_y][world_x].type) {
-                        case WATER:
-                            SetColor(COLOR_WATER);
-                            break;
-                        case PLAIN:
-                            SetColor(COLOR_PLANT);
-                            break;
-                        case FOREST:
-                            SetColor(COLOR_FOREST);
-                            break;
-                        case MOUNTAIN:
-                            SetColor(COLOR_MOUNTAIN);
-                            break;
-                        case DESERT:
-                            SetColor(COLOR_DESERT);
-                            break;
-                        case MARSH:
-                            SetColor(COLOR_MARSH);
-                            break;
-                        case VOLCANIC:
-                            SetColor(COLOR_VOLCANIC);
-                            break;
-                        case SNOW:
-                            SetColor(COLOR_SNOW);
-                            break;
-                        case GRASSLAND:
-                            SetColor(COLOR_GRASSLAND);
-                            break;
-                        case JUNGLE:
-                            SetColor(COLOR_JUNGLE);
-                            break;
-                        case TUNDRA:
-                            SetColor(COLOR_TUNDRA);
-                            break;
-                        case BEACH:
-                            SetColor(COLOR_BEACH);
-                            break;
-                        case FLOODED:
-                            SetColor(COLOR_RAIN);
-                            break;
-                        }
-                    }
-                    else {
-                        SetColor(COLOR_DEFAULT);
-                    }
-                }
-
-                // 如果有生物，则绘制生物（使用更亮的颜色）
-                if (organism_grid[y][x] != " ") {
-                    // 根据生物类型设置颜色
-                    if (organism_grid[y][x] == "P" || organism_grid[y][x] == "T" || organism_grid[y][x] == "A") {
-                        SetColor(COLOR_PLANT + 8); // 更亮的绿色
-                    }
-                    else if (organism_grid[y][x] == "H") {
-                        SetColor(COLOR_HERBIVORE + 8); // 更亮的黄色
-                    }
-                    else if (organism_grid[y][x] == "C") {
-                        SetColor(COLOR_CARNIVORE + 8); // 更亮的红色
-                    }
-                    else if (organism_grid[y][x] == "X") {
-                        SetColor(COLOR_WARNING + 8); // 更亮的红色
-                    }
-                    else if (organism_grid[y][x] == "~") {
-                        SetColor(COLOR_WATER + 8); // 更亮的蓝色
-                    }
-                    else if (organism_grid[y][x] == "B") {
-                        SetColor(COLOR_STATS + 8); // 更亮的青色
-                    }
-                    else {
-                        SetColor(COLOR_DEFAULT + 8); // 更亮的白色
-                    }
-                    cout << "[" << organism_grid[y][x] << "]";
-                }
-                else {
-                    // 没有生物，只显示地形
-                    cout << " " << terrain_grid[y][x] << " ";
-                }
-            }
-            SetColor(COLOR_DEFAULT);
-            cout << endl;
-        }
-
-        // 显示选中的生物状态
-        if (show_history && selected_x != -1 && selected_y != -1) {
-            bool found = false;
-            for (const Organism* org : organisms) {
-                if (org->getX() == selected_x && org->getY() == selected_y) {
-                    found = true;
-                    SetColor(COLOR_HIGHLIGHTA);
-                    cout << "\n=== 生物状态详情 ===" << endl;
-                    SetColor(COLOR_DEFAULT);
-                    cout << "类型: " << org->getName() << endl;
-                    cout << "位置: (" << selected_x << ", " << selected_y << ")" << endl;
-                    cout << "能量: " << fixed << setprecision(1) << org->getEnergy() << "/" << org->getEnergy() * 2 << endl;
-                    cout << "年龄: " << org->get_previous_state().age << "天" << endl;
-                    cout << "状态: " << org->get_previous_state().status << endl;
-
-                    // 显示前一天状态变化
-                    const auto& prev = org->get_previous_state();
-                    cout << "\n--- 前一天状态变化 ---" << endl;
-                    cout << "位置变化: (" << prev.x << ", " << prev.y << ") -> (" << org->getX() << ", " << org->getY() << ")" << endl;
-                    cout << "能量变化: " << fixed << setprecision(1) << prev.energy << " -> " << org->getEnergy() << endl;
-                    cout << "年龄变化: " << prev.age << " -> " << org->get_previous_state().age + 1 << endl;
-                    break;
-                }
-            }
-            if (!found) {
-                SetColor(COLOR_WARNING);
-                cout << "\n该位置没有存活的生物" << endl;
-                SetColor(COLOR_DEFAULT);
-            }
-        }
-
-        // 图例
-        SetColor(COLOR_STATS);
-        cout << "\n图例: ";
-        SetColor(COLOR_DEFAULT);
-        cout << "P=植物, T=树木, A=水生植物, H=食草动物, C=食肉动物\n";
-        cout << "      O=杂食动物, I=昆虫, F=飞行昆虫, D=分解者, X=顶级掠食者\n"; // 修改顶级掠食者符号为X
-        cout << "      *=寄生生物, ~=鱼类, B=鸟类, R=爬行动物, M=两栖动物\n"; // 修改鸟类符号为B
-
-        // 地形图例
-        SetColor(COLOR_STATS);
-        cout << "地形: ";
-        SetColor(COLOR_PLANT); cout << "."; SetColor(COLOR_DEFAULT); cout << "平原 ";
-        SetColor(COLOR_FOREST); cout << "Y"; SetColor(COLOR_DEFAULT); cout << "森林 ";
-        SetColor(COLOR_GRASSLAND); cout << ","; SetColor(COLOR_DEFAULT); cout << "草原 ";
-        SetColor(COLOR_JUNGLE); cout << "J"; SetColor(COLOR_DEFAULT); cout << "丛林\n";
-        cout << "      ";
-        SetColor(COLOR_MOUNTAIN); cout << "^"; SetColor(COLOR_DEFAULT); cout << "山脉 ";
-        SetColor(COLOR_DESERT); cout << "d"; SetColor(COLOR_DEFAULT); cout << "沙漠 ";
-        SetColor(COLOR_TUNDRA); cout << "T"; SetColor(COLOR_DEFAULT); cout << "苔原 ";
-        SetColor(COLOR_SNOW); cout << "*"; SetColor(COLOR_DEFAULT); cout << "雪地\n";
-        cout << "      ";
-        SetColor(COLOR_WATER); cout << "~"; SetColor(COLOR_DEFAULT); cout << "水域 ";
-        SetColor(COLOR_MARSH); cout << "m"; SetColor(COLOR_DEFAULT); cout << "沼泽 ";
-        SetColor(COLOR_VOLCANIC); cout << "V"; SetColor(COLOR_DEFAULT); cout << "火山 ";
-        SetColor(COLOR_BEACH); cout << "="; SetColor(COLOR_DEFAULT); cout << "海滩 ";
-        SetColor(COLOR_RAIN); cout << "≈"; SetColor(COLOR_DEFAULT); cout << "积水区\n";
-
-        SetColor(COLOR_DEFAULT);
-        cout << "==================================================" << endl;
-    }
-
-    // 调整环境参数
-    void adjust_environment() {
-        SetColor(COLOR_HIGHLIGHTA);
-        cout << "\n调整环境参数:\n";
-        SetColor(COLOR_DEFAULT);
-
-        cout << "1. 温度 (" << env.temperature << "°C): ";
-        cin >> env.temperature;
-        cout << "2. 湿度 (" << env.humidity << "%): ";
-        cin >> env.humidity;
-        cout << "3. 灾难概率 (" << env.disaster_chance * 100 << "%): ";
-        cin >> env.disaster_chance;
-        cout << "4. 污染 (" << env.pollution * 100 << "%): ";
-        cin >> env.pollution;
-        cout << "5. 降雨量 (" << env.rainfall << "mm): ";
-        cin >> env.rainfall;
-    }
-
-    // 移动视口
-    void move_viewport(int dx, int dy) {
-        viewport_x = max(0, min(width - viewport_width, viewport_x + dx));
-        viewport_y = max(0, min(height - viewport_height, viewport_y + dy));
-        show_history = false; // 移动视口时关闭历史显示
-    }
-
-    // 选择生物查看历史
-    void select_organism(int x, int y) {
-        selected_x = viewport_x + x;
-        selected_y = viewport_y + y;
-        show_history = true;
-    }
-
-    // 获取生物数量
-    size_t get_organism_count() const {
-        return organisms.size();
-    }
-
-    // 获取当前天数
-    int get_day() const {
-        return day;
-    }
-};
-
-// 显示欢迎界面
-void display_welcome() {
-    SetColor(COLOR_TITLE);
-    cout << "==================================================" << endl;
-    cout << "        生态系统模拟器 - 复杂生物网络 (中文版)      " << endl;
-    cout << "==================================================" << endl;
-    SetColor(COLOR_DEFAULT);
-
-    cout << "这是一个模拟自然界中复杂生物网络的程序，包含多种生物" << endl;
-    cout << "种群和复杂的生态关系，如食物链、共生和寄生关系。" << endl;
-
-    SetColor(COLOR_STATS);
-    cout << "\n模拟规则:" << endl;
-    SetColor(COLOR_DEFAULT);
-    cout << "- 植物通过光合作用获取能量并繁殖" << endl;
-    cout << "- 食草动物吃植物，食肉动物吃食草动物" << endl;
-    cout << "- 杂食动物既吃植物又吃小动物" << endl;
-    cout << "- 昆虫吃植物和腐肉，分解者分解死亡生物" << endl;
-    cout << "- 顶级掠食者捕食其他动物" << endl;
-    cout << "- 寄生生物依附在其他生物身上获取能量" << endl;
-    cout << "- 环境因素（温度、湿度、污染）影响所有生物" << endl;
-    cout << "- 季节变化影响环境条件" << endl;
-    cout << "- 地形影响生物分布和行为" << endl;
-    cout << "- 天气系统影响环境（晴天、雨天、雪天、暴风雨、干旱）" << endl;
-    cout << "- 积水、积雪和干旱会影响生物的生存和繁衍" << endl;
-
-    SetColor(COLOR_HIGHLIGHTA);
-    cout << "\n本次模拟将持续730天（约两年）" << endl;
-    SetColor(COLOR_STATS);
-    cout << "\n操作说明:" << endl;
-    SetColor(COLOR_DEFAULT);
-    cout << "  S - 模拟一天" << endl;
-    cout << "  A - 调整环境参数" << endl;
-    cout << "  R - 重置模拟" << endl;
-    cout << "  Q - 退出程序" << endl;
-    cout << "  方向键 - 移动视口" << endl;
-    cout << "  C - 选择生物查看状态变化" << endl;
-
-    SetColor(COLOR_TITLE);
-    cout << "==================================================" << endl;
-    SetColor(COLOR_DEFAULT);
-    cout << "按任意键开始模拟..." << endl;
-    _getch();
-}
-
-// 主函数
-int main() {
-    // 设置控制台支持中文
-    SetConsoleToGB2312();
-
-    // 显示欢迎界面
-    display_welcome();
-
-    World world;
-
-    while (true) {
-        world.display();
-
-        // 检查是否达到最大天数
-        if (world.get_day() >= 730) {
-            SetColor(COLOR_HIGHLIGHTA);
-            cout << "\n模拟完成！已到达730天（两年）。" << endl;
-            SetColor(COLOR_DEFAULT);
-            cout << "按任意键退出..." << endl;
-            _getch();
-            break;
-        }
-
-        SetColor(COLOR_STATS);
-        cout << "\n选项: [S]模拟一天  [A]调整环境  [R]重置  [Q]退出  [方向键]移动视口  [C]选择生物\n";
-        SetColor(COLOR_DEFAULT);
-        cout << "请选择操作: ";
-        char choice;
-        choice = _getch();
-
-        if (toupper(choice) == 'Q') break;
-
-        if (toupper(choice) == 'A') {
-            world.adjust_environment();
-        }
-        else if (toupper(choice) == 'R') {
-            // 重置世界
-            world.reset();
-        }
-        else if (toupper(choice) == 'S') {
-            world.simulate_day();
-        }
-        else if (toupper(choice) == 'C') {
-            int sel_x, sel_y;
-            cout << "\n输入要查看的生物坐标 (相对于视口): ";
-            cin >> sel_x >> sel_y;
-            world.select_organism(sel_x, sel_y);
-        }
-        else if (choice == -32) { // 扩展键
-            choice = _getch(); // 获取第二个键值
-            switch (choice) {
-            case 72: world.move_viewport(0, -10); break; // 上
-            case 80: world.move_viewport(0, 10); break;  // 下
-            case 75: world.move_viewport(-10, 0); break; // 左
-            case 77: world.move_viewport(10, 0); break;  // 右
-            }
-        }
-
-        // 如果所有生物灭绝，结束模拟
-        if (world.get_organism_count() == 0) {
-            world.display();
-            SetColor(COLOR_WARNING);
-            cout << "\n所有生物已灭绝，模拟结束!\n";
-            SetColor(COLOR_DEFAULT);
-            break;
-        }
-    }
-
-    SetColor(COLOR_TITLE);
-    cout << "\n感谢使用生态系统模拟器!\n";
-    SetColor(COLOR_DEFAULT);
-    return 0;
+﻿#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+#include <map>
+#ifdef _WIN32
+#include <conio.h>
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <termios.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/select.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <cerrno>
+#endif
+#include <locale>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+#include <set>
+#include <typeinfo>
+#include <iomanip>
+#include <fstream> // 用于保存历史数据
+#include <memory>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <array>
+#include <sstream>
+#include <chrono>
+#include <cstddef> // offsetof
+
+using namespace std;
+
+// 设置控制台编码为GB2312以支持中文
+void SetConsoleToGB2312() {
+#ifdef _WIN32
+    SetConsoleOutputCP(936); // GB2312编码
+    SetConsoleCP(936);
+#endif
+}
+
+#ifndef _WIN32
+// Linux终端下的按键读取（无回显、不等待回车），方向键转换为与Windows相同的扩展键码
+int _getch() {
+    static int pending = -1; // 方向键的第二个键值
+    if (pending >= 0) {
+        int key = pending;
+        pending = -1;
+        return key;
+    }
+
+    termios old_attr, raw_attr;
+    tcgetattr(STDIN_FILENO, &old_attr);
+    raw_attr = old_attr;
+    raw_attr.c_lflag &= ~(ICANON | ECHO);
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw_attr);
+
+    int key = getchar();
+    if (key == 27 && getchar() == '[') {
+        switch (getchar()) {
+        case 'A': pending = 72; break; // 上
+        case 'B': pending = 80; break; // 下
+        case 'D': pending = 75; break; // 左
+        case 'C': pending = 77; break; // 右
+        }
+        key = (pending >= 0) ? -32 : 27;
+    }
+
+    tcsetattr(STDIN_FILENO, TCSANOW, &old_attr);
+    return key;
+}
+
+// 是否有按键等待读取（不阻塞）
+int _kbhit() {
+    termios old_attr, raw_attr;
+    tcgetattr(STDIN_FILENO, &old_attr);
+    raw_attr = old_attr;
+    raw_attr.c_lflag &= ~(ICANON | ECHO);
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw_attr);
+
+    fd_set input;
+    FD_ZERO(&input);
+    FD_SET(STDIN_FILENO, &input);
+    timeval no_wait = { 0, 0 };
+    int ready = select(STDIN_FILENO + 1, &input, nullptr, nullptr, &no_wait);
+
+    tcsetattr(STDIN_FILENO, TCSANOW, &old_attr);
+    return ready > 0;
+}
+#endif
+
+// 清屏
+void clear_screen() {
+#ifdef _WIN32
+    system("cls");
+#else
+    cout << "\033[2J\033[H";
+#endif
+}
+
+// 控制台颜色枚举
+enum ConsoleColors {
+    COLOR_DEFAULT = 7,
+    COLOR_PLANT = 10,
+    COLOR_HERBIVORE = 14,
+    COLOR_CARNIVORE = 12,
+    COLOR_WATER = 9,
+    COLOR_MOUNTAIN = 8,
+    COLOR_DESERT = 6,
+    COLOR_FOREST = 2,
+    COLOR_MARSH = 11,
+    COLOR_VOLCANIC = 4,
+    COLOR_SNOW = 15,
+    COLOR_STATS = 11,
+    COLOR_TITLE = 14,
+    COLOR_WARNING = 12,
+    COLOR_HIGHLIGHTA = 13,
+    COLOR_GRASSLAND = 10,
+    COLOR_JUNGLE = 2,
+    COLOR_TUNDRA = 11,
+    COLOR_BEACH = 6,
+    COLOR_RAIN = 9,
+    COLOR_DROUGHT = 6
+};
+
+// 控制台颜色对应的ANSI转义序列
+// Windows颜色位为 蓝=1 绿=2 红=4 高亮=8，ANSI为 红=1 绿=2 蓝=4
+string ansi_color(int color) {
+    int ansi = ((color & 1) << 2) | (color & 2) | ((color & 4) >> 2);
+    return "\033[" + to_string(((color & 8) ? 90 : 30) + ansi) + "m";
+}
+
+// 设置控制台颜色
+void SetColor(int color) {
+#ifdef _WIN32
+    SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), color);
+#else
+    cout << ansi_color(color);
+#endif
+}
+
+// 天气类型枚举
+enum WeatherType {
+    SUNNY,      // 晴天
+    RAINY,      // 雨天
+    SNOWY,      // 雪天
+    CLOUDY,     // 多云
+    STORMY,     // 暴风雨
+    DROUGHT     // 干旱
+};
+
+// 地形类型枚举
+enum TerrainType {
+    PLAIN,      // 平原
+    FOREST,     // 森林
+    MOUNTAIN,   // 山脉
+    DESERT,     // 沙漠
+    WATER,      // 水域
+    MARSH,      // 沼泽
+    VOLCANIC,   // 火山
+    SNOW,       // 雪地
+    GRASSLAND,  // 草原
+    JUNGLE,     // 丛林
+    TUNDRA,     // 苔原
+    BEACH,      // 海滩
+    FLOODED     // 积水区
+};
+
+// 疾病类型
+enum DiseaseType {
+    NONE,
+    FUNGAL_INFECTION,  // 真菌感染
+    VIRAL_OUTBREAK,    // 病毒爆发
+    PARASITIC_INFESTATION // 寄生虫感染
+};
+
+// 地形结构体
+struct Terrain {
+    TerrainType type;
+    double height;      // 高度
+    double fertility;   // 肥沃度
+    double water_level; // 水位/湿度
+    double pollution_level; // 污染程度
+    double water_accumulation; // 积水深度 (0-1.0)
+    double snow_depth;       // 积雪深度 (0-1.0)
+    double drought_level;    // 干旱程度 (0-1.0)
+    double original_height;  // 原始高度，用于洪水退去后恢复地形
+
+    Terrain() : type(PLAIN), height(0.0), fertility(0.5), water_level(0.5),
+        pollution_level(0.0), water_accumulation(0.0),
+        snow_depth(0.0), drought_level(0.0), original_height(0.0) {
+    }
+
+    bool operator==(const Terrain& other) const {
+        return type == other.type && height == other.height &&
+            fertility == other.fertility && water_level == other.water_level &&
+            pollution_level == other.pollution_level &&
+            water_accumulation == other.water_accumulation && snow_depth == other.snow_depth &&
+            drought_level == other.drought_level && original_height == other.original_height;
+    }
+    bool operator!=(const Terrain& other) const { return !(*this == other); }
+};
+
+// ---- 内存统计 ----
+
+// 按子系统统计堆分配
+enum MemorySubsystem {
+    MEMORY_TERRAIN,   // 地形分块
+    MEMORY_ORGANISMS, // 生物对象
+    MEMORY_SCRATCH,   // 每次调用的临时列表（寻找附近同类等）
+    MEMORY_HISTORY,   // 历史记录的地形分块
+    MEMORY_COUNT
+};
+
+const char* const MEMORY_SUBSYSTEM_NAMES[MEMORY_COUNT] = { "terrain", "organisms", "scratch", "history" };
+
+// 一个子系统的分配计数（各线程并发更新）
+struct AllocationCounter {
+    atomic<long long> allocations;
+    atomic<long long> frees;
+    atomic<long long> bytes;      // 当前占用
+    atomic<long long> peak_bytes; // 占用峰值
+};
+
+AllocationCounter allocation_counters[MEMORY_COUNT];
+
+inline void record_allocation(MemorySubsystem subsystem, size_t bytes) {
+    AllocationCounter& counter = allocation_counters[subsystem];
+    counter.allocations.fetch_add(1, memory_order_relaxed);
+    long long now = counter.bytes.fetch_add(static_cast<long long>(bytes), memory_order_relaxed) + static_cast<long long>(bytes);
+    long long peak = counter.peak_bytes.load(memory_order_relaxed);
+    while (now > peak && !counter.peak_bytes.compare_exchange_weak(peak, now, memory_order_relaxed)) {}
+}
+
+inline void record_free(MemorySubsystem subsystem, size_t bytes) {
+    AllocationCounter& counter = allocation_counters[subsystem];
+    counter.frees.fetch_add(1, memory_order_relaxed);
+    counter.bytes.fetch_sub(static_cast<long long>(bytes), memory_order_relaxed);
+}
+
+// 计入指定子系统的分配器（用于容器和allocate_shared）
+template <class T, MemorySubsystem S>
+struct CountingAllocator {
+    typedef T value_type;
+    template <class U> struct rebind { typedef CountingAllocator<U, S> other; };
+
+    CountingAllocator() {}
+    template <class U> CountingAllocator(const CountingAllocator<U, S>&) {}
+
+    T* allocate(size_t n) {
+        record_allocation(S, n * sizeof(T));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t n) {
+        record_free(S, n * sizeof(T));
+        ::operator delete(p, n * sizeof(T));
+    }
+
+    template <class U> bool operator==(const CountingAllocator<U, S>&) const { return true; }
+    template <class U> bool operator!=(const CountingAllocator<U, S>&) const { return false; }
+};
+
+// 地形分块边长（2的幂，便于用移位计算分块坐标）
+const int TERRAIN_TILE_SHIFT = 6;
+const int TERRAIN_TILE_SIZE = 1 << TERRAIN_TILE_SHIFT; // 64x64格
+const int TERRAIN_TILE_MASK = TERRAIN_TILE_SIZE - 1;
+
+// 地形分块 - 固定大小，由多个地图通过引用计数共享
+struct TerrainTile {
+    Terrain cells[TERRAIN_TILE_SIZE * TERRAIN_TILE_SIZE];
+};
+
+// 基于坐标的确定性哈希（分块可以按任意顺序独立生成）
+inline unsigned int hash_coords(unsigned int seed, int x, int y, int salt) {
+    unsigned int h = seed ^ (static_cast<unsigned int>(x) * 0x27d4eb2dU) ^
+        (static_cast<unsigned int>(y) * 0x165667b1U) ^ (static_cast<unsigned int>(salt) * 0x9e3779b9U);
+    h ^= h >> 15;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+}
+
+// 地形生成器 - 根据坐标和种子生成任意格子的地形
+class TerrainGenerator {
+private:
+    unsigned int seed;
+    int width, height;
+
+    // 晶格值噪声（平滑插值）
+    double value_noise(double fx, double fy, int salt) const {
+        int ix = static_cast<int>(floor(fx));
+        int iy = static_cast<int>(floor(fy));
+        double tx = fx - ix;
+        double ty = fy - iy;
+        tx = tx * tx * (3.0 - 2.0 * tx);
+        ty = ty * ty * (3.0 - 2.0 * ty);
+
+        double v00 = hash_coords(seed, ix, iy, salt) / 4294967296.0;
+        double v10 = hash_coords(seed, ix + 1, iy, salt) / 4294967296.0;
+        double v01 = hash_coords(seed, ix, iy + 1, salt) / 4294967296.0;
+        double v11 = hash_coords(seed, ix + 1, iy + 1, salt) / 4294967296.0;
+
+        double top = v00 + (v10 - v00) * tx;
+        double bottom = v01 + (v11 - v01) * tx;
+        return top + (bottom - top) * ty;
+    }
+
+    // 分形噪声：多个倍频程叠加，结果归一化到0-1
+    double fractal_noise(int x, int y, int octaves, double persistence, double base_period, int salt) const {
+        double amplitude = 1.0;
+        double max_amplitude = 0.0;
+        double period = base_period;
+        double sum = 0.0;
+
+        for (int octave = 0; octave < octaves; octave++) {
+            sum += value_noise(x / period, y / period, salt * 16 + octave) * amplitude;
+            max_amplitude += amplitude;
+            amplitude *= persistence;
+            period = max(1.0, period / 2.0);
+        }
+        return sum / max_amplitude;
+    }
+
+public:
+    TerrainGenerator(unsigned int seed, int width, int height)
+        : seed(seed), width(width), height(height) {
+    }
+
+    // 根据高度和湿度设置地形
+    void generate_cell(int x, int y, Terrain& cell) const {
+        // 计算纬度因子（0-1，0为赤道，1为两极）
+        double lat_factor = 2.0 * abs(y - height / 2.0) / height;
+
+        double h = min(1.0, max(0.0, 0.5 + (fractal_noise(x, y, 8, 0.5, 256.0, 1) - 0.5) * 1.6));
+        double m = fractal_noise(x, y, 8, 0.5, 128.0, 2);
+
+        cell.height = h;
+        cell.original_height = h; // 保存原始高度
+        cell.water_level = m;
+
+        if (h < 0.2) {
+            cell.type = WATER;
+            cell.water_level = 1.0;
+            cell.fertility = 0.3;
+        }
+        else if (h < 0.25) {
+            cell.type = BEACH;
+            cell.water_level = 0.9;
+            cell.fertility = 0.5;
+        }
+        else if (h < 0.3) {
+            cell.type = MARSH;
+            cell.water_level = 0.8;
+            cell.fertility = 0.7;
+        }
+        else if (h < 0.5) {
+            if (m > 0.7) {
+                if (lat_factor < 0.3) {
+                    cell.type = JUNGLE;
+                }
+                else {
+                    cell.type = FOREST;
+                }
+                cell.fertility = 0.9;
+            }
+            else if (m > 0.4) {
+                cell.type = PLAIN;
+                cell.fertility = 0.7;
+            }
+            else {
+                cell.type = GRASSLAND;
+                cell.fertility = 0.8;
+            }
+            cell.water_level = m * 0.5;
+        }
+        else if (h < 0.7) {
+            if (m < 0.3) {
+                cell.type = DESERT;
+                cell.fertility = 0.2;
+            }
+            else if (m < 0.6) {
+                cell.type = GRASSLAND;
+                cell.fertility = 0.7;
+            }
+            else {
+                cell.type = PLAIN;
+                cell.fertility = 0.6;
+            }
+            cell.water_level = m * 0.3;
+        }
+        else if (h < 0.9) {
+            if (lat_factor > 0.6) {
+                cell.type = TUNDRA;
+                cell.fertility = 0.4;
+            }
+            else {
+                cell.type = MOUNTAIN;
+                cell.fertility = 0.4;
+            }
+            cell.water_level = m * 0.2;
+        }
+        else {
+            if (hash_coords(seed, x, y, 3) % 100 < 10) {
+                cell.type = VOLCANIC;
+                cell.fertility = 0.1;
+            }
+            else {
+                cell.type = MOUNTAIN;
+                cell.fertility = 0.3;
+            }
+            cell.water_level = m * 0.1;
+        }
+
+        // 添加雪地（基于高度和纬度）
+        if (h > 0.6 && lat_factor > 0.7) {
+            cell.type = SNOW;
+        }
+    }
+
+    void generate_tile(int tx, int ty, TerrainTile& tile) const {
+        for (int ly = 0; ly < TERRAIN_TILE_SIZE; ly++) {
+            for (int lx = 0; lx < TERRAIN_TILE_SIZE; lx++) {
+                generate_cell((tx << TERRAIN_TILE_SHIFT) + lx, (ty << TERRAIN_TILE_SHIFT) + ly,
+                    tile.cells[(ly << TERRAIN_TILE_SHIFT) + lx]);
+            }
+        }
+    }
+};
+
+// 原始地图 - 生成器和已生成的原始分块，由同一地图的所有副本共享
+struct TerrainSource {
+    shared_ptr<const TerrainGenerator> generator;
+    vector<shared_ptr<TerrainTile>> tiles; // 空指针表示尚未生成
+};
+
+// 分块存储的地形图（写时复制、按需生成）
+// 复制TerrainMap只复制分块指针，多个世界共享同一份原始地图；
+// 只有通过mut()修改某个格子时，才会克隆该格子所在的分块。
+// 分块在第一次被访问时才由生成器生成，未访问的区域不占内存
+class TerrainMap {
+private:
+    int width, height;
+    int tiles_x, tiles_y;
+    mutable vector<shared_ptr<TerrainTile>> tiles; // 空指针表示本地图尚未访问该分块
+    mutable vector<char> resting; // 分块内的格子都已恢复到原始状态（修改后清除）
+    shared_ptr<TerrainSource> source;
+
+    // 格子一天的自然恢复：污染消退，肥力缓慢恢复到原始地图上的值
+    static void recover_cell(Terrain& cell, const Terrain& origin) {
+        cell.pollution_level = max(0.0, cell.pollution_level - 0.001);
+        if (cell.fertility < origin.fertility) {
+            cell.fertility = min(origin.fertility, cell.fertility + 0.0001);
+        }
+    }
+
+    // 格子是否已处于自然恢复的不动点（再恢复也不会改变）
+    static bool cell_resting(const Terrain& cell, const Terrain& origin) {
+        return cell.pollution_level == 0.0 && cell.fertility >= origin.fertility;
+    }
+
+    // 对被修改过的分块内（地图范围内的）格子进行一天的自然恢复，返回是否都已到达不动点；
+    // apply为false时只检查不修改
+    bool recover_tile(int index, TerrainTile& tile, bool apply) const {
+        const TerrainTile& pristine = *source->tiles[index];
+        int x0 = (index % tiles_x) << TERRAIN_TILE_SHIFT;
+        int y0 = (index / tiles_x) << TERRAIN_TILE_SHIFT;
+        int w = min(TERRAIN_TILE_SIZE, width - x0);
+        int h = min(TERRAIN_TILE_SIZE, height - y0);
+        bool all_resting = true;
+        for (int ly = 0; ly < h; ly++) {
+            for (int lx = 0; lx < w; lx++) {
+                int local = (ly << TERRAIN_TILE_SHIFT) + lx;
+                Terrain& cell = tile.cells[local];
+                if (cell_resting(cell, pristine.cells[local])) continue;
+                if (apply) recover_cell(cell, pristine.cells[local]);
+                if (!cell_resting(cell, pristine.cells[local])) all_resting = false;
+            }
+        }
+        return all_resting;
+    }
+
+    // 取得原始分块（必要时生成），所有副本共用同一份。
+    // 原始分块就是自然恢复的不动点，不需要补上已经过去的恢复天数
+    void generate(int index) const {
+        shared_ptr<TerrainTile>& pristine = source->tiles[index];
+        if (!pristine) {
+            pristine = allocate_shared<TerrainTile>(CountingAllocator<TerrainTile, MEMORY_TERRAIN>());
+            source->generator->generate_tile(index % tiles_x, index / tiles_x, *pristine);
+        }
+        tiles[index] = pristine;
+        resting[index] = 1;
+    }
+
+    int tile_index(int x, int y) const {
+        return (y >> TERRAIN_TILE_SHIFT) * tiles_x + (x >> TERRAIN_TILE_SHIFT);
+    }
+    static int cell_index(int x, int y) {
+        return ((y & TERRAIN_TILE_MASK) << TERRAIN_TILE_SHIFT) + (x & TERRAIN_TILE_MASK);
+    }
+
+public:
+    // 只读行视图，保留 terrain[y][x] 的访问写法
+    class RowView {
+        const TerrainMap* map;
+        int y;
+    public:
+        RowView(const TerrainMap* map, int y) : map(map), y(y) {}
+        const Terrain& operator[](int x) const { return map->at(x, y); }
+    };
+
+    TerrainMap() : width(0), height(0), tiles_x(0), tiles_y(0) {}
+
+    // 重新建立为全新的地图（丢弃原有共享关系），所有分块延迟生成
+    void reset(int w, int h, shared_ptr<const TerrainGenerator> gen) {
+        width = w;
+        height = h;
+        tiles_x = (w + TERRAIN_TILE_MASK) >> TERRAIN_TILE_SHIFT;
+        tiles_y = (h + TERRAIN_TILE_MASK) >> TERRAIN_TILE_SHIFT;
+        source = make_shared<TerrainSource>();
+        source->generator = gen;
+        source->tiles.resize(static_cast<size_t>(tiles_x) * tiles_y);
+        tiles.clear();
+        tiles.resize(source->tiles.size());
+        resting.assign(source->tiles.size(), 0);
+    }
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    int get_tiles_x() const { return tiles_x; }
+    int get_tiles_y() const { return tiles_y; }
+
+    const Terrain& at(int x, int y) const {
+        int index = tile_index(x, y);
+        if (!tiles[index]) generate(index);
+        return tiles[index]->cells[cell_index(x, y)];
+    }
+    RowView operator[](int y) const { return RowView(this, y); }
+
+    // 获取可写引用，分块未生成时先生成，被共享时先克隆
+    Terrain& mut(int x, int y) {
+        int index = tile_index(x, y);
+        if (!tiles[index]) generate(index);
+        shared_ptr<TerrainTile>& tile = tiles[index];
+        if (tile.use_count() > 1) {
+            tile = allocate_shared<TerrainTile>(CountingAllocator<TerrainTile, MEMORY_TERRAIN>(), *tile);
+        }
+        resting[index] = 0;
+        return tile->cells[cell_index(x, y)];
+    }
+
+    // 被修改过的分块进行一天的自然恢复
+    // 原始分块和已恢复到原始状态的分块直接跳过，不会被克隆
+    void recover() {
+        for (size_t index = 0; index < tiles.size(); index++) {
+            if (!tiles[index] || resting[index] || tiles[index] == source->tiles[index]) continue;
+            int i = static_cast<int>(index);
+            if (recover_tile(i, *tiles[index], false)) {
+                resting[index] = 1;
+                continue;
+            }
+            if (tiles[index].use_count() > 1) {
+                tiles[index] = allocate_shared<TerrainTile>(CountingAllocator<TerrainTile, MEMORY_TERRAIN>(), *tiles[index]);
+            }
+            resting[index] = recover_tile(i, *tiles[index], true);
+        }
+    }
+
+    // 只有值真正改变时才写入，避免无谓地克隆共享分块
+    void set(int x, int y, const Terrain& cell) {
+        if (at(x, y) != cell) {
+            mut(x, y) = cell;
+        }
+    }
+
+    // 读取格子但不生成分块（未生成时直接由生成器计算原始值）
+    Terrain peek(int x, int y) const {
+        int index = tile_index(x, y);
+        if (tiles[index]) return tiles[index]->cells[cell_index(x, y)];
+        Terrain cell;
+        source->generator->generate_cell(x, y, cell);
+        return cell;
+    }
+
+    // 该格子所在分块是否已与原始地图分叉（被本地图修改过）
+    // 按指针比较而不是引用计数：导出快照等副本持有分块时结果不变
+    bool is_diverged(int x, int y) const {
+        int index = tile_index(x, y);
+        return tiles[index] && tiles[index] != source->tiles[index];
+    }
+
+    // 该格子所在分块是否已被本地图访问（生成）
+    bool is_generated(int x, int y) const {
+        return tiles[tile_index(x, y)] != nullptr;
+    }
+
+    // 预先生成一个矩形区域覆盖的分块
+    void ensure_generated(int x0, int y0, int x1, int y1) const {
+        x0 = max(0, x0); y0 = max(0, y0);
+        x1 = min(width - 1, x1); y1 = min(height - 1, y1);
+        for (int ty = y0 >> TERRAIN_TILE_SHIFT; ty <= (y1 >> TERRAIN_TILE_SHIFT); ty++) {
+            for (int tx = x0 >> TERRAIN_TILE_SHIFT; tx <= (x1 >> TERRAIN_TILE_SHIFT); tx++) {
+                int index = ty * tiles_x + tx;
+                if (!tiles[index]) generate(index);
+            }
+        }
+    }
+
+    size_t tile_count() const { return tiles.size(); }
+
+    size_t generated_tile_count() const {
+        size_t count = 0;
+        for (const auto& tile : tiles) {
+            if (tile) count++;
+        }
+        return count;
+    }
+
+    // 本地图修改过的分块数量（即本次运行相对原始地图实际产生的地形内存）
+    size_t owned_tile_count() const {
+        size_t count = 0;
+        for (size_t index = 0; index < tiles.size(); index++) {
+            if (tiles[index] && tiles[index] != source->tiles[index]) count++;
+        }
+        return count;
+    }
+
+    size_t owned_bytes() const {
+        return owned_tile_count() * sizeof(TerrainTile);
+    }
+};
+
+// 地表径流参数
+const double RUNOFF_RAINY = 0.05;    // 降雨时每格每天产生的径流（按降水50mm计）
+const double RUNOFF_STORMY = 0.15;   // 暴雨时每格每天产生的径流（按降水50mm计）
+const double RUNOFF_RETENTION = 0.3; // 坡面上每格留住的来水比例，其余流向下游
+const double FLOOD_SURGE = 0.3;      // 洪水灾害时每格注入的水量
+
+// 地表水汇流
+// 按高度用优先队列填洼（priority-flood）求出每格的下游格（D8，八邻域），填洼后被抬高的格子
+// 就是洼地。每天把各格的径流按拓扑顺序（上游在前）一次扫描汇向下游：洼地留住全部来水直到积满，
+// 坡面只留住一部分，所以水会积在山谷和洼地里。水体、地图边缘和未生成区域的边界是出口。
+// 流向只取决于高度和水体的分布，只有格子的高度或水体类型改变（以及生成了新的分块）时才需要更新，
+// 并且只在这些分块内重新填洼（新生成的分块连同相邻的分块：它们原来以未生成区域的边界为出口），
+// 区域外相邻的一圈格子保留原来的填洼高度作为起点，边界上的填洼高度不再成立时才把相邻的分块并入区域。
+// 每格按(填洼高度, 在同一水面上离溢出点的步数)排序，下游格总是排在前面，
+// 所以区域内重新求出的顺序可以直接与区域外原有的顺序归并
+class WaterRouting {
+private:
+    int width, height;
+    int tiles_x;
+    vector<int> tile_block;     // 分块 -> 数据块编号（-1表示该分块尚未建立流向）
+    vector<int> block_tile;     // 数据块编号 -> 分块
+    vector<float> filled;       // 填洼后的高度
+    vector<int> depth;          // 在同一填洼水面上离溢出点的步数
+    vector<int> receiver;       // 下游格编号（-1表示出口）
+    vector<int> order;          // 按(填洼高度, 步数)排序，下游在前（扫描时倒序）
+    vector<int> rank;           // 格子在order中的位置（order改变后重新计算）
+    vector<float> flow;         // 当天的径流，汇流后为每格留住的水量
+    vector<int> wet;            // 当天有径流或来水的格子（汇流只处理这些格子）
+    vector<char> is_wet;
+    vector<float> room;         // 整体扫描时每格还能留住的水量（负数表示水体）
+    vector<char> hollow;        // 整体扫描时每格是否为洼地
+    bool swept;                 // 当天整体扫描过（wet不完整，下次需要全部清空）
+    vector<int> region_slot;    // 分块在本次重新填洼区域中的序号（-1表示不在区域内）
+    vector<int> changed_tiles;  // 有格子的高度或水体类型改变的分块
+    vector<char> tile_changed;
+    bool stale;                 // 需要全部重新建立（重置后或有分块被丢弃）
+    size_t depressions;         // 被填洼抬高的格子数（流向更新时重新统计）
+
+    static const int BLOCK_CELLS = TERRAIN_TILE_SIZE * TERRAIN_TILE_SIZE;
+
+    int cell_id(int x, int y) const {
+        int block = tile_block[(y >> TERRAIN_TILE_SHIFT) * tiles_x + (x >> TERRAIN_TILE_SHIFT)];
+        if (block < 0) return -1;
+        return block * BLOCK_CELLS + ((y & TERRAIN_TILE_MASK) << TERRAIN_TILE_SHIFT) + (x & TERRAIN_TILE_MASK);
+    }
+    void cell_coords(int id, int& x, int& y) const {
+        int tile = block_tile[id / BLOCK_CELLS];
+        int local = id % BLOCK_CELLS;
+        x = ((tile % tiles_x) << TERRAIN_TILE_SHIFT) + (local & TERRAIN_TILE_MASK);
+        y = ((tile / tiles_x) << TERRAIN_TILE_SHIFT) + (local >> TERRAIN_TILE_SHIFT);
+    }
+    int cell_slot(int id) const {
+        return region_slot[block_tile[id / BLOCK_CELLS]];
+    }
+
+    // a是否排在b的下游
+    bool downstream(int a, int b) const {
+        return filled[a] < filled[b] || (filled[a] == filled[b] && depth[a] < depth[b]);
+    }
+
+    void add_block(int tile) {
+        tile_block[tile] = static_cast<int>(block_tile.size());
+        block_tile.push_back(tile);
+        size_t cells = block_tile.size() * BLOCK_CELLS;
+        filled.resize(cells, 0.0f);
+        depth.resize(cells, 0);
+        receiver.resize(cells, -1);
+    }
+
+    // 在区域（一组分块）内重新填洼：区域内的出口，以及区域外相邻、且不流入区域的格子
+    // （保留原来的填洼高度）作为起点，按填洼高度由低到高向内扩展，
+    // 不高于当前水面的邻格（洼地和平地）放入先进先出队列优先处理，不必进入优先队列。
+    // 区域内有格子没有被访问到、区域外流入区域的格子不再排在其下游格之后，
+    // 或区域外洼地中的格子的水面应随区域内的水面改变时返回false，grow中给出需要并入区域的分块
+    bool flood_region(const TerrainMap& terrain, const vector<int>& region, vector<int>& sequence, vector<int>& grow) {
+        sequence.clear();
+        grow.clear();
+        vector<char> visited(region.size() * BLOCK_CELLS, 0);
+        vector<int> donors; // 区域外流入区域的格子
+        vector<int> seeds;  // 区域外的起点
+
+        typedef pair<float, int> Entry;
+        priority_queue<Entry, vector<Entry>, greater<Entry>> open;
+        queue<int> pit;
+        for (size_t r = 0; r < region.size(); r++) {
+            int x0 = (region[r] % tiles_x) << TERRAIN_TILE_SHIFT, y0 = (region[r] / tiles_x) << TERRAIN_TILE_SHIFT;
+            for (int local = 0; local < BLOCK_CELLS; local++) {
+                int x = x0 + (local & TERRAIN_TILE_MASK), y = y0 + (local >> TERRAIN_TILE_SHIFT);
+                if (x >= width || y >= height) {
+                    visited[r * BLOCK_CELLS + local] = 1; // 地图之外的部分分块
+                    continue;
+                }
+                const Terrain& cell = terrain.at(x, y);
+                bool outlet = cell.type == WATER;
+                for (int d = 0; d < 8; d++) {
+                    int nx = x + DX8[d], ny = y + DY8[d];
+                    int next = nx < 0 || ny < 0 || nx >= width || ny >= height ? -1 : cell_id(nx, ny);
+                    if (next < 0) {
+                        outlet = true;
+                    }
+                    else if (cell_slot(next) < 0) {
+                        if (receiver[next] >= 0 && cell_slot(receiver[next]) >= 0) donors.push_back(next);
+                        else {
+                            open.push(Entry(filled[next], next)); // 区域外的起点（可能重复加入，只是多扩展一次）
+                            seeds.push_back(next);
+                        }
+                    }
+                }
+                if (outlet) {
+                    int id = cell_id(x, y);
+                    visited[r * BLOCK_CELLS + local] = 1;
+                    filled[id] = static_cast<float>(cell.height);
+                    depth[id] = 0;
+                    receiver[id] = -1;
+                    open.push(Entry(filled[id], id));
+                }
+            }
+        }
+
+        while (!open.empty() || !pit.empty()) {
+            int id;
+            if (!pit.empty()) {
+                id = pit.front();
+                pit.pop();
+            }
+            else {
+                id = open.top().second;
+                open.pop();
+            }
+            if (cell_slot(id) >= 0) sequence.push_back(id);
+            int x, y;
+            cell_coords(id, x, y);
+            for (int d = 0; d < 8; d++) {
+                int nx = x + DX8[d], ny = y + DY8[d];
+                if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+                int next = cell_id(nx, ny);
+                if (next < 0) continue;
+                int slot = cell_slot(next);
+                if (slot < 0 || visited[slot * BLOCK_CELLS + next % BLOCK_CELLS]) continue;
+                visited[slot * BLOCK_CELLS + next % BLOCK_CELLS] = 1;
+                receiver[next] = id;
+                float h = static_cast<float>(terrain.at(nx, ny).height);
+                if (h <= filled[id]) {
+                    filled[next] = filled[id];
+                    depth[next] = depth[id] + 1;
+                    pit.push(next);
+                }
+                else {
+                    filled[next] = h;
+                    depth[next] = 0;
+                    open.push(Entry(h, next));
+                }
+            }
+        }
+
+        // 区域内有格子无路可出：区域外围的分块一起重新填洼
+        if (find(visited.begin(), visited.end(), 0) != visited.end()) {
+            for (int tile : region) {
+                int tx = tile % tiles_x, ty = tile / tiles_x;
+                for (int d = 0; d < 8; d++) {
+                    int nx = tx + DX8[d], ny = ty + DY8[d];
+                    if (nx < 0 || ny < 0 || nx >= tiles_x || ny * tiles_x + nx >= static_cast<int>(tile_block.size())) continue;
+                    int neighbor = ny * tiles_x + nx;
+                    if (tile_block[neighbor] >= 0 && region_slot[neighbor] < 0) grow.push_back(neighbor);
+                }
+            }
+            return false;
+        }
+        // 流入区域的格子的水面被抬高（或溢出点移动）：所在分块一起重新填洼。
+        // 另外相邻两格的填洼高度总满足 filled[b] <= max(height[b], filled[a])，区域边界上不满足时
+        // （区域外洼地的水面应随区域内的水面降低，或区域内的格子本可以经流入区域的格子流出），
+        // 区域外的那一格所在分块也一起重新填洼，所以填洼高度与全部重新建立时相同
+        auto settled = [&](int id) {
+            int x, y;
+            cell_coords(id, x, y);
+            float h = static_cast<float>(terrain.at(x, y).height);
+            for (int d = 0; d < 8; d++) {
+                int nx = x + DX8[d], ny = y + DY8[d];
+                if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+                int next = cell_id(nx, ny);
+                if (next < 0 || cell_slot(next) < 0) continue;
+                if (filled[id] > max(h, filled[next])) return false;
+                if (filled[next] > max(static_cast<float>(terrain.at(nx, ny).height), filled[id])) return false;
+            }
+            return true;
+        };
+        for (int donor : donors) {
+            if (!downstream(receiver[donor], donor) || !settled(donor)) grow.push_back(block_tile[donor / BLOCK_CELLS]);
+        }
+        for (int seed : seeds) {
+            if (!settled(seed)) grow.push_back(block_tile[seed / BLOCK_CELLS]);
+        }
+        return grow.empty();
+    }
+
+    // 重新填洼新生成的分块（及其相邻分块）和被修改的分块，把结果归并到原有的顺序中
+    void update(const TerrainMap& terrain, const vector<int>& added, const vector<int>& changed) {
+        vector<int> region;
+        auto include = [&](int tile) {
+            if (tile_block[tile] < 0 || region_slot[tile] >= 0) return;
+            region_slot[tile] = static_cast<int>(region.size());
+            region.push_back(tile);
+        };
+        int tiles_y = static_cast<int>(tile_block.size()) / tiles_x;
+        for (int tile : added) {
+            int tx = tile % tiles_x, ty = tile / tiles_x;
+            include(tile);
+            for (int d = 0; d < 8; d++) {
+                int nx = tx + DX8[d], ny = ty + DY8[d];
+                if (nx >= 0 && ny >= 0 && nx < tiles_x && ny < tiles_y) include(ny * tiles_x + nx);
+            }
+        }
+        for (int tile : changed) include(tile);
+
+        vector<int> sequence, grow;
+        // 区域扩展到没有可并入的分块为止（此时区域的边界全是出口，不会再失败）
+        while (!flood_region(terrain, region, sequence, grow) && !grow.empty()) {
+            for (int tile : grow) include(tile);
+        }
+
+        // 同一键值的格子之间没有上下游关系，排序后按二分查找插入区域外原有的顺序
+        // （区域通常远小于整个地图，只比较区域内的格子，其余部分整段复制）
+        auto less = [this](int a, int b) { return downstream(a, b); };
+        stable_sort(sequence.begin(), sequence.end(), less);
+        order.erase(remove_if(order.begin(), order.end(), [this](int id) { return cell_slot(id) >= 0; }), order.end());
+        vector<int> merged;
+        merged.reserve(order.size() + sequence.size());
+        auto copied = order.begin();
+        for (int id : sequence) {
+            auto position = upper_bound(copied, order.end(), id, less);
+            merged.insert(merged.end(), copied, position);
+            merged.push_back(id);
+            copied = position;
+        }
+        merged.insert(merged.end(), copied, order.end());
+        order.swap(merged);
+        rank.clear();
+
+        for (int tile : region) region_slot[tile] = -1;
+
+        // 洼地面积只在流向更新时重新统计（归并已经遍历了全部格子），显示时直接读取
+        depressions = 0;
+        for (int id : order) {
+            int x, y;
+            cell_coords(id, x, y);
+            if (filled[id] > static_cast<float>(terrain.at(x, y).height)) depressions++;
+        }
+    }
+
+    // 全部重新建立：数据块按分块顺序重新编号，所有已生成的分块都重新填洼
+    void rebuild(const TerrainMap& terrain) {
+        tile_block.assign(tile_block.size(), -1);
+        block_tile.clear();
+        filled.clear();
+        depth.clear();
+        receiver.clear();
+        order.clear();
+        flow.clear();
+        wet.clear();
+        is_wet.clear();
+        vector<int> tiles;
+        for (size_t t = 0; t < tile_block.size(); t++) {
+            int tx = static_cast<int>(t) % tiles_x, ty = static_cast<int>(t) / tiles_x;
+            if (terrain.is_generated(tx << TERRAIN_TILE_SHIFT, ty << TERRAIN_TILE_SHIFT)) {
+                add_block(static_cast<int>(t));
+                tiles.push_back(static_cast<int>(t));
+            }
+        }
+        update(terrain, tiles, vector<int>());
+        stale = false;
+    }
+
+public:
+    static const int DX8[8];
+    static const int DY8[8];
+
+    WaterRouting() : width(0), height(0), tiles_x(0), swept(false), stale(true), depressions(0) {}
+
+    void reset(int w, int h) {
+        width = w;
+        height = h;
+        tiles_x = (w + TERRAIN_TILE_MASK) >> TERRAIN_TILE_SHIFT;
+        int tiles_y = (h + TERRAIN_TILE_MASK) >> TERRAIN_TILE_SHIFT;
+        tile_block.assign(static_cast<size_t>(tiles_x) * tiles_y, -1);
+        region_slot.assign(tile_block.size(), -1);
+        tile_changed.assign(tile_block.size(), 0);
+        changed_tiles.clear();
+        block_tile.clear();
+        filled.clear();
+        depth.clear();
+        receiver.clear();
+        order.clear();
+        rank.clear();
+        flow.clear();
+        wet.clear();
+        is_wet.clear();
+        stale = true;
+        depressions = 0;
+    }
+
+    // 格子被修改时调用：高度或水体类型改变会使所在分块的流向失效
+    void note_change(int x, int y, const Terrain& before, const Terrain& after) {
+        if (before.height != after.height || (before.type == WATER) != (after.type == WATER)) {
+            int tile = (y >> TERRAIN_TILE_SHIFT) * tiles_x + (x >> TERRAIN_TILE_SHIFT);
+            if (!tile_changed[tile]) {
+                tile_changed[tile] = 1;
+                changed_tiles.push_back(tile);
+            }
+        }
+    }
+
+    // 开始一次汇流：有分块被丢弃时全部重新建立，新生成或被修改的分块及其相邻分块重新填洼，并清空径流
+    void begin(const TerrainMap& terrain) {
+        vector<int> tiles;
+        for (size_t t = 0; t < tile_block.size() && !stale; t++) {
+            int tx = static_cast<int>(t) % tiles_x, ty = static_cast<int>(t) / tiles_x;
+            bool generated = terrain.is_generated(tx << TERRAIN_TILE_SHIFT, ty << TERRAIN_TILE_SHIFT);
+            if (tile_block[t] >= 0 && !generated) stale = true;
+            else if (tile_block[t] < 0 && generated) tiles.push_back(static_cast<int>(t));
+        }
+        if (stale) {
+            rebuild(terrain);
+        }
+        else if (!tiles.empty() || !changed_tiles.empty()) {
+            for (int tile : tiles) add_block(tile);
+            update(terrain, tiles, changed_tiles);
+        }
+        for (int tile : changed_tiles) tile_changed[tile] = 0;
+        changed_tiles.clear();
+
+        // 只清空前一天有水的格子
+        if (swept) {
+            flow.assign(flow.size(), 0.0f);
+            is_wet.assign(is_wet.size(), 0);
+            swept = false;
+        }
+        else {
+            for (int id : wet) {
+                flow[id] = 0.0f;
+                is_wet[id] = 0;
+            }
+        }
+        wet.clear();
+        flow.resize(filled.size(), 0.0f);
+        is_wet.resize(filled.size(), 0);
+        if (rank.empty()) {
+            rank.resize(filled.size());
+            for (size_t k = 0; k < order.size(); k++) rank[order[k]] = static_cast<int>(k);
+        }
+    }
+
+    void add_runoff(int x, int y, double amount) {
+        int id = cell_id(x, y);
+        if (id < 0) return;
+        if (!is_wet[id]) {
+            is_wet[id] = 1;
+            wet.push_back(id);
+        }
+        flow[id] += static_cast<float>(amount);
+    }
+
+    // 格子还能留住的水量，水体返回负数；洼地（被填洼抬高的格子）另外标出
+    float capacity(const Terrain& cell, int id, bool& hollow) const {
+        hollow = filled[id] > static_cast<float>(cell.height);
+        if (cell.type == WATER) return -1.0f;
+        return static_cast<float>(max(0.0, 1.0 - cell.water_accumulation));
+    }
+
+    // 一格的来水：留住一部分（洼地全部留住直到积满），其余流向下游
+    void drain(int id, float space, bool hollow) {
+        float inflow = flow[id];
+        float kept = 0.0f;
+        if (space >= 0.0f) {
+            kept = min(space, hollow ? inflow : inflow * static_cast<float>(RUNOFF_RETENTION));
+        }
+        if (receiver[id] >= 0) {
+            flow[receiver[id]] += inflow - kept;
+        }
+        flow[id] = kept;
+    }
+
+    // 按拓扑顺序汇流，之后retained()返回每格留住的水量。
+    // 没有水的格子对下游没有影响，所以只处理有径流的格子及其下游：按在order中的位置从大到小
+    // （上游在前）依次取出，下游格在第一次来水时加入，结果与整体扫描相同。
+    // 大范围降雨（有径流的格子超过八分之一）时整体倒序扫描一遍更快
+    void route(const TerrainMap& terrain) {
+        if (wet.size() * 8 > order.size()) {
+            // 先按地形的存储顺序取出各格的容量，倒序扫描时不再随机访问地形
+            room.resize(filled.size());
+            hollow.resize(filled.size());
+            for (size_t block = 0; block < block_tile.size(); block++) {
+                int x0 = (block_tile[block] % tiles_x) << TERRAIN_TILE_SHIFT;
+                int y0 = (block_tile[block] / tiles_x) << TERRAIN_TILE_SHIFT;
+                for (int local = 0; local < BLOCK_CELLS; local++) {
+                    int x = x0 + (local & TERRAIN_TILE_MASK), y = y0 + (local >> TERRAIN_TILE_SHIFT);
+                    if (x >= width || y >= height) continue;
+                    int id = static_cast<int>(block) * BLOCK_CELLS + local;
+                    bool low;
+                    room[id] = capacity(terrain.at(x, y), id, low);
+                    hollow[id] = low;
+                }
+            }
+            for (size_t k = order.size(); k-- > 0;) drain(order[k], room[order[k]], hollow[order[k]] != 0);
+            swept = true;
+            return;
+        }
+        priority_queue<pair<int, int>> pending; // (在order中的位置, 格子)
+        for (int id : wet) pending.push(make_pair(rank[id], id));
+        while (!pending.empty()) {
+            int id = pending.top().second;
+            pending.pop();
+            int x, y;
+            cell_coords(id, x, y);
+            bool low;
+            float space = capacity(terrain.at(x, y), id, low);
+            drain(id, space, low);
+            int down = receiver[id];
+            if (down >= 0 && !is_wet[down]) {
+                is_wet[down] = 1;
+                wet.push_back(down);
+                pending.push(make_pair(rank[down], down));
+            }
+        }
+    }
+
+    double retained(int x, int y) const {
+        int id = cell_id(x, y);
+        return id >= 0 ? flow[id] : 0.0;
+    }
+
+    // 标出汇流后有格子留住了水的分块
+    void mark_wet_tiles(vector<char>& tiles) const {
+        auto mark = [&](size_t id) {
+            if (flow[id] > 0.0f) tiles[block_tile[id / BLOCK_CELLS]] = 1;
+        };
+        if (swept) {
+            for (size_t id = 0; id < flow.size(); id++) mark(id);
+        }
+        else {
+            for (int id : wet) mark(id);
+        }
+    }
+
+    // 被填洼抬高的格子数（洼地面积，截至上次流向更新）
+    size_t depression_cells() const { return depressions; }
+
+    size_t memory_bytes() const {
+        return (tile_block.capacity() + block_tile.capacity() + depth.capacity() + receiver.capacity() +
+            order.capacity() + rank.capacity() + wet.capacity() + region_slot.capacity() + changed_tiles.capacity()) * sizeof(int) +
+            (filled.capacity() + flow.capacity() + room.capacity()) * sizeof(float) +
+            tile_changed.capacity() + is_wet.capacity() + hollow.capacity();
+    }
+};
+
+const int WaterRouting::DX8[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+const int WaterRouting::DY8[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+
+// 环境参数结构体
+struct Environment {
+    double temperature;    // 温度 (-20-50)
+    double humidity;       // 湿度 (0-100)
+    double disaster_chance;// 灾难概率 (0-0.1)
+    double pollution;      // 污染程度 (0-1.0)
+    double season_progress;// 季节进度 (0-1)
+    double rainfall;       // 降雨量 (0-100)
+    double daylight_hours; // 白天时长 (0-24)
+    DiseaseType disease;   // 当前流行疾病
+    int disease_duration;  // 疾病持续时间
+    WeatherType weather;   // 当前天气
+    int weather_duration;  // 天气持续时间
+    int consecutive_rain;  // 连续降雨天数
+    int consecutive_sunny; // 连续晴天天数
+
+    Environment() : temperature(25.0), humidity(50.0),
+        disaster_chance(0.01), pollution(0.1), season_progress(0.0),
+        rainfall(0.0), daylight_hours(12.0), disease(NONE), disease_duration(0),
+        weather(SUNNY), weather_duration(1), consecutive_rain(0), consecutive_sunny(0) {
+    }
+};
+
+// 前向声明所有生物类
+class Plant;
+class Herbivore;
+class Carnivore;
+class Omnivore;
+class Insect;
+class Decomposer;
+class ApexPredator;
+class Parasite;
+class Fish;
+class Bird;
+class Reptile;
+class Amphibian;
+class Scavenger;
+
+// 物种编号（用于跨进程传输、统计等需要按物种索引的场合）
+enum SpeciesType {
+    SPECIES_PLANT,
+    SPECIES_TREE,
+    SPECIES_AQUATIC_PLANT,
+    SPECIES_INSECT,
+    SPECIES_FLYING_INSECT,
+    SPECIES_HERBIVORE,
+    SPECIES_FISH,
+    SPECIES_BIRD,
+    SPECIES_DECOMPOSER,
+    SPECIES_OMNIVORE,
+    SPECIES_CARNIVORE,
+    SPECIES_APEX_PREDATOR,
+    SPECIES_PARASITE,
+    SPECIES_REPTILE,
+    SPECIES_AMPHIBIAN,
+    SPECIES_SCAVENGER,
+    SPECIES_COUNT
+};
+
+// 物种名称（按物种编号索引）
+const char* const SPECIES_NAMES[SPECIES_COUNT] = {
+    "植物", "树木", "水生植物", "昆虫", "飞行昆虫", "食草动物", "鱼类", "鸟类",
+    "分解者", "杂食动物", "食肉动物", "顶级掠食者", "寄生生物", "爬行动物", "两栖动物", "食腐动物"
+};
+
+// 物种位掩码
+constexpr unsigned int species_bit(int species) { return 1u << species; }
+
+const unsigned int PLANT_SPECIES = species_bit(SPECIES_PLANT) | species_bit(SPECIES_TREE) | species_bit(SPECIES_AQUATIC_PLANT);
+const unsigned int INSECT_SPECIES = species_bit(SPECIES_INSECT) | species_bit(SPECIES_FLYING_INSECT);
+
+// 各物种的食物（物种位掩码，0表示以死亡个体为食）
+// 个体的forage()和密度模型都按此表判断食物，子类算作父类的食物（如树木和水生植物也是植物）
+const unsigned int SPECIES_DIET[SPECIES_COUNT] = {
+    0, 0, 0,                                                                   // 植物 树木 水生植物
+    PLANT_SPECIES & ~species_bit(SPECIES_TREE),                                // 昆虫
+    PLANT_SPECIES | INSECT_SPECIES,                                            // 飞行昆虫
+    PLANT_SPECIES & ~species_bit(SPECIES_TREE),                                // 食草动物
+    species_bit(SPECIES_AQUATIC_PLANT) | INSECT_SPECIES,                       // 鱼类（只吃水中的）
+    INSECT_SPECIES | species_bit(SPECIES_FISH),                                // 鸟类
+    0,                                                                         // 分解者
+    PLANT_SPECIES | INSECT_SPECIES | species_bit(SPECIES_FISH),                // 杂食动物
+    species_bit(SPECIES_HERBIVORE) | species_bit(SPECIES_OMNIVORE) | species_bit(SPECIES_BIRD),     // 食肉动物
+    species_bit(SPECIES_CARNIVORE) | species_bit(SPECIES_OMNIVORE) | species_bit(SPECIES_HERBIVORE), // 顶级掠食者
+    (species_bit(SPECIES_COUNT) - 1) & ~species_bit(SPECIES_PARASITE),         // 寄生生物（寄生在活着的宿主上）
+    INSECT_SPECIES | species_bit(SPECIES_HERBIVORE),                           // 爬行动物
+    INSECT_SPECIES | species_bit(SPECIES_FISH),                                // 两栖动物
+    0,                                                                         // 食腐动物
+};
+
+// 物种的常量参数（同一物种的所有个体共享，个体间可遗传变化的性状在构造时复制到个体上）
+struct SpeciesTraits {
+    SpeciesType species;
+    int max_age;                   // 最大寿命
+    double reproduction_threshold; // 繁殖所需能量阈值
+    double reproduction_chance;    // 繁殖概率
+    double mobility;               // 移动能力
+    double preferred_temp;         // 偏好温度
+    double temp_tolerance;         // 温度耐受范围
+    int disease_resistance;        // 疾病抵抗力 (0-100)
+    double flood_resistance;       // 抗洪能力 (0-1.0)
+    double drought_resistance;     // 抗旱能力 (0-1.0)
+    double base_energy;            // 基础能量消耗
+    int territory_size;            // 领地大小
+    bool is_aquatic;               // 是否水生
+};
+
+// 各物种的默认参数（按SpeciesType顺序）
+constexpr SpeciesTraits SPECIES_TRAITS[SPECIES_COUNT] = {
+    // 物种                 寿命 繁殖阈值 繁殖率 移动  偏好温度 耐受 抗病 抗洪 抗旱 基础消耗 领地 水生
+    { SPECIES_PLANT,         50,  15.0, 0.4,  1.0, 22.0, 20.0, 30, 0.3, 0.6, 0.05,  1, false },
+    { SPECIES_TREE,          200, 30.0, 0.3,  1.0, 20.0, 15.0, 30, 0.2, 0.8, 0.03,  1, false },
+    { SPECIES_AQUATIC_PLANT, 40,  12.0, 0.5,  1.0, 18.0, 10.0, 30, 0.9, 0.1, 0.04,  1, true  },
+    { SPECIES_INSECT,        30,  8.0,  0.5,  1.5, 28.0, 25.0, 40, 0.1, 0.8, 0.08,  1, false },
+    { SPECIES_FLYING_INSECT, 20,  6.0,  0.6,  2.0, 30.0, 25.0, 40, 0.8, 0.8, 0.1,   5, false }, // 飞行昆虫不怕积水
+    { SPECIES_HERBIVORE,     70,  30.0, 0.3,  1.2, 22.0, 25.0, 60, 0.3, 0.7, 0.15, 10, false },
+    { SPECIES_FISH,          40,  20.0, 0.35, 1.2, 18.0, 10.0, 45, 0.9, 0.1, 0.12,  1, true  },
+    { SPECIES_BIRD,          50,  30.0, 0.3,  2.5, 22.0, 20.0, 50, 0.8, 0.6, 0.18, 20, false }, // 鸟类不怕洪水
+    { SPECIES_DECOMPOSER,    40,  6.0,  0.45, 0.5, 25.0, 15.0, 80, 0.4, 0.7, 0.06,  1, false }, // 分解者抵抗力强
+    { SPECIES_OMNIVORE,      65,  35.0, 0.28, 1.3, 24.0, 15.0, 55, 0.4, 0.6, 0.16,  8, false },
+    { SPECIES_CARNIVORE,     60,  40.0, 0.25, 1.8, 20.0, 15.0, 65, 0.3, 0.5, 0.2,  15, false },
+    { SPECIES_APEX_PREDATOR, 80,  60.0, 0.15, 2.0, 18.0, 15.0, 70, 0.5, 0.7, 0.25, 50, false },
+    { SPECIES_PARASITE,      20,  4.0,  0.6,  0.1, 25.0, 15.0, 90, 0.7, 0.3, 0.03,  1, false }, // 寄生虫抵抗力强
+    { SPECIES_REPTILE,       60,  25.0, 0.25, 1.0, 30.0, 15.0, 55, 0.4, 0.8, 0.14,  5, false },
+    { SPECIES_AMPHIBIAN,     45,  22.0, 0.35, 1.0, 25.0, 15.0, 40, 0.8, 0.3, 0.12,  1, false },
+    { SPECIES_SCAVENGER,     55,  20.0, 0.4,  1.5, 22.0, 15.0, 75, 0.5, 0.6, 0.15,  1, false }, // 食腐动物抵抗力强
+};
+
+// 植物特有的参数
+struct PlantTraits {
+    double water_need;        // 水分需求
+    int days_to_mature;       // 成熟所需天数
+    double seed_spread_range; // 种子传播范围
+    double flood_tolerance;   // 抗洪能力
+    double drought_tolerance; // 抗旱能力
+    int fruiting_stage;       // 可以结籽的最低生长阶段
+    int offspring_range;      // 结籽时种子落在周围多远以内
+    double min_growth_rate;   // 生长速率的遗传范围
+    double max_growth_rate;
+    double growth_mutation;   // 生长速率每代的变异幅度
+    double drought_mutation;  // 抗旱能力每代的变异幅度（0表示不变异）
+};
+
+// 各植物的默认参数（按SpeciesType顺序，植物排在最前面）
+constexpr PlantTraits PLANT_TRAITS[SPECIES_AQUATIC_PLANT + 1] = {
+    { 0.6, 20, 5.0,  0.4, 0.7, 2, 2, 0.1, 0.3, 0.01,  0.02 }, // 植物
+    { 0.7, 50, 10.0, 0.4, 0.7, 3, 1, 0.1, 0.2, 0.005, 0.0 },  // 树木
+    { 1.0, 10, 3.0,  0.4, 0.7, 2, 1, 0.2, 0.3, 0.01,  0.0 },  // 水生植物
+};
+
+// 场景文件覆盖后的参数（启动时由默认参数复制并修改，之后不再改变）
+// 默认表保持constexpr，没有覆盖时每日更新中的物种参数可在编译期折叠
+SpeciesTraits scenario_species_traits[SPECIES_COUNT];
+PlantTraits scenario_plant_traits[SPECIES_AQUATIC_PLANT + 1];
+bool traits_overridden = false; // 是否改用场景文件覆盖后的参数
+
+// 当前生效的参数表
+inline const SpeciesTraits* species_traits_table() {
+    return traits_overridden ? scenario_species_traits : SPECIES_TRAITS;
+}
+inline const PlantTraits* plant_traits_table() {
+    return traits_overridden ? scenario_plant_traits : PLANT_TRAITS;
+}
+
+// 每次结籽产生的种子数
+const int SEEDS_PER_FRUITING = 4;
+// 植物一天最多释放的种子数（结籽加一次远距离传播）
+const int PLANT_MAX_SEEDS = SEEDS_PER_FRUITING + 1;
+
+// 植物释放的一粒种子（由世界放入种子库）
+struct SeedDrop {
+    int x, y;
+    float growth_rate;        // 遗传的生长速率
+    float drought_resistance; // 遗传的抗旱能力
+};
+
+// 生物状态的平坦记录（可直接按字节复制到共享内存中）
+struct OrganismRecord {
+    unsigned long long id;
+    int species;
+    int x, y;
+    double energy;
+    int age;
+    int max_age;
+    double reproduction_threshold;
+    double reproduction_chance;
+    double mobility;
+    double preferred_temp;
+    double flood_resistance;
+    double drought_resistance;
+    int disease_resistance;
+    int days_without_food;
+    bool has_disease;
+    bool is_hibernating;
+    int immunity_days;
+    int extra_int;      // 子类状态（生长阶段、狩猎技能等）
+    double extra_value; // 子类状态（生长速率等）
+};
+
+// 生物编号的高位（多进程运行时为进程序号，保证各进程分配的编号互不冲突）
+unsigned long long organism_id_base = 0;
+
+// 分配全局唯一的生物编号
+inline unsigned long long allocate_organism_id() {
+    static unsigned long long next_id = 1;
+    return organism_id_base | next_id++;
+}
+
+// 休眠的时间轮槽数（一次最多跳过的天数）
+const int SLEEP_WHEEL_SLOTS = 64;
+
+// 种子萌发的最低气温
+const double SEED_GERMINATION_TEMP = 5.0;
+
+// 休眠计划：可以安全跳过的天数及提前唤醒的环境条件
+struct SleepPlan {
+    int days;                // 最多可跳过的天数
+    double wake_temperature; // 气温高于此值时提前唤醒
+    bool wake_on_rain;       // 降雨时提前唤醒
+};
+
+// 休眠调度状态（由SleepScheduler维护）
+struct SleepHandle {
+    int since;               // 开始休眠的日期（-1表示未休眠）
+    int wake_day;            // 预定唤醒日
+    int wheel_index;         // 在时间轮槽中的位置
+    double wake_temperature; // 唤醒气温
+    int warm_index;          // 在升温唤醒列表中的位置
+    int rain_index;          // 在降雨唤醒列表中的位置（-1表示不因降雨唤醒）
+
+    SleepHandle() : since(-1), wake_day(0), wheel_index(-1), wake_temperature(0.0),
+        warm_index(-1), rain_index(-1) {}
+};
+
+class Organism;
+
+// 进食意图：收集阶段由各生物只读地生成（可多线程并行），结算阶段统一裁决冲突后执行
+struct FeedingIntent {
+    Organism* target;   // 取食对象（nullptr表示不从其他生物身上取食）
+    double gain;        // 成功时自身获得的能量
+    double take;        // 取食对象损失的能量
+    bool exclusive;     // 是否独占取食对象（吃掉整个个体），同一对象只有一个获胜者
+    double penalty;     // 无论成败都要消耗的能量（地形不适、狩猎失败等）
+    const char* status; // 记录的状态（nullptr表示不记录）
+    double roll;        // 按种子、日期和编号预先生成的[0,1)随机数（收集阶段不能调用rand）
+
+    FeedingIntent() : target(nullptr), gain(0.0), take(0.0), exclusive(true), penalty(0.0),
+        status(nullptr), roll(0.0) {}
+
+    void claim(Organism* prey, double gain_amount, double take_amount, const char* new_status,
+        bool exclusive_claim = true) {
+        target = prey;
+        gain = gain_amount;
+        take = take_amount;
+        status = new_status;
+        exclusive = exclusive_claim;
+    }
+};
+
+// 康复后的免疫天数（免疫期内不会再次感染）
+const int DISEASE_IMMUNITY_DAYS = 60;
+
+// 生物基类
+// 寻找附近同类的结果（每次调用临时分配，计入内存统计）
+typedef vector<Organism*, CountingAllocator<Organism*, MEMORY_SCRATCH>> NearbyList;
+
+class Organism {
+protected:
+    unsigned long long id; // 生物编号
+    int x, y;             // 位置
+    double energy;         // 能量值
+    int age;               // 年龄
+    int max_age;           // 最大寿命
+    double reproduction_threshold; // 繁殖所需能量阈值
+    double reproduction_chance;    // 繁殖概率
+    double mobility;       // 移动能力
+    double preferred_temp; // 偏好温度
+    bool is_hibernating;   // 是否在冬眠
+    bool has_disease;      // 是否患病
+    int disease_resistance; // 疾病抵抗力 (0-100)
+    int immunity_days;     // 康复后剩余的免疫天数
+    int days_without_food; // 饥饿天数
+    double flood_resistance; // 抗洪能力 (0-1.0)
+    double drought_resistance; // 抗旱能力 (0-1.0)
+    const SpeciesTraits* traits; // 物种常量参数
+    SleepHandle sleep;     // 休眠调度状态
+
+    // 前一天的状态
+    struct PreviousState {
+        int x, y;
+        double energy;
+        int age;
+        bool is_dead;
+        string status;
+    } previous;
+
+public:
+    Organism(int x, int y, double energy, const SpeciesTraits& species_traits)
+        : id(allocate_organism_id()), x(x), y(y), energy(energy), age(0),
+        max_age(species_traits.max_age),
+        reproduction_threshold(species_traits.reproduction_threshold),
+        reproduction_chance(species_traits.reproduction_chance),
+        mobility(species_traits.mobility), preferred_temp(species_traits.preferred_temp),
+        is_hibernating(false), has_disease(false),
+        disease_resistance(species_traits.disease_resistance), immunity_days(0), days_without_food(0),
+        flood_resistance(species_traits.flood_resistance),
+        drought_resistance(species_traits.drought_resistance), traits(&species_traits) {
+        save_previous_state("创建");
+    }
+
+    virtual ~Organism() {}
+
+    // 生物对象的分配计入内存统计（虚析构函数保证按实际类型的大小释放）
+    static void* operator new(size_t bytes);
+    static void operator delete(void* p, size_t bytes);
+
+    // 导出为平坦记录
+    void save_record(OrganismRecord& record) const {
+        record.id = id;
+        record.species = getSpecies();
+        record.x = x;
+        record.y = y;
+        record.energy = energy;
+        record.age = age;
+        record.max_age = max_age;
+        record.reproduction_threshold = reproduction_threshold;
+        record.reproduction_chance = reproduction_chance;
+        record.mobility = mobility;
+        record.preferred_temp = preferred_temp;
+        record.flood_resistance = flood_resistance;
+        record.drought_resistance = drought_resistance;
+        record.disease_resistance = disease_resistance;
+        record.days_without_food = days_without_food;
+        record.has_disease = has_disease;
+        record.is_hibernating = is_hibernating;
+        record.immunity_days = immunity_days;
+        record.extra_int = 0;
+        record.extra_value = 0.0;
+        save_extra(record);
+    }
+
+    // 从平坦记录恢复状态（编号也取自记录，迁入的生物和边界副本保持原编号）
+    void load_record(const OrganismRecord& record) {
+        id = record.id;
+        x = record.x;
+        y = record.y;
+        energy = record.energy;
+        age = record.age;
+        max_age = record.max_age;
+        reproduction_threshold = record.reproduction_threshold;
+        reproduction_chance = record.reproduction_chance;
+        mobility = record.mobility;
+        preferred_temp = record.preferred_temp;
+        flood_resistance = record.flood_resistance;
+        drought_resistance = record.drought_resistance;
+        disease_resistance = record.disease_resistance;
+        days_without_food = record.days_without_food;
+        has_disease = record.has_disease;
+        is_hibernating = record.is_hibernating;
+        immunity_days = record.immunity_days;
+        load_extra(record);
+    }
+
+    // 子类特有状态的导入导出
+    virtual void save_extra(OrganismRecord& record) const {}
+    virtual void load_extra(const OrganismRecord& record) {}
+
+    // 保存前一天状态
+    void save_previous_state(const string& status) {
+        previous.x = x;
+        previous.y = y;
+        previous.energy = energy;
+        previous.age = age;
+        previous.is_dead = (energy <= 0 || age >= max_age);
+        previous.status = status;
+    }
+
+    // 获取前一天状态
+    const PreviousState& get_previous_state() const {
+        return previous;
+    }
+
+    // 纯虚函数 - 需要在子类实现
+    virtual void move(TerrainMap& terrain, Environment& env) = 0;
+    // 进食分两个阶段：forage()只读地寻找食物并填写进食意图，世界裁决冲突后调用eat()结算
+    // forage()会在多个线程中同时执行，只能读取地形和其他生物，不能修改任何状态
+    virtual void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const = 0;
+    // fed表示是否争到了取食对象（被取食对象的能量已由世界扣除）
+    virtual void eat(Environment& env, TerrainMap& terrain, const FeedingIntent& intent, bool fed) {
+        lose_energy(intent.penalty);
+        if (fed) {
+            gain_energy(intent.gain);
+        }
+        // 没有争到取食对象时不记录状态
+        if (intent.status && (fed || !intent.target)) {
+            save_previous_state(intent.status);
+        }
+    }
+    virtual Organism* reproduce(vector<Organism*>& organisms) = 0;
+    SpeciesType getSpecies() const { return traits->species; }
+    // food是否在species的食谱中（SPECIES_DIET）
+    static bool in_diet(SpeciesType species, const Organism* food) {
+        return (SPECIES_DIET[species] & species_bit(food->getSpecies())) != 0;
+    }
+    virtual string getSymbol() const = 0;
+    virtual string getName() const = 0;
+    virtual bool canInhabit(TerrainType type) const = 0;
+    virtual void seasonal_effect(Environment& env) {}  // 添加默认实现
+    virtual void weather_effect(Environment& env, const Terrain& terrain) {} // 天气影响
+
+    // 疾病相关函数
+    virtual void contract_disease(DiseaseType disease_type) {
+        if (immunity_days > 0) return; // 康复后的免疫期
+        if (rand() % 100 > disease_resistance) {
+            has_disease = true;
+            save_previous_state("感染疾病");
+        }
+    }
+
+    virtual void disease_effects() {
+        if (!has_disease) return;
+
+        // 疾病影响
+        lose_energy(0.5); // 每天损失能量
+        mobility *= 0.7;   // 移动能力降低
+
+        // 小概率死亡
+        if (rand() % 100 < 5) {
+            lose_energy(energy); // 直接死亡
+        }
+
+        // 小概率康复
+        if (rand() % 100 < disease_resistance / 10) {
+            has_disease = false;
+            immunity_days = DISEASE_IMMUNITY_DAYS;
+            save_previous_state("康复");
+        }
+    }
+
+    // 通用函数
+    // T为生物的实际类型：物种参数按编译期已知的下标读取，虚函数直接调用T的实现
+    // Overridden为场景文件是否覆盖了物种参数，没有覆盖时直接读取constexpr默认表
+    template <class T, bool Overridden>
+    void age_organism(Environment& env) {
+        const SpeciesTraits& species_traits = Overridden ? scenario_species_traits[T::SPECIES] : SPECIES_TRAITS[T::SPECIES];
+        T* self = static_cast<T*>(this);
+
+        age++;
+        if (immunity_days > 0) immunity_days--;
+        // 基础能量消耗（与体型和活动相关）
+        double consumption = species_traits.base_energy * (1.0 + mobility * 0.5);
+        energy -= consumption;
+
+        // 温度影响
+        double penalty = temperature_penalty(env.temperature, species_traits.temp_tolerance);
+        if (penalty > 0) {
+            lose_energy(penalty);
+        }
+
+        // 疾病影响
+        self->T::disease_effects();
+
+        // 处理冬眠
+        self->T::handle_hibernation(env);
+
+        // 处理饥饿
+        handle_hunger();
+    }
+
+    // 将handle_hibernation改为虚函数
+    virtual void handle_hibernation(Environment& env) {
+        if (env.temperature < 5 && energy > 20 && !traits->is_aquatic) {
+            is_hibernating = true;
+            lose_energy(0.1); // 冬眠时消耗少量能量
+        }
+        else if (env.temperature > 10 || energy < 10) {
+            is_hibernating = false;
+        }
+    }
+
+    // 温度超出耐受范围时每天损失的能量
+    double temperature_penalty(double temperature, double temp_tolerance) const {
+        double temp_diff = abs(temperature - preferred_temp);
+        return temp_diff > temp_tolerance ? temp_diff * 0.1 : 0.0;
+    }
+    double temperature_penalty(double temperature) const {
+        return temperature_penalty(temperature, traits->temp_tolerance);
+    }
+
+    // 是否进入休眠（跳过每天的更新），默认为冬眠中且健康的动物
+    virtual bool can_sleep(Environment& env, SleepPlan& plan) const {
+        if (!is_hibernating || has_disease) return false;
+        plan.wake_temperature = 10.0; // 与handle_hibernation中结束冬眠的气温一致
+        plan.wake_on_rain = false;
+        plan.days = safe_sleep_days(env, 0.1, 10.0);
+        return plan.days > 1;
+    }
+
+    // 按当前消耗估算能量和寿命允许跳过的天数
+    // extra_drain为休眠特有的每天消耗，能量低于min_energy（或开始挨饿）时需要唤醒
+    int safe_sleep_days(Environment& env, double extra_drain, double min_energy) const {
+        double drain = traits->base_energy * (1.0 + mobility * 0.5) + extra_drain +
+            temperature_penalty(env.temperature);
+        double floor_energy = max(min_energy, max_age / 10.0);
+        int days = static_cast<int>((energy - floor_energy) / drain);
+        return min(min(days, max_age - age - 1), SLEEP_WHEEL_SLOTS - 1);
+    }
+
+    // 唤醒时一次性结算休眠期间跳过的天数
+    // 衰老和基础消耗直接按天数结算，温度损失和冬眠消耗按记录的每天气温累计
+    void settle_sleep(const double* temperatures, int days) {
+        age += days;
+        immunity_days = max(0, immunity_days - days);
+        energy -= days * traits->base_energy * (1.0 + mobility * 0.5);
+        Environment day_env;
+        for (int i = 0; i < days; i++) {
+            day_env.temperature = temperatures[i];
+            energy -= temperature_penalty(temperatures[i]);
+            handle_hibernation(day_env);
+        }
+        if (energy < 0) energy = 0;
+    }
+
+    bool is_sleeping() const { return sleep.since >= 0; }
+    SleepHandle& getSleepHandle() { return sleep; }
+
+    void handle_hunger() {
+        if (energy < max_age / 10.0) { // 能量过低
+            days_without_food++;
+            if (days_without_food > 5) {
+                lose_energy(energy * 0.2); // 饥饿致死
+            }
+        }
+        else {
+            days_without_food = 0;
+        }
+    }
+
+    bool is_dead() const { return energy <= 0 || age >= max_age; }
+    bool reached_max_age() const { return age >= max_age; }
+    void gain_energy(double amount) {
+        energy += amount;
+        // 能量上限
+        energy = min(energy, static_cast<double>(max_age * 2));
+    }
+    void lose_energy(double amount) {
+        energy -= amount;
+        if (energy < 0) energy = 0;
+    }
+
+    // 位置和能量访问
+    unsigned long long getId() const { return id; }
+    int getX() const { return x; }
+    int getY() const { return y; }
+    double getEnergy() const { return energy; }
+    bool getIsAquatic() const { return traits->is_aquatic; }
+    bool isHibernating() const { return is_hibernating; }
+    bool hasDisease() const { return has_disease; }
+    double getMobility() const { return mobility; }  // 添加getMobility
+    void setPosition(int new_x, int new_y) { x = new_x; y = new_y; }  // 添加setPosition
+
+    // 繁殖机会检查
+    bool can_reproduce() const {
+        return energy > reproduction_threshold &&
+            (rand() / (double)RAND_MAX) < reproduction_chance &&
+            !is_hibernating && !has_disease && age > max_age / 4;
+    }
+
+    // 环境适应度
+    virtual double environment_fitness(Environment& env, const Terrain& terrain) const {
+        // 温度影响
+        double temp_diff = abs(env.temperature - preferred_temp);
+        double temp_fitness = 1.0 - min(1.0, temp_diff / traits->temp_tolerance);
+
+        // 白天时长影响 (夜行性/昼行性)
+        double daylight_fitness = (preferred_temp > 30) ?
+            min(1.0, env.daylight_hours / 12.0) :  // 喜热生物偏好白天
+            min(1.0, (24 - env.daylight_hours) / 12.0); // 喜冷生物偏好夜晚
+
+        // 地形适应度
+        double terrain_fitness = 0.0;
+        switch (terrain.type) {
+        case PLAIN: terrain_fitness = 0.8; break;
+        case FOREST: terrain_fitness = 0.9; break;
+        case MOUNTAIN: terrain_fitness = 0.4; break;
+        case DESERT: terrain_fitness = 0.3; break;
+        case WATER: terrain_fitness = traits->is_aquatic ? 1.0 : 0.1; break;
+        case MARSH: terrain_fitness = 0.7; break;
+        case VOLCANIC: terrain_fitness = 0.2; break;
+        case SNOW: terrain_fitness = 0.5; break;
+        case GRASSLAND: terrain_fitness = 0.85; break;
+        case JUNGLE: terrain_fitness = 0.95; break;
+        case TUNDRA: terrain_fitness = 0.4; break;
+        case BEACH: terrain_fitness = traits->is_aquatic ? 0.7 : 0.6; break;
+        case FLOODED: terrain_fitness = traits->is_aquatic ? 0.9 : 0.3; break;
+        }
+
+        // 污染影响
+        double pollution_fitness = 1.0 - max(env.pollution, terrain.pollution_level);
+
+        // 积水影响
+        double flood_fitness = 1.0 - terrain.water_accumulation * (1.0 - flood_resistance);
+
+        // 干旱影响
+        double drought_fitness = 1.0 - terrain.drought_level * (1.0 - drought_resistance);
+
+        // 综合适应度
+        return (temp_fitness * 0.3 +
+            daylight_fitness * 0.15 +
+            terrain_fitness * 0.15 +
+            pollution_fitness * 0.1 +
+            0.1 + // 疾病不再按地形计（疫病由压力场传播，直接作用于个体），此项恒为满分
+            flood_fitness * 0.1 +
+            drought_fitness * 0.1);
+    }
+
+    // 寻找附近同类
+    NearbyList find_nearby_species(vector<Organism*>& organisms, int range) {
+        NearbyList nearby;
+        for (Organism* org : organisms) {
+            if (typeid(*org) == typeid(*this)) {
+                int dx = abs(x - org->getX());
+                int dy = abs(y - org->getY());
+                if (dx <= range && dy <= range && !org->is_dead()) {
+                    nearby.push_back(org);
+                }
+            }
+        }
+        return nearby;
+    }
+};
+
+// 定义在类外：内联后的::operator new与类的operator delete配对时编译器会误报不匹配
+void* Organism::operator new(size_t bytes) {
+    record_allocation(MEMORY_ORGANISMS, bytes);
+    return ::operator new(bytes);
+}
+
+void Organism::operator delete(void* p, size_t bytes) {
+    record_free(MEMORY_ORGANISMS, bytes);
+    ::operator delete(p, bytes);
+}
+
+// 植物类
+class Plant : public Organism {
+protected:
+    double growth_rate; // 生长速率
+    int growth_stage;   // 0=种子, 1=幼苗, 2=成熟, 3=开花, 4=结果
+
+    const PlantTraits& plant_traits() const { return plant_traits_table()[getSpecies()]; }
+
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_PLANT; // 物种编号
+
+    Plant(int x, int y, double energy = 10.0, const SpeciesTraits& species_traits = species_traits_table()[SPECIES])
+        : Organism(x, y, energy, species_traits) {
+        growth_rate = 0.2;
+        growth_stage = 0;
+    }
+
+    void move(TerrainMap& terrain, Environment& env) override {
+        // 植物不移动，种子的传播见release_seeds
+    }
+
+    void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const override {
+        // 检查地形是否适合
+        if (!canInhabit(terrain[y][x].type)) {
+            intent.penalty = 0.5;
+            return;
+        }
+
+        // 植物通过光合作用获取能量
+        double light_factor = min(1.0, env.daylight_hours / 12.0);
+        double fertility_factor = terrain[y][x].fertility;
+        double water_factor = min(1.0, terrain[y][x].water_level / plant_traits().water_need);
+
+        // 降雨影响
+        water_factor = min(1.0, water_factor + env.rainfall / 100.0);
+
+        // 干旱影响
+        if (terrain[y][x].drought_level > 0.5) {
+            water_factor *= (1.0 - terrain[y][x].drought_level);
+        }
+
+        double growth = growth_rate * light_factor *
+            water_factor * fertility_factor *
+            environment_fitness(env, terrain[y][x]);
+
+        // 生长阶段影响生长速度（按今天推进后的阶段计算）
+        growth *= (1.0 + next_growth_stage() * 0.2);
+
+        // 积水影响
+        if (terrain[y][x].water_accumulation > plant_traits().flood_tolerance) {
+            growth *= 0.5; // 积水过多会抑制生长
+        }
+
+        intent.gain = growth;
+    }
+
+    void eat(Environment& env, TerrainMap& terrain, const FeedingIntent& intent, bool fed) override {
+        if (intent.penalty > 0) {
+            lose_energy(intent.penalty);
+            return;
+        }
+
+        // 植物生长阶段推进
+        int stage = next_growth_stage();
+        if (stage != growth_stage) {
+            growth_stage = stage;
+            if (growth_stage == 2) { // 成熟期
+                reproduction_chance += 0.1;
+            }
+        }
+
+        gain_energy(intent.gain);
+    }
+
+    // 今天结束后所处的生长阶段
+    int next_growth_stage() const {
+        if (growth_stage < 4 && age > plant_traits().days_to_mature * (growth_stage + 1) / 4) {
+            return growth_stage + 1;
+        }
+        return growth_stage;
+    }
+
+    // 植物以种子繁殖（见release_seeds），不直接产生后代
+    Organism* reproduce(vector<Organism*>& organisms) override {
+        return nullptr;
+    }
+
+    // 释放种子，返回写入drops的种子数（最多PLANT_MAX_SEEDS粒）
+    // 达到结籽阶段的植物把一半能量结成种子落在周围；开花结果期的植物还有机会把一粒种子传播到远处
+    int release_seeds(const TerrainMap& terrain, SeedDrop* drops) {
+        const PlantTraits& traits = plant_traits();
+        int count = 0;
+
+        if (can_reproduce() && growth_stage >= traits.fruiting_stage) {
+            energy /= 2;
+            for (int i = 0; i < SEEDS_PER_FRUITING; i++) {
+                SeedDrop& drop = drops[count++];
+                drop.x = x + rand() % (traits.offspring_range * 2 + 1) - traits.offspring_range;
+                drop.y = y + rand() % (traits.offspring_range * 2 + 1) - traits.offspring_range;
+                // 遗传变异
+                drop.growth_rate = static_cast<float>(max(traits.min_growth_rate, min(traits.max_growth_rate,
+                    growth_rate + (rand() % 11 - 5) * traits.growth_mutation)));
+                drop.drought_resistance = static_cast<float>(traits.drought_mutation > 0 ?
+                    max(0.3, min(0.8, drought_resistance + (rand() % 11 - 5) * traits.drought_mutation)) :
+                    drought_resistance);
+            }
+        }
+
+        if (growth_stage >= 3 && rand() % 100 < 5) { // 5%几率远距离传播种子
+            int range = static_cast<int>(traits.seed_spread_range);
+            int new_x = max(0, min(terrain.get_width() - 1, x + rand() % (range * 2) - range));
+            int new_y = max(0, min(terrain.get_height() - 1, y + rand() % (range * 2) - range));
+            if (canInhabit(terrain[new_y][new_x].type)) {
+                SeedDrop& drop = drops[count++];
+                drop.x = new_x;
+                drop.y = new_y;
+                drop.growth_rate = static_cast<float>(growth_rate);
+                drop.drought_resistance = static_cast<float>(drought_resistance);
+            }
+        }
+        return count;
+    }
+
+    // 萌发时继承种子的基因型
+    void set_genotype(double new_growth_rate, double new_drought_resistance) {
+        growth_rate = new_growth_rate;
+        drought_resistance = new_drought_resistance;
+    }
+
+    void save_extra(OrganismRecord& record) const override {
+        record.extra_int = growth_stage;
+        record.extra_value = growth_rate;
+    }
+    void load_extra(const OrganismRecord& record) override {
+        growth_stage = record.extra_int;
+        growth_rate = record.extra_value;
+    }
+
+    string getSymbol() const override {
+        if (growth_stage == 0) return "s"; // 种子
+        if (growth_stage == 1) return "p"; // 幼苗
+        return "P"; // 成熟植物
+    }
+    string getName() const override {
+        switch (growth_stage) {
+        case 0: return "种子";
+        case 1: return "幼苗";
+        case 2: return "植物";
+        case 3: return "开花植物";
+        default: return "结果植物";
+        }
+    }
+
+    bool canInhabit(TerrainType type) const override { return can_grow_on(type); }
+    static bool can_grow_on(TerrainType type) {
+        return type != WATER && type != VOLCANIC && type != FLOODED;
+    }
+
+    // 种子在寒冷且无雨时休眠，升温或降雨时萌发
+    bool can_sleep(Environment& env, SleepPlan& plan) const override {
+        if (growth_stage != 0 || has_disease) return false;
+        if (env.temperature > SEED_GERMINATION_TEMP || env.weather == RAINY || env.weather == STORMY) {
+            return false;
+        }
+        plan.wake_temperature = SEED_GERMINATION_TEMP;
+        plan.wake_on_rain = true;
+        plan.days = safe_sleep_days(env, 0.0, 0.0);
+        return plan.days > 1;
+    }
+
+    void disease_effects() override {
+        if (!has_disease) return;
+
+        // 植物疾病影响更大
+        lose_energy(1.0);
+        growth_rate *= 0.5;
+
+        // 较高概率死亡
+        if (rand() % 100 < 10) {
+            lose_energy(energy);
+        }
+
+        // 较低概率康复
+        if (rand() % 100 < disease_resistance / 5) {
+            has_disease = false;
+            immunity_days = DISEASE_IMMUNITY_DAYS;
+        }
+    }
+
+    void weather_effect(Environment& env, const Terrain& terrain) override {
+        // 干旱天气影响
+        if (env.weather == DROUGHT && terrain.drought_level > plant_traits().drought_tolerance) {
+            lose_energy(0.8);
+        }
+
+        // 暴雨天气影响
+        if (env.weather == STORMY && terrain.water_accumulation > plant_traits().flood_tolerance) {
+            lose_energy(1.0);
+        }
+    }
+};
+
+// 树木类 - 森林植物
+class Tree : public Plant {
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_TREE; // 物种编号
+
+    Tree(int x, int y, double energy = 20.0) : Plant(x, y, energy, species_traits_table()[SPECIES]) {
+        growth_rate = 0.15;
+    }
+
+    string getSymbol() const override {
+        if (growth_stage < 2) return "t";
+        return "T";
+    }
+    string getName() const override {
+        if (growth_stage < 2) return "小树苗";
+        return "树木";
+    }
+
+    bool canInhabit(TerrainType type) const override { return can_grow_on(type); }
+    static bool can_grow_on(TerrainType type) {
+        return type == FOREST || type == PLAIN || type == JUNGLE;
+    }
+
+    void weather_effect(Environment& env, const Terrain& terrain) override {
+        // 暴风雨可能吹倒树木
+        if (env.weather == STORMY && growth_stage < 3 && rand() % 100 < 10) {
+            lose_energy(energy * 0.5);
+        }
+    }
+};
+
+// 水生植物类
+class AquaticPlant : public Plant {
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_AQUATIC_PLANT; // 物种编号
+
+    AquaticPlant(int x, int y, double energy = 8.0) : Plant(x, y, energy, species_traits_table()[SPECIES]) {
+        growth_rate = 0.25;
+    }
+
+    string getSymbol() const override {
+        if (growth_stage < 2) return "a";
+        return "A";
+    }
+    string getName() const override {
+        if (growth_stage < 2) return "幼年水生植物";
+        return "水生植物";
+    }
+
+    bool canInhabit(TerrainType type) const override { return can_grow_on(type); }
+    static bool can_grow_on(TerrainType type) {
+        return type == WATER || type == MARSH || type == FLOODED;
+    }
+
+    void weather_effect(Environment& env, const Terrain& terrain) override {
+        // 干旱天气对水生植物影响很大
+        if (env.weather == DROUGHT) {
+            lose_energy(1.0);
+        }
+    }
+};
+
+// 动物移动函数增强
+void animal_move(Organism* org, TerrainMap& terrain, Environment& env, int base_range) {
+    if (org->isHibernating()) return; // 冬眠期间不移动
+
+    // 积雪影响移动能力
+    double snow_factor = 1.0 - min(0.5, terrain[org->getY()][org->getX()].snow_depth * 0.7);
+
+    // 积水影响移动能力
+    double flood_factor = 1.0;
+    if (!org->getIsAquatic() && terrain[org->getY()][org->getX()].water_accumulation > 0.3) {
+        flood_factor = 0.6;
+    }
+
+    int move_range = static_cast<int>(org->getMobility() * base_range * snow_factor * flood_factor);
+    int new_x = org->getX() + rand() % (move_range * 2 + 1) - move_range;
+    int new_y = org->getY() + rand() % (move_range * 2 + 1) - move_range;
+
+    // 边界检查
+    new_x = max(0, min(terrain.get_width() - 1, new_x));
+    new_y = max(0, min(terrain.get_height() - 1, new_y));
+
+    // 检查新位置是否适合栖息
+    if (org->canInhabit(terrain[new_y][new_x].type)) {
+        org->setPosition(new_x, new_y);
+        org->save_previous_state("移动");
+    }
+
+    org->lose_energy(0.2);
+}
+
+// 昆虫类
+class Insect : public Organism {
+protected:
+    bool is_flying;
+    bool is_nocturnal; // 是否夜行性
+
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_INSECT; // 物种编号
+
+    Insect(int x, int y, double energy = 5.0, const SpeciesTraits& species_traits = species_traits_table()[SPECIES])
+        : Organism(x, y, energy, species_traits) {
+        is_flying = false;
+        is_nocturnal = (rand() % 2 == 0);
+    }
+
+    void move(TerrainMap& terrain, Environment& env) override {
+        // 如果是夜行性昆虫，白天活动减少
+        if (is_nocturnal && env.daylight_hours > 12) {
+            if (rand() % 100 < 70) return; // 70%几率不活动
+        }
+
+        // 雨天使昆虫活动减少
+        if (env.weather == RAINY || env.weather == STORMY) {
+            if (rand() % 100 < 60) return;
+        }
+
+        // 小范围移动
+        int move_range = is_flying ? 5 : 3;
+        animal_move(this, terrain, env, move_range);
+    }
+
+    void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const override {
+        // 检查地形是否适合
+        if (!canInhabit(terrain[y][x].type)) {
+            intent.penalty = 0.5;
+            return;
+        }
+
+        // 干旱天气影响食物获取
+        if (env.weather == DROUGHT && terrain[y][x].drought_level > 0.5) {
+            intent.penalty = 0.3;
+            return;
+        }
+
+        // 寻找附近的植物或腐肉
+        for (Organism* org : organisms) {
+            if (in_diet(SPECIES, org)) {
+                int dx = abs(x - org->getX());
+                int dy = abs(y - org->getY());
+                if (dx <= 1 && dy <= 1) {
+                    // 吃植物
+                    intent.claim(org, org->getEnergy() * 0.7, org->getEnergy(), "进食");
+                    return;
+                }
+            }
+        }
+    }
+
+    Organism* reproduce(vector<Organism*>& organisms) override {
+        if (can_reproduce()) {
+            // 检查附近是否有配偶
+            NearbyList nearby = find_nearby_species(organisms, 3);
+            if (nearby.size() > 1) { // 至少有一个配偶
+                energy /= 2;
+                Insect* child = new Insect(x + rand() % 2 - 1, y + rand() % 2 - 1);
+                // 遗传变异
+                child->mobility = max(1.0, min(2.0, mobility + (rand() % 11 - 5) * 0.05));
+                child->disease_resistance = max(30, min(50, disease_resistance + rand() % 11 - 5));
+                save_previous_state("繁殖");
+                return child;
+            }
+        }
+        return nullptr;
+    }
+
+    void save_extra(OrganismRecord& record) const override {
+        record.extra_int = is_nocturnal ? 1 : 0;
+    }
+    void load_extra(const OrganismRecord& record) override {
+        is_nocturnal = record.extra_int != 0;
+    }
+
+    string getSymbol() const override { return "I"; }
+    string getName() const override { return "昆虫"; }
+
+    bool canInhabit(TerrainType type) const override {
+        return type != WATER && type != VOLCANIC && type != FLOODED;
+    }
+
+    double environment_fitness(Environment& env, const Terrain& terrain) const override {
+        double fitness = Organism::environment_fitness(env, terrain);
+
+        // 夜行性昆虫在夜晚更活跃
+        if (is_nocturnal && env.daylight_hours < 12) {
+            fitness *= 1.2;
+        }
+        return min(1.0, fitness);
+    }
+
+    void weather_effect(Environment& env, const Terrain& terrain) override {
+        // 暴雨可能冲走昆虫
+        if (env.weather == STORMY && !is_flying && rand() % 100 < 30) {
+            lose_energy(1.0);
+        }
+    }
+};
+
+// 飞行昆虫类
+class FlyingInsect : public Insect {
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_FLYING_INSECT; // 物种编号
+
+    FlyingInsect(int x, int y, double energy = 4.0) : Insect(x, y, energy, species_traits_table()[SPECIES]) {
+        is_flying = true;
+    }
+
+    void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const override {
+        // 检查地形是否适合
+        if (!canInhabit(terrain[y][x].type)) {
+            intent.penalty = 0.5;
+            return;
+        }
+
+        // 飞行昆虫可以吃花蜜和小型昆虫
+        for (Organism* org : organisms) {
+            if (in_diet(SPECIES, org)) {
+                int dx = abs(x - org->getX());
+                int dy = abs(y - org->getY());
+                if (dx <= 2 && dy <= 2) {
+                    // 吃植物或昆虫
+                    intent.claim(org, org->getEnergy() * 0.5, org->getEnergy() * 0.8, "进食");
+                    return;
+                }
+            }
+        }
+    }
+
+    Organism* reproduce(vector<Organism*>& organisms) override {
+        if (can_reproduce()) {
+            // 检查附近是否有配偶
+            NearbyList nearby = find_nearby_species(organisms, 5);
+            if (nearby.size() > 1) {
+                energy *= 0.5;
+                FlyingInsect* child = new FlyingInsect(x + rand() % 3 - 1, y + rand() % 3 - 1);
+                // 遗传变异
+                child->mobility = max(1.8, min(2.5, mobility + (rand() % 11 - 5) * 0.05));
+                save_previous_state("繁殖");
+                return child;
+            }
+        }
+        return nullptr;
+    }
+
+    string getSymbol() const override { return "F"; }
+    string getName() const override { return "飞行昆虫"; }
+
+    void weather_effect(Environment& env, const Terrain& terrain) override {
+        // 暴雨影响飞行
+        if (env.weather == STORMY && rand() % 100 < 40) {
+            lose_energy(0.5);
+        }
+    }
+};
+
+// 食草动物类
+class Herbivore : public Organism {
+protected:
+    bool migrated; // 是否已迁徙
+
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_HERBIVORE; // 物种编号
+
+    Herbivore(int x, int y, double energy = 20.0) : Organism(x, y, energy, species_traits_table()[SPECIES]) {
+        migrated = false;
+    }
+
+    void move(TerrainMap& terrain, Environment& env) override {
+        if (isHibernating()) return;
+
+        // 季节性迁徙
+        if (!migrated && (env.season_progress > 0.7 || env.season_progress < 0.3)) {
+            int move_range = static_cast<int>(mobility * 50); // 长距离迁徙
+            int new_x = x + rand() % (move_range * 2 + 1) - move_range;
+            int new_y = y + rand() % (move_range * 2 + 1) - move_range;
+
+            // 边界检查
+            new_x = max(0, min(terrain.get_width() - 1, new_x));
+            new_y = max(0, min(terrain.get_height() - 1, new_y));
+
+            if (canInhabit(terrain[new_y][new_x].type)) {
+                x = new_x;
+                y = new_y;
+                migrated = true;
+                save_previous_state("迁徙");
+                return;
+            }
+        }
+
+        animal_move(this, terrain, env, 3);
+    }
+
+    void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const override {
+        // 检查地形是否适合
+        if (!canInhabit(terrain[y][x].type)) {
+            intent.penalty = 1.0;
+            return;
+        }
+
+        // 干旱天气减少食物供应
+        double food_availability = 1.0;
+        if (env.weather == DROUGHT) {
+            food_availability = 0.7;
+        }
+
+        // 寻找附近的植物
+        vector<Organism*> nearby_plants;
+        for (Organism* org : organisms) {
+            if (in_diet(SPECIES, org)) {
+                int dx = abs(x - org->getX());
+                int dy = abs(y - org->getY());
+                if (dx <= 2 && dy <= 2) {
+                    nearby_plants.push_back(org);
+                }
+            }
+        }
+
+        // 吃能量最高的植物
+        if (!nearby_plants.empty()) {
+            sort(nearby_plants.begin(), nearby_plants.end(),
+                [](Organism* a, Organism* b) {
+                    return a->getEnergy() > b->getEnergy();
+                });
+
+            Organism* target = nearby_plants[0];
+            intent.claim(target, target->getEnergy() * 0.6 * food_availability, target->getEnergy(), "进食");
+            return;
+        }
+
+        // 食草动物需要消耗更多能量在寒冷环境中
+        if (env.temperature < 10) intent.penalty = 1.0;
+    }
+
+    Organism* reproduce(vector<Organism*>& organisms) override {
+        if (can_reproduce()) {
+            // 检查附近是否有配偶
+            NearbyList nearby = find_nearby_species(organisms, 5);
+            if (nearby.size() > 1) {
+                energy *= 0.4;
+                migrated = false; // 重置迁徙状态
+                Herbivore* child = new Herbivore(x + rand() % 3 - 1, y + rand() % 3 - 1);
+                // 遗传变异
+                child->max_age = max(50, min(80, max_age + rand() % 11 - 5));
+                child->reproduction_threshold = max(25.0, min(35.0, reproduction_threshold + (rand() % 11 - 5)));
+                save_previous_state("繁殖");
+                return child;
+            }
+        }
+        return nullptr;
+    }
+
+    void save_extra(OrganismRecord& record) const override {
+        record.extra_int = migrated ? 1 : 0;
+    }
+    void load_extra(const OrganismRecord& record) override {
+        migrated = record.extra_int != 0;
+    }
+
+    string getSymbol() const override { return "H"; }
+    string getName() const override { return "食草动物"; }
+
+    bool canInhabit(TerrainType type) const override {
+        return type != WATER && type != VOLCANIC && type != MOUNTAIN && type != FLOODED;
+    }
+
+    void seasonal_effect(Environment& env) override {
+        // 秋季增加繁殖几率
+        if (fmod(env.season_progress, 1.0) > 0.6 && fmod(env.season_progress, 1.0) < 0.9) {
+            reproduction_chance = min(0.6, reproduction_chance * 1.2);
+        }
+    }
+
+    void weather_effect(Environment& env, const Terrain& terrain) override {
+        // 暴风雨影响食草动物
+        if (env.weather == STORMY) {
+            lose_energy(1.0);
+        }
+    }
+};
+
+// 鱼类
+class Fish : public Organism {
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_FISH; // 物种编号
+
+    Fish(int x, int y, double energy = 15.0) : Organism(x, y, energy, species_traits_table()[SPECIES]) {}
+
+    void move(TerrainMap& terrain, Environment& env) override {
+        // 在水中移动
+        int move_range = static_cast<int>(mobility * 3);
+        int new_x = x + rand() % (move_range * 2 + 1) - move_range;
+        int new_y = y + rand() % (move_range * 2 + 1) - move_range;
+
+        // 边界检查
+        new_x = max(0, min(terrain.get_width() - 1, new_x));
+        new_y = max(0, min(terrain.get_height() - 1, new_y));
+
+        // 只能在水中移动
+        if (terrain[new_y][new_x].type == WATER || terrain[new_y][new_x].type == FLOODED) {
+            x = new_x;
+            y = new_y;
+            save_previous_state("移动");
+        }
+
+        lose_energy(0.3);
+    }
+
+    void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const override {
+        // 只能在水域进食
+        if (terrain[y][x].type != WATER && terrain[y][x].type != FLOODED) {
+            intent.penalty = 1.0;
+            return;
+        }
+
+        // 寻找附近的水生植物或小型水生生物
+        for (Organism* org : organisms) {
+            if (in_diet(SPECIES, org) && org->getIsAquatic()) {
+                int dx = abs(x - org->getX());
+                int dy = abs(y - org->getY());
+                if (dx <= 2 && dy <= 2) {
+                    // 进食
+                    intent.claim(org, org->getEnergy() * 0.6, org->getEnergy(), "进食");
+                    return;
+                }
+            }
+        }
+    }
+
+    Organism* reproduce(vector<Organism*>& organisms) override {
+        if (can_reproduce()) {
+            // 检查附近是否有配偶
+            NearbyList nearby = find_nearby_species(organisms, 3);
+            if (nearby.size() > 1) {
+                energy *= 0.5;
+                Fish* child = new Fish(x + rand() % 2 - 1, y + rand() % 2 - 1);
+                // 遗传变异
+                child->reproduction_chance = max(0.3, min(0.4, reproduction_chance + (rand() % 11 - 5) * 0.01));
+                save_previous_state("繁殖");
+                return child;
+            }
+        }
+        return nullptr;
+    }
+
+    string getSymbol() const override { return "~"; }
+    string getName() const override { return "鱼类"; }
+
+    bool canInhabit(TerrainType type) const override {
+        return type == WATER || type == FLOODED;
+    }
+
+    void seasonal_effect(Environment& env) override {
+        // 水温变化影响鱼类
+        double temp_diff = abs(env.temperature - preferred_temp);
+        if (temp_diff > 5) {
+            reproduction_chance *= 0.8;
+        }
+    }
+
+    void weather_effect(Environment& env, const Terrain& terrain) override {
+        // 干旱对鱼类是灾难性的
+        if (env.weather == DROUGHT) {
+            lose_energy(2.0);
+        }
+        // 降雨有利鱼类
+        else if (env.weather == RAINY) {
+            gain_energy(0.2);
+        }
+    }
+};
+
+// 鸟类
+class Bird : public Organism {
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_BIRD; // 物种编号
+
+    Bird(int x, int y, double energy = 25.0) : Organism(x, y, energy, species_traits_table()[SPECIES]) {}
+
+    void move(TerrainMap& terrain, Environment& env) override {
+        // 鸟类可以长距离移动
+        int move_range = static_cast<int>(mobility * 8);
+        int new_x = x + rand() % (move_range * 2 + 1) - move_range;
+        int new_y = y + rand() % (move_range * 2 + 1) - move_range;
+
+        // 边界检查
+        new_x = max(0, min(terrain.get_width() - 1, new_x));
+        new_y = max(0, min(terrain.get_height() - 1, new_y));
+
+        // 鸟类可以跨越大部分地形
+        if (terrain[new_y][new_x].type != WATER) {
+            x = new_x;
+            y = new_y;
+            save_previous_state("飞行");
+        }
+
+        lose_energy(0.8);
+    }
+
+    void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const override {
+        // 寻找附近的昆虫、鱼类或小型动物
+        for (Organism* org : organisms) {
+            if (in_diet(SPECIES, org)) {
+                int dx = abs(x - org->getX());
+                int dy = abs(y - org->getY());
+                if (dx <= 3 && dy <= 3) {
+                    // 捕食
+                    intent.claim(org, org->getEnergy() * 0.7, org->getEnergy(), "进食");
+                    return;
+                }
+            }
+        }
+    }
+
+    Organism* reproduce(vector<Organism*>& organisms) override {
+        if (can_reproduce()) {
+            // 检查附近是否有配偶
+            NearbyList nearby = find_nearby_species(organisms, 10);
+            if (nearby.size() > 1) {
+                energy *= 0.5;
+                Bird* child = new Bird(x + rand() % 5 - 2, y + rand() % 5 - 2);
+                // 遗传变异
+                child->mobility = max(2.0, min(3.0, mobility + (rand() % 11 - 5) * 0.1));
+                save_previous_state("繁殖");
+                return child;
+            }
+        }
+        return nullptr;
+    }
+
+    string getSymbol() const override { return "B"; }  // 改为B避免与顶级掠食者冲突
+    string getName() const override { return "鸟类"; }
+
+    bool canInhabit(TerrainType type) const override {
+        return type != WATER && type != VOLCANIC;
+    }
+
+    void seasonal_effect(Environment& env) override {
+        // 春季增加繁殖几率
+        if (fmod(env.season_progress, 1.0) > 0.2 && fmod(env.season_progress, 1.0) < 0.5) {
+            reproduction_chance = min(0.5, reproduction_chance * 1.5);
+        }
+    }
+
+    void weather_effect(Environment& env, const Terrain& terrain) override {
+        // 暴风雨影响鸟类飞行
+        if (env.weather == STORMY) {
+            lose_energy(1.0);
+        }
+    }
+};
+
+// 分解者类（分解死亡生物）
+class Decomposer : public Organism {
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_DECOMPOSER; // 物种编号
+
+    Decomposer(int x, int y, double energy = 3.0) : Organism(x, y, energy, species_traits_table()[SPECIES]) {}
+
+    void move(TerrainMap& terrain, Environment& env) override {
+        // 缓慢移动
+        if (rand() % 5 == 0) {
+            animal_move(this, terrain, env, 2);
+        }
+        lose_energy(0.1);
+    }
+
+    void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const override {
+        // 检查地形是否适合
+        if (!canInhabit(terrain[y][x].type)) {
+            intent.penalty = 0.3;
+            return;
+        }
+
+        // 寻找附近死亡的生物
+        for (Organism* org : organisms) {
+            if (org->is_dead() && !dynamic_cast<Decomposer*>(org)) {
+                int dx = abs(x - org->getX());
+                int dy = abs(y - org->getY());
+                if (dx <= 1 && dy <= 1) {
+                    // 分解死亡生物
+                    intent.claim(org, org->getEnergy() * 0.8, org->getEnergy(), "分解");
+                    return;
+                }
+            }
+        }
+    }
+
+    void eat(Environment& env, TerrainMap& terrain, const FeedingIntent& intent, bool fed) override {
+        Organism::eat(env, terrain, intent, fed);
+
+        // 增加土壤肥力
+        if (fed && terrain[y][x].fertility < 1.0) {
+            terrain.mut(x, y).fertility = min(1.0, terrain[y][x].fertility + 0.01);
+        }
+    }
+
+    Organism* reproduce(vector<Organism*>& organisms) override {
+        if (can_reproduce()) {
+            energy /= 2;
+            Decomposer* child = new Decomposer(x + rand() % 2 - 1, y + rand() % 2 - 1);
+            // 遗传变异
+            child->disease_resistance = max(70, min(90, disease_resistance + rand() % 11 - 5));
+            save_previous_state("繁殖");
+            return child;
+        }
+        return nullptr;
+    }
+
+    string getSymbol() const override { return "D"; }
+    string getName() const override { return "分解者"; }
+
+    bool canInhabit(TerrainType type) const override {
+        return type != WATER && type != VOLCANIC && type != FLOODED;
+    }
+
+    void weather_effect(Environment& env, const Terrain& terrain) override {
+        // 雨天有利于分解者
+        if (env.weather == RAINY) {
+            gain_energy(0.1);
+        }
+    }
+};
+
+// 杂食动物类（既吃植物又吃小动物）
+class Omnivore : public Organism {
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_OMNIVORE; // 物种编号
+
+    Omnivore(int x, int y, double energy = 25.0) : Organism(x, y, energy, species_traits_table()[SPECIES]) {}
+
+    void move(TerrainMap& terrain, Environment& env) override {
+        animal_move(this, terrain, env, 3);
+    }
+
+    void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const override {
+        // 检查地形是否适合
+        if (!canInhabit(terrain[y][x].type)) {
+            intent.penalty = 1.0;
+            return;
+        }
+
+        // 干旱天气减少食物供应
+        double food_availability = 1.0;
+        if (env.weather == DROUGHT) {
+            food_availability = 0.8;
+        }
+
+        // 寻找附近的植物或小动物
+        vector<Organism*> potential_food;
+        for (Organism* org : organisms) {
+            if (in_diet(SPECIES, org)) {
+                int dx = abs(x - org->getX());
+                int dy = abs(y - org->getY());
+                if (dx <= 2 && dy <= 2) {
+                    potential_food.push_back(org);
+                }
+            }
+        }
+
+        // 选择最近的食物
+        if (!potential_food.empty()) {
+            sort(potential_food.begin(), potential_food.end(),
+                [this](Organism* a, Organism* b) {
+                    int dx1 = abs(x - a->getX());
+                    int dy1 = abs(y - a->getY());
+                    int dx2 = abs(x - b->getX());
+                    int dy2 = abs(y - b->getY());
+                    return (dx1 + dy1) < (dx2 + dy2);
+                });
+
+            Organism* target = potential_food[0];
+            intent.claim(target, target->getEnergy() * 0.5 * food_availability, target->getEnergy(), "进食");
+            return;
+        }
+    }
+
+    Organism* reproduce(vector<Organism*>& organisms) override {
+        if (can_reproduce()) {
+            // 检查附近是否有配偶
+            NearbyList nearby = find_nearby_species(organisms, 5);
+            if (nearby.size() > 1) {
+                energy *= 0.4;
+                Omnivore* child = new Omnivore(x + rand() % 3 - 1, y + rand() % 3 - 1);
+                // 遗传变异
+                child->reproduction_threshold = max(30.0, min(40.0, reproduction_threshold + (rand() % 11 - 5)));
+                save_previous_state("繁殖");
+                return child;
+            }
+        }
+        return nullptr;
+    }
+
+    string getSymbol() const override { return "O"; }
+    string getName() const override { return "杂食动物"; }
+
+    bool canInhabit(TerrainType type) const override {
+        return type != WATER && type != VOLCANIC && type != FLOODED;
+    }
+
+    void weather_effect(Environment& env, const Terrain& terrain) override {
+        // 暴风雨影响
+        if (env.weather == STORMY) {
+            lose_energy(1.0);
+        }
+    }
+};
+
+// 食肉动物类
+class Carnivore : public Organism {
+protected:
+    int hunting_skill; // 狩猎技能 (0-100)
+
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_CARNIVORE; // 物种编号
+
+    Carnivore(int x, int y, double energy = 30.0) : Organism(x, y, energy, species_traits_table()[SPECIES]) {
+        hunting_skill = 50 + rand() % 40; // 50-90
+    }
+
+    void move(TerrainMap& terrain, Environment& env) override {
+        animal_move(this, terrain, env, 4);
+    }
+
+    void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const override {
+        // 检查地形是否适合
+        if (!canInhabit(terrain[y][x].type)) {
+            intent.penalty = 1.5;
+            return;
+        }
+
+        // 寻找附近的食草动物或杂食动物
+        vector<Organism*> prey_list;
+        for (Organism* org : organisms) {
+            if (in_diet(SPECIES, org)) {
+                int dx = abs(x - org->getX());
+                int dy = abs(y - org->getY());
+                if (dx <= 3 && dy <= 3) {
+                    prey_list.push_back(org);
+                }
+            }
+        }
+
+        // 选择猎物
+        if (!prey_list.empty()) {
+            // 选择最弱的猎物
+            sort(prey_list.begin(), prey_list.end(),
+                [](Organism* a, Organism* b) {
+                    return a->getEnergy() < b->getEnergy();
+                });
+
+            Organism* target = prey_list[0];
+
+            // 狩猎成功概率取决于狩猎技能
+            if (intent.roll * 100 < hunting_skill) {
+                intent.claim(target, target->getEnergy() * 0.7, target->getEnergy(), "捕猎成功");
+            }
+            else {
+                // 狩猎失败也消耗能量
+                intent.penalty = 2.0;
+                intent.status = "捕猎失败";
+            }
+            return;
+        }
+
+        // 食肉动物在炎热环境中消耗更多能量
+        if (env.temperature > 35) intent.penalty = 2.0;
+    }
+
+    Organism* reproduce(vector<Organism*>& organisms) override {
+        if (can_reproduce()) {
+            // 检查附近是否有配偶
+            NearbyList nearby = find_nearby_species(organisms, 8);
+            if (nearby.size() > 1) {
+                energy *= 0.4;
+                Carnivore* child = new Carnivore(x + rand() % 2 - 1, y + rand() % 2 - 1);
+                // 后代继承部分狩猎技能
+                child->hunting_skill = max(20, min(100, hunting_skill - 10 + rand() % 20));
+                // 遗传变异
+                child->mobility = max(1.5, min(2.2, mobility + (rand() % 11 - 5) * 0.05));
+                save_previous_state("繁殖");
+                return child;
+            }
+        }
+        return nullptr;
+    }
+
+    void save_extra(OrganismRecord& record) const override {
+        record.extra_int = hunting_skill;
+    }
+    void load_extra(const OrganismRecord& record) override {
+        hunting_skill = record.extra_int;
+    }
+
+    string getSymbol() const override { return "C"; }
+    string getName() const override { return "食肉动物"; }
+
+    bool canInhabit(TerrainType type) const override {
+        return type != WATER && type != VOLCANIC && type != FLOODED;
+    }
+
+    void weather_effect(Environment& env, const Terrain& terrain) override {
+        // 暴风雨影响狩猎
+        if (env.weather == STORMY) {
+            lose_energy(1.0);
+        }
+    }
+};
+
+// 顶级掠食者类
+class ApexPredator : public Organism {
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_APEX_PREDATOR; // 物种编号
+
+    ApexPredator(int x, int y, double energy = 50.0) : Organism(x, y, energy, species_traits_table()[SPECIES]) {}
+
+    void move(TerrainMap& terrain, Environment& env) override {
+        animal_move(this, terrain, env, 5);
+    }
+
+    void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const override {
+        // 检查地形是否适合
+        if (!canInhabit(terrain[y][x].type)) {
+            intent.penalty = 2.0;
+            return;
+        }
+
+        // 寻找附近的食肉动物或杂食动物
+        for (Organism* org : organisms) {
+            if (in_diet(SPECIES, org)) {
+                int dx = abs(x - org->getX());
+                int dy = abs(y - org->getY());
+                if (dx <= 4 && dy <= 4) {
+                    // 捕食
+                    intent.claim(org, org->getEnergy() * 0.8, org->getEnergy(), "捕食");
+                    return;
+                }
+            }
+        }
+    }
+
+    Organism* reproduce(vector<Organism*>& organisms) override {
+        if (can_reproduce()) {
+            // 检查附近是否有配偶
+            NearbyList nearby = find_nearby_species(organisms, 15);
+            if (nearby.size() > 1) {
+                energy *= 0.3;
+                ApexPredator* child = new ApexPredator(x + rand() % 3 - 1, y + rand() % 3 - 1);
+                // 遗传变异
+                child->max_age = max(70, min(90, max_age + rand() % 11 - 5));
+                save_previous_state("繁殖");
+                return child;
+            }
+        }
+        return nullptr;
+    }
+
+    string getSymbol() const override { return "X"; } // 改为X避免与水生植物冲突
+    string getName() const override { return "顶级掠食者"; }
+
+    bool canInhabit(TerrainType type) const override {
+        return type != WATER && type != VOLCANIC && type != FLOODED;
+    }
+
+    void seasonal_effect(Environment& env) override {
+        // 冬季减少活动
+        if (fmod(env.season_progress, 1.0) > 0.7 || fmod(env.season_progress, 1.0) < 0.3) {
+            mobility *= 0.8;
+        }
+    }
+
+    void weather_effect(Environment& env, const Terrain& terrain) override {
+        // 暴风雨影响顶级掠食者
+        if (env.weather == STORMY) {
+            lose_energy(1.5);
+        }
+    }
+};
+
+// 寄生生物类
+class Parasite : public Organism {
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_PARASITE; // 物种编号
+
+    Parasite(int x, int y, double energy = 2.0) : Organism(x, y, energy, species_traits_table()[SPECIES]) {}
+
+    void move(TerrainMap& terrain, Environment& env) override {
+        // 寄生生物不主动移动，依附宿主移动
+    }
+
+    void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const override {
+        // 寄生在宿主身上获取能量（不独占宿主，多个寄生虫可以同时寄生）
+        for (Organism* org : organisms) {
+            if (in_diet(SPECIES, org) && !org->is_dead()) {
+                int dx = abs(x - org->getX());
+                int dy = abs(y - org->getY());
+                if (dx == 0 && dy == 0) {
+                    // 从宿主获取能量
+                    double energy_taken = min(0.1, org->getEnergy() * 0.05);
+                    intent.claim(org, energy_taken, energy_taken, "寄生", false);
+                    return;
+                }
+            }
+        }
+    }
+
+    void eat(Environment& env, TerrainMap& terrain, const FeedingIntent& intent, bool fed) override {
+        Organism::eat(env, terrain, intent, fed);
+
+        // 传播疾病
+        if (fed && rand() % 100 < 20) {
+            intent.target->contract_disease(env.disease);
+        }
+    }
+
+    Organism* reproduce(vector<Organism*>& organisms) override {
+        if (can_reproduce()) {
+            energy /= 2;
+            Parasite* child = new Parasite(x, y);
+            // 遗传变异
+            child->reproduction_chance = max(0.5, min(0.7, reproduction_chance + (rand() % 11 - 5) * 0.01));
+            save_previous_state("繁殖");
+            return child;
+        }
+        return nullptr;
+    }
+
+    string getSymbol() const override { return "*"; }
+    string getName() const override { return "寄生生物"; }
+
+    bool canInhabit(TerrainType type) const override {
+        return true; // 寄生生物可以存在于任何地形
+    }
+};
+
+// 爬行动物
+class Reptile : public Organism {
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_REPTILE; // 物种编号
+
+    Reptile(int x, int y, double energy = 22.0) : Organism(x, y, energy, species_traits_table()[SPECIES]) {}
+
+    void move(TerrainMap& terrain, Environment& env) override {
+        animal_move(this, terrain, env, 3);
+    }
+
+    void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const override {
+        // 检查地形是否适合
+        if (!canInhabit(terrain[y][x].type)) {
+            intent.penalty = 1.0;
+            return;
+        }
+
+        // 寻找附近的昆虫、小型哺乳动物或蛋
+        for (Organism* org : organisms) {
+            if (in_diet(SPECIES, org)) {
+                int dx = abs(x - org->getX());
+                int dy = abs(y - org->getY());
+                if (dx <= 2 && dy <= 2) {
+                    // 捕食
+                    intent.claim(org, org->getEnergy() * 0.6, org->getEnergy(), "进食");
+                    return;
+                }
+            }
+        }
+    }
+
+    Organism* reproduce(vector<Organism*>& organisms) override {
+        if (can_reproduce()) {
+            // 检查附近是否有配偶
+            NearbyList nearby = find_nearby_species(organisms, 4);
+            if (nearby.size() > 1) {
+                energy *= 0.5;
+                Reptile* child = new Reptile(x + rand() % 2 - 1, y + rand() % 2 - 1);
+                // 遗传变异
+                child->preferred_temp = max(25.0, min(35.0, preferred_temp + (rand() % 11 - 5)));
+                save_previous_state("繁殖");
+                return child;
+            }
+        }
+        return nullptr;
+    }
+
+    string getSymbol() const override { return "R"; }
+    string getName() const override { return "爬行动物"; }
+
+    bool canInhabit(TerrainType type) const override {
+        return type != WATER && type != SNOW && type != VOLCANIC && type != FLOODED;
+    }
+
+    void handle_hibernation(Environment& env) override {
+        // 爬行动物更早开始冬眠
+        if (env.temperature < 10) {
+            is_hibernating = true;
+            lose_energy(0.05);
+        }
+        else if (env.temperature > 15) {
+            is_hibernating = false;
+        }
+    }
+
+    bool can_sleep(Environment& env, SleepPlan& plan) const override {
+        if (!is_hibernating || has_disease) return false;
+        plan.wake_temperature = 15.0;
+        plan.wake_on_rain = false;
+        plan.days = safe_sleep_days(env, 0.05, 0.0);
+        return plan.days > 1;
+    }
+
+    void weather_effect(Environment& env, const Terrain& terrain) override {
+        // 雨天爬行动物更活跃
+        if (env.weather == RAINY) {
+            gain_energy(0.1);
+        }
+    }
+};
+
+// 两栖动物
+class Amphibian : public Organism {
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_AMPHIBIAN; // 物种编号
+
+    Amphibian(int x, int y, double energy = 18.0) : Organism(x, y, energy, species_traits_table()[SPECIES]) {}
+
+    void move(TerrainMap& terrain, Environment& env) override {
+        animal_move(this, terrain, env, 3);
+    }
+
+    void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const override {
+        // 寻找附近的昆虫或小型水生生物
+        for (Organism* org : organisms) {
+            if (in_diet(SPECIES, org)) {
+                int dx = abs(x - org->getX());
+                int dy = abs(y - org->getY());
+                if (dx <= 2 && dy <= 2) {
+                    // 捕食
+                    intent.claim(org, org->getEnergy() * 0.7, org->getEnergy(), "进食");
+                    return;
+                }
+            }
+        }
+    }
+
+    Organism* reproduce(vector<Organism*>& organisms) override {
+        if (can_reproduce()) {
+            // 检查附近是否有配偶
+            NearbyList nearby = find_nearby_species(organisms, 4);
+            if (nearby.size() > 1) {
+                energy *= 0.5;
+                Amphibian* child = new Amphibian(x + rand() % 2 - 1, y + rand() % 2 - 1);
+                // 遗传变异
+                child->flood_resistance = max(0.7, min(0.9, flood_resistance + (rand() % 11 - 5) * 0.01));
+                save_previous_state("繁殖");
+                return child;
+            }
+        }
+        return nullptr;
+    }
+
+    string getSymbol() const override { return "M"; }
+    string getName() const override { return "两栖动物"; }
+
+    bool canInhabit(TerrainType type) const override {
+        return type == WATER || type == MARSH || type == PLAIN || type == FOREST || type == FLOODED;
+    }
+
+    void seasonal_effect(Environment& env) override {
+        // 雨季增加活动
+        if (env.rainfall > 50) {
+            mobility *= 1.2;
+            reproduction_chance *= 1.3;
+        }
+    }
+
+    void weather_effect(Environment& env, const Terrain& terrain) override {
+        // 雨天两栖动物更活跃
+        if (env.weather == RAINY) {
+            gain_energy(0.2);
+            reproduction_chance = min(0.5, reproduction_chance * 1.2);
+        }
+        // 干旱对两栖动物不利
+        else if (env.weather == DROUGHT) {
+            lose_energy(1.0);
+        }
+    }
+};
+
+// 食腐动物
+class Scavenger : public Organism {
+public:
+    static constexpr SpeciesType SPECIES = SPECIES_SCAVENGER; // 物种编号
+
+    Scavenger(int x, int y, double energy = 15.0) : Organism(x, y, energy, species_traits_table()[SPECIES]) {}
+
+    void move(TerrainMap& terrain, Environment& env) override {
+        animal_move(this, terrain, env, 4);
+    }
+
+    void forage(Environment& env, const vector<Organism*>& organisms, const TerrainMap& terrain, FeedingIntent& intent) const override {
+        // 检查地形是否适合
+        if (!canInhabit(terrain[y][x].type)) {
+            intent.penalty = 0.8;
+            return;
+        }
+
+        // 寻找附近死亡的生物
+        for (Organism* org : organisms) {
+            if (org->is_dead() && !dynamic_cast<Decomposer*>(org)) {
+                int dx = abs(x - org->getX());
+                int dy = abs(y - org->getY());
+                if (dx <= 3 && dy <= 3) {
+                    // 吃腐肉
+                    intent.claim(org, org->getEnergy() * 0.7, org->getEnergy(), "食腐");
+                    return;
+                }
+            }
+        }
+    }
+
+    void eat(Environment& env, TerrainMap& terrain, const FeedingIntent& intent, bool fed) override {
+        Organism::eat(env, terrain, intent, fed);
+
+        // 可能感染疾病
+        if (fed && rand() % 100 < 20) {
+            contract_disease(env.disease);
+        }
+    }
+
+    Organism* reproduce(vector<Organism*>& organisms) override {
+        if (can_reproduce()) {
+            // 检查附近是否有配偶
+            NearbyList nearby = find_nearby_species(organisms, 5);
+            if (nearby.size() > 1) {
+                energy *= 0.5;
+                Scavenger* child = new Scavenger(x + rand() % 3 - 1, y + rand() % 3 - 1);
+                // 遗传变异
+                child->disease_resistance = max(65, min(85, disease_resistance + rand() % 11 - 5));
+                save_previous_state("繁殖");
+                return child;
+            }
+        }
+        return nullptr;
+    }
+
+    string getSymbol() const override { return "S"; }
+    string getName() const override { return "食腐动物"; }
+
+    bool canInhabit(TerrainType type) const override {
+        return type != WATER && type != VOLCANIC && type != FLOODED;
+    }
+};
+
+// 按物种编号创建生物
+Organism* create_organism(SpeciesType species, int x, int y) {
+    switch (species) {
+    case SPECIES_PLANT: return new Plant(x, y);
+    case SPECIES_TREE: return new Tree(x, y);
+    case SPECIES_AQUATIC_PLANT: return new AquaticPlant(x, y);
+    case SPECIES_INSECT: return new Insect(x, y);
+    case SPECIES_FLYING_INSECT: return new FlyingInsect(x, y);
+    case SPECIES_HERBIVORE: return new Herbivore(x, y);
+    case SPECIES_FISH: return new Fish(x, y);
+    case SPECIES_BIRD: return new Bird(x, y);
+    case SPECIES_DECOMPOSER: return new Decomposer(x, y);
+    case SPECIES_OMNIVORE: return new Omnivore(x, y);
+    case SPECIES_CARNIVORE: return new Carnivore(x, y);
+    case SPECIES_APEX_PREDATOR: return new ApexPredator(x, y);
+    case SPECIES_PARASITE: return new Parasite(x, y);
+    case SPECIES_REPTILE: return new Reptile(x, y);
+    case SPECIES_AMPHIBIAN: return new Amphibian(x, y);
+    case SPECIES_SCAVENGER: return new Scavenger(x, y);
+    default: return nullptr;
+    }
+}
+
+// 按平坦记录重建生物（保留原编号，用于迁入和边界副本）
+Organism* create_organism(const OrganismRecord& record) {
+    Organism* org = create_organism(static_cast<SpeciesType>(record.species), record.x, record.y);
+    if (org) {
+        org->load_record(record);
+    }
+    return org;
+}
+
+// 休眠调度器（时间轮）
+// 休眠的生物不参与每天的更新：按预定唤醒日放入时间轮的槽中，
+// 同时按唤醒气温和降雨登记环境触发，条件满足时整批唤醒。
+// 每个生物记录自己在各列表中的位置，取消休眠（被捕食、死亡）为O(1)
+class SleepScheduler {
+private:
+    vector<vector<Organism*>> wheel;             // 按唤醒日取模的槽
+    map<double, vector<Organism*>> warm_waiters; // 唤醒气温 -> 等待升温的生物
+    vector<Organism*> rain_waiters;              // 等待降雨的生物
+    size_t sleeping;
+
+    // 从列表中交换删除，并更新被移动元素记录的位置
+    static void remove_at(vector<Organism*>& list, int index, int SleepHandle::* position) {
+        Organism* last = list.back();
+        list[index] = last;
+        last->getSleepHandle().*position = index;
+        list.pop_back();
+    }
+
+public:
+    SleepScheduler() : wheel(SLEEP_WHEEL_SLOTS), sleeping(0) {}
+
+    // 让生物从today之后开始休眠，最迟在today + plan.days唤醒
+    void schedule(Organism* org, int today, const SleepPlan& plan) {
+        SleepHandle& handle = org->getSleepHandle();
+        handle.since = today;
+        handle.wake_day = today + plan.days;
+
+        vector<Organism*>& slot = wheel[handle.wake_day % SLEEP_WHEEL_SLOTS];
+        handle.wheel_index = static_cast<int>(slot.size());
+        slot.push_back(org);
+
+        vector<Organism*>& warm = warm_waiters[plan.wake_temperature];
+        handle.wake_temperature = plan.wake_temperature;
+        handle.warm_index = static_cast<int>(warm.size());
+        warm.push_back(org);
+
+        handle.rain_index = -1;
+        if (plan.wake_on_rain) {
+            handle.rain_index = static_cast<int>(rain_waiters.size());
+            rain_waiters.push_back(org);
+        }
+        sleeping++;
+    }
+
+    // 取消休眠（不结算）
+    void cancel(Organism* org) {
+        SleepHandle& handle = org->getSleepHandle();
+        if (handle.since < 0) return;
+
+        remove_at(wheel[handle.wake_day % SLEEP_WHEEL_SLOTS], handle.wheel_index, &SleepHandle::wheel_index);
+
+        auto warm = warm_waiters.find(handle.wake_temperature);
+        remove_at(warm->second, handle.warm_index, &SleepHandle::warm_index);
+        if (warm->second.empty()) {
+            warm_waiters.erase(warm);
+        }
+
+        if (handle.rain_index >= 0) {
+            remove_at(rain_waiters, handle.rain_index, &SleepHandle::rain_index);
+        }
+        handle = SleepHandle();
+        sleeping--;
+    }
+
+    // 取出今天到期或被环境触发的生物（已从调度器中移除，返回的生物保留开始休眠的日期供结算）
+    // 环境触发按生物所在位置判断：warm(org, t)为该处气温是否高于t，rain(org)为该处是否在下雨。
+    // max_temperature为今天各处的最高气温，唤醒气温不低于它的生物不必逐个检查；any_rain为false时没有地方下雨
+    template <class Warm, class Rain>
+    void collect_due(int today, double max_temperature, bool any_rain, Warm warm, Rain rain,
+        vector<pair<Organism*, int>>& woken) {
+        auto wake = [&](Organism* org) {
+            woken.push_back(make_pair(org, org->getSleepHandle().since));
+            cancel(org);
+        };
+
+        vector<Organism*>& slot = wheel[today % SLEEP_WHEEL_SLOTS];
+        while (!slot.empty()) {
+            wake(slot.back());
+        }
+
+        // 先找出被触发的生物再唤醒：唤醒会修改正在遍历的列表
+        vector<Organism*> triggered;
+        for (auto it = warm_waiters.begin(); it != warm_waiters.end() && it->first < max_temperature; ++it) {
+            for (Organism* org : it->second) {
+                if (warm(org, it->first)) triggered.push_back(org);
+            }
+        }
+        if (any_rain) {
+            for (Organism* org : rain_waiters) {
+                if (rain(org)) triggered.push_back(org);
+            }
+        }
+        for (Organism* org : triggered) {
+            if (org->is_sleeping()) wake(org); // 同时被升温和降雨触发的只唤醒一次
+        }
+    }
+
+    void clear() {
+        for (vector<Organism*>& slot : wheel) {
+            for (Organism* org : slot) {
+                org->getSleepHandle() = SleepHandle();
+            }
+            slot.clear();
+        }
+        warm_waiters.clear();
+        rain_waiters.clear();
+        sleeping = 0;
+    }
+
+    size_t size() const { return sleeping; }
+
+    size_t memory_bytes() const {
+        size_t bytes = (wheel.capacity() * sizeof(vector<Organism*>)) + rain_waiters.capacity() * sizeof(Organism*);
+        for (const vector<Organism*>& slot : wheel) bytes += slot.capacity() * sizeof(Organism*);
+        for (const auto& entry : warm_waiters) bytes += sizeof(entry) + entry.second.capacity() * sizeof(Organism*);
+        return bytes;
+    }
+};
+
+// 天气场参数
+const int WEATHER_CELL_SIZE = 32;          // 默认天气格边长（世界格）
+const float WEATHER_DIFFUSION = 0.1f;      // 每天流向每个相邻格的比例
+const float WEATHER_PRECIP_DECAY = 0.35f;  // 降水每天消散的比例
+const float WEATHER_CLOUD_DECAY = 0.25f;   // 云量每天消散的比例
+const float WEATHER_ANOMALY_DECAY = 0.15f; // 温度距平每天回归的比例
+const double WEATHER_WIND_SPEED = 16.0;    // 风速（世界格/天）
+const float WEATHER_RAIN_THRESHOLD = 15.0f; // 局地降水量超过此值时下雨（或下雪）
+
+// 天气场：降水、温度距平和云量三个粗粒度二维场
+// 全局天气（由季节决定）只决定当天生成的天气系统，天气系统随风平流、扩散并逐渐消散，
+// 各格的局地天气由所在位置的双线性插值得到。场的更新只依赖种子、日期和全局环境，
+// 所以多进程运行时各进程各自计算出相同的天气场
+class WeatherField {
+private:
+    int cell_size;           // 天气格边长（世界格）
+    int cells_x, cells_y;
+    int stride;              // 每行的存储宽度（两侧各有一个边框格）
+    vector<float> precipitation; // 降水量 (mm)
+    vector<float> anomaly;       // 温度距平 (°C)
+    vector<float> cloud;         // 云量 (0-1)
+    vector<float> scratch;       // 平流和扩散的中间结果
+    float wind_x, wind_y;        // 当天的风（天气格/天）
+
+    size_t index(int cx, int cy) const {
+        return static_cast<size_t>(cy + 1) * stride + (cx + 1);
+    }
+
+    // 按种子、日期和序号生成的[0,1)随机数
+    static double noise(unsigned int seed, int day, int k, int salt) {
+        return hash_coords(seed, day, k, salt) / 4294967296.0;
+    }
+
+    // 半拉格朗日平流：每格沿风向回溯取上游的双线性插值
+    void advect(vector<float>& field) {
+        for (int cy = 0; cy < cells_y; cy++) {
+            float sy = max(0.0f, min(static_cast<float>(cells_y - 1), cy - wind_y));
+            int y0 = min(cells_y - 2, static_cast<int>(sy));
+            if (y0 < 0) y0 = 0;
+            float fy = cells_y > 1 ? sy - y0 : 0.0f;
+            int y1 = min(cells_y - 1, y0 + 1);
+            const float* row0 = &field[index(0, y0)];
+            const float* row1 = &field[index(0, y1)];
+            float* out = &scratch[index(0, cy)];
+            for (int cx = 0; cx < cells_x; cx++) {
+                float sx = max(0.0f, min(static_cast<float>(cells_x - 1), cx - wind_x));
+                int x0 = max(0, min(cells_x - 2, static_cast<int>(sx)));
+                float fx = cells_x > 1 ? sx - x0 : 0.0f;
+                int x1 = min(cells_x - 1, x0 + 1);
+                float top = row0[x0] + (row0[x1] - row0[x0]) * fx;
+                float bottom = row1[x0] + (row1[x1] - row1[x0]) * fx;
+                out[cx] = top + (bottom - top) * fy;
+            }
+        }
+        field.swap(scratch);
+    }
+
+    // 五点扩散并按比例衰减（边框格复制相邻格，零通量边界），内层循环无分支可向量化
+    void diffuse(vector<float>& field, float decay) {
+        for (int cx = 0; cx < cells_x; cx++) {
+            field[index(cx, -1)] = field[index(cx, 0)];
+            field[index(cx, cells_y)] = field[index(cx, cells_y - 1)];
+        }
+        for (int cy = -1; cy <= cells_y; cy++) {
+            field[index(-1, cy)] = field[index(0, cy)];
+            field[index(cells_x, cy)] = field[index(cells_x - 1, cy)];
+        }
+        const float keep = (1.0f - decay) * (1.0f - 4.0f * WEATHER_DIFFUSION);
+        const float spread = (1.0f - decay) * WEATHER_DIFFUSION;
+        for (int cy = 0; cy < cells_y; cy++) {
+            const float* row = &field[index(0, cy)];
+            const float* up = row - stride;
+            const float* down = row + stride;
+            float* out = &scratch[index(0, cy)];
+            for (int cx = 0; cx < cells_x; cx++) {
+                out[cx] = keep * row[cx] + spread * (row[cx - 1] + row[cx + 1] + up[cx] + down[cx]);
+            }
+        }
+        field.swap(scratch);
+    }
+
+    // 在(cx, cy)处叠加一个半径为radius的高斯形天气系统
+    void add_system(vector<float>& field, float cx, float cy, float radius, float amount) {
+        int r = static_cast<int>(radius * 2) + 1;
+        for (int y = max(0, static_cast<int>(cy) - r); y <= min(cells_y - 1, static_cast<int>(cy) + r); y++) {
+            for (int x = max(0, static_cast<int>(cx) - r); x <= min(cells_x - 1, static_cast<int>(cx) + r); x++) {
+                float d2 = ((x - cx) * (x - cx) + (y - cy) * (y - cy)) / (radius * radius);
+                field[index(x, y)] += amount * exp(-d2);
+            }
+        }
+    }
+
+    // 世界坐标处的双线性插值
+    float sample(const vector<float>& field, int x, int y) const {
+        float fx = max(0.0f, min(static_cast<float>(cells_x - 1), (x + 0.5f) / cell_size - 0.5f));
+        float fy = max(0.0f, min(static_cast<float>(cells_y - 1), (y + 0.5f) / cell_size - 0.5f));
+        int x0 = static_cast<int>(fx), y0 = static_cast<int>(fy);
+        int x1 = min(cells_x - 1, x0 + 1), y1 = min(cells_y - 1, y0 + 1);
+        fx -= x0;
+        fy -= y0;
+        float top = field[index(x0, y0)] + (field[index(x1, y0)] - field[index(x0, y0)]) * fx;
+        float bottom = field[index(x0, y1)] + (field[index(x1, y1)] - field[index(x0, y1)]) * fx;
+        return top + (bottom - top) * fy;
+    }
+
+public:
+    WeatherField() : cell_size(WEATHER_CELL_SIZE), cells_x(0), cells_y(0), stride(0), wind_x(0), wind_y(0) {}
+
+    void configure(int world_width, int world_height, int new_cell_size) {
+        cell_size = new_cell_size;
+        cells_x = max(1, (world_width + cell_size - 1) / cell_size);
+        cells_y = max(1, (world_height + cell_size - 1) / cell_size);
+        stride = cells_x + 2;
+        size_t size = static_cast<size_t>(stride) * (cells_y + 2);
+        precipitation.assign(size, 0.0f);
+        anomaly.assign(size, 0.0f);
+        cloud.assign(size, 0.0f);
+        scratch.assign(size, 0.0f);
+    }
+
+    int get_cells_x() const { return cells_x; }
+    int get_cells_y() const { return cells_y; }
+
+    // 推进一天：平流、扩散和消散，再按当天的全局天气生成新的天气系统
+    void step(const Environment& env, unsigned int seed, int day) {
+        // 风向每天缓慢变化，风速随机波动
+        double angle = 6.2832 * (noise(seed, day / 8, 0, 11) + (day % 8) / 8.0 * 0.25);
+        double speed = WEATHER_WIND_SPEED * (0.5 + noise(seed, day, 0, 12)) / cell_size;
+        wind_x = static_cast<float>(cos(angle) * speed);
+        wind_y = static_cast<float>(sin(angle) * speed);
+
+        advect(precipitation);
+        advect(cloud);
+        advect(anomaly);
+        diffuse(precipitation, WEATHER_PRECIP_DECAY);
+        diffuse(cloud, WEATHER_CLOUD_DECAY);
+        diffuse(anomaly, WEATHER_ANOMALY_DECAY);
+
+        // 当天生成的天气系统（数量和强度取决于全局天气）
+        int systems = 0;
+        float rain = 0.0f, clouds = 0.0f;
+        switch (env.weather) {
+        case RAINY: systems = 2; rain = 1.0f; clouds = 0.6f; break;
+        case STORMY: systems = 3; rain = 2.5f; clouds = 0.8f; break;
+        case SNOWY: systems = 2; rain = 1.0f; clouds = 0.6f; break;
+        case CLOUDY: systems = 2; rain = 0.1f; clouds = 0.7f; break;
+        default: break;
+        }
+        float radius = max(1.5f, min(cells_x, cells_y) / 5.0f);
+        for (int i = 0; i < systems; i++) {
+            float cx = static_cast<float>(noise(seed, day, i, 13) * cells_x);
+            float cy = static_cast<float>(noise(seed, day, i, 14) * cells_y);
+            add_system(precipitation, cx, cy, radius, rain * static_cast<float>(env.rainfall));
+            add_system(cloud, cx, cy, radius * 1.5f, clouds);
+        }
+
+        // 冷暖气团
+        float sign = noise(seed, day, 0, 15) < 0.5 ? -1.0f : 1.0f;
+        add_system(anomaly, static_cast<float>(noise(seed, day, 0, 16) * cells_x),
+            static_cast<float>(noise(seed, day, 0, 17) * cells_y), radius * 2, sign * 3.0f);
+    }
+
+    // 该位置的局地天气、降水量和气温
+    WeatherType local_weather(const Environment& env, int x, int y, double& rainfall, double& temperature) const {
+        if (cells_x == 0) {
+            rainfall = env.rainfall;
+            temperature = env.temperature;
+            return env.weather;
+        }
+        rainfall = min(100.0, static_cast<double>(sample(precipitation, x, y)));
+        temperature = env.temperature + sample(anomaly, x, y);
+        if (rainfall > 60.0) return temperature < 0 ? SNOWY : STORMY;
+        if (rainfall > WEATHER_RAIN_THRESHOLD) return temperature < 0 ? SNOWY : RAINY;
+        if (sample(cloud, x, y) > 0.5f) return CLOUDY;
+        return env.weather == DROUGHT ? DROUGHT : SUNNY;
+    }
+
+    // 局地环境：在全局环境的基础上替换为该位置的降水、气温和天气
+    void local_environment(const Environment& env, int x, int y, Environment& local) const {
+        local = env;
+        local.weather = local_weather(env, x, y, local.rainfall, local.temperature);
+    }
+
+    // 今天各处的最高气温
+    double peak_temperature(const Environment& env) const {
+        if (cells_x == 0) return env.temperature;
+        float peak = anomaly[index(0, 0)];
+        for (int cy = 0; cy < cells_y; cy++) {
+            for (int cx = 0; cx < cells_x; cx++) {
+                peak = max(peak, anomaly[index(cx, cy)]);
+            }
+        }
+        return env.temperature + peak;
+    }
+
+    // 今天是否有地方在下雨（降水量达到local_weather中降雨的阈值）
+    bool may_rain(const Environment& env) const {
+        if (cells_x == 0) return env.weather == RAINY || env.weather == STORMY;
+        return peak_precipitation() > WEATHER_RAIN_THRESHOLD;
+    }
+
+    // 整个场中的最大降水量
+    float peak_precipitation() const {
+        float peak = 0.0f;
+        for (int cy = 0; cy < cells_y; cy++) {
+            for (int cx = 0; cx < cells_x; cx++) {
+                peak = max(peak, precipitation[index(cx, cy)]);
+            }
+        }
+        return peak;
+    }
+
+    // 云量超过一半的天气格比例
+    double cloud_cover() const {
+        int covered = 0;
+        for (int cy = 0; cy < cells_y; cy++) {
+            for (int cx = 0; cx < cells_x; cx++) {
+                if (cloud[index(cx, cy)] > 0.5f) covered++;
+            }
+        }
+        return cells_x * cells_y > 0 ? static_cast<double>(covered) / (cells_x * cells_y) : 0.0;
+    }
+
+    size_t memory_bytes() const {
+        return (precipitation.capacity() + anomaly.capacity() + cloud.capacity() + scratch.capacity()) * sizeof(float);
+    }
+};
+
+// 疫病压力格边长（2的幂），8x8个世界格为一格
+const int EPIDEMIC_CELL_SHIFT = 3;
+// 压力格按页分配，一页与一个地形分块一样大（8x8个压力格）
+const int EPIDEMIC_PAGE_SHIFT = TERRAIN_TILE_SHIFT - EPIDEMIC_CELL_SHIFT;
+const int EPIDEMIC_PAGE_SIZE = 1 << EPIDEMIC_PAGE_SHIFT;
+
+// 疫病传播参数
+const float EPIDEMIC_SHEDDING = 0.5f;     // 每个患病个体每天向所在格释放的病原量
+const float EPIDEMIC_DIFFUSION = 0.1f;    // 每天流向每个相邻格的比例
+const float EPIDEMIC_DECAY = 0.15f;       // 病原每天的自然衰减比例
+const double EPIDEMIC_TRANSMISSION = 0.5; // 压力为1时每天的接触概率（之后仍由个体抵抗力决定是否感染）
+
+// 疫病压力场（SIR模型的空间版本）
+// 患病个体向所在格释放病原，病原按五点模板扩散并衰减，易感个体按所在格的压力接触感染。
+// 压力格按页存储，只有有病原的页才分配：未分配的页压力为0，病原扩散到页的边上时才分配相邻的页，
+// 压力全部降为0的页被释放，所以内存和每天的代价只与疫情波及的范围成正比
+class EpidemicField {
+private:
+    static const int PAGE_CELLS = EPIDEMIC_PAGE_SIZE * EPIDEMIC_PAGE_SIZE;
+
+    // 一页压力格（双缓冲，current指出当前的一半）
+    struct Page {
+        float pressure[2][PAGE_CELLS];
+    };
+
+    int origin_x, origin_y; // 覆盖区域左上角（世界坐标）
+    int cells_x, cells_y;
+    int pages_x, pages_y;
+    vector<unique_ptr<Page>> pages;
+    vector<int> active;     // 已分配的页
+    int current;
+    bool empty;             // 压力全为0（无疫情时跳过扩散）
+
+    int page_of(int cx, int cy) const {
+        return (cy >> EPIDEMIC_PAGE_SHIFT) * pages_x + (cx >> EPIDEMIC_PAGE_SHIFT);
+    }
+    static int local_index(int cx, int cy) {
+        return ((cy & (EPIDEMIC_PAGE_SIZE - 1)) << EPIDEMIC_PAGE_SHIFT) + (cx & (EPIDEMIC_PAGE_SIZE - 1));
+    }
+    void cell_of(int x, int y, int& cx, int& cy) const {
+        cx = max(0, min(cells_x - 1, (x - origin_x) >> EPIDEMIC_CELL_SHIFT));
+        cy = max(0, min(cells_y - 1, (y - origin_y) >> EPIDEMIC_CELL_SHIFT));
+    }
+
+    Page& ensure(int index) {
+        unique_ptr<Page>& page = pages[index];
+        if (!page) {
+            page.reset(new Page()); // 值初始化，压力为0
+            active.push_back(index);
+        }
+        return *page;
+    }
+
+    // 未分配的页压力为0
+    float value(int cx, int cy) const {
+        const unique_ptr<Page>& page = pages[page_of(cx, cy)];
+        return page ? page->pressure[current][local_index(cx, cy)] : 0.0f;
+    }
+
+    void release_all() {
+        for (int index : active) pages[index].reset();
+        active.clear();
+    }
+
+public:
+    EpidemicField() : origin_x(0), origin_y(0), cells_x(0), cells_y(0), pages_x(0), pages_y(0), current(0), empty(true) {}
+
+    // 覆盖矩形区域[x0, x1) x [y0, y1)
+    void configure(int x0, int y0, int x1, int y1) {
+        origin_x = x0;
+        origin_y = y0;
+        cells_x = max(1, (x1 - x0 + (1 << EPIDEMIC_CELL_SHIFT) - 1) >> EPIDEMIC_CELL_SHIFT);
+        cells_y = max(1, (y1 - y0 + (1 << EPIDEMIC_CELL_SHIFT) - 1) >> EPIDEMIC_CELL_SHIFT);
+        pages_x = (cells_x + EPIDEMIC_PAGE_SIZE - 1) >> EPIDEMIC_PAGE_SHIFT;
+        pages_y = (cells_y + EPIDEMIC_PAGE_SIZE - 1) >> EPIDEMIC_PAGE_SHIFT;
+        pages.clear();
+        pages.resize(static_cast<size_t>(pages_x) * pages_y);
+        active.clear();
+        current = 0;
+        empty = true;
+    }
+
+    void clear() {
+        if (empty) return;
+        release_all();
+        empty = true;
+    }
+
+    void deposit(int x, int y, float amount) {
+        int cx, cy;
+        cell_of(x, y, cx, cy);
+        ensure(page_of(cx, cy)).pressure[current][local_index(cx, cy)] += amount;
+        empty = false;
+    }
+
+    float sample(int x, int y) const {
+        int cx, cy;
+        cell_of(x, y, cx, cy);
+        return value(cx, cy);
+    }
+
+    // 推进一天：五点扩散和衰减，区域边界为零通量（边外的格取边上格的值）
+    void step() {
+        if (empty) return;
+
+        // 病原一天只扩散一格：边上有压力的页先分配相邻的页
+        const int last = EPIDEMIC_PAGE_SIZE - 1;
+        size_t allocated = active.size();
+        for (size_t i = 0; i < allocated; i++) {
+            int index = active[i];
+            int px = index % pages_x, py = index / pages_x;
+            const float* cells = pages[index]->pressure[current];
+            bool left = false, right = false, top = false, bottom = false;
+            for (int k = 0; k < EPIDEMIC_PAGE_SIZE; k++) {
+                left = left || cells[k * EPIDEMIC_PAGE_SIZE] > 0;
+                right = right || cells[k * EPIDEMIC_PAGE_SIZE + last] > 0;
+                top = top || cells[k] > 0;
+                bottom = bottom || cells[last * EPIDEMIC_PAGE_SIZE + k] > 0;
+            }
+            if (left && px > 0) ensure(index - 1);
+            if (right && px + 1 < pages_x) ensure(index + 1);
+            if (top && py > 0) ensure(index - pages_x);
+            if (bottom && py + 1 < pages_y) ensure(index + pages_x);
+        }
+
+        // 每页连同一圈边框（相邻页的边，或区域边上的零通量边界）复制到连续的缓冲区后计算，
+        // 内层循环无分支、连续访问，可由编译器向量化
+        const float keep = (1.0f - EPIDEMIC_DECAY) * (1.0f - 4.0f * EPIDEMIC_DIFFUSION);
+        const float spread = (1.0f - EPIDEMIC_DECAY) * EPIDEMIC_DIFFUSION;
+        const int stride = EPIDEMIC_PAGE_SIZE + 2;
+        float padded[stride * stride];
+        float peak = 0.0f;
+        vector<int> drained; // 压力全部降为0的页
+        for (int index : active) {
+            Page& page = *pages[index];
+            int cx0 = (index % pages_x) << EPIDEMIC_PAGE_SHIFT, cy0 = (index / pages_x) << EPIDEMIC_PAGE_SHIFT;
+            int w = min(EPIDEMIC_PAGE_SIZE, cells_x - cx0), h = min(EPIDEMIC_PAGE_SIZE, cells_y - cy0);
+            for (int ly = -1; ly <= h; ly++) {
+                int cy = max(0, min(cells_y - 1, cy0 + ly));
+                for (int lx = -1; lx <= w; lx++) {
+                    if ((lx < 0 || lx == w) && (ly < 0 || ly == h)) continue; // 角上的格不参与五点模板
+                    int cx = max(0, min(cells_x - 1, cx0 + lx));
+                    padded[(ly + 1) * stride + lx + 1] = lx >= 0 && lx < w && ly >= 0 && ly < h ?
+                        page.pressure[current][ly * EPIDEMIC_PAGE_SIZE + lx] : value(cx, cy);
+                }
+            }
+
+            float page_peak = 0.0f;
+            for (int ly = 0; ly < h; ly++) {
+                const float* row = &padded[(ly + 1) * stride + 1];
+                const float* up = row - stride;
+                const float* down = row + stride;
+                float* out = &page.pressure[current ^ 1][ly * EPIDEMIC_PAGE_SIZE];
+                for (int lx = 0; lx < w; lx++) {
+                    out[lx] = keep * row[lx] + spread * (row[lx - 1] + row[lx + 1] + up[lx] + down[lx]);
+                }
+                for (int lx = 0; lx < w; lx++) {
+                    page_peak = max(page_peak, out[lx]);
+                }
+            }
+            peak = max(peak, page_peak);
+            if (page_peak <= 0) drained.push_back(index);
+        }
+        current ^= 1;
+
+        // 压力降到可以忽略时整体清零，之后不再扩散
+        if (peak < 1e-4f) {
+            release_all();
+            empty = true;
+            return;
+        }
+        if (!drained.empty()) {
+            for (int index : drained) pages[index].reset();
+            active.erase(remove_if(active.begin(), active.end(), [this](int index) { return !pages[index]; }), active.end());
+        }
+    }
+
+    // 覆盖区域内的最高压力
+    float peak() const {
+        float result = 0.0f;
+        for (int index : active) {
+            const float* cells = pages[index]->pressure[current];
+            result = max(result, *max_element(cells, cells + PAGE_CELLS));
+        }
+        return result;
+    }
+
+    size_t memory_bytes() const {
+        return pages.capacity() * sizeof(unique_ptr<Page>) + active.capacity() * sizeof(int) + active.size() * sizeof(Page);
+    }
+};
+
+// 种子库参数
+const float SEED_CELL_CAPACITY = 1000.0f; // 每格最多保存的种子数
+const float SEED_DECAY = 0.02f;           // 每天失去活力的种子比例
+const float SEED_MIN_COUNT = 0.05f;       // 低于此数量时视为该格已没有种子
+const double SEED_GERMINATION_RATE = 0.3; // 条件最好时每格每天萌发一株的概率
+
+// 种子库中一个格子的种子（数量和平均基因型，一个格子只保存一种植物的种子）
+struct SeedCell {
+    float count;              // 有活力的种子数
+    float growth_rate;        // 平均生长速率
+    float drought_resistance; // 平均抗旱能力
+    unsigned char species;    // 种子所属物种
+    unsigned char occupied;   // 该格当天是否已有植物
+};
+
+// 与地形分块对齐的种子分块
+struct SeedTile {
+    SeedCell cells[TERRAIN_TILE_SIZE * TERRAIN_TILE_SIZE];
+    int seeded; // 有种子的格子数
+};
+
+// 按格保存的种子库：植物结籽时只累加所在格的数量和平均基因型，萌发时每天统一处理一遍
+// 分块在第一次有种子落入时才分配，种子全部萌发或失去活力后释放
+class SeedBank {
+private:
+    int width, height;
+    int tiles_x, tiles_y;
+    vector<unique_ptr<SeedTile>> tiles;
+
+    int tile_index(int x, int y) const {
+        return (y >> TERRAIN_TILE_SHIFT) * tiles_x + (x >> TERRAIN_TILE_SHIFT);
+    }
+    static int cell_index(int x, int y) {
+        return ((y & TERRAIN_TILE_MASK) << TERRAIN_TILE_SHIFT) + (x & TERRAIN_TILE_MASK);
+    }
+
+public:
+    SeedBank() : width(0), height(0), tiles_x(0), tiles_y(0) {}
+
+    void reset(int w, int h) {
+        width = w;
+        height = h;
+        tiles_x = (w + TERRAIN_TILE_MASK) >> TERRAIN_TILE_SHIFT;
+        tiles_y = (h + TERRAIN_TILE_MASK) >> TERRAIN_TILE_SHIFT;
+        tiles.clear();
+        tiles.resize(static_cast<size_t>(tiles_x) * tiles_y);
+    }
+
+    // 放入一粒种子（格子里已有其他植物的种子时被挤掉）
+    void deposit(SpeciesType species, const SeedDrop& drop) {
+        unique_ptr<SeedTile>& tile = tiles[tile_index(drop.x, drop.y)];
+        if (!tile) tile.reset(new SeedTile()); // 值初始化，所有格子为空
+        SeedCell& cell = tile->cells[cell_index(drop.x, drop.y)];
+        if (cell.count <= 0) {
+            cell.species = static_cast<unsigned char>(species);
+            cell.growth_rate = drop.growth_rate;
+            cell.drought_resistance = drop.drought_resistance;
+            cell.count = 1.0f;
+            tile->seeded++;
+            return;
+        }
+        if (cell.species != species || cell.count >= SEED_CELL_CAPACITY) return;
+        cell.growth_rate = (cell.growth_rate * cell.count + drop.growth_rate) / (cell.count + 1.0f);
+        cell.drought_resistance = (cell.drought_resistance * cell.count + drop.drought_resistance) / (cell.count + 1.0f);
+        cell.count += 1.0f;
+    }
+
+    // 清除所有格子的占用标记
+    void clear_occupancy() {
+        for (unique_ptr<SeedTile>& tile : tiles) {
+            if (!tile) continue;
+            for (SeedCell& cell : tile->cells) cell.occupied = 0;
+        }
+    }
+
+    // 标记格子已有植物（没有种子的分块无需标记）
+    void mark_occupied(int x, int y) {
+        unique_ptr<SeedTile>& tile = tiles[tile_index(x, y)];
+        if (tile) tile->cells[cell_index(x, y)].occupied = 1;
+    }
+
+    // 对每个有种子的格子调用fn(x, y, cell)，之后种子太少的格子被清空，空分块被释放
+    template <class Fn>
+    void for_each_seeded(Fn fn) {
+        for (size_t t = 0; t < tiles.size(); t++) {
+            unique_ptr<SeedTile>& tile = tiles[t];
+            if (!tile) continue;
+            int base_x = static_cast<int>(t % tiles_x) << TERRAIN_TILE_SHIFT;
+            int base_y = static_cast<int>(t / tiles_x) << TERRAIN_TILE_SHIFT;
+            for (int c = 0; c < TERRAIN_TILE_SIZE * TERRAIN_TILE_SIZE; c++) {
+                SeedCell& cell = tile->cells[c];
+                if (cell.count <= 0) continue;
+                fn(base_x + (c & TERRAIN_TILE_MASK), base_y + (c >> TERRAIN_TILE_SHIFT), cell);
+                if (cell.count < SEED_MIN_COUNT) {
+                    cell.count = 0.0f;
+                    tile->seeded--;
+                }
+            }
+            if (tile->seeded == 0) tile.reset();
+        }
+    }
+
+    // 种子总数和有种子的格子数
+    double seed_count() const {
+        double total = 0.0;
+        for (const unique_ptr<SeedTile>& tile : tiles) {
+            if (!tile) continue;
+            for (const SeedCell& cell : tile->cells) total += cell.count;
+        }
+        return total;
+    }
+    long long seeded_cells() const {
+        long long total = 0;
+        for (const unique_ptr<SeedTile>& tile : tiles) {
+            if (tile) total += tile->seeded;
+        }
+        return total;
+    }
+
+    size_t memory_bytes() const {
+        size_t bytes = tiles.capacity() * sizeof(unique_ptr<SeedTile>);
+        for (const unique_ptr<SeedTile>& tile : tiles) {
+            if (tile) bytes += sizeof(SeedTile);
+        }
+        return bytes;
+    }
+};
+
+// 粗粒度密度格边长（2的幂），16x16个世界格为一个密度格
+const int DENSITY_CELL_SHIFT = 4;
+const int DENSITY_CELL_SIZE = 1 << DENSITY_CELL_SHIFT;
+// 各物种的密度按页分配，一页与一个地形分块一样大（4x4个密度格）
+const int DENSITY_PAGE_SHIFT = TERRAIN_TILE_SHIFT - DENSITY_CELL_SHIFT;
+const int DENSITY_PAGE_SIZE = 1 << DENSITY_PAGE_SHIFT;
+
+// 关注区域（按个体模拟的矩形区域，右下角不含）
+struct FocusArea {
+    int x0, y0, x1, y1;
+};
+
+// 物种在密度模型中的参数
+struct DensityTraits {
+    bool plant;          // 植物按承载量做逻辑斯蒂增长
+    bool aquatic;        // 只在水域生长/活动
+    double rate;         // 植物：每天的增长率；动物：每天的自然死亡率
+    double capacity;     // 植物：肥沃度为1时每个密度格的承载量
+    double diffusion;    // 每天流向每个相邻密度格的比例
+    double attack;       // 捕食率（Holling II型功能反应）
+    double conversion;   // 捕获的食物转化为新个体的比例
+};
+
+// 各物种的密度模型参数（按SpeciesType顺序），食物与个体相同（SPECIES_DIET）
+const DensityTraits DENSITY_TRAITS[SPECIES_COUNT] = {
+    // 植物 树木 水生植物
+    { true,  false, 0.08,  60.0, 0.02,  0.0,   0.0 },
+    { true,  false, 0.02,  20.0, 0.005, 0.0,   0.0 },
+    { true,  true,  0.08,  40.0, 0.02,  0.0,   0.0 },
+    // 昆虫 飞行昆虫
+    { false, false, 0.03,  0.0,  0.05,  0.02,  0.3 },
+    { false, false, 0.03,  0.0,  0.10,  0.02,  0.3 },
+    // 食草动物
+    { false, false, 0.01,  0.0,  0.05,  0.02,  0.2 },
+    // 鱼类
+    { false, true,  0.02,  0.0,  0.05,  0.02,  0.2 },
+    // 鸟类
+    { false, false, 0.015, 0.0,  0.15,  0.02,  0.2 },
+    // 分解者
+    { false, false, 0.02,  0.0,  0.01,  0.05,  0.3 },
+    // 杂食动物
+    { false, false, 0.015, 0.0,  0.05,  0.015, 0.2 },
+    // 食肉动物
+    { false, false, 0.02,  0.0,  0.08,  0.03,  0.15 },
+    // 顶级掠食者
+    { false, false, 0.015, 0.0,  0.10,  0.03,  0.1 },
+    // 寄生生物
+    { false, false, 0.05,  0.0,  0.02,  0.01,  0.3 },
+    // 爬行动物
+    { false, false, 0.015, 0.0,  0.03,  0.02,  0.15 },
+    // 两栖动物
+    { false, false, 0.02,  0.0,  0.03,  0.02,  0.2 },
+    // 食腐动物
+    { false, false, 0.02,  0.0,  0.05,  0.05,  0.3 },
+};
+
+// 粗粒度密度场（细节层次）
+// 关注区域之外的密度格不再逐个模拟生物，而是记录每个物种的个体密度，
+// 每天用局部的增长/捕食反应和五点扩散模板推进；开销与关注区域外有生物的面积成正比。
+// 扩散进入关注区域的密度先累积在inflow中，满一个个体时由World转换为真实个体。
+// 各物种的密度按页存储，只有有生物（或有密度流入）的页才分配，未分配的页密度为0；
+// 承载量在划分时按当时的地形统计，仍按格保存
+class DensityField {
+private:
+    static const int PAGE_CELLS = DENSITY_PAGE_SIZE * DENSITY_PAGE_SIZE;
+
+    // 一页密度格的各物种密度
+    struct Page {
+        double density[SPECIES_COUNT][PAGE_CELLS];
+        double next[SPECIES_COUNT][PAGE_CELLS];   // 反应后的中间结果（双缓冲）
+        double inflow[SPECIES_COUNT][PAGE_CELLS]; // 流入关注区域、尚未转换为个体的密度
+    };
+
+    int cells_x, cells_y;
+    int pages_x, pages_y;
+    int world_width, world_height;
+    vector<unique_ptr<Page>> pages;
+    vector<int> active;           // 已分配的页
+    vector<double> land_capacity; // 每格陆地植物的承载比例（平均肥沃度×陆地比例）
+    vector<double> water_capacity;// 每格水域比例
+    vector<char> detailed;        // 该格是否在关注区域内
+
+    int page_of(int cell) const {
+        return ((cell / cells_x) >> DENSITY_PAGE_SHIFT) * pages_x + ((cell % cells_x) >> DENSITY_PAGE_SHIFT);
+    }
+    int local_index(int cell) const {
+        return (((cell / cells_x) & (DENSITY_PAGE_SIZE - 1)) << DENSITY_PAGE_SHIFT) + ((cell % cells_x) & (DENSITY_PAGE_SIZE - 1));
+    }
+
+    Page& ensure(int cell) {
+        int index = page_of(cell);
+        unique_ptr<Page>& page = pages[index];
+        if (!page) {
+            page.reset(new Page()); // 值初始化，密度为0
+            active.push_back(index);
+        }
+        return *page;
+    }
+
+    // 按行优先的顺序访问已分配的页中的各格（与逐格扫描整个场的累加顺序相同）：fn(页, 页内序号, 格)
+    template <class Fn>
+    void scan(Fn fn) const {
+        for (int cy = 0; cy < cells_y; cy++) {
+            int row = (cy >> DENSITY_PAGE_SHIFT) * pages_x;
+            int ly = (cy & (DENSITY_PAGE_SIZE - 1)) << DENSITY_PAGE_SHIFT;
+            for (int px = 0; px < pages_x; px++) {
+                if (!pages[row + px]) continue;
+                int cx0 = px << DENSITY_PAGE_SHIFT;
+                for (int cx = cx0; cx < min(cells_x, cx0 + DENSITY_PAGE_SIZE); cx++) {
+                    fn(row + px, ly + cx - cx0, cy * cells_x + cx);
+                }
+            }
+        }
+    }
+
+public:
+    DensityField() : cells_x(0), cells_y(0), pages_x(0), pages_y(0), world_width(0), world_height(0) {}
+
+    // 按关注区域重新划分（保留原有密度，只清空落入关注区域的格子，由调用者先转换为个体）
+    void configure(const TerrainMap& terrain, const vector<FocusArea>& areas) {
+        int new_cells_x = (terrain.get_width() + DENSITY_CELL_SIZE - 1) >> DENSITY_CELL_SHIFT;
+        int new_cells_y = (terrain.get_height() + DENSITY_CELL_SIZE - 1) >> DENSITY_CELL_SHIFT;
+        if (new_cells_x != cells_x || new_cells_y != cells_y) {
+            cells_x = new_cells_x;
+            cells_y = new_cells_y;
+            pages_x = (cells_x + DENSITY_PAGE_SIZE - 1) >> DENSITY_PAGE_SHIFT;
+            pages_y = (cells_y + DENSITY_PAGE_SIZE - 1) >> DENSITY_PAGE_SHIFT;
+            world_width = terrain.get_width();
+            world_height = terrain.get_height();
+            size_t cells = static_cast<size_t>(cells_x) * cells_y;
+            pages.clear();
+            pages.resize(static_cast<size_t>(pages_x) * pages_y);
+            active.clear();
+            land_capacity.assign(cells, 0.0);
+            water_capacity.assign(cells, 0.0);
+
+            // 每个密度格取4x4个样本估算承载量，不触发地形分块的生成
+            const int samples = 4;
+            for (int cy = 0; cy < cells_y; cy++) {
+                for (int cx = 0; cx < cells_x; cx++) {
+                    double fertility = 0.0;
+                    int water = 0;
+                    for (int sy = 0; sy < samples; sy++) {
+                        for (int sx = 0; sx < samples; sx++) {
+                            int x = min(world_width - 1, (cx << DENSITY_CELL_SHIFT) + sx * DENSITY_CELL_SIZE / samples);
+                            int y = min(world_height - 1, (cy << DENSITY_CELL_SHIFT) + sy * DENSITY_CELL_SIZE / samples);
+                            Terrain cell = terrain.peek(x, y);
+                            if (cell.type == WATER) water++;
+                            else fertility += cell.fertility;
+                        }
+                    }
+                    land_capacity[cy * cells_x + cx] = fertility / (samples * samples);
+                    water_capacity[cy * cells_x + cx] = static_cast<double>(water) / (samples * samples);
+                }
+            }
+        }
+
+        detailed.assign(static_cast<size_t>(cells_x) * cells_y, 0);
+        for (const FocusArea& area : areas) {
+            for (int cy = max(0, area.y0) >> DENSITY_CELL_SHIFT; cy <= (min(world_height, area.y1) - 1) >> DENSITY_CELL_SHIFT; cy++) {
+                for (int cx = max(0, area.x0) >> DENSITY_CELL_SHIFT; cx <= (min(world_width, area.x1) - 1) >> DENSITY_CELL_SHIFT; cx++) {
+                    detailed[cy * cells_x + cx] = 1;
+                }
+            }
+        }
+    }
+
+    int get_cells_x() const { return cells_x; }
+    int get_cells_y() const { return cells_y; }
+    int cell_of(int x, int y) const { return (y >> DENSITY_CELL_SHIFT) * cells_x + (x >> DENSITY_CELL_SHIFT); }
+    bool is_detailed(int cell) const { return detailed[cell] != 0; }
+    // 写入时分配所在的页，只读时未分配的页为0
+    double& at(int species, int cell) { return ensure(cell).density[species][local_index(cell)]; }
+    double at(int species, int cell) const {
+        const unique_ptr<Page>& page = pages[page_of(cell)];
+        return page ? page->density[species][local_index(cell)] : 0.0;
+    }
+    double& inflow_at(int species, int cell) { return ensure(cell).inflow[species][local_index(cell)]; }
+    double inflow_at(int species, int cell) const {
+        const unique_ptr<Page>& page = pages[page_of(cell)];
+        return page ? page->inflow[species][local_index(cell)] : 0.0;
+    }
+
+    // 左上角落在矩形[x0, x1) x [y0, y1)内、不在关注区域内的格子中某物种的密度乘以factor
+    void scale(int species, int x0, int y0, int x1, int y1, double factor) {
+        for (int index : active) {
+            Page& page = *pages[index];
+            int cx0 = (index % pages_x) << DENSITY_PAGE_SHIFT, cy0 = (index / pages_x) << DENSITY_PAGE_SHIFT;
+            for (int cy = cy0; cy < min(cells_y, cy0 + DENSITY_PAGE_SIZE); cy++) {
+                for (int cx = cx0; cx < min(cells_x, cx0 + DENSITY_PAGE_SIZE); cx++) {
+                    int c = cy * cells_x + cx;
+                    int x = cx << DENSITY_CELL_SHIFT, y = cy << DENSITY_CELL_SHIFT;
+                    if (!detailed[c] && x >= x0 && x < x1 && y >= y0 && y < y1) page.density[species][local_index(c)] *= factor;
+                }
+            }
+        }
+    }
+
+    // 植物在一个密度格中的承载量（陆地植物共享，动物为0）
+    double plant_capacity(int species, int cell) const {
+        const DensityTraits& traits = DENSITY_TRAITS[species];
+        if (!traits.plant) return 0.0;
+        return traits.capacity * (traits.aquatic ? water_capacity[cell] : land_capacity[cell]);
+    }
+
+    // 推进一天：局部反应（增长、捕食、死亡、食腐）后做五点扩散
+    // 未分配的页中没有生物，反应后仍为0，所以只需处理已分配的页
+    void step(const Environment& env) {
+        double light = min(1.0, env.daylight_hours / 12.0);
+        double cold = env.temperature < 0 ? 0.0 : min(1.0, env.temperature / 15.0); // 低温抑制植物生长
+
+        for (int index : active) {
+            Page& page = *pages[index];
+            int cx0 = (index % pages_x) << DENSITY_PAGE_SHIFT, cy0 = (index / pages_x) << DENSITY_PAGE_SHIFT;
+            for (int cy = cy0; cy < min(cells_y, cy0 + DENSITY_PAGE_SIZE); cy++) {
+                for (int cx = cx0; cx < min(cells_x, cx0 + DENSITY_PAGE_SIZE); cx++) {
+                    int c = cy * cells_x + cx;
+                    if (detailed[c]) continue;
+                    int local = local_index(c);
+
+                    double n[SPECIES_COUNT];
+                    double delta[SPECIES_COUNT];
+                    for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+                        n[sp] = page.density[sp][local];
+                        delta[sp] = 0.0;
+                    }
+
+                    // 植物：陆地植物共享陆地承载量，水生植物使用水域承载量
+                    double land_plants = n[SPECIES_PLANT] + n[SPECIES_TREE];
+                    double carrion = 0.0;
+                    for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+                        const DensityTraits& traits = DENSITY_TRAITS[sp];
+                        if (traits.plant) {
+                            double k = traits.capacity * (traits.aquatic ? water_capacity[c] : land_capacity[c]);
+                            double total = traits.aquatic ? n[sp] : land_plants;
+                            // 承载量为0时只衰减，避免陆地植物在水域中增长
+                            double growth = k > 0 ? traits.rate * light * cold * n[sp] * (1.0 - total / k) : -traits.rate * n[sp];
+                            delta[sp] += growth;
+                        }
+                        else if (n[sp] > 0) {
+                            double deaths = traits.rate * n[sp];
+                            delta[sp] -= deaths;
+                            carrion += deaths;
+                        }
+                    }
+
+                    // 捕食（Holling II型）：食物按各自所占比例被消耗
+                    for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+                        const DensityTraits& traits = DENSITY_TRAITS[sp];
+                        unsigned int diet = SPECIES_DIET[sp];
+                        if (traits.plant || n[sp] <= 0 || diet == 0) continue;
+                        double food = 0.0;
+                        for (int prey = 0; prey < SPECIES_COUNT; prey++) {
+                            if (diet & species_bit(prey)) food += n[prey];
+                        }
+                        if (food <= 0) continue;
+                        double eaten = n[sp] * traits.attack * food / (1.0 + traits.attack * food);
+                        eaten = min(eaten, food);
+                        for (int prey = 0; prey < SPECIES_COUNT; prey++) {
+                            if (diet & species_bit(prey)) delta[prey] -= eaten * n[prey] / food;
+                        }
+                        delta[sp] += traits.conversion * eaten;
+                    }
+
+                    // 分解者和食腐动物分享当天的死亡个体
+                    double scavengers = n[SPECIES_DECOMPOSER] + n[SPECIES_SCAVENGER];
+                    if (scavengers > 0 && carrion > 0) {
+                        for (int sp : { SPECIES_DECOMPOSER, SPECIES_SCAVENGER }) {
+                            const DensityTraits& traits = DENSITY_TRAITS[sp];
+                            double share = carrion * n[sp] / scavengers;
+                            delta[sp] += traits.conversion * min(share, traits.attack * n[sp] * 10.0);
+                        }
+                    }
+
+                    for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+                        page.next[sp][local] = max(0.0, n[sp] + delta[sp]);
+                    }
+                }
+            }
+        }
+
+        // 五点扩散：流向世界外的部分保留（零通量边界），流入关注区域的部分累积到inflow，
+        // 流入未分配的页时分配该页（新分配的页的next为0，不会再向外扩散）
+        for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+            double d = DENSITY_TRAITS[sp].diffusion;
+            for (int index : active) {
+                Page& page = *pages[index];
+                int cx0 = (index % pages_x) << DENSITY_PAGE_SHIFT, cy0 = (index / pages_x) << DENSITY_PAGE_SHIFT;
+                for (int cy = cy0; cy < min(cells_y, cy0 + DENSITY_PAGE_SIZE); cy++) {
+                    for (int cx = cx0; cx < min(cells_x, cx0 + DENSITY_PAGE_SIZE); cx++) {
+                        int c = cy * cells_x + cx;
+                        if (!detailed[c]) page.density[sp][local_index(c)] = page.next[sp][local_index(c)];
+                    }
+                }
+            }
+            scan([&](int index, int local, int c) {
+                if (detailed[c]) return;
+                Page& page = *pages[index];
+                double out = page.next[sp][local] * d;
+                if (out <= 0) return;
+                int cx = c % cells_x, cy = c / cells_x;
+                const int nx[4] = { cx - 1, cx + 1, cx, cx };
+                const int ny[4] = { cy, cy, cy - 1, cy + 1 };
+                for (int k = 0; k < 4; k++) {
+                    if (nx[k] < 0 || ny[k] < 0 || nx[k] >= cells_x || ny[k] >= cells_y) continue;
+                    int neighbour = ny[k] * cells_x + nx[k];
+                    page.density[sp][local] -= out;
+                    if (detailed[neighbour]) inflow_at(sp, neighbour) += out;
+                    else at(sp, neighbour) += out;
+                }
+            });
+        }
+    }
+
+    // 所有粗粒度格中的个体总数（估计值）
+    double total() const {
+        double sum = 0.0;
+        for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+            scan([&](int index, int local, int) { sum += pages[index]->density[sp][local]; });
+        }
+        return sum;
+    }
+
+    size_t coarse_cell_count() const {
+        return count(detailed.begin(), detailed.end(), 0);
+    }
+
+    size_t memory_bytes() const {
+        return pages.capacity() * sizeof(unique_ptr<Page>) + active.capacity() * sizeof(int) + active.size() * sizeof(Page) +
+            (land_capacity.capacity() + water_capacity.capacity()) * sizeof(double) + detailed.capacity();
+    }
+};
+
+// ---- 事件日志 ----
+
+// 日志事件类型
+enum JournalEventType {
+    EVENT_BIRTH = 0,     // 出生（other为亲代编号，0表示由种子萌发或由密度场转换）
+    EVENT_ARRIVAL = 1,   // 从其他区域迁入
+    EVENT_DEPARTURE = 2, // 迁出本区域（detail为1时表示并入密度场）
+    EVENT_PREDATION = 3, // 取食（id为取食者，other为被取食者）
+    EVENT_DEATH = 4,     // 死亡（detail为死因）
+    EVENT_DISASTER = 5   // 环境灾难（detail为灾难类型）
+};
+
+// 死因
+enum DeathCause {
+    DEATH_STARVATION = 0, // 饥饿（能量耗尽）
+    DEATH_AGE = 1,        // 衰老
+    DEATH_PREDATION = 2,  // 被捕食
+    DEATH_DISASTER = 3,   // 灾难
+    DEATH_DISEASE = 4,    // 疾病
+    DEATH_CAUSE_COUNT = 5
+};
+
+const char* const DEATH_CAUSE_NAMES[DEATH_CAUSE_COUNT] = { "饥饿", "衰老", "捕食", "灾难", "疾病" };
+
+// 检查点间隔（天）：回放从不晚于目标日期的最近检查点开始
+const int JOURNAL_CHECKPOINT_DAYS = 100;
+const unsigned int JOURNAL_MAGIC = 0x4a4f4345; // "ECOJ"
+
+// 一条日志事件，detail为物种、死因或灾难类型，坐标只对出生和迁入有意义
+struct JournalEvent {
+    unsigned long long id;    // 当事生物
+    unsigned long long other; // 亲代或被取食者
+    int x, y;
+    unsigned char type;
+    unsigned char detail;
+};
+
+// 写入文件的数据块：一天的事件或一个检查点
+struct JournalBlock {
+    unsigned char kind; // 1为事件，2为检查点
+    int day;
+    vector<JournalEvent> events;
+    vector<OrganismRecord> organisms;
+};
+
+// 变长整数编码：数值越小占用字节越少（编号和坐标按差值编码后大多只占1字节）
+inline void journal_put_varint(vector<unsigned char>& out, unsigned long long value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+inline void journal_put_signed(vector<unsigned char>& out, long long value) {
+    journal_put_varint(out, (static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63));
+}
+
+inline bool journal_get_varint(const unsigned char*& p, const unsigned char* end, unsigned long long& value) {
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char byte = *p++;
+        value |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+inline bool journal_get_signed(const unsigned char*& p, const unsigned char* end, long long& value) {
+    unsigned long long raw;
+    if (!journal_get_varint(p, end, raw)) return false;
+    value = static_cast<long long>(raw >> 1) ^ -static_cast<long long>(raw & 1);
+    return true;
+}
+
+// 事件日志（可选）：记录出生、死亡及死因、取食、迁移和灾难，用于事后重建任意一天的种群
+// 事件按发生顺序写入缓冲区，每天开始时作为上一天的数据块交给后台线程，
+// 由后台线程按差值和变长整数压缩后写入文件，模拟线程不等待磁盘。
+// 日志中只有确定的事件，不含随机数状态，所以同一种子的两次运行得到相同的日志
+class EventJournal {
+private:
+    ofstream file;
+
+    // 当天已记录的事件（只由模拟线程写入）
+    vector<JournalEvent> events;
+
+    // 等待后台线程压缩写入的数据块
+    mutex queue_mutex;
+    condition_variable queue_ready;
+    deque<JournalBlock> pending;
+    bool closing;
+    thread writer;
+
+    atomic<unsigned long long> event_count;
+    atomic<unsigned long long> raw_bytes;     // 未压缩时的大小
+    atomic<unsigned long long> written_bytes; // 实际写入的大小
+
+    void enqueue(JournalBlock& block) {
+        lock_guard<mutex> lock(queue_mutex);
+        pending.push_back(JournalBlock());
+        swap(pending.back(), block);
+        queue_ready.notify_one();
+    }
+
+    // 编码一个数据块：[类型][日期][数量][载荷长度][载荷]
+    void encode(const JournalBlock& block, vector<unsigned char>& out) {
+        vector<unsigned char> payload;
+        unsigned long long prev_id = 0, prev_other = 0;
+        size_t count;
+        if (block.kind == 1) {
+            count = block.events.size();
+            for (const JournalEvent& e : block.events) {
+                payload.push_back(e.type);
+                payload.push_back(e.detail);
+                journal_put_signed(payload, static_cast<long long>(e.id - prev_id));
+                journal_put_signed(payload, static_cast<long long>(e.other - prev_other));
+                if (e.type == EVENT_BIRTH || e.type == EVENT_ARRIVAL) {
+                    journal_put_varint(payload, e.x);
+                    journal_put_varint(payload, e.y);
+                }
+                prev_id = e.id;
+                prev_other = e.other;
+            }
+            raw_bytes += count * sizeof(JournalEvent);
+            event_count += count;
+        }
+        else {
+            count = block.organisms.size();
+            for (const OrganismRecord& r : block.organisms) {
+                journal_put_signed(payload, static_cast<long long>(r.id - prev_id));
+                payload.push_back(static_cast<unsigned char>(r.species));
+                journal_put_varint(payload, r.x);
+                journal_put_varint(payload, r.y);
+                journal_put_varint(payload, static_cast<unsigned long long>(max(0, r.age)));
+                journal_put_varint(payload, static_cast<unsigned long long>(max(0.0, r.energy) * 100.0));
+                prev_id = r.id;
+            }
+            raw_bytes += count * sizeof(OrganismRecord);
+        }
+        out.push_back(block.kind);
+        journal_put_varint(out, static_cast<unsigned long long>(block.day));
+        journal_put_varint(out, count);
+        journal_put_varint(out, payload.size());
+        out.insert(out.end(), payload.begin(), payload.end());
+    }
+
+    void run_writer() {
+        vector<unsigned char> bytes;
+        while (true) {
+            JournalBlock block;
+            {
+                unique_lock<mutex> lock(queue_mutex);
+                queue_ready.wait(lock, [this] { return closing || !pending.empty(); });
+                if (pending.empty()) return;
+                swap(block, pending.front());
+                pending.pop_front();
+            }
+            bytes.clear();
+            encode(block, bytes);
+            file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+            written_bytes += bytes.size();
+        }
+    }
+
+public:
+    EventJournal() : closing(false), event_count(0), raw_bytes(0), written_bytes(0) {}
+
+    EventJournal(const EventJournal&) = delete;
+    EventJournal& operator=(const EventJournal&) = delete;
+
+    ~EventJournal() {
+        close();
+    }
+
+    // 打开日志文件并写入文件头，失败时返回false
+    bool open(const string& path, int width, int height, unsigned int seed, int rank) {
+        file.open(path.c_str(), ios::binary | ios::trunc);
+        if (!file) return false;
+        unsigned int header[5] = { JOURNAL_MAGIC, static_cast<unsigned int>(width),
+            static_cast<unsigned int>(height), seed, static_cast<unsigned int>(rank) };
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        written_bytes = sizeof(header);
+        writer = thread(&EventJournal::run_writer, this);
+        return true;
+    }
+
+    // 记录一个事件（只在模拟线程中调用：进食的并行收集阶段不产生事件）
+    void record(JournalEventType type, unsigned long long id, unsigned long long other = 0,
+        int detail = 0, int x = 0, int y = 0) {
+        JournalEvent e;
+        e.id = id;
+        e.other = other;
+        e.x = x;
+        e.y = y;
+        e.type = static_cast<unsigned char>(type);
+        e.detail = static_cast<unsigned char>(detail);
+        events.push_back(e);
+    }
+
+    // 把已记录的事件作为day这一天的数据块交给后台线程
+    void flush(int day) {
+        if (events.empty()) return;
+        JournalBlock block;
+        block.kind = 1;
+        block.day = day;
+        swap(block.events, events);
+        enqueue(block);
+    }
+
+    // 写入day这一天结束时的全部生物（按编号排序）
+    void checkpoint(int day, vector<OrganismRecord>& organisms) {
+        JournalBlock block;
+        block.kind = 2;
+        block.day = day;
+        swap(block.organisms, organisms);
+        sort(block.organisms.begin(), block.organisms.end(),
+            [](const OrganismRecord& a, const OrganismRecord& b) { return a.id < b.id; });
+        enqueue(block);
+    }
+
+    // 等待后台线程写完并关闭文件
+    void close() {
+        if (!writer.joinable()) return;
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            closing = true;
+            queue_ready.notify_one();
+        }
+        writer.join();
+        file.close();
+    }
+
+    // 以下统计由后台线程更新，只用于显示
+    unsigned long long get_event_count() const { return event_count; }
+    unsigned long long get_raw_bytes() const { return raw_bytes; }
+    unsigned long long get_written_bytes() const { return written_bytes; }
+};
+
+// ---- 历史记录 ----
+
+// 每隔多少天保存一个关键帧（回看某一天时从之前最近的关键帧开始应用每天的变化）
+const int HISTORY_KEYFRAME_DAYS = 30;
+
+// 历史中的一个生物（只保存回看时显示需要的信息）
+struct HistoryOrganism {
+    unsigned long long id;
+    int x, y;
+    unsigned char species;
+    char symbol;
+};
+
+// 历史中的一个地形格
+struct HistoryCell {
+    int x, y;
+    unsigned char type;
+};
+
+// 一天相对前一天的变化
+struct HistoryDelta {
+    vector<HistoryOrganism> changed;    // 新出现、移动或外观改变的生物
+    vector<unsigned long long> removed; // 消失的生物
+    vector<HistoryCell> cells;          // 类型改变的地形格
+};
+
+typedef vector<unsigned char, CountingAllocator<unsigned char, MEMORY_HISTORY>> HistoryTileCells;
+typedef shared_ptr<HistoryTileCells> HistoryTile; // 一个分块的地形类型
+
+// 关键帧：这一天的全部生物和各分块的地形类型
+// 分块与之前的关键帧共享，只有自上一个关键帧以来有格子改变的分块才是新的一份
+struct HistoryKeyframe {
+    int day;
+    vector<HistoryOrganism> organisms;     // 按编号排序
+    vector<pair<int, HistoryTile>> tiles;  // (分块序号, 类型)，按分块序号排序
+};
+
+// 回看某一天时重建的状态
+struct HistorySnapshot {
+    vector<HistoryOrganism> organisms;
+    unordered_map<long long, unsigned char> cells; // 关键帧之后类型改变的格子（键为 y * 世界宽度 + x）
+    const HistoryKeyframe* keyframe;
+};
+
+// 只追加的历史存储：关键帧加每天的变化，内存只随实际发生的变化增长
+// 地形只记录类型：每个分块第一次被记录时保存一份基准类型，之后只记录类型改变的格子
+class HistoryStore {
+private:
+    int width, height;
+    int tiles_x;
+    vector<HistoryTile> baseline;       // 各分块第一次记录时的地形类型
+    vector<HistoryTile> current;        // 各分块最近一次记录的地形类型（可能与关键帧共享）
+    vector<HistoryOrganism> last;       // 最近一次记录的生物（按编号排序）
+    vector<HistoryKeyframe> keyframes;
+    vector<HistoryDelta> deltas;        // deltas[d - first_day]为第d天相对前一天的变化
+    int first_day;
+
+    static int cell_index(int x, int y) {
+        return ((y & TERRAIN_TILE_MASK) << TERRAIN_TILE_SHIFT) + (x & TERRAIN_TILE_MASK);
+    }
+
+    // 比较已生成分块的地形类型与上次记录，收集变化（新分块保存基准）
+    void diff_terrain(const TerrainMap& terrain, vector<HistoryCell>& changes) {
+        int tiles_y = (height + TERRAIN_TILE_MASK) >> TERRAIN_TILE_SHIFT;
+        for (int ty = 0; ty < tiles_y; ty++) {
+            for (int tx = 0; tx < tiles_x; tx++) {
+                int x0 = tx << TERRAIN_TILE_SHIFT, y0 = ty << TERRAIN_TILE_SHIFT;
+                if (!terrain.is_generated(x0, y0)) continue;
+                size_t tile = static_cast<size_t>(ty) * tiles_x + tx;
+                bool fresh = !current[tile];
+                if (fresh) {
+                    current[tile] = make_shared<HistoryTileCells>(TERRAIN_TILE_SIZE * TERRAIN_TILE_SIZE, 0);
+                }
+                int x1 = min(width, x0 + TERRAIN_TILE_SIZE), y1 = min(height, y0 + TERRAIN_TILE_SIZE);
+                for (int y = y0; y < y1; y++) {
+                    for (int x = x0; x < x1; x++) {
+                        unsigned char type = static_cast<unsigned char>(terrain.at(x, y).type);
+                        if (type == (*current[tile])[cell_index(x, y)]) continue;
+                        if (current[tile].use_count() > 1) {
+                            current[tile] = make_shared<HistoryTileCells>(*current[tile]); // 与关键帧共享时先复制
+                        }
+                        (*current[tile])[cell_index(x, y)] = type;
+                        if (!fresh) {
+                            HistoryCell cell;
+                            cell.x = x;
+                            cell.y = y;
+                            cell.type = type;
+                            changes.push_back(cell);
+                        }
+                    }
+                }
+                if (fresh) {
+                    baseline[tile] = make_shared<HistoryTileCells>(*current[tile]);
+                }
+            }
+        }
+    }
+
+
+public:
+    HistoryStore() : width(0), height(0), tiles_x(0), first_day(0) {}
+
+    void reset(int w, int h) {
+        width = w;
+        height = h;
+        tiles_x = (w + TERRAIN_TILE_MASK) >> TERRAIN_TILE_SHIFT;
+        int tiles_y = (h + TERRAIN_TILE_MASK) >> TERRAIN_TILE_SHIFT;
+        baseline.clear();
+        baseline.resize(static_cast<size_t>(tiles_x) * tiles_y);
+        current.clear();
+        current.resize(baseline.size());
+        last.clear();
+        keyframes.clear();
+        deltas.clear();
+        first_day = 0;
+    }
+
+    bool empty() const { return deltas.empty(); }
+    int get_first_day() const { return first_day; }
+    int get_last_day() const { return first_day + static_cast<int>(deltas.size()) - 1; }
+    size_t keyframe_count() const { return keyframes.size(); }
+
+    // 记录一天结束时的状态（organisms按编号排序），只能按日期顺序追加
+    void record(int day, const vector<HistoryOrganism>& organisms, const TerrainMap& terrain) {
+        if (deltas.empty()) first_day = day;
+        HistoryDelta delta;
+        diff_terrain(terrain, delta.cells);
+
+        size_t i = 0, j = 0;
+        while (i < last.size() || j < organisms.size()) {
+            if (j == organisms.size() || (i < last.size() && last[i].id < organisms[j].id)) {
+                delta.removed.push_back(last[i++].id);
+            }
+            else if (i == last.size() || organisms[j].id < last[i].id) {
+                delta.changed.push_back(organisms[j++]);
+            }
+            else {
+                const HistoryOrganism& before = last[i++];
+                const HistoryOrganism& after = organisms[j++];
+                if (before.x != after.x || before.y != after.y || before.symbol != after.symbol) {
+                    delta.changed.push_back(after);
+                }
+            }
+        }
+        last = organisms;
+
+        if (deltas.empty() || (day - first_day) % HISTORY_KEYFRAME_DAYS == 0) {
+            HistoryKeyframe keyframe;
+            keyframe.day = day;
+            keyframe.organisms = organisms;
+            for (size_t tile = 0; tile < current.size(); tile++) {
+                if (current[tile]) keyframe.tiles.push_back(make_pair(static_cast<int>(tile), current[tile]));
+            }
+            keyframes.push_back(keyframe);
+        }
+        deltas.push_back(delta);
+    }
+
+    // 丢弃最早的关键帧和它之后到下一个关键帧之前每天的变化（只剩一个关键帧时返回false）
+    bool drop_oldest_keyframe() {
+        if (keyframes.size() < 2) return false;
+        int days = keyframes[1].day - keyframes[0].day;
+        keyframes.erase(keyframes.begin());
+        deltas.erase(deltas.begin(), deltas.begin() + days);
+        first_day += days;
+        return true;
+    }
+
+    // 重建某一天结束时的生物和地形：从之前最近的关键帧开始依次应用每天的变化
+    bool reconstruct(int day, HistorySnapshot& snapshot) const {
+        if (deltas.empty() || day < first_day || day > get_last_day()) return false;
+        const HistoryKeyframe& keyframe = keyframes[(day - first_day) / HISTORY_KEYFRAME_DAYS];
+        snapshot.keyframe = &keyframe;
+
+        map<unsigned long long, HistoryOrganism> alive;
+        for (const HistoryOrganism& org : keyframe.organisms) alive[org.id] = org;
+        unordered_map<long long, unsigned char>& cells = snapshot.cells;
+        cells.clear();
+
+        for (int d = keyframe.day + 1; d <= day; d++) {
+            const HistoryDelta& delta = deltas[d - first_day];
+            for (unsigned long long id : delta.removed) alive.erase(id);
+            for (const HistoryOrganism& org : delta.changed) alive[org.id] = org;
+            for (const HistoryCell& cell : delta.cells) {
+                cells[static_cast<long long>(cell.y) * width + cell.x] = cell.type;
+            }
+        }
+
+        snapshot.organisms.clear();
+        for (const auto& entry : alive) snapshot.organisms.push_back(entry.second);
+        return true;
+    }
+
+    // 快照中某格的地形类型（当时该分块尚未生成时返回false）
+    bool snapshot_type(const HistorySnapshot& snapshot, int x, int y, unsigned char& type) const {
+        auto it = snapshot.cells.find(static_cast<long long>(y) * width + x);
+        if (it != snapshot.cells.end()) {
+            type = it->second;
+            return true;
+        }
+        int tile = (y >> TERRAIN_TILE_SHIFT) * tiles_x + (x >> TERRAIN_TILE_SHIFT);
+        const vector<pair<int, HistoryTile>>& tiles = snapshot.keyframe->tiles;
+        auto found = lower_bound(tiles.begin(), tiles.end(), make_pair(tile, HistoryTile()),
+            [](const pair<int, HistoryTile>& a, const pair<int, HistoryTile>& b) { return a.first < b.first; });
+        if (found != tiles.end() && found->first == tile) {
+            type = (*found->second)[cell_index(x, y)];
+            return true;
+        }
+        // 关键帧之后才生成的分块：生成时的类型加上之后的变化
+        if (!baseline[tile]) return false;
+        type = (*baseline[tile])[cell_index(x, y)];
+        return true;
+    }
+
+    // 历史记录占用的内存（字节），共享的分块只计一次
+    size_t memory_bytes() const {
+        size_t bytes = last.capacity() * sizeof(HistoryOrganism);
+        set<const HistoryTileCells*> tiles;
+        for (const HistoryTile& tile : baseline) {
+            if (tile) tiles.insert(tile.get());
+        }
+        for (const HistoryTile& tile : current) {
+            if (tile) tiles.insert(tile.get());
+        }
+        for (const HistoryKeyframe& keyframe : keyframes) {
+            bytes += keyframe.organisms.capacity() * sizeof(HistoryOrganism) +
+                keyframe.tiles.capacity() * sizeof(pair<int, HistoryTile>);
+            for (const pair<int, HistoryTile>& tile : keyframe.tiles) tiles.insert(tile.second.get());
+        }
+        bytes += tiles.size() * TERRAIN_TILE_SIZE * TERRAIN_TILE_SIZE;
+        for (const HistoryDelta& delta : deltas) {
+            bytes += sizeof(HistoryDelta) + delta.changed.capacity() * sizeof(HistoryOrganism) +
+                delta.removed.capacity() * sizeof(unsigned long long) + delta.cells.capacity() * sizeof(HistoryCell);
+        }
+        return bytes;
+    }
+};
+
+// ---- 实时结果文件 ----
+// 每天结束时把汇总数据和低分辨率密度栅格追加到内存映射文件中，分析程序可以在模拟进行中
+// 直接映射同一文件读取（零拷贝），模拟从不等待读者。文件头之后是定长的每日记录：
+// 已提交的记录不再修改；文件头中的计数由序列锁保护（写入时序号为奇数，读者读到奇数或
+// 前后序号不同就重读），每条记录还有自己的提交标记（写完最后才写入“序号+1”）
+
+const unsigned int RESULTS_MAGIC = 0x53455245; // "ERES"
+const unsigned int RESULTS_VERSION = 1;
+const int RESULTS_HEADER_BYTES = 4096;  // 文件头占一页
+const int RESULTS_RASTER_SIZE = 32;     // 密度栅格边长
+const int RESULTS_INITIAL_DAYS = 1024;  // 初始预留的天数，写满后文件容量翻倍
+
+// 文件头（写入者与读者进程共享）
+struct ResultsHeader {
+    unsigned int magic;
+    unsigned int version;
+    int width, height;
+    unsigned int seed;
+    int rank;
+    int raster_size;
+    int species_count;
+    int record_bytes;                   // 每条记录（含栅格）的字节数
+    atomic<unsigned int> sequence;      // 序列锁
+    atomic<long long> capacity;         // 文件当前能容纳的记录数
+    atomic<long long> count;            // 已提交的记录数
+    atomic<int> finished;               // 模拟已结束，不会再追加
+};
+
+// 每日记录，之后紧跟两层栅格：植物数量、动物数量（各 raster_size * raster_size 个unsigned short）
+struct ResultsDay {
+    atomic<long long> commit;           // 提交标记：写完整条记录后才写入 序号+1
+    int day;
+    int population[SPECIES_COUNT];      // 按物种的个体数量
+    double density_population;          // 关注区域之外由密度场表示的数量
+    double temperature;
+    double rainfall;
+    double pollution;
+    int weather;
+    int disease;
+    int infected;                       // 患病个体数
+    int sleeping;                       // 休眠个体数
+    double seeds;                       // 种子库中的种子数
+};
+
+class ResultsStore {
+private:
+    int fd;
+    char* base;
+    size_t mapped_bytes;
+
+    ResultsHeader* header() const { return reinterpret_cast<ResultsHeader*>(base); }
+
+    static size_t record_bytes() {
+        size_t bytes = sizeof(ResultsDay) + 2 * RESULTS_RASTER_SIZE * RESULTS_RASTER_SIZE * sizeof(unsigned short);
+        return (bytes + 63) & ~static_cast<size_t>(63);
+    }
+
+    // 把文件扩大到能容纳capacity条记录并重新映射
+    bool reserve(long long capacity) {
+#ifndef _WIN32
+        size_t bytes = RESULTS_HEADER_BYTES + static_cast<size_t>(capacity) * record_bytes();
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) return false;
+        void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (memory == MAP_FAILED) return false;
+        if (base) munmap(base, mapped_bytes);
+        base = static_cast<char*>(memory);
+        mapped_bytes = bytes;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+public:
+    ResultsStore() : fd(-1), base(nullptr), mapped_bytes(0) {}
+
+    ResultsStore(const ResultsStore&) = delete;
+    ResultsStore& operator=(const ResultsStore&) = delete;
+
+    ~ResultsStore() {
+        close();
+    }
+
+    // 创建结果文件并写入文件头，失败时返回false
+    bool open(const string& path, int width, int height, unsigned int seed, int rank) {
+#ifndef _WIN32
+        fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+        if (fd < 0) return false;
+        if (!reserve(RESULTS_INITIAL_DAYS)) {
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        ResultsHeader* h = header();
+        h->magic = RESULTS_MAGIC;
+        h->version = RESULTS_VERSION;
+        h->width = width;
+        h->height = height;
+        h->seed = seed;
+        h->rank = rank;
+        h->raster_size = RESULTS_RASTER_SIZE;
+        h->species_count = SPECIES_COUNT;
+        h->record_bytes = static_cast<int>(record_bytes());
+        new (&h->sequence) atomic<unsigned int>(0);
+        new (&h->capacity) atomic<long long>(RESULTS_INITIAL_DAYS);
+        new (&h->count) atomic<long long>(0);
+        new (&h->finished) atomic<int>(0);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // 取得下一条记录的写入位置（必要时扩大文件），栅格已清零
+    ResultsDay* begin_record(unsigned short*& plants, unsigned short*& animals) {
+        ResultsHeader* h = header();
+        long long index = h->count.load(memory_order_relaxed);
+        if (index >= h->capacity.load(memory_order_relaxed)) {
+            long long capacity = h->capacity.load(memory_order_relaxed) * 2;
+            if (!reserve(capacity)) return nullptr;
+            h = header();
+            h->sequence.fetch_add(1, memory_order_acq_rel);
+            h->capacity.store(capacity, memory_order_relaxed);
+            h->sequence.fetch_add(1, memory_order_release);
+        }
+        char* slot = base + RESULTS_HEADER_BYTES + static_cast<size_t>(index) * record_bytes();
+        memset(slot, 0, record_bytes());
+        ResultsDay* record = reinterpret_cast<ResultsDay*>(slot);
+        new (&record->commit) atomic<long long>(0);
+        plants = reinterpret_cast<unsigned short*>(slot + sizeof(ResultsDay));
+        animals = plants + RESULTS_RASTER_SIZE * RESULTS_RASTER_SIZE;
+        return record;
+    }
+
+    // 提交begin_record()取得的记录
+    void commit_record(ResultsDay* record) {
+        ResultsHeader* h = header();
+        long long index = h->count.load(memory_order_relaxed);
+        record->commit.store(index + 1, memory_order_release);
+        h->sequence.fetch_add(1, memory_order_acq_rel);
+        h->count.store(index + 1, memory_order_relaxed);
+        h->sequence.fetch_add(1, memory_order_release);
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (!base) return;
+        header()->finished.store(1, memory_order_release);
+        munmap(base, mapped_bytes);
+        ::close(fd);
+        base = nullptr;
+        fd = -1;
+#endif
+    }
+};
+
+// ---- 运行指标 ----
+
+// 一天中分别计时的阶段
+enum SimulationPhase {
+    PHASE_ENVIRONMENT,     // 季节、天气和灾难掷骰
+    PHASE_TERRAIN,         // 天气场、水文和灾难对地形与生物的影响
+    PHASE_MOVE,            // 唤醒和移动
+    PHASE_FEED,            // 进食
+    PHASE_FINISH,          // 衰老、繁殖和休眠
+    PHASE_CLEANUP,         // 种子萌发、寄生和移除死亡生物
+    PHASE_LEVEL_OF_DETAIL, // 密度场
+    PHASE_END_DAY,         // 演替、历史和结果发布
+    PHASE_COUNT
+};
+
+// 有容量上限的存储（指标中报告占用和容量）
+enum MetricsPool {
+    POOL_TERRAIN_TILES,       // 已生成的地形分块
+    POOL_MAILBOX_GHOSTS,      // 多进程信箱中的边界生物
+    POOL_MAILBOX_HALO_CELLS,  // 多进程信箱中的边界地形格
+    POOL_MAILBOX_MIGRANTS,    // 多进程信箱中的迁入生物
+    POOL_MAILBOX_DAMAGE,      // 多进程信箱中的伤害通知
+    POOL_COUNT
+};
+
+// 指标标签（Prometheus标签值只用ASCII）
+const char* const PHASE_NAMES[PHASE_COUNT] = {
+    "environment", "terrain", "move", "feed", "finish", "cleanup", "level_of_detail", "end_day"
+};
+const char* const POOL_NAMES[POOL_COUNT] = {
+    "terrain_tiles", "mailbox_ghosts", "mailbox_halo_cells", "mailbox_migrants", "mailbox_damage"
+};
+const char* const SPECIES_METRIC_NAMES[SPECIES_COUNT] = {
+    "plant", "tree", "aquatic_plant", "insect", "flying_insect", "herbivore", "fish", "bird",
+    "decomposer", "omnivore", "carnivore", "apex_predator", "parasite", "reptile", "amphibian", "scavenger"
+};
+const char* const DEATH_CAUSE_METRIC_NAMES[DEATH_CAUSE_COUNT] = {
+    "starvation", "age", "predation", "disaster", "disease"
+};
+
+// 运行指标：模拟线程每天结束时写入，导出线程随时读取（全部为无锁原子量，互不等待）
+struct SimulationMetrics {
+    atomic<int> day;
+    atomic<long long> days_completed;
+    atomic<long long> last_day_ns;                    // 最近完成的一天的耗时
+    atomic<long long> phase_ns[PHASE_COUNT];          // 最近完成的一天各阶段的耗时
+    atomic<long long> phase_total_ns[PHASE_COUNT];    // 各阶段的累计耗时
+    atomic<long long> organisms[SPECIES_COUNT];       // 当天结束时各物种的个体数量
+    atomic<long long> births_last_day;
+    atomic<long long> births_total;
+    atomic<long long> deaths_last_day[DEATH_CAUSE_COUNT];
+    atomic<long long> deaths_total[DEATH_CAUSE_COUNT];
+    atomic<long long> pool_used[POOL_COUNT];
+    atomic<long long> pool_capacity[POOL_COUNT];      // 0表示本次运行不使用该存储
+    atomic<long long> tiles_owned;                    // 相对原始地图被修改的地形分块
+    atomic<long long> sleeping;                       // 休眠调度中的生物
+    atomic<long long> seeded_cells;                   // 种子库中有种子的格子
+
+    SimulationMetrics() : day(0), days_completed(0), last_day_ns(0), births_last_day(0), births_total(0),
+        tiles_owned(0), sleeping(0), seeded_cells(0) {
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            phase_ns[p] = 0;
+            phase_total_ns[p] = 0;
+        }
+        for (int sp = 0; sp < SPECIES_COUNT; sp++) organisms[sp] = 0;
+        for (int c = 0; c < DEATH_CAUSE_COUNT; c++) {
+            deaths_last_day[c] = 0;
+            deaths_total[c] = 0;
+        }
+        for (int p = 0; p < POOL_COUNT; p++) {
+            pool_used[p] = 0;
+            pool_capacity[p] = 0;
+        }
+    }
+};
+
+// 硬件性能计数器
+enum HardwareCounter {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_LLC_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_COUNT
+};
+
+const char* const COUNTER_NAMES[COUNTER_COUNT] = { "cycles", "instructions", "LLC-misses", "branch-misses" };
+
+// 按阶段累计的耗时和硬件计数器读数（基准测试用）
+// 计数器通过Linux perf_event_open读取（只计用户态，工作线程继承父线程的计数器）；
+// 内核不支持、权限不足或虚拟机没有暴露PMU时只累计耗时
+class PhaseCounters {
+private:
+    int fds[COUNTER_COUNT];                      // -1表示该计数器不可用
+    string unavailable;                          // 计数器不可用的原因
+    double start[COUNTER_COUNT];                 // 当前阶段开始时的读数
+    long long calls[PHASE_COUNT];                // 各阶段的执行次数
+    long long elapsed_ns[PHASE_COUNT];           // 各阶段的累计耗时
+    double counts[PHASE_COUNT][COUNTER_COUNT];   // 各阶段的累计计数
+
+    // 读取计数器的当前值（与其他计数器轮流使用PMU时按实际计数时间的比例换算）
+    double read_counter(int c) const {
+#ifndef _WIN32
+        unsigned long long value[3]; // 计数、启用时间、实际计数时间
+        if (fds[c] < 0 || read(fds[c], value, sizeof(value)) != static_cast<ssize_t>(sizeof(value))) return 0.0;
+        if (value[2] == 0) return 0.0;
+        return static_cast<double>(value[0]) * value[1] / value[2];
+#else
+        (void)c;
+        return 0.0;
+#endif
+    }
+
+public:
+    PhaseCounters() {
+        fill(fds, fds + COUNTER_COUNT, -1);
+        fill(start, start + COUNTER_COUNT, 0.0);
+        fill(calls, calls + PHASE_COUNT, 0LL);
+        fill(elapsed_ns, elapsed_ns + PHASE_COUNT, 0LL);
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            fill(counts[p], counts[p] + COUNTER_COUNT, 0.0);
+        }
+#ifndef _WIN32
+        static const unsigned long long configs[COUNTER_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+        };
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[c];
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[c] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fds[c] < 0 && unavailable.empty()) {
+                unavailable = string(COUNTER_NAMES[c]) + ": " + strerror(errno);
+            }
+        }
+#else
+        unavailable = "仅支持Linux";
+#endif
+    }
+
+    PhaseCounters(const PhaseCounters&) = delete;
+    PhaseCounters& operator=(const PhaseCounters&) = delete;
+
+    ~PhaseCounters() {
+#ifndef _WIN32
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+
+    bool available(int c) const { return fds[c] >= 0; }
+    const string& get_unavailable_reason() const { return unavailable; }
+
+    void begin() {
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            start[c] = read_counter(c);
+        }
+    }
+
+    void end(int phase, long long ns) {
+        calls[phase]++;
+        elapsed_ns[phase] += ns;
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (available(c)) counts[phase][c] += read_counter(c) - start[c];
+        }
+    }
+
+    // 输出各阶段的耗时、占比和计数器读数
+    void write_report(ostream& out) const {
+        long long total_ns = 0;
+        for (int p = 0; p < PHASE_COUNT; p++) total_ns += elapsed_ns[p];
+
+        out << left << setw(16) << "phase" << right << setw(8) << "calls" << setw(12) << "seconds" << setw(8) << "share";
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (available(c)) out << setw(16) << COUNTER_NAMES[c];
+        }
+        if (available(COUNTER_CYCLES) && available(COUNTER_INSTRUCTIONS)) out << setw(8) << "IPC";
+        out << "\n";
+
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            out << left << setw(16) << PHASE_NAMES[p] << right << setw(8) << calls[p]
+                << setw(12) << fixed << setprecision(4) << elapsed_ns[p] / 1e9
+                << setw(7) << setprecision(1) << (total_ns > 0 ? 100.0 * elapsed_ns[p] / total_ns : 0.0) << "%";
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                if (available(c)) out << setw(16) << setprecision(0) << counts[p][c];
+            }
+            if (available(COUNTER_CYCLES) && available(COUNTER_INSTRUCTIONS)) {
+                double cycles = counts[p][COUNTER_CYCLES];
+                out << setw(8) << setprecision(2) << (cycles > 0 ? counts[p][COUNTER_INSTRUCTIONS] / cycles : 0.0);
+            }
+            out << "\n";
+        }
+        if (!unavailable.empty()) {
+            bool any = false;
+            for (int c = 0; c < COUNTER_COUNT; c++) any = any || available(c);
+            out << (any ? "部分" : "") << "硬件计数器不可用（" << unavailable << "）" << (any ? "" : "，只报告耗时") << "\n";
+        }
+        out.unsetf(ios::floatfield);
+        out << setprecision(6);
+    }
+};
+
+// 阶段计时：离开作用域时把经过的时间累加到elapsed[phase]（启用计数器时同时累计计数器读数）
+class PhaseTimer {
+private:
+    long long* elapsed;
+    PhaseCounters* counters;
+    int phase;
+    chrono::steady_clock::time_point start;
+
+public:
+    PhaseTimer(long long* elapsed, PhaseCounters* counters, int phase)
+        : elapsed(elapsed), counters(counters), phase(phase) {
+        if (counters) counters->begin();
+        start = chrono::steady_clock::now();
+    }
+
+    ~PhaseTimer() {
+        long long ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        elapsed[phase] += ns;
+        if (counters) counters->end(phase, ns);
+    }
+};
+
+// 本进程的常驻内存（字节，无法读取时为0）
+inline long long resident_memory_bytes() {
+#ifndef _WIN32
+    ifstream statm("/proc/self/statm");
+    long long pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+// 导出线程等待单个客户端请求或发送响应的最长时间
+const int METRICS_CLIENT_TIMEOUT_SECONDS = 2;
+
+// 指标导出：在本机端口上以Prometheus文本格式提供SimulationMetrics的当前值
+// 每个连接应答一次后关闭；导出线程只读取原子量，抓取不会让模拟等待
+class MetricsExporter {
+private:
+    const SimulationMetrics& metrics;
+    int rank;
+    int listen_fd;
+    int client_fd;     // 正在服务的连接（-1表示没有），stop()时一并关闭
+    mutex client_mutex;
+    atomic<bool> stopping;
+    thread server;
+
+    static void describe(ostringstream& out, const char* name, const char* type, const char* help) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+    }
+
+    string render() const {
+        ostringstream out;
+        string rank_label = "rank=\"" + to_string(rank) + "\"";
+
+        describe(out, "ecosystem_day", "gauge", "Current simulation day");
+        out << "ecosystem_day{" << rank_label << "} " << metrics.day.load() << "\n";
+        describe(out, "ecosystem_days_total", "counter", "Simulated days completed");
+        out << "ecosystem_days_total{" << rank_label << "} " << metrics.days_completed.load() << "\n";
+        long long day_ns = metrics.last_day_ns.load();
+        describe(out, "ecosystem_days_per_second", "gauge", "Simulation speed over the last completed day");
+        out << "ecosystem_days_per_second{" << rank_label << "} " << (day_ns > 0 ? 1e9 / day_ns : 0.0) << "\n";
+
+        describe(out, "ecosystem_phase_seconds", "gauge", "Time spent in each phase of the last completed day");
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            out << "ecosystem_phase_seconds{" << rank_label << ",phase=\"" << PHASE_NAMES[p] << "\"} "
+                << metrics.phase_ns[p].load() / 1e9 << "\n";
+        }
+        describe(out, "ecosystem_phase_seconds_total", "counter", "Time spent in each phase since the start of the run");
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            out << "ecosystem_phase_seconds_total{" << rank_label << ",phase=\"" << PHASE_NAMES[p] << "\"} "
+                << metrics.phase_total_ns[p].load() / 1e9 << "\n";
+        }
+
+        describe(out, "ecosystem_organisms", "gauge", "Individual organisms per species at the end of the day");
+        for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+            out << "ecosystem_organisms{" << rank_label << ",species=\"" << SPECIES_METRIC_NAMES[sp] << "\"} "
+                << metrics.organisms[sp].load() << "\n";
+        }
+        describe(out, "ecosystem_births_last_day", "gauge", "Births during the last completed day");
+        out << "ecosystem_births_last_day{" << rank_label << "} " << metrics.births_last_day.load() << "\n";
+        describe(out, "ecosystem_births_total", "counter", "Births since the start of the run");
+        out << "ecosystem_births_total{" << rank_label << "} " << metrics.births_total.load() << "\n";
+        describe(out, "ecosystem_deaths_last_day", "gauge", "Deaths by cause during the last completed day");
+        for (int c = 0; c < DEATH_CAUSE_COUNT; c++) {
+            out << "ecosystem_deaths_last_day{" << rank_label << ",cause=\"" << DEATH_CAUSE_METRIC_NAMES[c] << "\"} "
+                << metrics.deaths_last_day[c].load() << "\n";
+        }
+        describe(out, "ecosystem_deaths_total", "counter", "Deaths by cause since the start of the run");
+        for (int c = 0; c < DEATH_CAUSE_COUNT; c++) {
+            out << "ecosystem_deaths_total{" << rank_label << ",cause=\"" << DEATH_CAUSE_METRIC_NAMES[c] << "\"} "
+                << metrics.deaths_total[c].load() << "\n";
+        }
+
+        describe(out, "ecosystem_pool_used", "gauge", "Occupied entries in bounded stores");
+        for (int p = 0; p < POOL_COUNT; p++) {
+            if (metrics.pool_capacity[p].load() == 0) continue;
+            out << "ecosystem_pool_used{" << rank_label << ",pool=\"" << POOL_NAMES[p] << "\"} "
+                << metrics.pool_used[p].load() << "\n";
+        }
+        describe(out, "ecosystem_pool_capacity", "gauge", "Capacity of bounded stores");
+        for (int p = 0; p < POOL_COUNT; p++) {
+            if (metrics.pool_capacity[p].load() == 0) continue;
+            out << "ecosystem_pool_capacity{" << rank_label << ",pool=\"" << POOL_NAMES[p] << "\"} "
+                << metrics.pool_capacity[p].load() << "\n";
+        }
+        describe(out, "ecosystem_terrain_tiles_owned", "gauge", "Terrain tiles modified away from the pristine map");
+        out << "ecosystem_terrain_tiles_owned{" << rank_label << "} " << metrics.tiles_owned.load() << "\n";
+        describe(out, "ecosystem_sleeping_organisms", "gauge", "Organisms held by the sleep scheduler");
+        out << "ecosystem_sleeping_organisms{" << rank_label << "} " << metrics.sleeping.load() << "\n";
+        describe(out, "ecosystem_seed_bank_cells", "gauge", "Cells holding dormant seeds");
+        out << "ecosystem_seed_bank_cells{" << rank_label << "} " << metrics.seeded_cells.load() << "\n";
+
+        describe(out, "ecosystem_resident_memory_bytes", "gauge", "Resident set size of the process");
+        out << "ecosystem_resident_memory_bytes{" << rank_label << "} " << resident_memory_bytes() << "\n";
+        return out.str();
+    }
+
+    void serve() {
+#ifndef _WIN32
+        while (!stopping.load()) {
+            int client = accept(listen_fd, nullptr, nullptr);
+            if (client < 0) continue;
+            // 空闲或很慢的客户端最多占用导出线程几秒，不会拖住进程退出
+            timeval timeout;
+            timeout.tv_sec = METRICS_CLIENT_TIMEOUT_SECONDS;
+            timeout.tv_usec = 0;
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            {
+                lock_guard<mutex> lock(client_mutex);
+                if (stopping.load()) {
+                    ::close(client);
+                    break;
+                }
+                client_fd = client;
+            }
+            char request[1024];
+            recv(client, request, sizeof(request), 0); // 不区分路径，任何请求都返回全部指标
+            string body = render();
+            string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+            for (size_t sent = 0; sent < response.size();) {
+                ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0) break;
+                sent += static_cast<size_t>(n);
+            }
+            {
+                lock_guard<mutex> lock(client_mutex);
+                client_fd = -1;
+            }
+            ::close(client);
+        }
+#endif
+    }
+
+public:
+    MetricsExporter(const SimulationMetrics& metrics, int rank)
+        : metrics(metrics), rank(rank), listen_fd(-1), client_fd(-1), stopping(false) {}
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    ~MetricsExporter() {
+        stop();
+    }
+
+    // 在127.0.0.1:port上监听并启动导出线程，失败时返回false
+    bool start(int port) {
+#ifndef _WIN32
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd < 0) return false;
+        int reuse = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<unsigned short>(port));
+        if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listen_fd, 8) != 0) {
+            ::close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+        server = thread(&MetricsExporter::serve, this);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void stop() {
+#ifndef _WIN32
+        if (!server.joinable()) return;
+        {
+            lock_guard<mutex> lock(client_mutex);
+            stopping = true;
+            if (client_fd >= 0) shutdown(client_fd, SHUT_RDWR); // 唤醒阻塞在recv()/send()中的导出线程
+        }
+        shutdown(listen_fd, SHUT_RDWR); // 唤醒阻塞在accept()中的导出线程
+        server.join();
+        ::close(listen_fd);
+        listen_fd = -1;
+#endif
+    }
+};
+
+// ---- 种群汇总表 ----
+// 按物种的个体数量和能量的二维前缀和（summed-area table），每天结束时重建一次。
+// 区域划分为边长8格的块，块又按地形分块的大小分页，每页保存本页各块的前缀和，只有有个体的页才分配。
+// 查询时逐页处理：完全落在查询矩形内的块由前缀和在常数时间内求出，
+// 矩形边上只覆盖了一部分的块逐个检查其中的个体（个体按页和块排好序），所以任意矩形的结果都是精确的。
+// 每天重建时分配新的页，原来的页留给仍在使用的副本（导出帧），所以复制汇总表只复制页的指针。
+// 只统计个体，关注区域之外由密度场表示的数量不在其中
+
+const int POPULATION_TABLE_SHIFT = 3; // 块的边长为8格
+const int POPULATION_PAGE_SHIFT = TERRAIN_TILE_SHIFT - POPULATION_TABLE_SHIFT;
+const int POPULATION_PAGE_BLOCKS = 1 << POPULATION_PAGE_SHIFT; // 每页8x8块
+
+class PopulationTables {
+private:
+    static const int PAGE_BLOCKS = POPULATION_PAGE_BLOCKS * POPULATION_PAGE_BLOCKS;
+    static const int TABLE_SIZE = (POPULATION_PAGE_BLOCKS + 1) * (POPULATION_PAGE_BLOCKS + 1);
+
+    struct Entry {
+        int x, y;
+        int species;
+        double energy;
+    };
+
+    // 一页的前缀和：[物种][(块y)*(每页块数+1)+块x]，第0行和第0列为0
+    struct Page {
+        unsigned int counts[SPECIES_COUNT][TABLE_SIZE];
+        double energy[SPECIES_COUNT][TABLE_SIZE];
+        unsigned int block_start[PAGE_BLOCKS + 1]; // 各块的个体在entries中的起始位置
+        int slot;                                  // 在occupied中的序号（重建时使用）
+    };
+
+    int x0, y0, x1, y1; // 统计的区域
+    int pages_x, pages_y;
+    vector<shared_ptr<Page>> pages;
+    vector<int> occupied;             // 有个体的页（按编号排序）
+    vector<Entry> entries;            // 按页和块排序的个体
+    unsigned int totals[SPECIES_COUNT];
+    unsigned int infected, sleeping;
+
+    static int table_index(int bx, int by) {
+        return by * (POPULATION_PAGE_BLOCKS + 1) + bx;
+    }
+    int page_of(int x, int y) const {
+        return ((y - y0) >> TERRAIN_TILE_SHIFT) * pages_x + ((x - x0) >> TERRAIN_TILE_SHIFT);
+    }
+    int block_of(int x, int y) const {
+        return (((y - y0) >> POPULATION_TABLE_SHIFT) & (POPULATION_PAGE_BLOCKS - 1)) * POPULATION_PAGE_BLOCKS +
+            (((x - x0) >> POPULATION_TABLE_SHIFT) & (POPULATION_PAGE_BLOCKS - 1));
+    }
+
+    // 矩形（已裁剪到页和区域内）中first..last物种的数量和能量，ox/oy为页的左上角
+    void accumulate_page(const Page& page, int ox, int oy, int first, int last, int qx0, int qy0, int qx1, int qy1,
+        unsigned int& count, double& total) const {
+        const int size = 1 << POPULATION_TABLE_SHIFT;
+        // 完全落在矩形内的块（区域右边和下边不满一块的部分也算）
+        int fx0 = (qx0 - ox + size - 1) >> POPULATION_TABLE_SHIFT, fx1 = (qx1 - ox) >> POPULATION_TABLE_SHIFT;
+        int fy0 = (qy0 - oy + size - 1) >> POPULATION_TABLE_SHIFT, fy1 = (qy1 - oy) >> POPULATION_TABLE_SHIFT;
+        if (qx1 == x1) fx1 = ((qx1 - 1 - ox) >> POPULATION_TABLE_SHIFT) + 1;
+        if (qy1 == y1) fy1 = ((qy1 - 1 - oy) >> POPULATION_TABLE_SHIFT) + 1;
+        bool full = fx0 < fx1 && fy0 < fy1;
+        if (full) {
+            for (int sp = first; sp <= last; sp++) {
+                count += page.counts[sp][table_index(fx1, fy1)] - page.counts[sp][table_index(fx0, fy1)] -
+                    page.counts[sp][table_index(fx1, fy0)] + page.counts[sp][table_index(fx0, fy0)];
+                total += page.energy[sp][table_index(fx1, fy1)] - page.energy[sp][table_index(fx0, fy1)] -
+                    page.energy[sp][table_index(fx1, fy0)] + page.energy[sp][table_index(fx0, fy0)];
+            }
+        }
+
+        // 边上的块逐个检查个体
+        int bx0 = (qx0 - ox) >> POPULATION_TABLE_SHIFT, bx1 = ((qx1 - 1 - ox) >> POPULATION_TABLE_SHIFT) + 1;
+        int by0 = (qy0 - oy) >> POPULATION_TABLE_SHIFT, by1 = ((qy1 - 1 - oy) >> POPULATION_TABLE_SHIFT) + 1;
+        for (int by = by0; by < by1; by++) {
+            for (int bx = bx0; bx < bx1; bx++) {
+                if (full && bx >= fx0 && bx < fx1 && by >= fy0 && by < fy1) {
+                    bx = fx1 - 1; // 跳过这一行中完全在内的块
+                    continue;
+                }
+                int block = by * POPULATION_PAGE_BLOCKS + bx;
+                for (unsigned int i = page.block_start[block]; i < page.block_start[block + 1]; i++) {
+                    const Entry& entry = entries[i];
+                    if (entry.species >= first && entry.species <= last &&
+                        entry.x >= qx0 && entry.x < qx1 && entry.y >= qy0 && entry.y < qy1) {
+                        count++;
+                        total += entry.energy;
+                    }
+                }
+            }
+        }
+    }
+
+    // 矩形（已裁剪到区域内）中first..last物种的数量和能量：逐个处理与矩形相交的已分配的页
+    void accumulate(int first, int last, int qx0, int qy0, int qx1, int qy1, unsigned int& count, double& total) const {
+        int px0 = (qx0 - x0) >> TERRAIN_TILE_SHIFT, px1 = ((qx1 - 1 - x0) >> TERRAIN_TILE_SHIFT) + 1;
+        int py0 = (qy0 - y0) >> TERRAIN_TILE_SHIFT, py1 = ((qy1 - 1 - y0) >> TERRAIN_TILE_SHIFT) + 1;
+        for (int py = py0; py < py1; py++) {
+            for (int px = px0; px < px1; px++) {
+                const Page* page = pages[static_cast<size_t>(py) * pages_x + px].get();
+                if (!page) continue;
+                int ox = x0 + (px << TERRAIN_TILE_SHIFT), oy = y0 + (py << TERRAIN_TILE_SHIFT);
+                accumulate_page(*page, ox, oy, first, last, max(qx0, ox), max(qy0, oy),
+                    min(qx1, ox + TERRAIN_TILE_SIZE), min(qy1, oy + TERRAIN_TILE_SIZE), count, total);
+            }
+        }
+    }
+
+public:
+    PopulationTables() : x0(0), y0(0), x1(0), y1(0), pages_x(0), pages_y(0), totals(), infected(0), sleeping(0) {}
+
+    // 设定统计的区域（本进程负责的区域），内容清空
+    void reset(int rx0, int ry0, int rx1, int ry1) {
+        x0 = rx0; y0 = ry0; x1 = rx1; y1 = ry1;
+        pages_x = ((x1 - x0 - 1) >> TERRAIN_TILE_SHIFT) + 1;
+        pages_y = ((y1 - y0 - 1) >> TERRAIN_TILE_SHIFT) + 1;
+        pages.clear();
+        pages.resize(static_cast<size_t>(pages_x) * pages_y);
+        occupied.clear();
+        entries.clear();
+        fill(totals, totals + SPECIES_COUNT, 0u);
+        infected = sleeping = 0;
+    }
+
+    // 重建第一步：为有个体的页分配新的页，把个体按页和块排序，并把各块的合计写入页中（区域之外的个体不计）
+    // 之后由调用者对sum_pages的全部任务各执行一遍（可以多线程）
+    void bin(const vector<Organism*>& organisms) {
+        for (int index : occupied) pages[index].reset();
+        occupied.clear();
+        fill(totals, totals + SPECIES_COUNT, 0u);
+        infected = sleeping = 0;
+
+        for (const Organism* org : organisms) {
+            int x = org->getX(), y = org->getY();
+            if (x < x0 || y < y0 || x >= x1 || y >= y1) continue;
+            shared_ptr<Page>& page = pages[page_of(x, y)];
+            if (!page) {
+                page = make_shared<Page>(); // 值初始化，数量为0
+                occupied.push_back(page_of(x, y));
+            }
+            page->block_start[block_of(x, y) + 1]++;
+        }
+        sort(occupied.begin(), occupied.end());
+
+        unsigned int inside = 0;
+        vector<unsigned int> next(occupied.size() * PAGE_BLOCKS);
+        for (size_t slot = 0; slot < occupied.size(); slot++) {
+            Page& page = *pages[occupied[slot]];
+            page.slot = static_cast<int>(slot);
+            page.block_start[0] = inside;
+            for (int b = 1; b <= PAGE_BLOCKS; b++) {
+                page.block_start[b] += page.block_start[b - 1];
+            }
+            copy(page.block_start, page.block_start + PAGE_BLOCKS, next.begin() + slot * PAGE_BLOCKS);
+            inside = page.block_start[PAGE_BLOCKS];
+        }
+
+        entries.resize(inside);
+        for (const Organism* org : organisms) {
+            int x = org->getX(), y = org->getY();
+            if (x < x0 || y < y0 || x >= x1 || y >= y1) continue;
+            Page& page = *pages[page_of(x, y)];
+            Entry& entry = entries[next[static_cast<size_t>(page.slot) * PAGE_BLOCKS + block_of(x, y)]++];
+            entry.x = x;
+            entry.y = y;
+            entry.species = org->getSpecies();
+            entry.energy = org->getEnergy();
+            int cell = table_index((((x - x0) >> POPULATION_TABLE_SHIFT) & (POPULATION_PAGE_BLOCKS - 1)) + 1,
+                (((y - y0) >> POPULATION_TABLE_SHIFT) & (POPULATION_PAGE_BLOCKS - 1)) + 1);
+            page.counts[entry.species][cell]++;
+            page.energy[entry.species][cell] += entry.energy;
+            totals[entry.species]++;
+            if (org->hasDisease() && !org->is_dead()) infected++;
+            if (org->is_sleeping()) sleeping++;
+        }
+    }
+
+    // 重建第二步：每个任务对一页的各物种先按行、再按列做前缀和
+    size_t page_tasks() const { return occupied.size(); }
+    void sum_pages(size_t begin, size_t end) {
+        for (size_t task = begin; task < end; task++) {
+            Page& page = *pages[occupied[task]];
+            for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+                for (int by = 1; by <= POPULATION_PAGE_BLOCKS; by++) {
+                    for (int bx = 1; bx <= POPULATION_PAGE_BLOCKS; bx++) {
+                        page.counts[sp][table_index(bx, by)] += page.counts[sp][table_index(bx - 1, by)];
+                        page.energy[sp][table_index(bx, by)] += page.energy[sp][table_index(bx - 1, by)];
+                    }
+                }
+                for (int by = 1; by <= POPULATION_PAGE_BLOCKS; by++) {
+                    for (int bx = 1; bx <= POPULATION_PAGE_BLOCKS; bx++) {
+                        page.counts[sp][table_index(bx, by)] += page.counts[sp][table_index(bx, by - 1)];
+                        page.energy[sp][table_index(bx, by)] += page.energy[sp][table_index(bx, by - 1)];
+                    }
+                }
+            }
+        }
+    }
+
+    // 矩形[qx0,qx1)x[qy0,qy1)中物种first..last的个体数量
+    unsigned int count(int first, int last, int qx0, int qy0, int qx1, int qy1) const {
+        unsigned int result = 0;
+        double total = 0.0;
+        qx0 = max(qx0, x0); qy0 = max(qy0, y0); qx1 = min(qx1, x1); qy1 = min(qy1, y1);
+        if (qx0 < qx1 && qy0 < qy1) accumulate(first, last, qx0, qy0, qx1, qy1, result, total);
+        return result;
+    }
+    unsigned int count(int species, int qx0, int qy0, int qx1, int qy1) const {
+        return count(species, species, qx0, qy0, qx1, qy1);
+    }
+
+    // 矩形中物种first..last的能量合计
+    double total_energy(int first, int last, int qx0, int qy0, int qx1, int qy1) const {
+        unsigned int result = 0;
+        double total = 0.0;
+        qx0 = max(qx0, x0); qy0 = max(qy0, y0); qx1 = min(qx1, x1); qy1 = min(qy1, y1);
+        if (qx0 < qx1 && qy0 < qy1) accumulate(first, last, qx0, qy0, qx1, qy1, result, total);
+        return total;
+    }
+
+    // 整个区域中某物种的个体数量
+    unsigned int total(int species) const {
+        return totals[species];
+    }
+
+    unsigned int get_infected() const { return infected; }
+    unsigned int get_sleeping() const { return sleeping; }
+
+    size_t memory_bytes() const {
+        return pages.capacity() * sizeof(shared_ptr<Page>) + occupied.capacity() * sizeof(int) +
+            occupied.size() * sizeof(Page) + entries.capacity() * sizeof(Entry);
+    }
+};
+
+// ---- 图像帧导出 ----
+// 按设定的间隔把整个区域的地形、积水、干旱和种群密度渲染成图像序列（PPM或PNG），用于制作录像。
+// 模拟线程只复制一份快照（地形图按分块共享，只复制指针；生物只复制当天的种群汇总表），
+// 缩小、着色和编码都在后台线程中进行，各天的帧可以同时编码
+
+// 可导出的图层（FRAME_SPECIES之后按物种编号依次为各物种的密度）
+enum FrameLayer {
+    FRAME_TERRAIN,    // 地形类型
+    FRAME_WATER,      // 积水深度
+    FRAME_DROUGHT,    // 干旱程度
+    FRAME_POPULATION, // 全部生物的密度
+    FRAME_SPECIES,
+    FRAME_LAYER_COUNT = FRAME_SPECIES + SPECIES_COUNT
+};
+
+const char* const FRAME_LAYER_NAMES[FRAME_SPECIES] = { "terrain", "water", "drought", "population" };
+
+const int FRAME_ENCODER_THREADS = 2; // 后台编码线程数
+const int FRAME_QUEUE_LIMIT = 8;     // 等待编码的快照上限，编码跟不上时模拟线程等待
+const double FRAME_DENSITY_GAIN = 4.0; // 密度着色的增益（每格0.25个个体约为最亮的63%），各帧使用同一标尺
+
+// 地形类型的颜色（按TerrainType顺序）
+const unsigned char FRAME_TERRAIN_COLORS[FLOODED + 1][3] = {
+    { 150, 190, 90 },  // 平原
+    { 30, 110, 40 },   // 森林
+    { 130, 120, 110 }, // 山脉
+    { 220, 200, 130 }, // 沙漠
+    { 40, 90, 200 },   // 水域
+    { 80, 120, 90 },   // 沼泽
+    { 120, 30, 20 },   // 火山
+    { 240, 240, 250 }, // 雪地
+    { 170, 210, 80 },  // 草原
+    { 20, 80, 30 },    // 丛林
+    { 160, 170, 150 }, // 苔原
+    { 230, 220, 170 }, // 海滩
+    { 90, 150, 230 }   // 积水区
+};
+
+// 按名称查找图层（物种图层使用指标中的物种名），找不到时返回-1
+int frame_layer_index(const string& name) {
+    for (int layer = 0; layer < FRAME_SPECIES; layer++) {
+        if (name == FRAME_LAYER_NAMES[layer]) return layer;
+    }
+    for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+        if (name == SPECIES_METRIC_NAMES[sp]) return FRAME_SPECIES + sp;
+    }
+    return -1;
+}
+
+string frame_layer_name(int layer) {
+    return layer < FRAME_SPECIES ? FRAME_LAYER_NAMES[layer] : SPECIES_METRIC_NAMES[layer - FRAME_SPECIES];
+}
+
+// 导出一帧所需的数据（模拟线程复制，编码线程独占）
+struct FrameSnapshot {
+    int day;
+    int x0, y0, x1, y1;        // 导出的区域（本进程负责的区域）
+    TerrainMap terrain;        // 与世界共享分块的地形图副本（编码线程只用peek读取，不生成分块）
+    PopulationTables population; // 种群汇总表的副本
+    int density_cells_x, density_cells_y;
+    vector<float> density;     // 关注区域之外的密度 [物种][密度格]（未启用细节层次时为空）
+};
+
+class FrameExporter {
+private:
+    string prefix; // 文件名前缀，各图层写入 前缀_图层_天数.扩展名
+    vector<int> layers;
+    int stride, scale;
+    bool png;
+
+    mutex queue_mutex;
+    condition_variable queue_changed;
+    deque<unique_ptr<FrameSnapshot>> pending;
+    // 编码完的快照交回模拟线程释放：地形分块是否被共享由引用计数判断，
+    // 在模拟线程中释放副本才能保证模拟线程原地修改分块时，编码线程已不再读取
+    vector<unique_ptr<FrameSnapshot>> finished;
+    bool closing;
+    vector<thread> encoders;
+
+    atomic<int> frames_written;
+    atomic<int> frames_failed;
+
+    // 颜色在两端之间线性插值
+    static void blend(const unsigned char* low, const unsigned char* high, double t, unsigned char* pixel) {
+        t = max(0.0, min(1.0, t));
+        for (int c = 0; c < 3; c++) {
+            pixel[c] = static_cast<unsigned char>(low[c] + (high[c] - low[c]) * t + 0.5);
+        }
+    }
+
+    // 密度着色：黑-红-黄-白
+    static void heat(double density, unsigned char* pixel) {
+        static const unsigned char stops[4][3] = { { 0, 0, 0 }, { 200, 30, 20 }, { 250, 210, 40 }, { 255, 255, 255 } };
+        double t = (1.0 - exp(-density * FRAME_DENSITY_GAIN)) * 3.0;
+        int segment = min(2, static_cast<int>(t));
+        blend(stops[segment], stops[segment + 1], t - segment, pixel);
+    }
+
+    // 地形图层：每个像素汇总scale x scale个格子，取最多的地形类型和平均的积水、干旱
+    // 像素中心所在的分块尚未生成时，只取中心格的原始值（未生成的区域保持生成时的样子）
+    void render_terrain(const FrameSnapshot& frame, int pixels_x, int pixels_y,
+        vector<unsigned char>& types, vector<float>& water, vector<float>& drought) const {
+        types.assign(static_cast<size_t>(pixels_x) * pixels_y, 0);
+        water.assign(types.size(), 0.0f);
+        drought.assign(types.size(), 0.0f);
+        for (int py = 0; py < pixels_y; py++) {
+            for (int px = 0; px < pixels_x; px++) {
+                int bx0 = frame.x0 + px * scale, by0 = frame.y0 + py * scale;
+                int bx1 = min(frame.x1, bx0 + scale), by1 = min(frame.y1, by0 + scale);
+                int cx = (bx0 + bx1) / 2, cy = (by0 + by1) / 2;
+                if (!frame.terrain.is_generated(cx, cy)) {
+                    bx0 = cx; by0 = cy; bx1 = cx + 1; by1 = cy + 1;
+                }
+
+                int histogram[FLOODED + 1] = { 0 };
+                double water_sum = 0.0, drought_sum = 0.0;
+                for (int y = by0; y < by1; y++) {
+                    for (int x = bx0; x < bx1; x++) {
+                        Terrain cell = frame.terrain.peek(x, y);
+                        histogram[cell.type]++;
+                        water_sum += cell.water_accumulation;
+                        drought_sum += cell.drought_level;
+                    }
+                }
+                int cells = (bx1 - bx0) * (by1 - by0);
+                size_t pixel = static_cast<size_t>(py) * pixels_x + px;
+                types[pixel] = static_cast<unsigned char>(max_element(histogram, histogram + FLOODED + 1) - histogram);
+                water[pixel] = static_cast<float>(water_sum / cells);
+                drought[pixel] = static_cast<float>(drought_sum / cells);
+            }
+        }
+    }
+
+    // 密度图层：由种群汇总表查询每个像素内的个体，加上关注区域之外的密度（按与像素重叠的面积分摊），再除以像素覆盖的格数
+    void render_density(const FrameSnapshot& frame, int species, int pixels_x, int pixels_y, vector<float>& density) const {
+        density.assign(static_cast<size_t>(pixels_x) * pixels_y, 0.0f);
+        int first = species < 0 ? 0 : species, last = species < 0 ? SPECIES_COUNT - 1 : species;
+        for (int py = 0; py < pixels_y; py++) {
+            for (int px = 0; px < pixels_x; px++) {
+                int x = frame.x0 + px * scale, y = frame.y0 + py * scale;
+                density[static_cast<size_t>(py) * pixels_x + px] =
+                    static_cast<float>(frame.population.count(first, last, x, y, x + scale, y + scale));
+            }
+        }
+
+        size_t cells = static_cast<size_t>(frame.density_cells_x) * frame.density_cells_y;
+        for (size_t c = 0; c < cells && !frame.density.empty(); c++) {
+            float amount = 0.0f;
+            for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+                if (species < 0 || sp == species) amount += frame.density[sp * cells + c];
+            }
+            if (amount <= 0.0f) continue;
+            int cell_x = static_cast<int>(c % frame.density_cells_x) << DENSITY_CELL_SHIFT;
+            int cell_y = static_cast<int>(c / frame.density_cells_x) << DENSITY_CELL_SHIFT;
+            int cx0 = max(frame.x0, cell_x), cx1 = min(frame.x1, cell_x + DENSITY_CELL_SIZE);
+            int cy0 = max(frame.y0, cell_y), cy1 = min(frame.y1, cell_y + DENSITY_CELL_SIZE);
+            if (cx0 >= cx1 || cy0 >= cy1) continue;
+            float per_cell = amount / (DENSITY_CELL_SIZE * DENSITY_CELL_SIZE);
+            for (int py = (cy0 - frame.y0) / scale; py * scale + frame.y0 < cy1; py++) {
+                int overlap_y = min(cy1, frame.y0 + (py + 1) * scale) - max(cy0, frame.y0 + py * scale);
+                for (int px = (cx0 - frame.x0) / scale; px * scale + frame.x0 < cx1; px++) {
+                    int overlap_x = min(cx1, frame.x0 + (px + 1) * scale) - max(cx0, frame.x0 + px * scale);
+                    density[static_cast<size_t>(py) * pixels_x + px] += per_cell * overlap_x * overlap_y;
+                }
+            }
+        }
+
+        for (int py = 0; py < pixels_y; py++) {
+            int rows = min(frame.y1, frame.y0 + (py + 1) * scale) - (frame.y0 + py * scale);
+            for (int px = 0; px < pixels_x; px++) {
+                int columns = min(frame.x1, frame.x0 + (px + 1) * scale) - (frame.x0 + px * scale);
+                density[static_cast<size_t>(py) * pixels_x + px] /= static_cast<float>(rows * columns);
+            }
+        }
+    }
+
+    static unsigned int crc32(const unsigned char* data, size_t length, unsigned int crc = 0) {
+        static unsigned int table[256];
+        static once_flag table_built;
+        call_once(table_built, [] {
+            for (unsigned int n = 0; n < 256; n++) {
+                unsigned int c = n;
+                for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+            }
+        });
+        crc = ~crc;
+        for (size_t i = 0; i < length; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    static void put_u32(vector<unsigned char>& out, unsigned int value) {
+        for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<unsigned char>(value >> shift));
+    }
+
+    static void put_chunk(vector<unsigned char>& out, const char* type, const vector<unsigned char>& data) {
+        put_u32(out, static_cast<unsigned int>(data.size()));
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        put_u32(out, crc32(&out[start], out.size() - start));
+    }
+
+    // 编码为PNG（8位RGB，zlib数据流使用不压缩的存储块，不依赖外部库）
+    static void encode_png(const vector<unsigned char>& rgb, int width, int height, vector<unsigned char>& out) {
+        static const unsigned char signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+        out.assign(signature, signature + 8);
+
+        vector<unsigned char> header;
+        put_u32(header, static_cast<unsigned int>(width));
+        put_u32(header, static_cast<unsigned int>(height));
+        const unsigned char format[5] = { 8, 2, 0, 0, 0 }; // 位深、RGB、压缩、过滤、不隔行
+        header.insert(header.end(), format, format + 5);
+        put_chunk(out, "IHDR", header);
+
+        // 每行前加过滤类型0
+        vector<unsigned char> raw;
+        raw.reserve(static_cast<size_t>(width * 3 + 1) * height);
+        for (int y = 0; y < height; y++) {
+            raw.push_back(0);
+            raw.insert(raw.end(), rgb.begin() + static_cast<size_t>(y) * width * 3, rgb.begin() + static_cast<size_t>(y + 1) * width * 3);
+        }
+        vector<unsigned char> stream = { 0x78, 0x01 };
+        unsigned int a = 1, b = 0; // Adler-32
+        size_t offset = 0;
+        do {
+            unsigned short length = static_cast<unsigned short>(min<size_t>(65535, raw.size() - offset));
+            unsigned short complement = static_cast<unsigned short>(~length);
+            stream.push_back(offset + length == raw.size() ? 1 : 0); // 最后一块的标记
+            stream.push_back(static_cast<unsigned char>(length));
+            stream.push_back(static_cast<unsigned char>(length >> 8));
+            stream.push_back(static_cast<unsigned char>(complement));
+            stream.push_back(static_cast<unsigned char>(complement >> 8));
+            for (size_t i = offset; i < offset + length; i++) {
+                a = (a + raw[i]) % 65521;
+                b = (b + a) % 65521;
+            }
+            stream.insert(stream.end(), raw.begin() + offset, raw.begin() + offset + length);
+            offset += length;
+        } while (offset < raw.size());
+        put_u32(stream, (b << 16) | a);
+        put_chunk(out, "IDAT", stream);
+        put_chunk(out, "IEND", vector<unsigned char>());
+    }
+
+    bool write_image(const string& path, const vector<unsigned char>& rgb, int width, int height) const {
+        ofstream file(path, ios::binary | ios::trunc);
+        if (!file) return false;
+        if (png) {
+            vector<unsigned char> encoded;
+            encode_png(rgb, width, height, encoded);
+            file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+        }
+        else {
+            file << "P6\n" << width << " " << height << "\n255\n";
+            file.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+        }
+        return static_cast<bool>(file);
+    }
+
+    // 渲染并写入一天的全部图层
+    void encode(const FrameSnapshot& frame) {
+        int pixels_x = (frame.x1 - frame.x0 + scale - 1) / scale;
+        int pixels_y = (frame.y1 - frame.y0 + scale - 1) / scale;
+        vector<unsigned char> types;
+        vector<float> water, drought, density;
+        if (wants_terrain()) {
+            render_terrain(frame, pixels_x, pixels_y, types, water, drought);
+        }
+
+        static const unsigned char dry[3] = { 20, 20, 30 }, wet[3] = { 60, 160, 255 };
+        static const unsigned char moist[3] = { 40, 70, 40 }, parched[3] = { 230, 150, 40 };
+        vector<unsigned char> rgb(static_cast<size_t>(pixels_x) * pixels_y * 3);
+        char day_text[16];
+        snprintf(day_text, sizeof(day_text), "%05d", frame.day);
+        for (int layer : layers) {
+            if (layer >= FRAME_POPULATION) {
+                render_density(frame, layer == FRAME_POPULATION ? -1 : layer - FRAME_SPECIES, pixels_x, pixels_y, density);
+            }
+            for (size_t pixel = 0; pixel < static_cast<size_t>(pixels_x) * pixels_y; pixel++) {
+                unsigned char* out = &rgb[pixel * 3];
+                switch (layer) {
+                case FRAME_TERRAIN: memcpy(out, FRAME_TERRAIN_COLORS[types[pixel]], 3); break;
+                case FRAME_WATER: blend(dry, wet, water[pixel], out); break;
+                case FRAME_DROUGHT: blend(moist, parched, drought[pixel], out); break;
+                default: heat(density[pixel], out);
+                }
+            }
+            string path = prefix + "_" + frame_layer_name(layer) + "_" + day_text + (png ? ".png" : ".ppm");
+            if (write_image(path, rgb, pixels_x, pixels_y)) frames_written++;
+            else frames_failed++;
+        }
+    }
+
+    void run() {
+        while (true) {
+            unique_ptr<FrameSnapshot> frame;
+            {
+                unique_lock<mutex> lock(queue_mutex);
+                queue_changed.wait(lock, [this] { return closing || !pending.empty(); });
+                if (pending.empty()) return;
+                frame = move(pending.front());
+                pending.pop_front();
+            }
+            queue_changed.notify_all(); // 唤醒等待队列空位的模拟线程
+            encode(*frame);
+            lock_guard<mutex> lock(queue_mutex);
+            finished.push_back(move(frame));
+        }
+    }
+
+public:
+    FrameExporter(const string& prefix, const vector<int>& layers, int stride, int scale, bool png)
+        : prefix(prefix), layers(layers), stride(stride), scale(scale), png(png), closing(false),
+        frames_written(0), frames_failed(0) {
+        for (int i = 0; i < FRAME_ENCODER_THREADS; i++) {
+            encoders.emplace_back(&FrameExporter::run, this);
+        }
+    }
+
+    ~FrameExporter() {
+        close();
+    }
+
+    int get_stride() const { return stride; }
+    int get_written() const { return frames_written; }
+    int get_failed() const { return frames_failed; }
+
+    // 需要地形图层（否则快照不必复制地形）
+    bool wants_terrain() const {
+        return find_if(layers.begin(), layers.end(), [](int layer) { return layer < FRAME_POPULATION; }) != layers.end();
+    }
+    // 需要密度图层（否则快照不必复制种群汇总表）
+    bool wants_population() const {
+        return find_if(layers.begin(), layers.end(), [](int layer) { return layer >= FRAME_POPULATION; }) != layers.end();
+    }
+
+    // 交给后台线程编码；等待编码的快照已达上限时先等待
+    // 同时释放之前编码完的快照
+    void submit(unique_ptr<FrameSnapshot> frame) {
+        vector<unique_ptr<FrameSnapshot>> released;
+        unique_lock<mutex> lock(queue_mutex);
+        queue_changed.wait(lock, [this] { return static_cast<int>(pending.size()) < FRAME_QUEUE_LIMIT; });
+        pending.push_back(move(frame));
+        released.swap(finished);
+        queue_changed.notify_all();
+    }
+
+    // 编码完所有等待中的帧后结束后台线程
+    void close() {
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            closing = true;
+        }
+        queue_changed.notify_all();
+        for (thread& encoder : encoders) {
+            if (encoder.joinable()) encoder.join();
+        }
+        finished.clear();
+    }
+};
+
+// ---- 物种开销统计 ----
+
+// 按物种统计耗时的行为
+enum ProfiledBehaviour {
+    BEHAVIOUR_MOVE,
+    BEHAVIOUR_EAT,       // 觅食（并行收集进食意图）和进食结算
+    BEHAVIOUR_REPRODUCE,
+    BEHAVIOUR_AGE,
+    BEHAVIOUR_WEATHER,
+    BEHAVIOUR_COUNT
+};
+
+const char* const BEHAVIOUR_NAMES[BEHAVIOUR_COUNT] = { "move", "eat", "reproduce", "age_organism", "weather_effect" };
+
+// 时间戳计数器（x86上为TSC，其他平台退回steady_clock的纳秒数）
+inline unsigned long long read_timestamp() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#else
+    return static_cast<unsigned long long>(chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// 每个(物种, 行为)的累计时间戳计数和调用次数
+struct ProfileTable {
+    unsigned long long ticks[SPECIES_COUNT][BEHAVIOUR_COUNT];
+    unsigned long long calls[SPECIES_COUNT][BEHAVIOUR_COUNT];
+
+    ProfileTable() {
+        memset(ticks, 0, sizeof(ticks));
+        memset(calls, 0, sizeof(calls));
+    }
+
+    // 计时执行fn，计入species的behaviour（table为空时直接执行）
+    template <class Fn>
+    static void measure(ProfileTable* table, int species, int behaviour, Fn fn) {
+        if (!table) {
+            fn();
+            return;
+        }
+        unsigned long long start = read_timestamp();
+        fn();
+        table->ticks[species][behaviour] += read_timestamp() - start;
+        table->calls[species][behaviour]++;
+    }
+};
+
+// 物种开销统计：模拟线程直接累加到totals，工作线程先累加到各自的表，结束时合并
+class SpeciesProfiler {
+private:
+    ProfileTable totals;
+    mutex merge_mutex;
+    unsigned long long start_ticks;
+    chrono::steady_clock::time_point start_time;
+
+public:
+    SpeciesProfiler() : start_ticks(read_timestamp()), start_time(chrono::steady_clock::now()) {}
+
+    ProfileTable* table() { return &totals; }
+
+    void merge(const ProfileTable& local) {
+        lock_guard<mutex> lock(merge_mutex);
+        for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+            for (int b = 0; b < BEHAVIOUR_COUNT; b++) {
+                totals.ticks[sp][b] += local.ticks[sp][b];
+                totals.calls[sp][b] += local.calls[sp][b];
+            }
+        }
+    }
+
+    // 按累计耗时从高到低输出各(物种, 行为)的调用次数、耗时、占比和每次耗时
+    // （时间戳计数按统计开始以来的墙钟时间换算为秒）
+    void write_report(ostream& out) {
+        lock_guard<mutex> lock(merge_mutex);
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+        unsigned long long ticks = read_timestamp() - start_ticks;
+        double seconds_per_tick = ticks > 0 ? elapsed / ticks : 0.0;
+
+        vector<pair<int, int>> rows;
+        unsigned long long total_ticks = 0;
+        for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+            for (int b = 0; b < BEHAVIOUR_COUNT; b++) {
+                if (totals.calls[sp][b] == 0) continue;
+                rows.push_back(make_pair(sp, b));
+                total_ticks += totals.ticks[sp][b];
+            }
+        }
+        sort(rows.begin(), rows.end(), [&](const pair<int, int>& a, const pair<int, int>& b) {
+            return totals.ticks[a.first][a.second] > totals.ticks[b.first][b.second];
+        });
+
+        out << "物种开销排名（统计 " << fixed << setprecision(1) << elapsed << " 秒）\n";
+        out << right << setw(4) << "#" << "  " << left << setw(16) << "species" << setw(16) << "behaviour"
+            << right << setw(14) << "calls" << setw(12) << "seconds" << setw(8) << "share" << setw(12) << "ns/call" << "\n";
+        for (size_t i = 0; i < rows.size(); i++) {
+            int sp = rows[i].first, b = rows[i].second;
+            double seconds = totals.ticks[sp][b] * seconds_per_tick;
+            out << right << setw(4) << i + 1 << "  " << left << setw(16) << SPECIES_METRIC_NAMES[sp] << setw(16) << BEHAVIOUR_NAMES[b]
+                << right << setw(14) << totals.calls[sp][b]
+                << setw(12) << setprecision(4) << seconds
+                << setw(7) << setprecision(1) << (total_ticks > 0 ? 100.0 * totals.ticks[sp][b] / total_ticks : 0.0) << "%"
+                << setw(12) << setprecision(0) << seconds * 1e9 / totals.calls[sp][b] << "\n";
+        }
+        if (rows.empty()) out << "（尚无记录）\n";
+        out.unsetf(ios::floatfield);
+        out << setprecision(6);
+    }
+};
+
+// 内存占用（字节）
+struct MemoryFootprint {
+    size_t terrain;   // 地形分块（共享的原始分块和被修改后复制的分块）
+    size_t organisms; // 生物对象和生物列表
+    size_t indices;   // 休眠调度、种子库和各种场（天气、疫病、密度、流向）
+    size_t history;   // 回看用的历史记录
+
+    MemoryFootprint() : terrain(0), organisms(0), indices(0), history(0) {}
+    size_t total() const { return terrain + organisms + indices + history; }
+};
+
+// 预估内存时生物数量相对初始种群的增长余量
+const double MEMORY_POPULATION_HEADROOM = 2.0;
+
+// 世界尺寸上限（16384x16384的大陆地图）
+const int MAX_WORLD_SIZE = 16384;
+
+// 世界配置（运行时可调的尺寸、模拟天数和随机种子）
+// 初始种群的放置规则：在区域内随机取count个位置（按本进程区域占的面积缩放），
+// 位置空闲且地形允许时放置一个该物种的个体
+struct SeedingRule {
+    SpeciesType species;
+    int count;                 // 尝试放置的次数
+    unsigned int terrain_mask; // 允许的地形（按TerrainType的位，0表示不限）
+    int x0, y0, x1, y1;        // 放置区域（x1<=x0表示整个世界）
+
+    bool has_region() const { return x1 > x0 && y1 > y0; }
+};
+
+// 默认的初始种群（按放置顺序，决定随机数的使用顺序）
+const SeedingRule DEFAULT_SEEDING[SPECIES_COUNT] = {
+    { SPECIES_PLANT,         500, 0,             0, 0, 0, 0 },
+    { SPECIES_TREE,          300, 0,             0, 0, 0, 0 },
+    { SPECIES_AQUATIC_PLANT, 200, 1u << WATER,   0, 0, 0, 0 },
+    { SPECIES_HERBIVORE,     80,  0,             0, 0, 0, 0 },
+    { SPECIES_CARNIVORE,     30,  0,             0, 0, 0, 0 },
+    { SPECIES_OMNIVORE,      40,  0,             0, 0, 0, 0 },
+    { SPECIES_INSECT,        200, 0,             0, 0, 0, 0 },
+    { SPECIES_FLYING_INSECT, 150, 0,             0, 0, 0, 0 },
+    { SPECIES_DECOMPOSER,    150, 0,             0, 0, 0, 0 },
+    { SPECIES_APEX_PREDATOR, 10,  0,             0, 0, 0, 0 },
+    { SPECIES_PARASITE,      100, 0,             0, 0, 0, 0 },
+    { SPECIES_FISH,          100, 1u << WATER,   0, 0, 0, 0 },
+    { SPECIES_BIRD,          50,  0,             0, 0, 0, 0 },
+    { SPECIES_REPTILE,       40,  0,             0, 0, 0, 0 },
+    { SPECIES_AMPHIBIAN,     60,  0,             0, 0, 0, 0 },
+    { SPECIES_SCAVENGER,     70,  0,             0, 0, 0, 0 },
+};
+
+// 计划干预的动作
+enum InterventionAction {
+    INTERVENE_TEMPERATURE,     // 设定温度（持续days天）
+    INTERVENE_POLLUTION,       // 设定污染程度
+    INTERVENE_DISASTER_CHANCE, // 设定灾难概率
+    INTERVENE_DISASTER,        // 强制发生某种灾难（有区域时只作用于区域内）
+    INTERVENE_CULL,            // 按比例捕杀区域内的某个物种
+    INTERVENE_INTRODUCE,       // 在区域内引入某个物种
+    INTERVENE_WEATHER,         // 设定天气（持续days天）
+    INTERVENTION_ACTION_COUNT
+};
+
+// 在指定的一天开始时执行的干预
+struct Intervention {
+    int day;
+    InterventionAction action;
+    double value;        // 温度、污染、灾难概率；捕杀时为捕杀比例
+    int days;            // 温度和天气的持续天数
+    int kind;            // 灾难类型（同roll_disaster）或天气类型
+    SpeciesType species; // 捕杀或引入的物种
+    int count;           // 引入的数量
+    int x0, y0, x1, y1;  // 作用区域（x1<=x0表示整个世界）
+
+    Intervention() : day(0), action(INTERVENE_TEMPERATURE), value(0.0), days(1), kind(0),
+        species(SPECIES_PLANT), count(0), x0(0), y0(0), x1(0), y1(0) {}
+    bool has_region() const { return x1 > x0 && y1 > y0; }
+};
+
+struct WorldConfig {
+    int width;         // 世界宽度
+    int height;        // 世界高度
+    int max_days;      // 最大模拟天数
+    unsigned int seed; // 随机种子（0表示使用当前时间）
+    int domain_x0, domain_y0; // 本进程负责的子区域左上角（多进程运行时）
+    int domain_x1, domain_y1; // 子区域右下角（不含），-1表示到世界边缘
+    int rank;          // 进程序号（决定生物的随机数序列，0为单进程）
+    int ranks;         // 进程总数（大于1时按区域分解以多进程无界面运行）
+    vector<FocusArea> focus_areas; // 关注区域（为空时整个世界按个体模拟）
+    int threads;       // 进食阶段的工作线程数（0表示按CPU核数）
+    int weather_cell;  // 天气场的格子边长（世界格）
+    string journal_path; // 事件日志文件（为空时不记录，多进程时各进程写入 path.rankN）
+    string replay_path;  // 回放的日志文件（不为空时只回放日志，不运行模拟）
+    int replay_day;      // 回放到第几天（-1表示日志记录的最后一天）
+    string results_path; // 实时结果文件（为空时不写入，多进程时各进程写入 path.rankN）
+    string tail_path;    // 跟踪读取的结果文件（不为空时只读取，不运行模拟）
+    int metrics_port;    // 指标导出端口（0表示不导出，多进程时各进程使用 port+rank）
+    string bench_path;   // 基准测试报告（不为空时无界面运行并写入报告，"-"表示标准输出）
+    string profile_path; // 物种开销报告（不为空时统计，运行结束时写入，"-"表示标准输出，多进程时各进程写入 path.rankN）
+    long long memory_budget; // 每个进程的内存预算（字节，0表示不限制）
+    vector<SeedingRule> seeding; // 初始种群的放置规则（默认为DEFAULT_SEEDING，可由场景文件修改）
+    vector<Intervention> interventions; // 计划干预（来自场景文件）
+    string frames_path;      // 图像帧的文件名前缀（为空时不导出，多进程时各进程写入 前缀.rankN）
+    vector<int> frame_layers; // 导出的图层（FrameLayer）
+    int frame_stride;        // 每隔几天导出一帧
+    int frame_scale;         // 缩小倍数（每个像素汇总 scale x scale 个格子）
+    bool frame_png;          // 使用PNG格式（否则为PPM）
+
+    WorldConfig() : width(1000), height(1000), max_days(730), seed(0),
+        domain_x0(0), domain_y0(0), domain_x1(-1), domain_y1(-1), rank(0), ranks(1), threads(0),
+        weather_cell(WEATHER_CELL_SIZE), replay_day(-1), metrics_port(0), memory_budget(0),
+        seeding(DEFAULT_SEEDING, DEFAULT_SEEDING + SPECIES_COUNT), frame_layers({ FRAME_TERRAIN, FRAME_POPULATION }),
+        frame_stride(1), frame_scale(1), frame_png(false) {}
+};
+
+// ---- 场景文件 ----
+// 场景文件是一个JSON对象，启动时解析一次，直接写入配置、初始种群规则和覆盖后的物种参数表：
+// {
+//   "world": { "width": 800, "height": 600, "days": 365, "seed": 42, "weather_cell": 32,
+//              "focus": [[0, 0, 200, 200]] },
+//   "species": {
+//     "herbivore": { "count": 120, "terrain": ["plain", "grassland"], "region": [0, 0, 400, 300],
+//                    "traits": { "max_age": 90, "reproduction_chance": 0.35 } },
+//     "plant": { "traits": { "water_need": 0.5 } }
+//   },
+//   "interventions": [
+//     { "day": 30, "action": "temperature", "value": 38, "days": 10 },
+//     { "day": 60, "action": "disaster", "disaster": "fire", "region": [0, 0, 100, 100] },
+//     { "day": 90, "action": "introduce", "species": "carnivore", "count": 20 }
+//   ]
+// }
+// 物种名见SPECIES_METRIC_NAMES，未列出的物种和参数保持默认值
+// 干预动作见INTERVENTION_ACTION_KEYS，在指定的一天开始时执行
+
+// JSON值（场景文件只需要对象、数组、数字、字符串和布尔值）
+struct JsonValue {
+    enum Kind { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+    Kind kind;
+    bool boolean;
+    double number;
+    string text;
+    vector<JsonValue> items;                   // 数组元素
+    vector<pair<string, JsonValue>> members;   // 对象成员（保持文件中的顺序）
+    int line;                                  // 值在文件中的行号（用于报告参数错误）
+
+    JsonValue() : kind(JSON_NULL), boolean(false), number(0.0), line(0) {}
+};
+
+// 递归下降的JSON解析器，出错时记录行号和原因
+class JsonParser {
+private:
+    const char* p;
+    const char* end;
+    int line;
+    string error;
+
+    bool fail(const string& message) {
+        if (error.empty()) error = "第" + to_string(line) + "行: " + message;
+        return false;
+    }
+
+    void skip_space() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+            if (*p == '\n') line++;
+            p++;
+        }
+    }
+
+    bool literal(const char* word) {
+        size_t length = strlen(word);
+        if (static_cast<size_t>(end - p) < length || strncmp(p, word, length) != 0) return fail("无法识别的值");
+        p += length;
+        return true;
+    }
+
+    bool parse_string(string& out) {
+        p++; // 开头的引号
+        out.clear();
+        while (p < end && *p != '"') {
+            if (*p == '\n') return fail("字符串中不能换行");
+            if (*p == '\\') {
+                if (++p >= end) break;
+                switch (*p) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'u': return fail("不支持\\u转义");
+                default: out += *p; break; // \" \\ \/
+                }
+                p++;
+                continue;
+            }
+            out += *p++;
+        }
+        if (p >= end) return fail("字符串没有结束");
+        p++;
+        return true;
+    }
+
+    bool parse_value(JsonValue& value, int depth) {
+        if (depth > 32) return fail("嵌套层数过多");
+        skip_space();
+        if (p >= end) return fail("缺少值");
+        value.line = line;
+        if (*p == '{') {
+            value.kind = JsonValue::JSON_OBJECT;
+            p++;
+            skip_space();
+            if (p < end && *p == '}') {
+                p++;
+                return true;
+            }
+            while (true) {
+                skip_space();
+                if (p >= end || *p != '"') return fail("对象的键必须是字符串");
+                value.members.push_back(make_pair(string(), JsonValue()));
+                if (!parse_string(value.members.back().first)) return false;
+                skip_space();
+                if (p >= end || *p != ':') return fail("键之后缺少冒号");
+                p++;
+                if (!parse_value(value.members.back().second, depth + 1)) return false;
+                skip_space();
+                if (p < end && *p == ',') {
+                    p++;
+                    continue;
+                }
+                if (p < end && *p == '}') {
+                    p++;
+                    return true;
+                }
+                return fail("对象中缺少逗号或右花括号");
+            }
+        }
+        if (*p == '[') {
+            value.kind = JsonValue::JSON_ARRAY;
+            p++;
+            skip_space();
+            if (p < end && *p == ']') {
+                p++;
+                return true;
+            }
+            while (true) {
+                value.items.push_back(JsonValue());
+                if (!parse_value(value.items.back(), depth + 1)) return false;
+                skip_space();
+                if (p < end && *p == ',') {
+                    p++;
+                    continue;
+                }
+                if (p < end && *p == ']') {
+                    p++;
+                    return true;
+                }
+                return fail("数组中缺少逗号或右方括号");
+            }
+        }
+        if (*p == '"') {
+            value.kind = JsonValue::JSON_STRING;
+            return parse_string(value.text);
+        }
+        if (*p == 't') {
+            value.kind = JsonValue::JSON_BOOL;
+            value.boolean = true;
+            return literal("true");
+        }
+        if (*p == 'f') {
+            value.kind = JsonValue::JSON_BOOL;
+            return literal("false");
+        }
+        if (*p == 'n') return literal("null");
+
+        char* number_end = nullptr;
+        value.number = strtod(p, &number_end);
+        if (number_end == p) return fail("无法识别的值");
+        value.kind = JsonValue::JSON_NUMBER;
+        p = number_end;
+        return true;
+    }
+
+public:
+    bool parse(const string& text, JsonValue& root, string& message) {
+        p = text.data();
+        end = text.data() + text.size();
+        line = 1;
+        error.clear();
+        bool ok = parse_value(root, 0);
+        skip_space();
+        if (ok && p != end) ok = fail("值之后有多余的内容");
+        message = error;
+        return ok;
+    }
+};
+
+// 场景文件中的地形名（按TerrainType顺序）
+const char* const TERRAIN_KEYS[] = {
+    "plain", "forest", "mountain", "desert", "water", "marsh", "volcanic", "snow",
+    "grassland", "jungle", "tundra", "beach", "flooded"
+};
+const int TERRAIN_KEY_COUNT = sizeof(TERRAIN_KEYS) / sizeof(TERRAIN_KEYS[0]);
+
+// 可由场景文件覆盖的参数：名称、类型、在参数结构中的位置和允许的取值范围
+struct TraitField {
+    const char* name;
+    enum Type { TRAIT_INT, TRAIT_DOUBLE, TRAIT_BOOL } type;
+    size_t offset;
+    double min_value, max_value;
+};
+
+const double TRAIT_UNBOUNDED = 1e9; // 参数没有实际上限（或下限）
+
+// 取值范围按参数的用法确定：范围和天数作除数或取模，至少为1；概率和抗性在[0, 1]内；作除数的需求和耐受度必须为正
+const TraitField SPECIES_TRAIT_FIELDS[] = {
+    { "max_age", TraitField::TRAIT_INT, offsetof(SpeciesTraits, max_age), 1, TRAIT_UNBOUNDED },
+    { "reproduction_threshold", TraitField::TRAIT_DOUBLE, offsetof(SpeciesTraits, reproduction_threshold), 0.0, TRAIT_UNBOUNDED },
+    { "reproduction_chance", TraitField::TRAIT_DOUBLE, offsetof(SpeciesTraits, reproduction_chance), 0.0, 1.0 },
+    { "mobility", TraitField::TRAIT_DOUBLE, offsetof(SpeciesTraits, mobility), 0.0, TRAIT_UNBOUNDED },
+    { "preferred_temp", TraitField::TRAIT_DOUBLE, offsetof(SpeciesTraits, preferred_temp), -TRAIT_UNBOUNDED, TRAIT_UNBOUNDED },
+    { "temp_tolerance", TraitField::TRAIT_DOUBLE, offsetof(SpeciesTraits, temp_tolerance), 0.01, TRAIT_UNBOUNDED },
+    { "disease_resistance", TraitField::TRAIT_INT, offsetof(SpeciesTraits, disease_resistance), 0, 100 },
+    { "flood_resistance", TraitField::TRAIT_DOUBLE, offsetof(SpeciesTraits, flood_resistance), 0.0, 1.0 },
+    { "drought_resistance", TraitField::TRAIT_DOUBLE, offsetof(SpeciesTraits, drought_resistance), 0.0, 1.0 },
+    { "base_energy", TraitField::TRAIT_DOUBLE, offsetof(SpeciesTraits, base_energy), 0.0, TRAIT_UNBOUNDED },
+    { "territory_size", TraitField::TRAIT_INT, offsetof(SpeciesTraits, territory_size), 1, TRAIT_UNBOUNDED },
+    { "is_aquatic", TraitField::TRAIT_BOOL, offsetof(SpeciesTraits, is_aquatic), 0, 1 },
+};
+
+const TraitField PLANT_TRAIT_FIELDS[] = {
+    { "water_need", TraitField::TRAIT_DOUBLE, offsetof(PlantTraits, water_need), 0.01, TRAIT_UNBOUNDED },
+    { "days_to_mature", TraitField::TRAIT_INT, offsetof(PlantTraits, days_to_mature), 1, TRAIT_UNBOUNDED },
+    { "seed_spread_range", TraitField::TRAIT_DOUBLE, offsetof(PlantTraits, seed_spread_range), 1.0, TRAIT_UNBOUNDED },
+    { "flood_tolerance", TraitField::TRAIT_DOUBLE, offsetof(PlantTraits, flood_tolerance), 0.0, 1.0 },
+    { "drought_tolerance", TraitField::TRAIT_DOUBLE, offsetof(PlantTraits, drought_tolerance), 0.0, 1.0 },
+    { "fruiting_stage", TraitField::TRAIT_INT, offsetof(PlantTraits, fruiting_stage), 0, 4 },
+    { "offspring_range", TraitField::TRAIT_INT, offsetof(PlantTraits, offspring_range), 1, TRAIT_UNBOUNDED },
+    { "min_growth_rate", TraitField::TRAIT_DOUBLE, offsetof(PlantTraits, min_growth_rate), 0.0, TRAIT_UNBOUNDED },
+    { "max_growth_rate", TraitField::TRAIT_DOUBLE, offsetof(PlantTraits, max_growth_rate), 0.0, TRAIT_UNBOUNDED },
+    { "growth_mutation", TraitField::TRAIT_DOUBLE, offsetof(PlantTraits, growth_mutation), 0.0, TRAIT_UNBOUNDED },
+    { "drought_mutation", TraitField::TRAIT_DOUBLE, offsetof(PlantTraits, drought_mutation), 0.0, TRAIT_UNBOUNDED },
+};
+
+// 把一个参数写入参数结构，名称不在fields中时返回false；类型不对或超出范围时写入带行号的错误
+template <size_t N>
+bool apply_trait(const TraitField (&fields)[N], void* traits, const string& name, const JsonValue& value, string& error) {
+    for (const TraitField& field : fields) {
+        if (name != field.name) continue;
+        char* target = static_cast<char*>(traits) + field.offset;
+        const string where = "第" + to_string(value.line) + "行: 参数" + name;
+        if (field.type == TraitField::TRAIT_BOOL) {
+            if (value.kind != JsonValue::JSON_BOOL) {
+                error = where + "应为true或false";
+                return true;
+            }
+            *reinterpret_cast<bool*>(target) = value.boolean;
+        }
+        else if (value.kind != JsonValue::JSON_NUMBER) {
+            error = where + "应为数字";
+        }
+        else if (!(value.number >= field.min_value && value.number <= field.max_value)) {
+            ostringstream range;
+            if (field.max_value >= TRAIT_UNBOUNDED) range << "不能小于" << field.min_value;
+            else range << "应在" << field.min_value << "到" << field.max_value << "之间";
+            error = where + range.str();
+        }
+        else if (field.type == TraitField::TRAIT_INT) {
+            *reinterpret_cast<int*>(target) = static_cast<int>(value.number);
+        }
+        else {
+            *reinterpret_cast<double*>(target) = value.number;
+        }
+        return true;
+    }
+    return false;
+}
+
+// 读取整数或[x0, y0, x1, y1]区域
+bool scenario_int(const JsonValue& value, const string& name, int& out, string& error) {
+    if (value.kind != JsonValue::JSON_NUMBER) {
+        error = name + "应为数字";
+        return false;
+    }
+    // 超出int范围的数转换为int是未定义行为，直接拒绝
+    if (!(value.number >= numeric_limits<int>::min() && value.number <= numeric_limits<int>::max())) {
+        error = "第" + to_string(value.line) + "行: " + name + "超出整数范围";
+        return false;
+    }
+    out = static_cast<int>(value.number);
+    return true;
+}
+
+bool scenario_area(const JsonValue& value, const string& name, int& x0, int& y0, int& x1, int& y1, string& error) {
+    if (value.kind != JsonValue::JSON_ARRAY || value.items.size() != 4) {
+        error = name + "应为[x0, y0, x1, y1]";
+        return false;
+    }
+    int* corners[4] = { &x0, &y0, &x1, &y1 };
+    for (int i = 0; i < 4; i++) {
+        if (!scenario_int(value.items[i], name, *corners[i], error)) return false;
+    }
+    if (x0 >= x1 || y0 >= y1) {
+        error = name + "的范围为空";
+        return false;
+    }
+    return true;
+}
+
+// 场景文件中的干预动作、灾难和天气名（按枚举顺序）
+const char* const INTERVENTION_ACTION_KEYS[INTERVENTION_ACTION_COUNT] = {
+    "temperature", "pollution", "disaster_chance", "disaster", "cull", "introduce", "weather"
+};
+const char* const DISASTER_KEYS[] = { "fire", "flood", "plague", "volcano", "drought" };
+const char* const WEATHER_KEYS[] = { "sunny", "rainy", "snowy", "cloudy", "stormy", "drought" };
+
+// 在名称表中查找，找不到时返回-1
+template <size_t N>
+int scenario_key_index(const char* const (&keys)[N], const JsonValue& value) {
+    if (value.kind != JsonValue::JSON_STRING) return -1;
+    for (size_t i = 0; i < N; i++) {
+        if (value.text == keys[i]) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+// 一条计划干预：{"day": 30, "action": "cull", "species": "herbivore", "fraction": 0.5, "region": [0, 0, 100, 100]}
+bool parse_intervention(const JsonValue& entry, Intervention& intervention, string& error) {
+    if (entry.kind != JsonValue::JSON_OBJECT) {
+        error = "interventions中的每一项应为对象";
+        return false;
+    }
+    bool has_day = false, has_action = false, has_value = false, has_species = false;
+    string kind_key; // 给出的是disaster还是weather
+    intervention.value = 1.0; // 未给出捕杀比例时全部捕杀
+    for (const auto& member : entry.members) {
+        const string& key = member.first;
+        const JsonValue& value = member.second;
+        if (key == "day") {
+            if (!scenario_int(value, "interventions.day", intervention.day, error)) return false;
+            has_day = true;
+        }
+        else if (key == "action") {
+            int action = scenario_key_index(INTERVENTION_ACTION_KEYS, value);
+            if (action < 0) {
+                error = "未知的干预动作: " + value.text;
+                return false;
+            }
+            intervention.action = static_cast<InterventionAction>(action);
+            has_action = true;
+        }
+        else if (key == "value" || key == "fraction") {
+            if (value.kind != JsonValue::JSON_NUMBER) {
+                error = "interventions." + key + "应为数字";
+                return false;
+            }
+            intervention.value = value.number;
+            has_value = true;
+        }
+        else if (key == "days") {
+            if (!scenario_int(value, "interventions.days", intervention.days, error)) return false;
+        }
+        else if (key == "count") {
+            if (!scenario_int(value, "interventions.count", intervention.count, error)) return false;
+        }
+        else if (key == "disaster" || key == "weather") {
+            intervention.kind = key == "disaster" ? scenario_key_index(DISASTER_KEYS, value) : scenario_key_index(WEATHER_KEYS, value);
+            if (intervention.kind < 0) {
+                error = "未知的" + key + ": " + value.text;
+                return false;
+            }
+            kind_key = key;
+        }
+        else if (key == "species") {
+            int species = scenario_key_index(SPECIES_METRIC_NAMES, value);
+            if (species < 0) {
+                error = "未知的物种: " + value.text;
+                return false;
+            }
+            intervention.species = static_cast<SpeciesType>(species);
+            has_species = true;
+        }
+        else if (key == "region") {
+            if (!scenario_area(value, "interventions.region", intervention.x0, intervention.y0,
+                intervention.x1, intervention.y1, error)) return false;
+        }
+        else {
+            error = "interventions中有未知的键: " + key;
+            return false;
+        }
+    }
+
+    // 各动作必需的字段
+    if (!has_day || !has_action || intervention.day < 1) {
+        error = "每项干预都需要day（从1开始）和action";
+        return false;
+    }
+    const string name = INTERVENTION_ACTION_KEYS[intervention.action];
+    bool complete = true;
+    switch (intervention.action) {
+    case INTERVENE_TEMPERATURE: complete = has_value; break;
+    case INTERVENE_POLLUTION:
+    case INTERVENE_DISASTER_CHANCE: complete = has_value && intervention.value >= 0.0 && intervention.value <= 1.0; break;
+    case INTERVENE_DISASTER: complete = kind_key == "disaster"; break;
+    case INTERVENE_CULL: complete = has_species && intervention.value >= 0.0 && intervention.value <= 1.0; break;
+    case INTERVENE_INTRODUCE: complete = has_species && intervention.count > 0; break;
+    case INTERVENE_WEATHER: complete = kind_key == "weather"; break;
+    default: break;
+    }
+    if (!complete || intervention.days < 1) {
+        error = "干预" + name + "（第" + to_string(intervention.day) + "天）缺少参数或参数超出范围";
+        return false;
+    }
+    return true;
+}
+
+// 一个物种的初始数量、放置规则和参数
+bool apply_species_scenario(SpeciesType species, const JsonValue& entry, WorldConfig& config, string& error) {
+    const string name = SPECIES_METRIC_NAMES[species];
+    if (entry.kind != JsonValue::JSON_OBJECT) {
+        error = "物种" + name + "应为对象";
+        return false;
+    }
+    SeedingRule* rule = nullptr;
+    for (SeedingRule& candidate : config.seeding) {
+        if (candidate.species == species) rule = &candidate;
+    }
+    for (const auto& member : entry.members) {
+        const string& key = member.first;
+        const JsonValue& value = member.second;
+        if (key == "count") {
+            if (!scenario_int(value, name + ".count", rule->count, error)) return false;
+            if (rule->count < 0) {
+                error = name + ".count不能为负数";
+                return false;
+            }
+        }
+        else if (key == "terrain") {
+            if (value.kind != JsonValue::JSON_ARRAY) {
+                error = name + ".terrain应为地形名数组";
+                return false;
+            }
+            rule->terrain_mask = 0;
+            for (const JsonValue& item : value.items) {
+                const char* const* found = find(TERRAIN_KEYS, TERRAIN_KEYS + TERRAIN_KEY_COUNT, item.text);
+                if (item.kind != JsonValue::JSON_STRING || found == TERRAIN_KEYS + TERRAIN_KEY_COUNT) {
+                    error = name + ".terrain中有未知的地形: " + item.text;
+                    return false;
+                }
+                rule->terrain_mask |= 1u << (found - TERRAIN_KEYS);
+            }
+        }
+        else if (key == "region") {
+            if (!scenario_area(value, name + ".region", rule->x0, rule->y0, rule->x1, rule->y1, error)) return false;
+        }
+        else if (key == "traits") {
+            if (value.kind != JsonValue::JSON_OBJECT) {
+                error = name + ".traits应为对象";
+                return false;
+            }
+            // 第一次覆盖时从默认参数复制出运行时参数表
+            if (!traits_overridden) {
+                copy(begin(SPECIES_TRAITS), end(SPECIES_TRAITS), scenario_species_traits);
+                copy(begin(PLANT_TRAITS), end(PLANT_TRAITS), scenario_plant_traits);
+                traits_overridden = true;
+            }
+            for (const auto& trait : value.members) {
+                bool known = apply_trait(SPECIES_TRAIT_FIELDS, &scenario_species_traits[species], trait.first, trait.second, error) ||
+                    (species <= SPECIES_AQUATIC_PLANT &&
+                        apply_trait(PLANT_TRAIT_FIELDS, &scenario_plant_traits[species], trait.first, trait.second, error));
+                if (!known) error = "第" + to_string(trait.second.line) + "行: " + name + "没有参数" + trait.first;
+                if (!error.empty()) return false;
+            }
+            if (species <= SPECIES_AQUATIC_PLANT &&
+                scenario_plant_traits[species].min_growth_rate > scenario_plant_traits[species].max_growth_rate) {
+                error = "第" + to_string(value.line) + "行: " + name + "的min_growth_rate不能大于max_growth_rate";
+                return false;
+            }
+        }
+        else {
+            error = "物种" + name + "中有未知的键: " + key;
+            return false;
+        }
+    }
+    return true;
+}
+
+// 读取场景文件，写入配置和物种参数表；出错时返回false并说明原因
+bool load_scenario(const string& path, WorldConfig& config, string& error) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        error = "无法打开";
+        return false;
+    }
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    if (text.compare(0, 3, "\xEF\xBB\xBF") == 0) text.erase(0, 3); // UTF-8 BOM
+
+    JsonValue root;
+    JsonParser parser;
+    if (!parser.parse(text, root, error)) {
+        return false;
+    }
+    if (root.kind != JsonValue::JSON_OBJECT) {
+        error = "场景应为JSON对象";
+        return false;
+    }
+
+    for (const auto& section : root.members) {
+        const JsonValue& value = section.second;
+        if (section.first == "world") {
+            if (value.kind != JsonValue::JSON_OBJECT) {
+                error = "world应为对象";
+                return false;
+            }
+            for (const auto& member : value.members) {
+                const string& key = member.first;
+                int number = 0;
+                if (key == "focus") {
+                    if (member.second.kind != JsonValue::JSON_ARRAY) {
+                        error = "world.focus应为区域数组";
+                        return false;
+                    }
+                    config.focus_areas.clear();
+                    for (const JsonValue& item : member.second.items) {
+                        FocusArea area;
+                        if (!scenario_area(item, "world.focus", area.x0, area.y0, area.x1, area.y1, error)) return false;
+                        config.focus_areas.push_back(area);
+                    }
+                    continue;
+                }
+                if (!scenario_int(member.second, "world." + key, number, error)) return false;
+                if (key == "width") config.width = number;
+                else if (key == "height") config.height = number;
+                else if (key == "days") config.max_days = number;
+                else if (key == "seed") config.seed = static_cast<unsigned int>(number);
+                else if (key == "weather_cell") config.weather_cell = number;
+                else {
+                    error = "world中有未知的键: " + key;
+                    return false;
+                }
+            }
+        }
+        else if (section.first == "species") {
+            if (value.kind != JsonValue::JSON_OBJECT) {
+                error = "species应为对象";
+                return false;
+            }
+            for (const auto& member : value.members) {
+                const char* const* found = find_if(SPECIES_METRIC_NAMES, SPECIES_METRIC_NAMES + SPECIES_COUNT,
+                    [&](const char* name) { return member.first == name; });
+                if (found == SPECIES_METRIC_NAMES + SPECIES_COUNT) {
+                    error = "未知的物种: " + member.first;
+                    return false;
+                }
+                SpeciesType species = static_cast<SpeciesType>(found - SPECIES_METRIC_NAMES);
+                if (!apply_species_scenario(species, member.second, config, error)) return false;
+            }
+        }
+        else if (section.first == "interventions") {
+            if (value.kind != JsonValue::JSON_ARRAY) {
+                error = "interventions应为数组";
+                return false;
+            }
+            for (const JsonValue& item : value.items) {
+                Intervention intervention;
+                if (!parse_intervention(item, intervention, error)) return false;
+                config.interventions.push_back(intervention);
+            }
+        }
+        else {
+            error = "场景中有未知的键: " + section.first;
+            return false;
+        }
+    }
+    return true;
+}
+
+// 常驻的工作线程池：第一次使用时创建线程，之后每次只唤醒它们领取任务，而不是每次重新创建
+// 调用线程处理第0段并一起领取剩余的段，所有段完成后run才返回
+class WorkerPool {
+private:
+    int threads; // 包括调用线程在内的线程数
+    vector<thread> workers;
+    mutex pool_mutex;
+    condition_variable work_ready; // 有新的段可领取或线程池关闭
+    condition_variable work_done;  // 当前任务的所有段都已完成
+    const function<void(size_t)>* job;
+    size_t next_chunk, chunk_count, unfinished;
+    bool closing;
+
+    // 领取并执行当前任务的段，直到没有剩余（调用时持有锁，返回时仍持有）
+    void take_chunks(unique_lock<mutex>& lock) {
+        while (next_chunk < chunk_count) {
+            size_t chunk = next_chunk++;
+            const function<void(size_t)>& fn = *job;
+            lock.unlock();
+            fn(chunk);
+            lock.lock();
+            if (--unfinished == 0) work_done.notify_all();
+        }
+    }
+
+    void run_worker() {
+        unique_lock<mutex> lock(pool_mutex);
+        while (true) {
+            work_ready.wait(lock, [this] { return closing || next_chunk < chunk_count; });
+            if (closing) return;
+            take_chunks(lock);
+        }
+    }
+
+public:
+    explicit WorkerPool(int thread_count)
+        : threads(max(1, thread_count)), job(nullptr), next_chunk(0), chunk_count(0), unfinished(0), closing(false) {}
+
+    ~WorkerPool() {
+        {
+            lock_guard<mutex> lock(pool_mutex);
+            closing = true;
+        }
+        work_ready.notify_all();
+        for (thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    int size() const { return threads; }
+
+    // 执行fn(0)到fn(chunks - 1)，返回时全部完成（同一时间只能有一个调用者）
+    void run(size_t chunks, const function<void(size_t)>& fn) {
+        // 第一次真正分段执行时才创建线程（生物较少时一直在调用线程中执行）
+        if (workers.empty()) {
+            for (int i = 1; i < threads; i++) {
+                workers.emplace_back(&WorkerPool::run_worker, this);
+            }
+        }
+        unique_lock<mutex> lock(pool_mutex);
+        job = &fn;
+        next_chunk = 1;
+        chunk_count = chunks;
+        unfinished = chunks - 1;
+        work_ready.notify_all();
+        lock.unlock();
+        fn(0);
+        lock.lock();
+        take_chunks(lock);
+        work_done.wait(lock, [this] { return unfinished == 0; });
+        job = nullptr;
+        next_chunk = chunk_count = 0;
+    }
+};
+
+// 把[0, count)分段交给线程池执行，fn(begin, end)处理一段（数量较少时直接在当前线程执行）
+const size_t PARALLEL_MIN_CHUNK = 256;
+
+template <class Fn>
+void parallel_for(WorkerPool& pool, size_t count, Fn fn) {
+    size_t chunks = min(static_cast<size_t>(pool.size()), count / PARALLEL_MIN_CHUNK);
+    if (chunks <= 1) {
+        fn(0, count);
+        return;
+    }
+    size_t chunk_size = (count + chunks - 1) / chunks;
+    pool.run(chunks, [&](size_t c) { fn(c * chunk_size, min(count, (c + 1) * chunk_size)); });
+}
+
+// 按物种把生物转换为实际类型后调用fn（用于实例化各物种的更新函数）
+template <class Fn>
+void dispatch_species(Organism* org, Fn fn) {
+    switch (org->getSpecies()) {
+    case SPECIES_PLANT: fn(static_cast<Plant*>(org)); break;
+    case SPECIES_TREE: fn(static_cast<Tree*>(org)); break;
+    case SPECIES_AQUATIC_PLANT: fn(static_cast<AquaticPlant*>(org)); break;
+    case SPECIES_INSECT: fn(static_cast<Insect*>(org)); break;
+    case SPECIES_FLYING_INSECT: fn(static_cast<FlyingInsect*>(org)); break;
+    case SPECIES_HERBIVORE: fn(static_cast<Herbivore*>(org)); break;
+    case SPECIES_FISH: fn(static_cast<Fish*>(org)); break;
+    case SPECIES_BIRD: fn(static_cast<Bird*>(org)); break;
+    case SPECIES_DECOMPOSER: fn(static_cast<Decomposer*>(org)); break;
+    case SPECIES_OMNIVORE: fn(static_cast<Omnivore*>(org)); break;
+    case SPECIES_CARNIVORE: fn(static_cast<Carnivore*>(org)); break;
+    case SPECIES_APEX_PREDATOR: fn(static_cast<ApexPredator*>(org)); break;
+    case SPECIES_PARASITE: fn(static_cast<Parasite*>(org)); break;
+    case SPECIES_REPTILE: fn(static_cast<Reptile*>(org)); break;
+    case SPECIES_AMPHIBIAN: fn(static_cast<Amphibian*>(org)); break;
+    case SPECIES_SCAVENGER: fn(static_cast<Scavenger*>(org)); break;
+    default: break;
+    }
+}
+
+// 区域边界上的地形格（在相邻区域之间交换）
+struct HaloCell {
+    int x, y;
+    Terrain cell;
+};
+
+// ---- 概览地图 ----
+
+// 数量金字塔第0级一格的边长（世界格，2的幂）
+const int POPULATION_BASE_SHIFT = 2;
+// 各级的数量按页分配，每页16x16格（第0级的一页与一个地形分块一样大）
+const int POPULATION_PYRAMID_PAGE_SHIFT = TERRAIN_TILE_SHIFT - POPULATION_BASE_SHIFT;
+const int POPULATION_PYRAMID_PAGE_SIZE = 1 << POPULATION_PYRAMID_PAGE_SHIFT;
+
+// 概览地图上各物种的符号（按SpeciesType顺序，与成熟个体的符号相同）
+const char SPECIES_SYMBOLS[SPECIES_COUNT + 1] = "PTAIFH~BDOCX*RMS";
+
+// 各物种数量的多级汇总（用于概览地图）：第0级每格汇总4x4个世界格，每升一级边长加倍，直到一格覆盖整个世界
+// 出生、死亡、迁入迁出和移动时增量更新，任意一级的一格都可以在常数时间内读取
+// 数量按页保存，有过生物的页才分配（未分配的页数量为0）；每格的主要地形在绘制时按天刷新（只重新统计已生成的分块）
+class PopulationPyramid {
+private:
+    static const int PAGE_CELLS = POPULATION_PYRAMID_PAGE_SIZE * POPULATION_PYRAMID_PAGE_SIZE;
+
+    struct Level {
+        int shift;                     // 世界坐标右移shift位得到本级的格坐标
+        int cells_x, cells_y;
+        int pages_x;
+        vector<unique_ptr<unsigned int[]>> pages; // 每页[格][物种]
+        mutable vector<unsigned char> terrain; // 每格数量最多的地形（TERRAIN_UNKNOWN表示尚未统计，绘制时刷新）
+    };
+    static constexpr unsigned char TERRAIN_UNKNOWN = 0xff;
+    static const unsigned int EMPTY_COUNTS[SPECIES_COUNT];
+
+    vector<Level> levels;
+    mutable int terrain_day; // 地形最近一次刷新的日期（-1表示需要刷新）
+
+    // 一格的各物种数量（所在页尚未分配时分配）
+    static unsigned int* cell_counts(Level& level, int cx, int cy) {
+        unique_ptr<unsigned int[]>& page = level.pages[(cy >> POPULATION_PYRAMID_PAGE_SHIFT) * level.pages_x + (cx >> POPULATION_PYRAMID_PAGE_SHIFT)];
+        if (!page) page.reset(new unsigned int[PAGE_CELLS * SPECIES_COUNT]()); // 值初始化，数量为0
+        int local = ((cy & (POPULATION_PYRAMID_PAGE_SIZE - 1)) << POPULATION_PYRAMID_PAGE_SHIFT) + (cx & (POPULATION_PYRAMID_PAGE_SIZE - 1));
+        return &page[local * SPECIES_COUNT];
+    }
+
+    void update(int species, int x, int y, unsigned int delta) {
+        for (Level& level : levels) {
+            cell_counts(level, x >> level.shift, y >> level.shift)[species] += delta; // 减少时delta为-1（无符号回绕）
+        }
+    }
+
+    // 第0级一格的主要地形：分块已生成时统计全部格子，否则取中心格的原始地形
+    unsigned char block_terrain(const TerrainMap& terrain, int cx, int cy) const {
+        int x0 = cx << POPULATION_BASE_SHIFT, y0 = cy << POPULATION_BASE_SHIFT;
+        int x1 = min(terrain.get_width(), x0 + (1 << POPULATION_BASE_SHIFT));
+        int y1 = min(terrain.get_height(), y0 + (1 << POPULATION_BASE_SHIFT));
+        if (!terrain.is_generated(x0, y0)) return static_cast<unsigned char>(terrain.peek((x0 + x1) / 2, (y0 + y1) / 2).type);
+
+        int histogram[FLOODED + 1] = { 0 };
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                histogram[terrain.at(x, y).type]++;
+            }
+        }
+        return static_cast<unsigned char>(max_element(histogram, histogram + FLOODED + 1) - histogram);
+    }
+
+public:
+    PopulationPyramid() : terrain_day(-1) {}
+
+    // 按世界尺寸建立各级（数量清零）
+    void reset(int width, int height) {
+        levels.clear();
+        for (int shift = POPULATION_BASE_SHIFT; ; shift++) {
+            levels.emplace_back();
+            Level& level = levels.back();
+            level.shift = shift;
+            level.cells_x = ((width - 1) >> shift) + 1;
+            level.cells_y = ((height - 1) >> shift) + 1;
+            level.pages_x = ((level.cells_x - 1) >> POPULATION_PYRAMID_PAGE_SHIFT) + 1;
+            level.pages.resize(static_cast<size_t>(level.pages_x) * (((level.cells_y - 1) >> POPULATION_PYRAMID_PAGE_SHIFT) + 1));
+            level.terrain.assign(static_cast<size_t>(level.cells_x) * level.cells_y, TERRAIN_UNKNOWN);
+            if (level.cells_x == 1 && level.cells_y == 1) break;
+        }
+        terrain_day = -1;
+    }
+
+    // 清零所有数量和地形（重置世界时地形可能已恢复为原始地图）
+    void clear() {
+        for (Level& level : levels) {
+            for (unique_ptr<unsigned int[]>& page : level.pages) page.reset();
+            fill(level.terrain.begin(), level.terrain.end(), TERRAIN_UNKNOWN);
+        }
+        terrain_day = -1;
+    }
+
+    bool enabled() const { return !levels.empty(); }
+
+    void add(int species, int x, int y) {
+        if (enabled()) update(species, x, y, 1u);
+    }
+
+    void remove(int species, int x, int y) {
+        if (enabled()) update(species, x, y, ~0u);
+    }
+
+    // 移动：从某一级起新旧位置落在同一格后，更高的级别都不变
+    void relocate(int species, int old_x, int old_y, int new_x, int new_y) {
+        for (Level& level : levels) {
+            int from_x = old_x >> level.shift, from_y = old_y >> level.shift;
+            int to_x = new_x >> level.shift, to_y = new_y >> level.shift;
+            if (from_x == to_x && from_y == to_y) break;
+            cell_counts(level, from_x, from_y)[species]--;
+            cell_counts(level, to_x, to_y)[species]++;
+        }
+    }
+
+    int level_count() const { return static_cast<int>(levels.size()); }
+    int level_shift(int level) const { return levels[level].shift; }
+    int cells_x(int level) const { return levels[level].cells_x; }
+    int cells_y(int level) const { return levels[level].cells_y; }
+
+    // 一格的各物种数量（SPECIES_COUNT个）
+    const unsigned int* counts(int level, int cx, int cy) const {
+        const Level& l = levels[level];
+        const unique_ptr<unsigned int[]>& page = l.pages[(cy >> POPULATION_PYRAMID_PAGE_SHIFT) * l.pages_x + (cx >> POPULATION_PYRAMID_PAGE_SHIFT)];
+        if (!page) return EMPTY_COUNTS;
+        int local = ((cy & (POPULATION_PYRAMID_PAGE_SIZE - 1)) << POPULATION_PYRAMID_PAGE_SHIFT) + (cx & (POPULATION_PYRAMID_PAGE_SIZE - 1));
+        return &page[local * SPECIES_COUNT];
+    }
+
+    TerrainType terrain_at(int level, int cx, int cy) const {
+        const Level& l = levels[level];
+        return static_cast<TerrainType>(l.terrain[static_cast<size_t>(cy) * l.cells_x + cx]);
+    }
+
+    // 刷新各格的主要地形（每天最多一次）
+    // 第0级只重新统计已生成的分块（未生成的分块保持原始地形，只统计一次），更高级取下一级四格中最多的地形
+    void refresh_terrain(const TerrainMap& terrain, int day) const {
+        if (!enabled() || terrain_day == day) return;
+        terrain_day = day;
+
+        const Level& base = levels[0];
+        for (int cy = 0; cy < base.cells_y; cy++) {
+            for (int cx = 0; cx < base.cells_x; cx++) {
+                unsigned char& type = base.terrain[static_cast<size_t>(cy) * base.cells_x + cx];
+                if (type == TERRAIN_UNKNOWN || terrain.is_generated(cx << POPULATION_BASE_SHIFT, cy << POPULATION_BASE_SHIFT)) {
+                    type = block_terrain(terrain, cx, cy);
+                }
+            }
+        }
+        for (size_t l = 1; l < levels.size(); l++) {
+            const Level& lower = levels[l - 1];
+            const Level& level = levels[l];
+            for (int cy = 0; cy < level.cells_y; cy++) {
+                for (int cx = 0; cx < level.cells_x; cx++) {
+                    int histogram[FLOODED + 1] = { 0 };
+                    for (int sy = cy * 2; sy < min(lower.cells_y, cy * 2 + 2); sy++) {
+                        for (int sx = cx * 2; sx < min(lower.cells_x, cx * 2 + 2); sx++) {
+                            histogram[lower.terrain[static_cast<size_t>(sy) * lower.cells_x + sx]]++;
+                        }
+                    }
+                    level.terrain[static_cast<size_t>(cy) * level.cells_x + cx] =
+                        static_cast<unsigned char>(max_element(histogram, histogram + FLOODED + 1) - histogram);
+                }
+            }
+        }
+    }
+
+    size_t memory_bytes() const {
+        size_t bytes = 0;
+        for (const Level& level : levels) {
+            bytes += level.pages.capacity() * sizeof(unique_ptr<unsigned int[]>) + level.terrain.capacity();
+            for (const unique_ptr<unsigned int[]>& page : level.pages) {
+                if (page) bytes += PAGE_CELLS * SPECIES_COUNT * sizeof(unsigned int);
+            }
+        }
+        return bytes;
+    }
+};
+
+const unsigned int PopulationPyramid::EMPTY_COUNTS[SPECIES_COUNT] = {};
+
+// ---- 界面 ----
+// 交互界面由单独的绘制线程按自己的帧率绘制：模拟线程每天结束时把视口和统计数据复制到快照中发布，
+// 绘制线程只读取快照，不访问世界
+
+// 绘制线程的帧间隔（毫秒）
+const int RENDER_FRAME_MS = 50;
+
+// 连续运行时的默认速度和上限（天/秒）
+const int PLAY_DEFAULT_SPEED = 5;
+const int PLAY_MAX_SPEED = 200;
+
+// 界面上显示的最近提示条数
+const size_t VIEW_MESSAGE_LIMIT = 4;
+
+// 选中的生物的状态
+struct SelectedOrganism {
+    string name;
+    int x, y;
+    double energy;
+    int age;
+    string status;
+    int previous_x, previous_y;
+    double previous_energy;
+};
+
+// 一帧界面所需的全部数据（只读副本）
+// 每个成员都有默认值：绘制线程的缓冲在发布第一份快照之前就参与交换
+struct WorldSnapshot {
+    int width = 0, height = 0;
+    int day = 0, max_days = 0, season = 0;
+    Environment env;
+    int weather_cells_x = 0, weather_cells_y = 0;
+    double weather_peak = 0.0, weather_cloud = 0.0;
+
+    int viewport_x = 0, viewport_y = 0, viewport_width = 0, viewport_height = 0;
+    size_t organism_count = 0, sleeping_count = 0;
+    size_t generated_tiles = 0, tile_count = 0, owned_tiles = 0, owned_bytes = 0, depression_cells = 0;
+    bool record_history = false;
+    int history_first_day = 0, history_last_day = 0, view_day = -1;
+    size_t history_keyframes = 0, history_bytes = 0;
+    bool journal = false;
+    unsigned long long journal_events = 0, journal_raw_bytes = 0, journal_written_bytes = 0;
+    double seed_count = 0.0;
+    long long seeded_cells = 0;
+    MemoryFootprint footprint;
+    size_t memory_budget = 0;
+    long long resident_bytes = 0;
+    bool density_enabled = false;
+    size_t focus_area_count = 0, coarse_cells = 0, density_cells = 0;
+    double density_total = 0.0;
+    int infected = 0;
+    double epidemic_peak = 0.0;
+    int species_counts[SPECIES_COUNT] = {};
+    unsigned int region_count = 0; // 视口所显示区域内的个体数量
+    double region_energy = 0.0;    // 其平均能量
+    vector<string> messages;       // 模拟中产生的最近几条提示（灾难、内存预算等）
+
+    // 视口内各格的地形（-1表示世界之外）和生物符号（空格表示没有生物），按行存储
+    vector<signed char> cell_types;
+    vector<char> cell_symbols;
+    int view_scale = 1;                     // 视口一格对应的世界格边长（1为正常视图，更大时为概览地图）
+    int highlight_x = -1, highlight_y = -1; // 高亮的格（视口坐标，-1表示没有）
+    bool show_selection = false;            // 显示选中生物的详情
+    bool selection_found = false;
+    SelectedOrganism selected{};
+
+    bool show_prompt = false;              // 显示操作提示（交互界面）
+    bool playing = false;                  // 正在连续运行
+    int play_speed = PLAY_DEFAULT_SPEED;   // 连续运行的速度（天/秒）
+};
+
+// ---- 终端绘制 ----
+// 一帧先组成文本行和视口格，与上一帧比较后只输出变化的行和格，整帧的输出一次写入终端
+
+// 每隔多少帧完整重绘一次（其他输出打乱屏幕或终端尺寸改变后恢复）
+const int RENDER_FULL_REFRESH_FRAMES = 40;
+
+// 视口中的一格（3列：生物为[X]，地形为 X ）
+struct ScreenCell {
+    char text[8]; // UTF-8，以0结尾
+    unsigned char color;
+
+    bool operator==(const ScreenCell& other) const {
+        return color == other.color && strcmp(text, other.text) == 0;
+    }
+    bool operator!=(const ScreenCell& other) const { return !(*this == other); }
+};
+
+// 屏幕上的一行：文本行（含颜色转义），或者视口行（cells不为空）
+struct ScreenRow {
+    string text;
+    vector<ScreenCell> cells;
+};
+
+typedef vector<ScreenRow> ScreenFrame;
+
+// 把多行文本按换行拆成文本行，每行以当时的颜色开头（各行可以单独重绘）
+void append_text_rows(const string& text, ScreenFrame& frame) {
+    string color = ansi_color(COLOR_DEFAULT);
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.find('\n', begin);
+        if (end == string::npos) end = text.size();
+        ScreenRow row;
+        row.text = color + text.substr(begin, end - begin);
+        size_t escape = row.text.rfind("\033[");
+        color = row.text.substr(escape, row.text.find('m', escape) + 1 - escape);
+        frame.push_back(row);
+        begin = end + 1;
+    }
+}
+
+// 由快照组成一帧
+void compose_frame(const WorldSnapshot& snapshot, ScreenFrame& frame) {
+    frame.clear();
+    ostringstream out;
+
+    // 季节名称
+    string seasons[4] = { "春", "夏", "秋", "冬" };
+
+    // 天气名称
+    string weather_names[6] = {
+        "晴天", "雨天", "雪天", "多云", "暴风雨", "干旱"
+    };
+
+    // 天气颜色
+    int weather_colors[6] = {
+        COLOR_DEFAULT, COLOR_RAIN, COLOR_SNOW,
+        COLOR_DEFAULT, COLOR_WARNING, COLOR_DROUGHT
+    };
+
+    const Environment& env = snapshot.env;
+
+    // 标题
+    out << ansi_color(COLOR_TITLE);
+    out << " 生态系统模拟器 - 复杂生物网络 (" << snapshot.width << "x" << snapshot.height << ") ";
+    out << ansi_color(COLOR_DEFAULT);
+    out << endl;
+    out << "==================================================" << endl;
+
+    // 环境信息
+    out << ansi_color(COLOR_STATS);
+    out << "天数: " << snapshot.day << "/" << snapshot.max_days << " (" << seasons[snapshot.season] << "季) | ";
+    out << "温度: " << fixed << setprecision(1) << env.temperature << "°C | ";
+    out << "湿度: " << fixed << setprecision(1) << env.humidity << "%" << endl;
+    out << "降雨: " << fixed << setprecision(1) << env.rainfall << "mm | ";
+    out << "白天时长: " << fixed << setprecision(1) << env.daylight_hours << "小时 | ";
+    out << "污染: " << fixed << setprecision(2) << env.pollution * 100 << "%" << endl;
+
+    // 显示天气
+    out << ansi_color(weather_colors[env.weather]);
+    out << "天气: " << weather_names[env.weather]
+        << " (剩余" << env.weather_duration << "天)";
+    out << ansi_color(COLOR_DEFAULT);
+    out << " | 天气场: " << snapshot.weather_cells_x << "x" << snapshot.weather_cells_y
+        << " 最大降水" << fixed << setprecision(1) << snapshot.weather_peak << "mm"
+        << " 云量" << fixed << setprecision(0) << snapshot.weather_cloud * 100 << "%" << endl;
+
+    out << ansi_color(COLOR_DEFAULT);
+
+    // 视口和生物信息
+    out << ansi_color(COLOR_HIGHLIGHTA);
+    out << "视口位置: (" << snapshot.viewport_x << "," << snapshot.viewport_y << ")";
+    if (snapshot.view_scale > 1) out << " 概览1:" << snapshot.view_scale;
+    out << " 区域内" << snapshot.region_count << "个 (平均能量" << fixed << setprecision(1) << snapshot.region_energy << ") | ";
+    out << "生物总数: " << snapshot.organism_count << " (休眠" << snapshot.sleeping_count << ") | ";
+    out << "地形分块: 已生成" << snapshot.generated_tiles << "/" << snapshot.tile_count
+        << " 已分叉" << snapshot.owned_tiles << " (" << snapshot.owned_bytes / (1024 * 1024) << "MB)"
+        << " | 洼地: " << snapshot.depression_cells << "格" << endl;
+    if (snapshot.record_history) {
+        out << "历史记录: 第" << snapshot.history_first_day << "-" << snapshot.history_last_day << "天 关键帧"
+            << snapshot.history_keyframes << "个 (" << snapshot.history_bytes / 1024 << "KB)";
+        if (snapshot.view_day >= 0) {
+            out << ansi_color(COLOR_WARNING);
+            out << " | 正在回看第" << snapshot.view_day << "天";
+        }
+        out << ansi_color(COLOR_HIGHLIGHTA);
+        out << endl;
+    }
+    if (snapshot.journal) {
+        out << "事件日志: " << snapshot.journal_events << "条 "
+            << snapshot.journal_raw_bytes / 1024 << "KB -> " << snapshot.journal_written_bytes / 1024 << "KB" << endl;
+    }
+    out << "种子库: 约" << static_cast<long long>(snapshot.seed_count) << "粒 | "
+        << snapshot.seeded_cells << "格" << endl;
+    const MemoryFootprint& footprint = snapshot.footprint;
+    const size_t mb = 1024 * 1024;
+    out << "内存: 地形" << footprint.terrain / mb << "MB 生物" << footprint.organisms / mb << "MB 索引和场"
+        << footprint.indices / mb << "MB 历史" << footprint.history / mb << "MB 共" << footprint.total() / mb << "MB";
+    if (snapshot.memory_budget > 0) out << " (预算" << snapshot.memory_budget / mb << "MB)";
+    out << " | 常驻" << snapshot.resident_bytes / static_cast<long long>(mb) << "MB" << endl;
+    if (snapshot.density_enabled) {
+        out << "细节层次: 关注区域" << snapshot.focus_area_count << "个 | 粗粒度格 "
+            << snapshot.coarse_cells << "/" << snapshot.density_cells
+            << " | 密度场个体约" << static_cast<long long>(snapshot.density_total) << endl;
+    }
+    out << ansi_color(COLOR_DEFAULT);
+
+    // 显示疾病状态
+    if (env.disease != NONE) {
+        out << ansi_color(COLOR_WARNING);
+        string disease_name;
+        switch (env.disease) {
+        case FUNGAL_INFECTION: disease_name = "真菌感染"; break;
+        case VIRAL_OUTBREAK: disease_name = "病毒爆发"; break;
+        case PARASITIC_INFESTATION: disease_name = "寄生虫感染"; break;
+        default: disease_name = "未知疾病";
+        }
+        out << "当前疫情: " << disease_name << " (剩余" << env.disease_duration << "天) | 患病个体 "
+            << snapshot.infected << " | 病原压力峰值 " << fixed << setprecision(2) << snapshot.epidemic_peak << endl;
+        out << ansi_color(COLOR_DEFAULT);
+    }
+
+    // 种群数量（植物包含树木和水生植物，昆虫包含飞行昆虫）
+    const int* counts = snapshot.species_counts;
+    int plants = counts[SPECIES_PLANT] + counts[SPECIES_TREE] + counts[SPECIES_AQUATIC_PLANT];
+    int insects = counts[SPECIES_INSECT] + counts[SPECIES_FLYING_INSECT];
+
+    // 植物统计
+    out << ansi_color(COLOR_PLANT);
+    out << "植物: " << plants << " | 树木: " << counts[SPECIES_TREE] << " | 水生植物: " << counts[SPECIES_AQUATIC_PLANT] << endl;
+
+    // 动物统计
+    out << ansi_color(COLOR_HERBIVORE);
+    out << "食草动物: " << counts[SPECIES_HERBIVORE] << " | ";
+    out << ansi_color(COLOR_CARNIVORE);
+    out << "食肉动物: " << counts[SPECIES_CARNIVORE] << " | ";
+    out << ansi_color(COLOR_DEFAULT);
+    out << "杂食动物: " << counts[SPECIES_OMNIVORE] << endl;
+
+    // 其他生物
+    out << ansi_color(COLOR_DEFAULT);
+    out << "昆虫: " << insects << " | 飞行昆虫: " << counts[SPECIES_FLYING_INSECT] << " | 分解者: " << counts[SPECIES_DECOMPOSER] << endl;
+    out << "顶级掠食者: " << counts[SPECIES_APEX_PREDATOR] << " | 寄生生物: " << counts[SPECIES_PARASITE] << " | 鱼类: " << counts[SPECIES_FISH] << endl;
+    out << "鸟类: " << counts[SPECIES_BIRD] << " | 爬行动物: " << counts[SPECIES_REPTILE] << " | 两栖动物: " << counts[SPECIES_AMPHIBIAN] << endl;
+    out << "食腐动物: " << counts[SPECIES_SCAVENGER] << endl;
+
+    append_text_rows(out.str(), frame);
+
+    // 地形符号和颜色（按TerrainType顺序）
+    static const char* const terrain_symbols[] = { ".", "Y", "^", "d", "~", "m", "V", "*", ",", "J", "T", "=", "≈" };
+    static const int terrain_colors[] = {
+        COLOR_PLANT, COLOR_FOREST, COLOR_MOUNTAIN, COLOR_DESERT, COLOR_WATER, COLOR_MARSH, COLOR_VOLCANIC,
+        COLOR_SNOW, COLOR_GRASSLAND, COLOR_JUNGLE, COLOR_TUNDRA, COLOR_BEACH, COLOR_RAIN
+    };
+
+    // 视口 - 使用方格格式
+    for (int y = 0; y < snapshot.viewport_height; y++) {
+        ScreenRow row;
+        row.cells.resize(snapshot.viewport_width);
+        for (int x = 0; x < snapshot.viewport_width; x++) {
+            int type = snapshot.cell_types[y * snapshot.viewport_width + x];
+            char symbol = snapshot.cell_symbols[y * snapshot.viewport_width + x];
+            ScreenCell& cell = row.cells[x];
+
+            // 高亮选中的生物，否则使用地形颜色
+            int color = (x == snapshot.highlight_x && y == snapshot.highlight_y) ? COLOR_HIGHLIGHTA :
+                type >= 0 ? terrain_colors[type] : COLOR_DEFAULT;
+
+            // 如果有生物，则绘制生物（使用更亮的颜色）
+            if (symbol != ' ') {
+                // 根据生物类型设置颜色
+                if (symbol == 'P' || symbol == 'T' || symbol == 'A') {
+                    color = COLOR_PLANT + 8; // 更亮的绿色
+                }
+                else if (symbol == 'H') {
+                    color = COLOR_HERBIVORE + 8; // 更亮的黄色
+                }
+                else if (symbol == 'C') {
+                    color = COLOR_CARNIVORE + 8; // 更亮的红色
+                }
+                else if (symbol == 'X') {
+                    color = COLOR_WARNING + 8; // 更亮的红色
+                }
+                else if (symbol == '~') {
+                    color = COLOR_WATER + 8; // 更亮的蓝色
+                }
+                else if (symbol == 'B') {
+                    color = COLOR_STATS + 8; // 更亮的青色
+                }
+                else {
+                    color = COLOR_DEFAULT + 8; // 更亮的白色
+                }
+                snprintf(cell.text, sizeof(cell.text), "[%c]", symbol);
+            }
+            else {
+                // 没有生物，只显示地形
+                snprintf(cell.text, sizeof(cell.text), " %s ", type >= 0 ? terrain_symbols[type] : " ");
+            }
+            cell.color = static_cast<unsigned char>(color);
+        }
+        frame.push_back(row);
+    }
+
+    out.str("");
+    // 显示选中的生物状态
+    if (snapshot.show_selection) {
+        if (snapshot.selection_found) {
+            const SelectedOrganism& org = snapshot.selected;
+            out << ansi_color(COLOR_HIGHLIGHTA);
+            out << "\n=== 生物状态详情 ===" << endl;
+            out << ansi_color(COLOR_DEFAULT);
+            out << "类型: " << org.name << endl;
+            out << "位置: (" << org.x << ", " << org.y << ")" << endl;
+            out << "能量: " << fixed << setprecision(1) << org.energy << "/" << org.energy * 2 << endl;
+            out << "年龄: " << org.age << "天" << endl;
+            out << "状态: " << org.status << endl;
+
+            // 显示前一天状态变化
+            out << "\n--- 前一天状态变化 ---" << endl;
+            out << "位置变化: (" << org.previous_x << ", " << org.previous_y << ") -> (" << org.x << ", " << org.y << ")" << endl;
+            out << "能量变化: " << fixed << setprecision(1) << org.previous_energy << " -> " << org.energy << endl;
+            out << "年龄变化: " << org.age << " -> " << org.age + 1 << endl;
+        }
+        else {
+            out << ansi_color(COLOR_WARNING);
+            out << "\n该位置没有存活的生物" << endl;
+            out << ansi_color(COLOR_DEFAULT);
+        }
+    }
+
+    // 图例
+    out << ansi_color(COLOR_STATS);
+    out << "\n图例: ";
+    out << ansi_color(COLOR_DEFAULT);
+    out << "P=植物, T=树木, A=水生植物, H=食草动物, C=食肉动物\n";
+    out << "      O=杂食动物, I=昆虫, F=飞行昆虫, D=分解者, X=顶级掠食者\n"; // 修改顶级掠食者符号为X
+    out << "      *=寄生生物, ~=鱼类, B=鸟类, R=爬行动物, M=两栖动物\n"; // 修改鸟类符号为B
+
+    // 地形图例
+    out << ansi_color(COLOR_STATS);
+    out << "地形: ";
+    out << ansi_color(COLOR_PLANT); out << "."; out << ansi_color(COLOR_DEFAULT); out << "平原 ";
+    out << ansi_color(COLOR_FOREST); out << "Y"; out << ansi_color(COLOR_DEFAULT); out << "森林 ";
+    out << ansi_color(COLOR_GRASSLAND); out << ","; out << ansi_color(COLOR_DEFAULT); out << "草原 ";
+    out << ansi_color(COLOR_JUNGLE); out << "J"; out << ansi_color(COLOR_DEFAULT); out << "丛林\n";
+    out << "      ";
+    out << ansi_color(COLOR_MOUNTAIN); out << "^"; out << ansi_color(COLOR_DEFAULT); out << "山脉 ";
+    out << ansi_color(COLOR_DESERT); out << "d"; out << ansi_color(COLOR_DEFAULT); out << "沙漠 ";
+    out << ansi_color(COLOR_TUNDRA); out << "T"; out << ansi_color(COLOR_DEFAULT); out << "苔原 ";
+    out << ansi_color(COLOR_SNOW); out << "*"; out << ansi_color(COLOR_DEFAULT); out << "雪地\n";
+    out << "      ";
+    out << ansi_color(COLOR_WATER); out << "~"; out << ansi_color(COLOR_DEFAULT); out << "水域 ";
+    out << ansi_color(COLOR_MARSH); out << "m"; out << ansi_color(COLOR_DEFAULT); out << "沼泽 ";
+    out << ansi_color(COLOR_VOLCANIC); out << "V"; out << ansi_color(COLOR_DEFAULT); out << "火山 ";
+    out << ansi_color(COLOR_BEACH); out << "="; out << ansi_color(COLOR_DEFAULT); out << "海滩 ";
+    out << ansi_color(COLOR_RAIN); out << "≈"; out << ansi_color(COLOR_DEFAULT); out << "积水区\n";
+
+    out << ansi_color(COLOR_DEFAULT);
+    out << "==================================================" << endl;
+
+    // 模拟中产生的提示
+    if (!snapshot.messages.empty()) {
+        out << ansi_color(COLOR_WARNING);
+        for (const string& message : snapshot.messages) out << message << endl;
+        out << ansi_color(COLOR_DEFAULT);
+    }
+
+    // 操作提示
+    if (snapshot.show_prompt) {
+        out << ansi_color(COLOR_STATS);
+        out << "\n选项: [S]模拟一天  [G]连续运行/暂停  [+/-]速度  [A]调整环境  [R]重置  [Q]退出  [方向键]移动视口  [C]选择生物  [F]关注区域  [P]物种开销  [[/]]缩放\n";
+        out << "回看: [,]前一天  [.]后一天  [<]前十天  [>]后十天  [L]回到当前\n";
+        if (snapshot.playing) {
+            out << ansi_color(COLOR_HIGHLIGHTA);
+            out << "连续运行中: " << snapshot.play_speed << "天/秒\n";
+        }
+        out << ansi_color(COLOR_DEFAULT);
+        out << "请选择操作: ";
+    }
+    append_text_rows(out.str(), frame);
+}
+
+// 终端绘制器：保存上一帧，只输出变化的部分
+class TerminalRenderer {
+private:
+    ScreenFrame previous;
+    ScreenFrame frame;
+    string output;
+    int frames_since_full;
+    bool cleared; // 是否已清过屏
+
+    // 输出缓冲中光标和颜色的当前状态（-1表示未知）
+    int cursor_row, cursor_column, current_color;
+
+    void move_to(int row, int column) {
+        if (row == cursor_row && column == cursor_column) return;
+        output += "\033[" + to_string(row + 1) + ";" + to_string(column + 1) + "H";
+        cursor_row = row;
+        cursor_column = column;
+    }
+
+    void put_cell(int row, int x, const ScreenCell& cell) {
+        move_to(row, x * 3);
+        if (cell.color != current_color) {
+            output += ansi_color(cell.color);
+            current_color = cell.color;
+        }
+        output += cell.text;
+        // 非ASCII字符在不同终端中的宽度不一致，之后的格重新定位
+        bool ascii = true;
+        for (const char* c = cell.text; *c; c++) {
+            if (static_cast<unsigned char>(*c) >= 0x80) ascii = false;
+        }
+        cursor_column = ascii ? cursor_column + 3 : -1;
+    }
+
+    void put_text_row(int row, const ScreenRow& text_row) {
+        move_to(row, 0);
+        output += text_row.text;
+        output += "\033[K"; // 清除上一帧残留的行尾
+        cursor_row = -1;
+        current_color = -1;
+    }
+
+    // 一次写入终端（之前通过cout的输出先刷新）
+    void write_output() {
+        cout.flush();
+#ifdef _WIN32
+        DWORD written = 0;
+        WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), output.data(), static_cast<DWORD>(output.size()), &written, nullptr);
+#else
+        size_t offset = 0;
+        while (offset < output.size()) {
+            ssize_t written = ::write(STDOUT_FILENO, output.data() + offset, output.size() - offset);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            offset += static_cast<size_t>(written);
+        }
+#endif
+    }
+
+public:
+    TerminalRenderer() : frames_since_full(0), cleared(false), cursor_row(-1), cursor_column(-1), current_color(-1) {
+#ifdef _WIN32
+        // 让控制台解释ANSI转义序列
+        HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode = 0;
+        if (GetConsoleMode(console, &mode)) SetConsoleMode(console, mode | 0x0004); // ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#endif
+    }
+
+    // 下一帧完整重绘（屏幕被其他输出改变之后）
+    void invalidate() {
+        previous.clear();
+    }
+
+    // 绘制一帧，返回写入终端的字节数
+    size_t draw(const WorldSnapshot& snapshot) {
+        compose_frame(snapshot, frame);
+        output.clear();
+        cursor_row = cursor_column = current_color = -1;
+
+        bool full = previous.empty() || ++frames_since_full >= RENDER_FULL_REFRESH_FRAMES;
+        if (full) frames_since_full = 0;
+        if (!cleared) {
+            output += "\033[2J";
+            cleared = true;
+        }
+
+        for (size_t r = 0; r < frame.size(); r++) {
+            const ScreenRow& row = frame[r];
+            const ScreenRow* old = (!full && r < previous.size()) ? &previous[r] : nullptr;
+            int screen_row = static_cast<int>(r);
+            if (row.cells.empty()) {
+                if (!old || !old->cells.empty() || old->text != row.text) put_text_row(screen_row, row);
+                continue;
+            }
+            bool same_shape = old && old->cells.size() == row.cells.size();
+            for (size_t x = 0; x < row.cells.size(); x++) {
+                if (!same_shape || row.cells[x] != old->cells[x]) put_cell(screen_row, static_cast<int>(x), row.cells[x]);
+            }
+            if (!same_shape) {
+                output += "\033[K";
+                cursor_column = -1;
+            }
+        }
+        // 清除上一帧多出的行，光标停在最后一行末尾（操作提示之后）
+        move_to(static_cast<int>(frame.size()), 0);
+        output += "\033[J";
+        if (!frame.empty() && frame.back().cells.empty()) put_text_row(static_cast<int>(frame.size()) - 1, frame.back());
+        output += ansi_color(COLOR_DEFAULT);
+
+        write_output();
+        swap(previous, frame);
+        return output.size();
+    }
+};
+
+// 在当前线程完整绘制一帧
+void render_snapshot(const WorldSnapshot& snapshot) {
+    TerminalRenderer renderer;
+    renderer.draw(snapshot);
+    cout << "\n";
+}
+
+// 绘制线程：模拟线程把快照发布到共享的前缓冲，绘制线程取走最新的一份按帧率绘制
+// 快照之间只交换缓冲（不复制），两边的缓冲在后续帧中复用
+class RenderThread {
+private:
+    mutex lock;
+    condition_variable wake;
+    WorldSnapshot front;  // 最新发布、尚未绘制的快照
+    bool fresh;           // front是否为新的快照
+    bool paused;          // 暂停绘制（主线程需要直接使用终端时）
+    bool drawing;         // 正在绘制一帧
+    bool redraw;          // 屏幕被主线程使用过，下一帧完整重绘
+    bool stopping;
+    TerminalRenderer terminal; // 只由绘制线程使用
+    thread worker;
+
+    void run() {
+        WorldSnapshot current;
+        auto next_frame = chrono::steady_clock::now();
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            wake.wait(guard, [&] { return stopping || (fresh && !paused); });
+            if (stopping) return;
+            // 限制帧率：帧间隔内到达的快照只绘制最新的一份
+            if (wake.wait_until(guard, next_frame, [&] { return stopping; })) return;
+            if (!fresh || paused) continue;
+            swap(current, front);
+            fresh = false;
+            drawing = true;
+            if (redraw) terminal.invalidate();
+            redraw = false;
+            guard.unlock();
+
+            terminal.draw(current);
+            next_frame = chrono::steady_clock::now() + chrono::milliseconds(RENDER_FRAME_MS);
+
+            guard.lock();
+            drawing = false;
+            wake.notify_all();
+        }
+    }
+
+public:
+    RenderThread() : fresh(false), paused(false), drawing(false), redraw(false), stopping(false) {
+        worker = thread(&RenderThread::run, this);
+    }
+
+    ~RenderThread() {
+        stop();
+    }
+
+    // 发布一份快照（与snapshot交换，snapshot得到一份可复用的旧缓冲）
+    void publish(WorldSnapshot& snapshot) {
+        lock_guard<mutex> guard(lock);
+        swap(front, snapshot);
+        fresh = true;
+        wake.notify_all();
+    }
+
+    // 暂停绘制，等待正在绘制的一帧完成（之后主线程可以直接读写终端，恢复后完整重绘）
+    void pause() {
+        unique_lock<mutex> guard(lock);
+        paused = true;
+        wake.wait(guard, [&] { return !drawing; });
+    }
+
+    void resume() {
+        lock_guard<mutex> guard(lock);
+        paused = false;
+        redraw = true;
+        wake.notify_all();
+    }
+
+    // 停止绘制线程（未绘制的快照丢弃）
+    void stop() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+            wake.notify_all();
+        }
+        if (worker.joinable()) worker.join();
+    }
+};
+
+// 世界模拟器类
+class World {
+private:
+    int width;  // 世界宽度
+    int height; // 世界高度
+    unsigned int seed; // 地形和随机数种子
+    Environment env;
+    vector<Organism*> organisms;
+    SleepScheduler sleepers;             // 休眠中的生物（仍在organisms中，但跳过每天的更新）
+    vector<FocusArea> focus_areas;       // 关注区域，之外的生物以密度场表示
+    vector<SeedingRule> seeding;         // 初始种群的放置规则（重新开始时再次使用）
+    vector<Intervention> interventions;  // 计划干预
+    double forced_temperature;           // 干预设定的温度
+    int forced_temperature_until;        // 干预设定的温度持续到哪一天（0表示没有）
+    DensityField density_field;          // 关注区域之外的粗粒度密度（未启用时为空）
+    EpidemicField epidemic;              // 本区域的疫病压力场
+    WeatherField weather;                // 整个世界的天气场（各进程相同）
+    WaterRouting water_routing;          // 地表水汇流的流向
+    vector<unsigned char> hydrology_weather;   // 水文更新时各格的局地天气（每天只采样一次）
+    vector<float> hydrology_temperature;       // 水文更新时各格的局地气温
+    unique_ptr<EventJournal> journal;    // 事件日志（未启用时为空）
+    unique_ptr<ResultsStore> results;    // 实时结果文件（未启用时为空）
+    SimulationMetrics metrics;           // 运行指标（导出线程读取）
+    unique_ptr<MetricsExporter> metrics_exporter; // 指标导出（未启用时为空）
+    unique_ptr<PhaseCounters> phase_counters; // 各阶段的累计耗时和硬件计数器（只在基准测试时启用）
+    unique_ptr<SpeciesProfiler> profiler; // 物种开销统计（未启用时为空）
+    string profile_path;                 // 运行结束时写入物种开销报告的文件
+    long long phase_elapsed[PHASE_COUNT]; // 当天各阶段的耗时
+    long long births_today;              // 当天出生的个体数
+    long long deaths_today[DEATH_CAUSE_COUNT]; // 当天按死因的死亡数
+    chrono::steady_clock::time_point day_started;
+    set<unsigned long long> killed;      // 当天被取食致死的生物编号
+    SeedBank seed_bank;                  // 本区域土壤中的种子
+    vector<double> temperature_history;  // 每天的气温，唤醒时用于结算休眠期间的消耗
+    TerrainMap terrain;
+    TerrainMap pristine_terrain; // 生成时的原始地图，与共享同一地图的其他世界共用分块
+    bool owns_generation;        // 地形由本世界生成（否则来自共享的原始地图）
+    int day;
+    int season; // 0-春,1-夏,2-秋,3-冬
+    int viewport_x, viewport_y; // 视口位置
+    int viewport_width, viewport_height; // 视口尺寸
+    PopulationTables population_tables; // 按物种的数量和能量前缀和（每天结束时重建）
+    PopulationPyramid population; // 各物种数量的多级汇总（概览地图，只在单进程界面模式下维护）
+    unique_ptr<FrameExporter> frames; // 图像帧导出（未启用时为空）
+    int zoom; // 概览地图的级别（0为正常视图，n表示视口一格对应数量汇总第n-1级的一格）
+    int max_days; // 最大模拟天数
+    int selected_x, selected_y; // 选中的生物位置
+    bool show_history; // 是否显示历史状态
+    HistoryStore history; // 每天的状态历史（用于回看）
+    bool record_history;  // 是否记录历史（只在单进程界面模式下记录）
+    int view_day;         // 正在回看的日期（-1表示显示当前状态）
+    int domain_x0, domain_y0, domain_x1, domain_y1; // 本世界负责的区域（单进程时为整个世界）
+    int rank; // 进程序号
+    int worker_threads; // 进食阶段的工作线程数
+    WorkerPool workers; // 进食阶段和种群汇总表共用的常驻工作线程
+    size_t memory_budget;    // 内存预算（字节，0表示不限制）
+    bool over_budget_warned; // 已提示过内存无法再缩减
+    bool hold_messages;      // 提示不直接输出，保存在messages中由快照交给绘制线程显示
+    deque<string> messages;  // 最近几条提示（带日期）
+
+    // 禁止复制和赋值
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    // 生成地形
+    // 只建立分块索引，分块在第一次被访问时按坐标确定性地生成
+    void generate_terrain() {
+        terrain.reset(width, height, make_shared<TerrainGenerator>(seed, width, height));
+
+        // 保存原始地图，其分块与当前地图共享，直到被修改
+        pristine_terrain = terrain;
+    }
+
+    // 季节变化影响
+    void update_season() {
+        // 两年共730天，每季约182.5天
+        env.season_progress = fmod(day / 182.5, 4.0);
+        season = static_cast<int>(env.season_progress) % 4;
+        env.season_progress = fmod(env.season_progress, 1.0); // 当前季节内的进度
+
+        // 季节影响环境
+        switch (season) {
+        case 0: // 春
+            env.temperature = 10.0 + 15.0 * sin(env.season_progress * 3.1416);
+            env.humidity = 70.0;
+            env.daylight_hours = 12.0 + 4.0 * sin(env.season_progress * 3.1416);
+            env.rainfall = 60.0;
+            break;
+        case 1: // 夏
+            env.temperature = 20.0 + 15.0 * sin(env.season_progress * 3.1416);
+            env.humidity = 60.0;
+            env.daylight_hours = 16.0 - 4.0 * sin(env.season_progress * 3.1416);
+            env.rainfall = 30.0;
+            break;
+        case 2: // 秋
+            env.temperature = 10.0 + 10.0 * sin(env.season_progress * 3.1416);
+            env.humidity = 50.0;
+            env.daylight_hours = 12.0 - 4.0 * sin(env.season_progress * 3.1416);
+            env.rainfall = 40.0;
+            break;
+        case 3: // 冬
+            env.temperature = -5.0 + 10.0 * sin(env.season_progress * 3.1416);
+            env.humidity = 40.0;
+            env.daylight_hours = 8.0 + 4.0 * sin(env.season_progress * 3.1416);
+            env.rainfall = 20.0;
+            break;
+        }
+
+        // 温度波动
+        env.temperature += (rand() % 7 - 3);
+
+        // 降雨量波动
+        env.rainfall = max(0.0, min(100.0, env.rainfall + (rand() % 20 - 10)));
+    }
+
+    // 更新天气
+    void update_weather() {
+        // 天气持续时间结束，生成新天气
+        if (--env.weather_duration <= 0) {
+            // 根据季节确定天气概率
+            vector<WeatherType> weather_options;
+            vector<double> weather_probs;
+
+            if (season == 0) { // 春
+                weather_options = { SUNNY, RAINY, CLOUDY, STORMY };
+                weather_probs = { 0.4, 0.3, 0.2, 0.1 };
+            }
+            else if (season == 1) { // 夏
+                weather_options = { SUNNY, CLOUDY, STORMY, DROUGHT };
+                weather_probs = { 0.5, 0.2, 0.2, 0.1 };
+            }
+            else if (season == 2) { // 秋
+                weather_options = { SUNNY, CLOUDY, RAINY };
+                weather_probs = { 0.4, 0.3, 0.3 };
+            }
+            else { // 冬
+                weather_options = { CLOUDY, SNOWY, SUNNY };
+                weather_probs = { 0.5, 0.4, 0.1 };
+            }
+
+            // 选择天气
+            double r = static_cast<double>(rand()) / RAND_MAX;
+            double cumulative = 0.0;
+            for (size_t i = 0; i < weather_options.size(); i++) {
+                cumulative += weather_probs[i];
+                if (r < cumulative) {
+                    env.weather = weather_options[i];
+                    break;
+                }
+            }
+
+            // 设置天气持续时间 (1-5天)
+            env.weather_duration = 1 + rand() % 5;
+        }
+
+        // 更新连续天气计数
+        if (env.weather == RAINY || env.weather == STORMY) {
+            env.consecutive_rain++;
+            env.consecutive_sunny = 0;
+        }
+        else if (env.weather == SUNNY || env.weather == DROUGHT) {
+            env.consecutive_sunny++;
+            env.consecutive_rain = 0;
+        }
+        else {
+            env.consecutive_rain = 0;
+            env.consecutive_sunny = 0;
+        }
+    }
+
+    // 更新积水、积雪和干旱
+    // 只处理已生成的分块，未生成的区域保持原始状态
+    void update_terrain_hydrology() {
+        // 降雨产生的径流沿地形汇向下游
+        // 各格的局地天气在这里采样一次，积水和积雪的更新直接沿用
+        size_t cells = static_cast<size_t>(width) * height;
+        hydrology_weather.resize(cells);
+        hydrology_temperature.resize(cells);
+        water_routing.begin(terrain);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                if (!terrain.is_generated(x, y)) {
+                    x |= TERRAIN_TILE_MASK; // 跳过尚未生成的分块
+                    continue;
+                }
+                double rainfall, temperature;
+                WeatherType local = weather.local_weather(env, x, y, rainfall, temperature);
+                size_t index = static_cast<size_t>(y) * width + x;
+                hydrology_weather[index] = static_cast<unsigned char>(local);
+                hydrology_temperature[index] = static_cast<float>(temperature);
+                if (local == RAINY) water_routing.add_runoff(x, y, RUNOFF_RAINY * (rainfall / 50.0));
+                else if (local == STORMY) water_routing.add_runoff(x, y, RUNOFF_STORMY * (rainfall / 50.0));
+            }
+        }
+        water_routing.route(terrain);
+
+        // 只更新有生物、当天有水留住，或者还有积水、积雪和洪水区的分块：
+        // 其余分块上的积雪和干旱没有生物读取，跳过它们，原始分块也就不会被克隆
+        int tiles_x = terrain.get_tiles_x(), tiles_y = terrain.get_tiles_y();
+        vector<char> active(terrain.tile_count(), 0);
+        for (Organism* org : organisms) {
+            active[(org->getY() >> TERRAIN_TILE_SHIFT) * tiles_x + (org->getX() >> TERRAIN_TILE_SHIFT)] = 1;
+        }
+        water_routing.mark_wet_tiles(active);
+
+        for (int ty = 0; ty < tiles_y; ty++) {
+            for (int tx = 0; tx < tiles_x; tx++) {
+                int x0 = tx << TERRAIN_TILE_SHIFT, y0 = ty << TERRAIN_TILE_SHIFT;
+                int x1 = min(width, x0 + TERRAIN_TILE_SIZE), y1 = min(height, y0 + TERRAIN_TILE_SIZE);
+                if (!terrain.is_generated(x0, y0)) continue;
+                // 原始分块上没有积水和积雪，只有被修改过的分块才需要检查
+                if (!active[ty * tiles_x + tx] && !(terrain.is_diverged(x0, y0) && damp_tile(x0, y0, x1, y1))) continue;
+
+                for (int y = y0; y < y1; y++) {
+                    for (int x = x0; x < x1; x++) {
+                        const Terrain& before = terrain.at(x, y);
+                        Terrain cell = before;
+
+                        // 该格的局地天气（径流阶段已采样）
+                        size_t index = static_cast<size_t>(y) * width + x;
+                        WeatherType local = static_cast<WeatherType>(hydrology_weather[index]);
+                        float temperature = hydrology_temperature[index];
+                        bool raining = local == RAINY || local == STORMY || local == SNOWY;
+
+                        // 汇流留在本格的水增加积水（山谷和洼地积水最多）
+                        cell.water_accumulation = min(1.0,
+                            cell.water_accumulation + water_routing.retained(x, y));
+
+                        // 晴天减少积水
+                        if (local == SUNNY) {
+                            cell.water_accumulation = max(0.0,
+                                cell.water_accumulation - 0.03);
+                        }
+                        // 干旱大幅减少积水
+                        else if (local == DROUGHT) {
+                            cell.water_accumulation = max(0.0,
+                                cell.water_accumulation - 0.08);
+                            cell.drought_level = min(1.0,
+                                cell.drought_level + 0.05);
+                        }
+
+                        // 下雪增加积雪
+                        if (local == SNOWY && temperature < 0) {
+                            cell.snow_depth = min(1.0,
+                                cell.snow_depth + 0.1);
+                        }
+                        // 晴天减少积雪
+                        else if (local == SUNNY && temperature > 0) {
+                            cell.snow_depth = max(0.0,
+                                cell.snow_depth - 0.05);
+                        }
+
+                        // 连续晴天增加干旱（局地正在降水的格子除外）
+                        if (env.consecutive_sunny > 5 && !raining) {
+                            cell.drought_level = min(1.0,
+                                cell.drought_level + 0.01 * env.consecutive_sunny);
+                        }
+                        // 降雨减少干旱（只作用于局地正在降水的格子）
+                        if (env.consecutive_rain > 0 && raining) {
+                            cell.drought_level = max(0.0,
+                                cell.drought_level - 0.02 * env.consecutive_rain);
+                        }
+
+                        // 积水过多形成洪水区
+                        if (cell.water_accumulation > 0.5 &&
+                            cell.type != WATER && cell.type != MARSH) {
+                            cell.type = FLOODED;
+                        }
+                        // 积水减少恢复原状
+                        else if (cell.water_accumulation < 0.2 &&
+                            cell.type == FLOODED) {
+                            // 根据原始高度恢复地形
+                            double h = cell.original_height;
+                            if (h < 0.2) cell.type = WATER;
+                            else if (h < 0.25) cell.type = BEACH;
+                            else if (h < 0.3) cell.type = MARSH;
+                            else if (h < 0.5) {
+                                if (cell.water_level > 0.7) cell.type = FOREST;
+                                else cell.type = PLAIN;
+                            }
+                            else if (h < 0.7) cell.type = GRASSLAND;
+                            else cell.type = MOUNTAIN;
+                        }
+
+                        // 干旱导致水域缩小
+                        if (cell.type == WATER && cell.drought_level > 0.6) {
+                            if (cell.height > 0.15) {
+                                cell.type = MARSH;
+                            }
+                        }
+                        else if (cell.type == MARSH && cell.drought_level > 0.7) {
+                            cell.type = PLAIN;
+                        }
+
+                        // 只有发生变化的格子才写回（并克隆其所在分块）
+                        if (cell != before) {
+                            water_routing.note_change(x, y, before, cell);
+                            terrain.mut(x, y) = cell;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // 区域内是否还有积水、积雪或洪水区（需要继续消退）
+    bool damp_tile(int x0, int y0, int x1, int y1) const {
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                const Terrain& cell = terrain.at(x, y);
+                if (cell.water_accumulation > 0 || cell.snow_depth > 0 || cell.type == FLOODED) return true;
+            }
+        }
+        return false;
+    }
+
+    // 掷骰决定是否发生环境灾难，返回灾难类型（-1表示没有）
+    // 这里只决定全局的部分（灾难类型、瘟疫种类），伤亡和地形影响由apply_disaster处理
+    int roll_disaster() {
+        if ((double)rand() / RAND_MAX >= env.disaster_chance) {
+            return -1;
+        }
+
+        notify("\n!!! 发生环境灾难 !!!\n");
+        int disaster_type = rand() % 5;
+        announce_disaster(disaster_type);
+        return disaster_type;
+    }
+
+    // 宣布灾难，瘟疫时决定疾病种类
+    void announce_disaster(int disaster_type) {
+        switch (disaster_type) {
+        case 0: notify("森林火灾爆发!\n"); break;
+        case 1: notify("洪水泛滥!\n"); break;
+        case 2:
+            notify("瘟疫蔓延!\n");
+            env.disease = static_cast<DiseaseType>(1 + rand() % 3);
+            env.disease_duration = 30; // 持续30天
+            break;
+        case 3: notify("火山喷发!\n"); break;
+        case 4: notify("严重干旱!\n"); break;
+        }
+    }
+
+    // 输出一条提示。交互界面中绘制线程独占终端，提示保存为最近几条，由快照交给绘制线程显示
+    void notify(const string& text) {
+        if (!hold_messages) {
+            cout << text << flush;
+            return;
+        }
+        string line = text;
+        line.erase(remove(line.begin(), line.end(), '\n'), line.end());
+        messages.push_back("第" + to_string(day) + "天 " + line);
+        if (messages.size() > VIEW_MESSAGE_LIMIT) messages.pop_front();
+    }
+
+    // 疫病传播：患病个体向压力场释放病原，扩散一天后易感个体按所在格的压力接触感染
+    void spread_epidemic() {
+        for (Organism* org : organisms) {
+            if (org->hasDisease() && !org->is_dead()) {
+                epidemic.deposit(org->getX(), org->getY(), EPIDEMIC_SHEDDING);
+            }
+        }
+        epidemic.step();
+
+        for (Organism* org : organisms) {
+            // 休眠的生物不与外界接触
+            if (org->hasDisease() || org->is_dead() || org->is_sleeping()) continue;
+            double contact = epidemic.sample(org->getX(), org->getY()) * EPIDEMIC_TRANSMISSION;
+            if (contact > 0 && (double)rand() / RAND_MAX < contact) {
+                org->contract_disease(env.disease);
+            }
+        }
+    }
+
+    // 处理环境灾难
+    void apply_disaster(int disaster_type) {
+        if (disaster_type >= 0) {
+            if (journal) journal->record(EVENT_DISASTER, 0, 0, disaster_type);
+            int casualties = static_cast<int>(organisms.size()) / 5;
+
+            switch (disaster_type) {
+            case 0: // 火灾
+                for (int i = 0; i < casualties; i++) {
+                    int index = rand() % static_cast<int>(organisms.size());
+                    if (dynamic_cast<Plant*>(organisms[index]) ||
+                        dynamic_cast<Tree*>(organisms[index])) {
+                        discard_organism(index);
+                    }
+                }
+                env.pollution = min(1.0, env.pollution + 0.1);
+                break;
+
+            case 1: // 洪水
+                for (int i = 0; i < casualties; i++) {
+                    int index = rand() % static_cast<int>(organisms.size());
+                    if (!organisms[index]->getIsAquatic()) {
+                        discard_organism(index);
+                    }
+                }
+                env.pollution = min(1.0, env.pollution + 0.05);
+                // 洪水沿地形汇流，积在山谷和洼地里
+                water_routing.begin(terrain);
+                for (int y = 0; y < height; y++) {
+                    for (int x = 0; x < width; x++) {
+                        if (!terrain.is_generated(x, y)) {
+                            x |= TERRAIN_TILE_MASK; // 跳过尚未生成的分块
+                            continue;
+                        }
+                        water_routing.add_runoff(x, y, FLOOD_SURGE);
+                    }
+                }
+                water_routing.route(terrain);
+                for (int y = 0; y < height; y++) {
+                    for (int x = 0; x < width; x++) {
+                        if (!terrain.is_generated(x, y)) {
+                            x |= TERRAIN_TILE_MASK; // 跳过尚未生成的分块
+                            continue;
+                        }
+                        Terrain cell = terrain.at(x, y);
+                        cell.water_accumulation = min(1.0,
+                            cell.water_accumulation + water_routing.retained(x, y));
+                        terrain.set(x, y, cell);
+                    }
+                }
+                break;
+
+            case 2: // 瘟疫（疾病种类已在掷骰时确定），随机的少数个体成为最初的感染者
+                for (int i = 0; i < (organisms.empty() ? 0 : max(1, casualties / 20)); i++) {
+                    int index = rand() % static_cast<int>(organisms.size());
+                    if (!organisms[index]->is_sleeping()) {
+                        organisms[index]->contract_disease(env.disease);
+                    }
+                }
+                break;
+
+            case 3: // 火山喷发
+                for (int i = 0; i < casualties; i++) {
+                    int index = rand() % static_cast<int>(organisms.size());
+                    discard_organism(index);
+                }
+                env.pollution = min(1.0, env.pollution + 0.3);
+                // 增加火山地形
+                for (int i = 0; i < 10; i++) {
+                    int x = random_x();
+                    int y = random_y();
+                    if (terrain.is_generated(x, y) &&
+                        terrain[y][x].height > 0.8 && terrain[y][x].type != VOLCANIC) {
+                        terrain.mut(x, y).type = VOLCANIC;
+                    }
+                }
+                break;
+
+            case 4: // 干旱
+                env.weather = DROUGHT;
+                env.weather_duration = 10;
+                // 增加干旱程度
+                for (int y = 0; y < height; y++) {
+                    for (int x = 0; x < width; x++) {
+                        if (!terrain.is_generated(x, y)) {
+                            x |= TERRAIN_TILE_MASK; // 跳过尚未生成的分块
+                            continue;
+                        }
+                        Terrain cell = terrain.at(x, y);
+                        cell.drought_level = min(1.0,
+                            cell.drought_level + 0.2);
+                        terrain.set(x, y, cell);
+                    }
+                }
+                break;
+            }
+        }
+
+        // 处理疾病传播
+        if (env.disease != NONE) {
+            env.disease_duration--;
+            if (env.disease_duration <= 0) {
+                env.disease = NONE;
+                epidemic.clear();
+            }
+            else {
+                spread_epidemic();
+            }
+        }
+
+        // 污染自然减少
+        env.pollution = max(0.0, env.pollution - 0.005);
+
+        // 被修改过的地形自然恢复到原始状态
+        terrain.recover();
+    }
+
+    // ---- 计划干预 ----
+    // 环境参数、天气和灾难类型属于全局环境，在advance_environment中执行（多进程时由0号进程执行后广播）；
+    // 区域内的灾难影响、捕杀和引入在apply_environment中由各进程对本区域执行
+
+    // 执行今天的全局干预，返回强制发生的全世界灾难（-1表示没有）
+    int apply_global_interventions() {
+        int forced_disaster = -1;
+        for (const Intervention& intervention : interventions) {
+            if (intervention.day != day) continue;
+            switch (intervention.action) {
+            case INTERVENE_TEMPERATURE:
+                forced_temperature = intervention.value;
+                forced_temperature_until = day + intervention.days - 1;
+                break;
+            case INTERVENE_POLLUTION:
+                env.pollution = intervention.value;
+                break;
+            case INTERVENE_DISASTER_CHANCE:
+                env.disaster_chance = intervention.value;
+                break;
+            case INTERVENE_WEATHER:
+                env.weather = static_cast<WeatherType>(intervention.kind);
+                env.weather_duration = intervention.days + 1; // update_weather随后减去今天
+                break;
+            case INTERVENE_DISASTER:
+                notify("\n!!! 计划干预：环境灾难 !!!\n");
+                announce_disaster(intervention.kind);
+                if (!intervention.has_region()) forced_disaster = intervention.kind;
+                break;
+            default:
+                break;
+            }
+        }
+        if (day <= forced_temperature_until) env.temperature = forced_temperature;
+        return forced_disaster;
+    }
+
+    // 执行今天在本区域内的干预
+    void apply_local_interventions() {
+        for (const Intervention& intervention : interventions) {
+            if (intervention.day != day) continue;
+            int x0 = intervention.x0, y0 = intervention.y0, x1 = intervention.x1, y1 = intervention.y1;
+            if (!intervention.has_region()) {
+                x0 = 0;
+                y0 = 0;
+                x1 = width;
+                y1 = height;
+            }
+            if (intervention.action == INTERVENE_INTRODUCE) {
+                introduce_organisms(intervention);
+            }
+            else if (!clip_to_domain(x0, y0, x1, y1)) {
+                continue; // 与本区域不相交
+            }
+            else if (intervention.action == INTERVENE_CULL) {
+                cull_organisms(intervention.species, intervention.value, x0, y0, x1, y1);
+            }
+            else if (intervention.action == INTERVENE_DISASTER && intervention.has_region()) {
+                apply_regional_disaster(intervention.kind, x0, y0, x1, y1);
+            }
+        }
+    }
+
+    // 把区域限制在世界和本进程区域之内，交集为空时返回false
+    bool clip_to_domain(int& x0, int& y0, int& x1, int& y1) const {
+        x0 = max(x0, domain_x0);
+        y0 = max(y0, domain_y0);
+        x1 = min(x1, domain_x1);
+        y1 = min(y1, domain_y1);
+        return x0 < x1 && y0 < y1;
+    }
+
+    // 按比例捕杀区域内的某个物种（关注区域之外按比例减少密度）
+    void cull_organisms(SpeciesType species, double fraction, int x0, int y0, int x1, int y1) {
+        size_t kept = 0;
+        for (size_t i = 0; i < organisms.size(); i++) {
+            Organism* org = organisms[i];
+            if (org->getSpecies() == species && !org->is_dead() &&
+                org->getX() >= x0 && org->getX() < x1 && org->getY() >= y0 && org->getY() < y1 &&
+                (double)rand() / RAND_MAX < fraction) {
+                note_death(org, DEATH_DISASTER);
+                sleepers.cancel(org);
+                delete org;
+                continue;
+            }
+            organisms[kept++] = org;
+        }
+        organisms.resize(kept);
+
+        density_field.scale(species, x0, y0, x1, y1, 1.0 - fraction);
+    }
+
+    // 在区域内引入某个物种，地形要求与初始放置相同
+    void introduce_organisms(const Intervention& intervention) {
+        SeedingRule rule = { intervention.species, intervention.count, 0,
+            intervention.x0, intervention.y0, intervention.x1, intervention.y1 };
+        for (const SeedingRule& initial : seeding) {
+            if (initial.species == intervention.species) rule.terrain_mask = initial.terrain_mask;
+        }
+        if (!rule.has_region()) {
+            rule.x0 = 0;
+            rule.y0 = 0;
+            rule.x1 = width;
+            rule.y1 = height;
+        }
+        int placed = place_organisms(rule);
+        for (size_t i = organisms.size() - placed; i < organisms.size(); i++) {
+            note_birth(organisms[i], 0);
+        }
+    }
+
+    // 只作用于区域内的灾难（与apply_disaster的各类灾难对应，污染加在区域内的地形上）
+    void apply_regional_disaster(int disaster_type, int x0, int y0, int x1, int y1) {
+        if (journal) journal->record(EVENT_DISASTER, 0, 0, disaster_type);
+        double pollution = disaster_type == 0 ? 0.1 : disaster_type == 1 ? 0.05 : disaster_type == 3 ? 0.3 : 0.0;
+
+        size_t kept = 0;
+        for (size_t i = 0; i < organisms.size(); i++) {
+            Organism* org = organisms[i];
+            bool lost = false;
+            if (org->getX() >= x0 && org->getX() < x1 && org->getY() >= y0 && org->getY() < y1) {
+                double roll = (double)rand() / RAND_MAX;
+                switch (disaster_type) {
+                case 0: lost = org->getSpecies() <= SPECIES_TREE && roll < 0.2; break; // 火灾
+                case 1: lost = !org->getIsAquatic() && roll < 0.2; break;             // 洪水
+                case 2:                                                               // 瘟疫
+                    if (!org->is_sleeping() && roll < 0.01) org->contract_disease(env.disease);
+                    break;
+                case 3: lost = roll < 0.2; break;                                     // 火山喷发
+                default: break;
+                }
+            }
+            if (lost) {
+                note_death(org, DEATH_DISASTER);
+                sleepers.cancel(org);
+                delete org;
+                continue;
+            }
+            organisms[kept++] = org;
+        }
+        organisms.resize(kept);
+
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                Terrain& cell = terrain.mut(x, y);
+                cell.pollution_level = min(1.0, cell.pollution_level + pollution);
+                if (disaster_type == 1) cell.water_accumulation = min(1.0, cell.water_accumulation + FLOOD_SURGE);
+                if (disaster_type == 3 && cell.height > 0.8 && rand() % 100 == 0) cell.type = VOLCANIC;
+                if (disaster_type == 4) cell.drought_level = min(1.0, cell.drought_level + 0.2);
+            }
+        }
+    }
+
+    // 本区域内的随机坐标
+    int random_x() const { return domain_x0 + rand() % (domain_x1 - domain_x0); }
+    int random_y() const { return domain_y0 + rand() % (domain_y1 - domain_y0); }
+
+    // 按本区域占世界的面积比例缩放初始数量
+    int scaled_count(int count) const {
+        long long area = static_cast<long long>(domain_x1 - domain_x0) * (domain_y1 - domain_y0);
+        return static_cast<int>(count * area / (static_cast<long long>(width) * height));
+    }
+
+    // ---- 细节层次（关注区域之外使用密度场） ----
+
+    // 按当前关注区域重新划分细节层次，并在个体和密度之间转换
+    void apply_focus() {
+        if (focus_areas.empty()) {
+            if (density_field.get_cells_x() == 0) return; // 未启用
+            // 关闭细节层次：整个世界都转换回个体
+            vector<FocusArea> whole_world(1, FocusArea{ 0, 0, width, height });
+            density_field.configure(terrain, whole_world);
+            materialize_density(true);
+            density_field = DensityField();
+            return;
+        }
+        density_field.configure(terrain, focus_areas);
+        materialize_density(true);
+        absorb_organisms();
+    }
+
+    // 将关注区域内的密度转换为个体
+    // whole为true时转换格子中的全部密度（随机取整），否则只转换当天扩散流入的整数部分
+    void materialize_density(bool whole) {
+        const DensityField& field = density_field; // 先只读，有密度时才写入（不为空格分配密度页）
+        int cells = density_field.get_cells_x() * density_field.get_cells_y();
+        for (int c = 0; c < cells; c++) {
+            if (!density_field.is_detailed(c)) continue;
+            int cx = (c % density_field.get_cells_x()) << DENSITY_CELL_SHIFT;
+            int cy = (c / density_field.get_cells_x()) << DENSITY_CELL_SHIFT;
+            for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+                int count;
+                if (whole) {
+                    double amount = field.inflow_at(sp, c) + field.at(sp, c);
+                    count = static_cast<int>(amount);
+                    if ((double)rand() / RAND_MAX < amount - count) count++;
+                    if (amount > 0) {
+                        density_field.inflow_at(sp, c) = 0.0;
+                        density_field.at(sp, c) = 0.0;
+                    }
+                }
+                else {
+                    count = static_cast<int>(field.inflow_at(sp, c));
+                    if (count > 0) density_field.inflow_at(sp, c) -= count;
+                    // 流入的植物不超过该格剩余的承载量，超出的部分不再生长（个体数取自前一天结束时的种群汇总表）
+                    if (count > 0 && DENSITY_TRAITS[sp].plant) {
+                        bool aquatic = DENSITY_TRAITS[sp].aquatic;
+                        unsigned int present = population_tables.count(aquatic ? SPECIES_AQUATIC_PLANT : SPECIES_PLANT,
+                            aquatic ? SPECIES_AQUATIC_PLANT : SPECIES_TREE, cx, cy, cx + DENSITY_CELL_SIZE, cy + DENSITY_CELL_SIZE);
+                        double room = density_field.plant_capacity(sp, c) - present;
+                        count = max(0, min(count, static_cast<int>(room)));
+                    }
+                }
+
+                for (int i = 0; i < count; i++) {
+                    // 在密度格内随机寻找可栖息的位置
+                    for (int attempt = 0; attempt < 8; attempt++) {
+                        int x = cx + rand() % DENSITY_CELL_SIZE;
+                        int y = cy + rand() % DENSITY_CELL_SIZE;
+                        if (x >= width || y >= height) continue;
+                        Organism* org = create_organism(static_cast<SpeciesType>(sp), x, y);
+                        if (org->canInhabit(terrain[y][x].type)) {
+                            organisms.push_back(org);
+                            population.add(sp, x, y);
+                            if (journal) journal->record(EVENT_BIRTH, org->getId(), 0, sp, x, y);
+                            break;
+                        }
+                        delete org;
+                    }
+                }
+            }
+        }
+    }
+
+    // 离开关注区域的个体并入所在密度格
+    void absorb_organisms() {
+        auto it = remove_if(organisms.begin(), organisms.end(),
+            [this](Organism* org) {
+                int cell = density_field.cell_of(org->getX(), org->getY());
+                if (density_field.is_detailed(cell)) {
+                    return false;
+                }
+                density_field.at(org->getSpecies(), cell) += 1.0;
+                population.remove(org->getSpecies(), org->getX(), org->getY());
+                if (journal) journal->record(EVENT_DEPARTURE, org->getId(), 0, 1);
+                sleepers.cancel(org);
+                delete org;
+                return true;
+            });
+        organisms.erase(it, organisms.end());
+    }
+
+    // 删除指定位置的生物
+    void discard_organism(int index) {
+        note_death(organisms[index], DEATH_DISASTER);
+        sleepers.cancel(organisms[index]);
+        delete organisms[index];
+        organisms.erase(organisms.begin() + index);
+    }
+
+    // 唤醒今天到期或被天气触发的休眠生物，并结算其休眠期间跳过的天数
+    void wake_sleepers() {
+        if (temperature_history.size() <= static_cast<size_t>(day)) {
+            temperature_history.resize(day + 1);
+        }
+        temperature_history[day] = env.temperature;
+
+        // 升温和降雨按生物所在位置的局地天气判断，与决定休眠的can_sleep一致
+        auto warm = [this](Organism* org, double wake_temperature) {
+            double rainfall, temperature;
+            weather.local_weather(env, org->getX(), org->getY(), rainfall, temperature);
+            return wake_temperature < temperature;
+        };
+        auto rain = [this](Organism* org) {
+            double rainfall, temperature;
+            WeatherType local = weather.local_weather(env, org->getX(), org->getY(), rainfall, temperature);
+            return local == RAINY || local == STORMY;
+        };
+        vector<pair<Organism*, int>> woken;
+        sleepers.collect_due(day, weather.peak_temperature(env), weather.may_rain(env), warm, rain, woken);
+        for (const pair<Organism*, int>& entry : woken) {
+            int since = entry.second;
+            entry.first->settle_sleep(&temperature_history[since + 1], day - since - 1);
+        }
+    }
+
+    // 休眠中的生物能量被改变（被部分取食、寄生、其他区域的伤害）后，原定的唤醒日已不可信：
+    // 结算到今天为止跳过的天数，再按当前能量重新登记，不再满足休眠条件时保持清醒
+    void replan_sleep(Organism* org) {
+        if (!org->is_sleeping()) return;
+        int since = org->getSleepHandle().since;
+        sleepers.cancel(org);
+        org->settle_sleep(temperature_history.data() + since + 1, day - since);
+        if (org->is_dead()) return;
+
+        Environment local;
+        weather.local_environment(env, org->getX(), org->getY(), local);
+        SleepPlan plan;
+        if (org->can_sleep(local, plan)) {
+            sleepers.schedule(org, day, plan);
+        }
+    }
+
+    // 死因：当天被取食致死、衰老、患病，否则为能量耗尽
+    int death_cause(const Organism* org) const {
+        if (killed.count(org->getId())) return DEATH_PREDATION;
+        if (org->reached_max_age()) return DEATH_AGE;
+        if (org->hasDisease()) return DEATH_DISEASE;
+        return DEATH_STARVATION;
+    }
+
+    // 移除死亡的生物
+    void remove_dead_organisms() {
+        auto it = remove_if(organisms.begin(), organisms.end(),
+            [this](Organism* org) {
+                if (org->is_dead()) {
+                    note_death(org, death_cause(org));
+                    sleepers.cancel(org);
+                    delete org;
+                    return true;
+                }
+                return false;
+            });
+        organisms.erase(it, organisms.end());
+    }
+
+    // 寄生关系处理
+    void handle_parasites() {
+        for (Organism* org : organisms) {
+            // 寄生生物寻找宿主
+            if (Parasite* parasite = dynamic_cast<Parasite*>(org)) {
+                bool found_host = false;
+                for (Organism* host : organisms) {
+                    if (host != parasite && !dynamic_cast<Parasite*>(host) && !host->is_dead()) {
+                        int dx = abs(parasite->getX() - host->getX());
+                        int dy = abs(parasite->getY() - host->getY());
+                        if (dx <= 1 && dy <= 1) {
+                            // 移动到宿主位置
+                            parasite->lose_energy(0.05); // 移动消耗能量
+                            parasite->gain_energy(0.1);  // 找到宿主获得能量
+                            found_host = true;
+                            break;
+                        }
+                    }
+                }
+
+                // 没找到宿主会死亡
+                if (!found_host) {
+                    parasite->lose_energy(0.5);
+                }
+                replan_sleep(parasite);
+            }
+        }
+    }
+
+public:
+    explicit World(const WorldConfig& config = WorldConfig())
+        : width(config.width), height(config.height),
+        seed(config.seed != 0 ? config.seed : static_cast<unsigned int>(time(0))),
+        owns_generation(true), day(0), season(0), viewport_x(0), viewport_y(0),
+        viewport_width(min(40, config.width)), viewport_height(min(20, config.height)),
+        max_days(config.max_days), selected_x(-1), selected_y(-1), show_history(false),
+        record_history(config.ranks == 1 && config.bench_path.empty()), view_day(-1),
+
+        domain_x0(config.domain_x0), domain_y0(config.domain_y0),
+        domain_x1(config.domain_x1 < 0 ? config.width : config.domain_x1),
+        domain_y1(config.domain_y1 < 0 ? config.height : config.domain_y1), rank(config.rank),
+        worker_threads(config.threads > 0 ? config.threads : max(1, static_cast<int>(thread::hardware_concurrency()))),
+        workers(worker_threads),
+        memory_budget(static_cast<size_t>(config.memory_budget)), over_budget_warned(false), hold_messages(false) {
+        srand(seed + rank * 7919); // 各进程使用不同的随机数序列，地形仍由同一种子生成
+        focus_areas = config.focus_areas;
+        seeding = config.seeding;
+        interventions = config.interventions;
+        forced_temperature = 0.0;
+        forced_temperature_until = 0;
+        epidemic.configure(domain_x0, domain_y0, domain_x1, domain_y1);
+        seed_bank.reset(width, height);
+        weather.configure(width, height, config.weather_cell);
+        water_routing.reset(width, height);
+        zoom = 0;
+        population_tables.reset(domain_x0, domain_y0, domain_x1, domain_y1);
+        if (record_history) population.reset(width, height);
+        // 初始化地形
+        generate_terrain();
+        // 初始化随机生物
+        initialize_organisms();
+        open_journal(config);
+        open_results(config);
+        open_frames(config);
+        open_metrics(config);
+        if (!config.bench_path.empty()) phase_counters.reset(new PhaseCounters());
+        open_profile(config);
+        history.reset(width, height);
+        if (record_history) record_day();
+    }
+
+    // 基于共享的原始地图创建世界（集合模拟/分支实验）
+    // 地形分块在各世界间共享，只有被修改的分块才会复制
+    // （世界尺寸取自共享地图，配置中的尺寸被忽略）
+    explicit World(const TerrainMap& shared_terrain, const WorldConfig& config = WorldConfig())
+        : width(shared_terrain.get_width()), height(shared_terrain.get_height()),
+        seed(config.seed != 0 ? config.seed : static_cast<unsigned int>(time(0))),
+        terrain(shared_terrain), pristine_terrain(shared_terrain),
+        owns_generation(false), day(0), season(0), viewport_x(0), viewport_y(0),
+        viewport_width(min(40, shared_terrain.get_width())), viewport_height(min(20, shared_terrain.get_height())),
+        max_days(config.max_days), selected_x(-1), selected_y(-1), show_history(false),
+        record_history(config.ranks == 1 && config.bench_path.empty()), view_day(-1),
+
+        domain_x0(config.domain_x0), domain_y0(config.domain_y0),
+        domain_x1(config.domain_x1 < 0 ? shared_terrain.get_width() : config.domain_x1),
+        domain_y1(config.domain_y1 < 0 ? shared_terrain.get_height() : config.domain_y1), rank(config.rank),
+        worker_threads(config.threads > 0 ? config.threads : max(1, static_cast<int>(thread::hardware_concurrency()))),
+        workers(worker_threads),
+        memory_budget(static_cast<size_t>(config.memory_budget)), over_budget_warned(false), hold_messages(false) {
+        srand(seed + rank * 7919);
+        focus_areas = config.focus_areas;
+        seeding = config.seeding;
+        interventions = config.interventions;
+        forced_temperature = 0.0;
+        forced_temperature_until = 0;
+        epidemic.configure(domain_x0, domain_y0, domain_x1, domain_y1);
+        seed_bank.reset(width, height);
+        weather.configure(width, height, config.weather_cell);
+        water_routing.reset(width, height);
+        zoom = 0;
+        population_tables.reset(domain_x0, domain_y0, domain_x1, domain_y1);
+        if (record_history) population.reset(width, height);
+        initialize_organisms();
+        open_journal(config);
+        open_results(config);
+        open_frames(config);
+        open_metrics(config);
+        if (!config.bench_path.empty()) phase_counters.reset(new PhaseCounters());
+        open_profile(config);
+        history.reset(width, height);
+        if (record_history) record_day();
+    }
+
+    ~World() {
+        if (journal) {
+            journal->flush(day);
+            journal->close();
+        }
+        if (profiler && !profile_path.empty()) write_profile();
+        if (frames) {
+            frames->close();
+            if (frames->get_failed() > 0) cout << "有" << frames->get_failed() << "个图像帧无法写入" << endl;
+        }
+        clear_organisms();
+    }
+
+    // 按配置开始统计物种开销
+    void open_profile(const WorldConfig& config) {
+        if (config.profile_path.empty()) return;
+        profile_path = config.profile_path;
+        if (config.ranks > 1 && profile_path != "-") profile_path += ".rank" + to_string(rank);
+        profiler.reset(new SpeciesProfiler());
+    }
+
+    // 把物种开销报告写入配置的文件
+    void write_profile() {
+        if (profile_path == "-") {
+            profiler->write_report(cout);
+            return;
+        }
+        ofstream file(profile_path);
+        if (!file) {
+            cout << "无法创建物种开销报告: " << profile_path << endl;
+            return;
+        }
+        profiler->write_report(file);
+    }
+
+    // 当前的内存占用（地形和生物按实际分配统计，其余按各结构的容量计算）
+    MemoryFootprint memory_footprint() const {
+        MemoryFootprint footprint;
+        footprint.terrain = static_cast<size_t>(max(0LL, allocation_counters[MEMORY_TERRAIN].bytes.load()));
+        footprint.organisms = static_cast<size_t>(max(0LL, allocation_counters[MEMORY_ORGANISMS].bytes.load())) +
+            organisms.capacity() * sizeof(Organism*);
+        footprint.indices = sleepers.memory_bytes() + seed_bank.memory_bytes() + density_field.memory_bytes() +
+            hydrology_weather.capacity() + hydrology_temperature.capacity() * sizeof(float) +
+            epidemic.memory_bytes() + weather.memory_bytes() + water_routing.memory_bytes() + population.memory_bytes() +
+            population_tables.memory_bytes();
+        footprint.history = record_history ? history.memory_bytes() : 0;
+        return footprint;
+    }
+
+    // 预估运行中不能缩减部分的内存峰值：本区域的地形分块和种子库分块都被使用，生物数量增长到初始的数倍
+    // 被修改的地形分块会在原始分块之外再复制一份，所以每个分块按原始和副本两份计算
+    // （历史记录不计入，超出预算时由历史让出）
+    MemoryFootprint projected_memory() const {
+        size_t tiles = static_cast<size_t>(((domain_x1 - 1) >> TERRAIN_TILE_SHIFT) - (domain_x0 >> TERRAIN_TILE_SHIFT) + 1) *
+            static_cast<size_t>(((domain_y1 - 1) >> TERRAIN_TILE_SHIFT) - (domain_y0 >> TERRAIN_TILE_SHIFT) + 1);
+        MemoryFootprint current = memory_footprint();
+        MemoryFootprint projected;
+        projected.terrain = max(current.terrain, 2 * tiles * sizeof(TerrainTile));
+        projected.organisms = static_cast<size_t>(current.organisms * MEMORY_POPULATION_HEADROOM);
+        size_t cells = static_cast<size_t>(width) * height;
+        projected.indices = current.indices - seed_bank.memory_bytes() + tiles * sizeof(SeedTile) -
+            hydrology_weather.capacity() - hydrology_temperature.capacity() * sizeof(float) + cells * (1 + sizeof(float));
+        return projected;
+    }
+
+    // 按预算检查预估的内存，超出时说明原因并返回false（未设预算时总是通过）
+    bool check_memory_budget() const {
+        if (memory_budget == 0) return true;
+        MemoryFootprint projected = projected_memory();
+        if (projected.total() <= memory_budget) return true;
+        const size_t mb = 1024 * 1024;
+        cout << "预计内存" << projected.total() / mb << "MB超过预算" << memory_budget / mb << "MB（地形"
+            << projected.terrain / mb << "MB，生物" << projected.organisms / mb << "MB，索引和场" << projected.indices / mb
+            << "MB），请减小世界尺寸或提高预算" << endl;
+        return false;
+    }
+
+    // 超出内存预算时先丢弃最早的历史，历史无法再缩减时停止记录历史
+    void enforce_memory_budget() {
+        MemoryFootprint footprint = memory_footprint();
+        if (footprint.total() <= memory_budget) return;
+        if (record_history) {
+            bool trimmed = false;
+            while (footprint.total() > memory_budget && history.drop_oldest_keyframe()) {
+                footprint.history = history.memory_bytes();
+                trimmed = true;
+            }
+            if (footprint.total() <= memory_budget) {
+                if (trimmed) notify("内存接近预算，历史记录只保留第" + to_string(history.get_first_day()) + "天之后\n");
+                return;
+            }
+            record_history = false;
+            history.reset(width, height);
+            view_day = -1;
+            footprint.history = 0;
+            notify("内存超出预算，已停止记录历史\n");
+            if (footprint.total() <= memory_budget) return;
+        }
+        if (!over_budget_warned) {
+            over_budget_warned = true;
+            notify("警告: 内存" + to_string(footprint.total() / (1024 * 1024)) + "MB超出预算" +
+                to_string(memory_budget / (1024 * 1024)) + "MB，已无可缩减的历史记录\n");
+        }
+    }
+
+    // 输出内存占用、各子系统的分配计数和常驻内存
+    void write_memory_report(ostream& out) const {
+        const double mb = 1024.0 * 1024.0;
+        MemoryFootprint footprint = memory_footprint();
+        out << fixed << setprecision(1)
+            << "memory  terrain " << footprint.terrain / mb << " MB  organisms " << footprint.organisms / mb
+            << " MB  indices " << footprint.indices / mb << " MB  history " << footprint.history / mb
+            << " MB  total " << footprint.total() / mb << " MB  resident " << resident_memory_bytes() / mb << " MB";
+        if (memory_budget > 0) out << "  budget " << memory_budget / mb << " MB";
+        out << "\n";
+        out << left << setw(12) << "subsystem" << right << setw(14) << "allocations" << setw(14) << "frees"
+            << setw(12) << "live MB" << setw(12) << "peak MB" << "\n";
+        for (int m = 0; m < MEMORY_COUNT; m++) {
+            const AllocationCounter& counter = allocation_counters[m];
+            out << left << setw(12) << MEMORY_SUBSYSTEM_NAMES[m] << right << setw(14) << counter.allocations.load()
+                << setw(14) << counter.frees.load() << setw(12) << counter.bytes.load() / mb
+                << setw(12) << counter.peak_bytes.load() / mb << "\n";
+        }
+        out.unsetf(ios::floatfield);
+        out << setprecision(6);
+    }
+
+    // 模拟线程使用的物种开销统计表（未启用时为空）
+    ProfileTable* profile_table() {
+        return profiler ? profiler->table() : nullptr;
+    }
+
+    // 按配置打开事件日志，并写入初始种群作为第一个检查点
+    void open_journal(const WorldConfig& config) {
+        if (config.journal_path.empty()) return;
+        string path = config.journal_path;
+        if (config.ranks > 1) path += ".rank" + to_string(rank);
+        journal.reset(new EventJournal());
+        if (!journal->open(path, width, height, seed, rank)) {
+            cout << "无法创建日志文件: " << path << endl;
+            journal.reset();
+            return;
+        }
+        write_checkpoint();
+    }
+
+    // 按配置创建实时结果文件，并发布初始状态
+    void open_results(const WorldConfig& config) {
+        if (config.results_path.empty()) return;
+        string path = config.results_path;
+        if (config.ranks > 1) path += ".rank" + to_string(rank);
+        results.reset(new ResultsStore());
+        if (!results->open(path, width, height, seed, rank)) {
+            cout << "无法创建结果文件: " << path << endl;
+            results.reset();
+            return;
+        }
+        publish_results();
+    }
+
+    // 按配置开始导出图像帧，并导出第0天
+    void open_frames(const WorldConfig& config) {
+        if (config.frames_path.empty()) return;
+        string prefix = config.frames_path;
+        if (config.ranks > 1) prefix += ".rank" + to_string(rank);
+        frames.reset(new FrameExporter(prefix, config.frame_layers, config.frame_stride, config.frame_scale, config.frame_png));
+        export_frame();
+    }
+
+    // 复制导出一帧所需的数据，交给后台线程编码
+    void export_frame() {
+        unique_ptr<FrameSnapshot> frame(new FrameSnapshot());
+        frame->day = day;
+        frame->x0 = domain_x0;
+        frame->y0 = domain_y0;
+        frame->x1 = domain_x1;
+        frame->y1 = domain_y1;
+        if (frames->wants_terrain()) frame->terrain = terrain;
+        frame->density_cells_x = frame->density_cells_y = 0;
+        if (frames->wants_population()) {
+            frame->population = population_tables;
+            frame->density_cells_x = density_field.get_cells_x();
+            frame->density_cells_y = density_field.get_cells_y();
+            int cells = frame->density_cells_x * frame->density_cells_y;
+            frame->density.resize(static_cast<size_t>(cells) * SPECIES_COUNT);
+            const DensityField& field = density_field; // 只读，不分配密度页
+            for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+                for (int c = 0; c < cells; c++) {
+                    frame->density[static_cast<size_t>(sp) * cells + c] = static_cast<float>(field.at(sp, c));
+                }
+            }
+        }
+        frames->submit(move(frame));
+    }
+
+    // 按配置启动指标导出，并发布初始状态
+    void open_metrics(const WorldConfig& config) {
+        clear_day_metrics();
+        if (config.metrics_port == 0) return;
+        int port = config.metrics_port + (config.ranks > 1 ? rank : 0);
+        metrics_exporter.reset(new MetricsExporter(metrics, rank));
+        if (!metrics_exporter->start(port)) {
+            cout << "无法在端口" << port << "上导出指标" << endl;
+            metrics_exporter.reset();
+            return;
+        }
+        publish_metrics();
+    }
+
+    // 开始新一天的计时和出生、死亡计数
+    void clear_day_metrics() {
+        fill(phase_elapsed, phase_elapsed + PHASE_COUNT, 0LL);
+        births_today = 0;
+        fill(deaths_today, deaths_today + DEATH_CAUSE_COUNT, 0LL);
+        day_started = chrono::steady_clock::now();
+    }
+
+    // 把当天的计时、计数和各存储的占用写入运行指标
+    void publish_metrics() {
+        metrics.day = day;
+        metrics.last_day_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - day_started).count();
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            metrics.phase_ns[p] = phase_elapsed[p];
+            metrics.phase_total_ns[p] += phase_elapsed[p];
+        }
+        long long population[SPECIES_COUNT] = {};
+        for (const Organism* org : organisms) {
+            population[org->getSpecies()]++;
+        }
+        for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+            metrics.organisms[sp] = population[sp];
+        }
+        metrics.births_last_day = births_today;
+        metrics.births_total += births_today;
+        for (int c = 0; c < DEATH_CAUSE_COUNT; c++) {
+            metrics.deaths_last_day[c] = deaths_today[c];
+            metrics.deaths_total[c] += deaths_today[c];
+        }
+        metrics.pool_used[POOL_TERRAIN_TILES] = static_cast<long long>(terrain.generated_tile_count());
+        metrics.pool_capacity[POOL_TERRAIN_TILES] = static_cast<long long>(terrain.tile_count());
+        metrics.tiles_owned = static_cast<long long>(terrain.owned_tile_count());
+        metrics.sleeping = static_cast<long long>(sleepers.size());
+        metrics.seeded_cells = seed_bank.seeded_cells();
+    }
+
+    // 出生和死亡：计入当天的指标并写入日志
+    void note_birth(const Organism* org, unsigned long long parent) {
+        births_today++;
+        population.add(org->getSpecies(), org->getX(), org->getY());
+        if (journal) journal->record(EVENT_BIRTH, org->getId(), parent, org->getSpecies(), org->getX(), org->getY());
+    }
+    void note_death(const Organism* org, int cause) {
+        deaths_today[cause]++;
+        population.remove(org->getSpecies(), org->getX(), org->getY());
+        if (journal) journal->record(EVENT_DEATH, org->getId(), 0, cause);
+    }
+
+    // 把当天结束时的汇总数据和密度栅格追加到结果文件
+    void publish_results() {
+        unsigned short* plants;
+        unsigned short* animals;
+        ResultsDay* record = results->begin_record(plants, animals);
+        if (!record) return;
+        record->day = day;
+        for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+            record->population[sp] = static_cast<int>(population_tables.total(sp));
+        }
+        record->infected = static_cast<int>(population_tables.get_infected());
+        record->sleeping = static_cast<int>(population_tables.get_sleeping());
+        // 栅格格(rx, ry)包含 x*RESULTS_RASTER_SIZE/width 取整后等于rx的格子，即[ceil(rx*width/N), ceil((rx+1)*width/N))
+        auto raster_edge = [](int index, int size) {
+            return static_cast<int>((static_cast<long long>(index) * size + RESULTS_RASTER_SIZE - 1) / RESULTS_RASTER_SIZE);
+        };
+        for (int ry = 0; ry < RESULTS_RASTER_SIZE; ry++) {
+            int qy0 = raster_edge(ry, height), qy1 = raster_edge(ry + 1, height);
+            for (int rx = 0; rx < RESULTS_RASTER_SIZE; rx++) {
+                int qx0 = raster_edge(rx, width), qx1 = raster_edge(rx + 1, width);
+                int cell = ry * RESULTS_RASTER_SIZE + rx;
+                plants[cell] = static_cast<unsigned short>(min(0xffffu,
+                    population_tables.count(SPECIES_PLANT, SPECIES_AQUATIC_PLANT, qx0, qy0, qx1, qy1)));
+                animals[cell] = static_cast<unsigned short>(min(0xffffu,
+                    population_tables.count(SPECIES_AQUATIC_PLANT + 1, SPECIES_COUNT - 1, qx0, qy0, qx1, qy1)));
+            }
+        }
+        record->density_population = density_field.total();
+        record->temperature = env.temperature;
+        record->rainfall = env.rainfall;
+        record->pollution = env.pollution;
+        record->weather = env.weather;
+        record->disease = env.disease;
+        record->seeds = seed_bank.seed_count();
+        results->commit_record(record);
+    }
+
+    // 把当前的全部生物写入日志检查点
+    void write_checkpoint() {
+        vector<OrganismRecord> records(organisms.size());
+        for (size_t i = 0; i < organisms.size(); i++) {
+            organisms[i]->save_record(records[i]);
+        }
+        journal->checkpoint(day, records);
+    }
+
+    // 清空所有生物
+    void clear_organisms() {
+        sleepers.clear();
+        for (Organism* org : organisms) {
+            delete org;
+        }
+        organisms.clear();
+        population.clear();
+    }
+
+    // 初始化生物种群
+    void initialize_organisms() {
+        clear_organisms();
+
+        // 按放置规则的顺序逐个物种随机放置
+        for (const SeedingRule& rule : seeding) {
+            place_organisms(rule);
+        }
+        for (const Organism* org : organisms) {
+            population.add(org->getSpecies(), org->getX(), org->getY());
+        }
+
+        // 关注区域之外的生物转换为密度
+        density_field = DensityField();
+        apply_focus();
+        rebuild_population_tables();
+    }
+
+    // 重建种群汇总表：按块排序个体后，行和列的前缀和按物种分给多个线程
+    void rebuild_population_tables() {
+        population_tables.bin(organisms);
+        parallel_for(workers, population_tables.page_tasks(),
+            [this](size_t begin, size_t end) { population_tables.sum_pages(begin, end); });
+    }
+
+    // 按放置规则在本区域内随机放置生物，返回放置的数量（新生物追加在organisms末尾）
+    int place_organisms(const SeedingRule& rule) {
+        int x0 = domain_x0, y0 = domain_y0, x1 = domain_x1, y1 = domain_y1;
+        int count = scaled_count(rule.count);
+        if (rule.has_region()) {
+            // 只在放置区域与本区域的交集内放置，数量按交集占放置区域的比例缩放
+            int rx0 = max(0, rule.x0), ry0 = max(0, rule.y0);
+            int rx1 = min(width, rule.x1), ry1 = min(height, rule.y1);
+            x0 = rx0;
+            y0 = ry0;
+            x1 = rx1;
+            y1 = ry1;
+            if (!clip_to_domain(x0, y0, x1, y1)) return 0;
+            long long region_area = static_cast<long long>(rx1 - rx0) * (ry1 - ry0);
+            count = static_cast<int>(rule.count * (static_cast<long long>(x1 - x0) * (y1 - y0)) / region_area);
+        }
+        int placed = 0;
+        for (int i = 0; i < count; i++) {
+            int x = x0 + rand() % (x1 - x0);
+            int y = y0 + rand() % (y1 - y0);
+            // 只读取地形而不生成分块：分块在放置了生物后由生物按需生成
+            if (can_place_organism(x, y) &&
+                (rule.terrain_mask == 0 || (rule.terrain_mask & (1u << terrain.peek(x, y).type)) != 0)) {
+                organisms.push_back(create_organism(rule.species, x, y));
+                placed++;
+            }
+        }
+        return placed;
+    }
+
+    // 检查位置是否可以放置生物
+    bool can_place_organism(int x, int y) {
+        if (x < 0 || y < 0 || x >= width || y >= height)
+            return false;
+
+        // 检查地形是否适合
+        for (Organism* org : organisms) {
+            if (org->getX() == x && org->getY() == y) {
+                return false; // 位置已被占用
+            }
+        }
+
+        return true;
+    }
+
+    // 重置世界
+    void reset() {
+        if (journal) journal->flush(day);
+        day = 0;
+        season = 0;
+        env = Environment();
+        forced_temperature_until = 0;
+        if (owns_generation) {
+            generate_terrain();
+        }
+        else {
+            terrain = pristine_terrain; // 恢复为共享的原始地图
+        }
+        water_routing.reset(width, height); // 地形已恢复，流向需要重新建立
+        initialize_organisms();
+        if (journal) write_checkpoint(); // 日志中从新的第0天检查点开始新的一次运行
+        history.reset(width, height);
+        view_day = -1;
+        if (record_history) record_day();
+        selected_x = -1;
+        selected_y = -1;
+        show_history = false;
+    }
+
+    // 模拟一天的变化
+    // 单进程时依次执行各阶段；多进程运行时由区域驱动在阶段之间交换边界数据
+    void simulate_day() {
+        if (day >= max_days) return; // 达到最大天数
+        view_day = -1; // 回到当前状态
+
+        begin_day();
+        int disaster_type = advance_environment();
+        apply_environment(disaster_type);
+        run_organisms();
+        update_level_of_detail();
+        end_day();
+    }
+
+    // 开始新的一天
+    void begin_day() {
+        // 前一天的事件交给日志，并定期写入检查点
+        if (journal) {
+            journal->flush(day);
+            if (day > 0 && day % JOURNAL_CHECKPOINT_DAYS == 0) write_checkpoint();
+        }
+        killed.clear();
+        clear_day_metrics();
+        day++;
+
+        // 保存前一天状态（休眠中的生物保持休眠前的状态）
+        for (Organism* org : organisms) {
+            if (!org->is_sleeping()) {
+                org->save_previous_state("存活");
+            }
+        }
+    }
+
+    // 推进全局环境（季节、天气、灾难掷骰），返回当天的灾难类型（-1表示没有）
+    // 多进程运行时只由0号进程执行，结果广播给其他进程
+    int advance_environment() {
+        PhaseTimer timer(phase_elapsed, phase_counters.get(), PHASE_ENVIRONMENT);
+
+        // 更新季节
+        update_season();
+
+        // 计划干预（在天气更新之前，设定的天气从今天开始持续）
+        int forced_disaster = apply_global_interventions();
+
+        // 更新天气
+        update_weather();
+
+        int disaster_type = roll_disaster();
+        return forced_disaster >= 0 ? forced_disaster : disaster_type;
+    }
+
+    // 将当天的环境作用到本区域的地形和生物上
+    void apply_environment(int disaster_type) {
+        PhaseTimer timer(phase_elapsed, phase_counters.get(), PHASE_TERRAIN);
+
+        // 推进天气场
+        weather.step(env, seed, day);
+
+        // 更新地形水文
+        update_terrain_hydrology();
+
+        // 计划干预
+        apply_local_interventions();
+
+        // 环境灾难
+        apply_disaster(disaster_type);
+    }
+
+    // 生物一天的各个阶段，T为生物的实际类型（直接调用T的实现，不经过虚函数表）
+    // local为生物所在位置的局地环境
+    template <class T>
+    void move_organism(T* org, Environment& local) {
+        ProfileTable* table = profile_table();
+
+        // 天气影响
+        ProfileTable::measure(table, T::SPECIES, BEHAVIOUR_WEATHER,
+            [&] { org->T::weather_effect(local, terrain[org->getY()][org->getX()]); });
+
+        int old_x = org->getX(), old_y = org->getY();
+        ProfileTable::measure(table, T::SPECIES, BEHAVIOUR_MOVE, [&] { org->T::move(terrain, local); });
+        if (population.enabled() && (org->getX() != old_x || org->getY() != old_y)) {
+            population.relocate(T::SPECIES, old_x, old_y, org->getX(), org->getY());
+        }
+        // 进食收集阶段多线程只读地形，先生成所在的分块
+        terrain.ensure_generated(org->getX(), org->getY(), org->getX(), org->getY());
+    }
+
+    // table为当前工作线程的物种开销统计表（未启用时为空）
+    template <class T>
+    void forage_organism(T* org, Environment& local, const vector<Organism*>& visible, FeedingIntent& intent,
+        ProfileTable* table) {
+        ProfileTable::measure(table, T::SPECIES, BEHAVIOUR_EAT, [&] { org->T::forage(local, visible, terrain, intent); });
+    }
+
+    template <class T>
+    void eat_organism(T* org, Environment& local, const FeedingIntent& intent, bool fed) {
+        ProfileTable::measure(profile_table(), T::SPECIES, BEHAVIOUR_EAT, [&] { org->T::eat(local, terrain, intent, fed); });
+    }
+
+    template <class T>
+    void finish_organism(T* org, Environment& local, vector<Organism*>& visible, vector<Organism*>& new_organisms) {
+        ProfileTable* table = profile_table();
+        ProfileTable::measure(table, T::SPECIES, BEHAVIOUR_AGE, [&] {
+            if (traits_overridden) org->template age_organism<T, true>(local);
+            else org->template age_organism<T, false>(local);
+        });
+
+        // 繁殖（在世界边缘出生的后代限制在世界范围内）
+        Organism* child = nullptr;
+        ProfileTable::measure(table, T::SPECIES, BEHAVIOUR_REPRODUCE, [&] { child = org->T::reproduce(visible); });
+        if (child) {
+            child->setPosition(max(0, min(width - 1, child->getX())), max(0, min(height - 1, child->getY())));
+            note_birth(child, org->getId());
+            new_organisms.push_back(child);
+        }
+        release_seeds(org, is_base_of<Plant, T>());
+
+        // 冬眠的动物和寒冷中的种子进入休眠，直到唤醒日或天气变化
+        SleepPlan plan;
+        if (!org->is_dead() && org->T::can_sleep(local, plan)) {
+            sleepers.schedule(org, day, plan);
+        }
+    }
+
+    // 植物释放的种子放入种子库（落到本区域之外的种子丢弃）
+    template <class T>
+    void release_seeds(T* plant, true_type) {
+        SeedDrop drops[PLANT_MAX_SEEDS];
+        int count = plant->T::release_seeds(terrain, drops);
+        for (int i = 0; i < count; i++) {
+            if (in_domain(drops[i].x, drops[i].y)) {
+                seed_bank.deposit(T::SPECIES, drops[i]);
+            }
+        }
+    }
+    template <class T>
+    void release_seeds(T*, false_type) {} // 动物没有种子
+
+    // 种子萌发：每天处理一遍种子库，温暖时没有植物的格子按肥沃度和水分萌发一株，种子逐渐失去活力
+    void germinate_seeds() {
+        seed_bank.clear_occupancy();
+        for (Organism* org : organisms) {
+            if (org->getSpecies() <= SPECIES_AQUATIC_PLANT && !org->is_dead()) {
+                seed_bank.mark_occupied(org->getX(), org->getY());
+            }
+        }
+
+        bool warm = env.temperature > SEED_GERMINATION_TEMP;
+        double rain = env.rainfall / 100.0;
+        seed_bank.for_each_seeded([&](int x, int y, SeedCell& cell) {
+            cell.count *= 1.0f - SEED_DECAY;
+            if (!warm || cell.occupied) return;
+
+            const Terrain& ground = terrain[y][x];
+            SpeciesType species = static_cast<SpeciesType>(cell.species);
+            bool suitable = species == SPECIES_TREE ? Tree::can_grow_on(ground.type) :
+                species == SPECIES_AQUATIC_PLANT ? AquaticPlant::can_grow_on(ground.type) :
+                Plant::can_grow_on(ground.type);
+            if (!suitable) return;
+
+            double water = min(1.0, ground.water_level / plant_traits_table()[species].water_need + rain);
+            // 不足一粒的部分按比例降低萌发概率（数量表示平均仍有活力的种子数）
+            double chance = SEED_GERMINATION_RATE * ground.fertility * water * min(1.0f, cell.count);
+            if ((double)rand() / RAND_MAX >= chance) return;
+
+            Plant* plant = static_cast<Plant*>(create_organism(species, x, y));
+            plant->set_genotype(cell.growth_rate, cell.drought_resistance);
+            organisms.push_back(plant);
+            note_birth(plant, 0);
+            cell.count = max(0.0f, cell.count - 1.0f);
+            cell.occupied = 1;
+        });
+    }
+
+    // 按种子、日期和编号生成的[0,1)随机数，与生物的更新顺序和线程划分无关
+    double feeding_roll(unsigned long long id, int salt) const {
+        return hash_coords(seed ^ (static_cast<unsigned int>(day) * 0x9e3779b9U),
+            static_cast<int>(id), static_cast<int>(id >> 32), salt) / 4294967296.0;
+    }
+
+    // 进食：先并行收集所有生物的进食意图，再统一裁决冲突并结算
+    // 同一取食对象被多个生物独占取食时，能量最低（最饥饿）者获胜，相同时按种子决定；
+    // 当天被吃掉的生物自己不再进食。结果与线程数无关，
+    // 但各生物按可见列表的顺序选取第一个合适的取食对象，所以仍与列表顺序有关
+    void feed_organisms(const vector<Organism*>& active, vector<Environment>& local,
+        const vector<Organism*>& visible) {
+        vector<FeedingIntent> intents(active.size());
+        parallel_for(workers, active.size(), [&](size_t begin, size_t end) {
+            unique_ptr<ProfileTable> table(profiler ? new ProfileTable() : nullptr);
+            for (size_t i = begin; i < end; i++) {
+                intents[i].roll = feeding_roll(active[i]->getId(), 0);
+                dispatch_species(active[i], [&](auto* org) { forage_organism(org, local[i], visible, intents[i], table.get()); });
+            }
+            if (table) profiler->merge(*table);
+        });
+
+        // 按取食对象分组，组内按饥饿程度和随机数排序
+        vector<size_t> claims;
+        for (size_t i = 0; i < active.size(); i++) {
+            if (intents[i].target && intents[i].exclusive) {
+                claims.push_back(i);
+            }
+        }
+        vector<double> tie_break(active.size());
+        for (size_t i : claims) {
+            tie_break[i] = feeding_roll(active[i]->getId() ^ intents[i].target->getId(), 1);
+        }
+        sort(claims.begin(), claims.end(), [&](size_t a, size_t b) {
+            unsigned long long ta = intents[a].target->getId(), tb = intents[b].target->getId();
+            if (ta != tb) return ta < tb;
+            if (active[a]->getEnergy() != active[b]->getEnergy()) {
+                return active[a]->getEnergy() < active[b]->getEnergy();
+            }
+            if (tie_break[a] != tie_break[b]) return tie_break[a] < tie_break[b];
+            return active[a]->getId() < active[b]->getId();
+        });
+
+        vector<char> fed(active.size(), 0);
+        set<const Organism*> consumed;
+        for (size_t k = 0; k < claims.size(); k++) {
+            if (k == 0 || intents[claims[k]].target != intents[claims[k - 1]].target) {
+                fed[claims[k]] = 1;
+                consumed.insert(intents[claims[k]].target);
+            }
+        }
+        for (size_t i = 0; i < active.size(); i++) {
+            if (intents[i].target && !intents[i].exclusive) {
+                fed[i] = consumed.count(intents[i].target) == 0;
+            }
+        }
+
+        // 先扣除被取食对象的能量，再按列表顺序结算仍然存活的生物的进食
+        for (size_t i = 0; i < active.size(); i++) {
+            if (fed[i]) {
+                Organism* target = intents[i].target;
+                bool alive = !target->is_dead();
+                target->lose_energy(intents[i].take);
+                if (journal) journal->record(EVENT_PREDATION, active[i]->getId(), target->getId(), active[i]->getSpecies());
+                if (alive && target->is_dead()) killed.insert(target->getId());
+                replan_sleep(target);
+            }
+        }
+        for (size_t i = 0; i < active.size(); i++) {
+            if (active[i]->is_dead()) continue; // 自己被吃掉了
+            dispatch_species(active[i], [&](auto* org) { eat_organism(org, local[i], intents[i], fed[i] != 0); });
+        }
+    }
+
+    // 生物行为
+    // ghosts为相邻区域边界上生物的只读副本：可被捕食或作为配偶，但不在本区域内更新
+    void run_organisms(const vector<Organism*>* ghosts = nullptr) {
+        vector<Organism*> visible_with_ghosts;
+        vector<Organism*>* visible = &organisms;
+        if (ghosts && !ghosts->empty()) {
+            visible_with_ghosts.reserve(organisms.size() + ghosts->size());
+            visible_with_ghosts.insert(visible_with_ghosts.end(), organisms.begin(), organisms.end());
+            visible_with_ghosts.insert(visible_with_ghosts.end(), ghosts->begin(), ghosts->end());
+            visible = &visible_with_ghosts;
+        }
+
+        vector<Organism*> active;
+        vector<Environment> local;
+        {
+            PhaseTimer timer(phase_elapsed, phase_counters.get(), PHASE_MOVE);
+
+            // 唤醒到期的休眠生物
+            wake_sleepers();
+
+            // 移动（局地环境按当天开始时所在的位置取样，移动的距离远小于天气格）
+            for (Organism* org : organisms) {
+                if (!org->is_dead() && !org->is_sleeping()) {
+                    active.push_back(org);
+                    local.emplace_back();
+                    weather.local_environment(env, org->getX(), org->getY(), local.back());
+                    dispatch_species(org, [&](auto* o) { move_organism(o, local.back()); });
+                }
+            }
+        }
+
+        // 进食
+        {
+            PhaseTimer timer(phase_elapsed, phase_counters.get(), PHASE_FEED);
+            feed_organisms(active, local, *visible);
+        }
+
+        // 衰老、繁殖和休眠
+        vector<Organism*> new_organisms;
+        {
+            PhaseTimer timer(phase_elapsed, phase_counters.get(), PHASE_FINISH);
+            for (size_t i = 0; i < active.size(); i++) {
+                if (!active[i]->is_dead()) {
+                    dispatch_species(active[i], [&](auto* o) { finish_organism(o, local[i], *visible, new_organisms); });
+                }
+            }
+        }
+
+        // 添加新生物
+        PhaseTimer timer(phase_elapsed, phase_counters.get(), PHASE_CLEANUP);
+        organisms.insert(organisms.end(), new_organisms.begin(), new_organisms.end());
+
+        // 种子萌发
+        germinate_seeds();
+
+        // 处理寄生关系
+        handle_parasites();
+
+        // 移除死亡的生物
+        remove_dead_organisms();
+    }
+
+    // 推进关注区域之外的密度场，并交换边界上的个体和密度
+    void update_level_of_detail() {
+        if (density_field.get_cells_x() == 0) return;
+        PhaseTimer timer(phase_elapsed, phase_counters.get(), PHASE_LEVEL_OF_DETAIL);
+        density_field.step(env);
+        materialize_density(false);
+        absorb_organisms();
+    }
+
+    // 结束一天
+    void end_day() {
+        {
+            PhaseTimer timer(phase_elapsed, phase_counters.get(), PHASE_END_DAY);
+            if (day % 30 == 0) grow_forests();
+            rebuild_population_tables();
+            if (record_history) record_day();
+            if (results) publish_results();
+            if (frames && day % frames->get_stride() == 0) export_frame();
+            if (memory_budget > 0) enforce_memory_budget();
+        }
+        metrics.days_completed++;
+        if (metrics_exporter) publish_metrics();
+    }
+
+    // 自然演替 - 森林扩张
+    void grow_forests() {
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                if (!terrain.is_generated(x, y)) {
+                    x |= TERRAIN_TILE_MASK; // 跳过尚未生成的分块
+                    continue;
+                }
+                if (terrain[y][x].type == PLAIN && terrain[y][x].fertility > 0.6) {
+                    // 检查周围是否有森林
+                    for (int dy = -1; dy <= 1; dy++) {
+                        for (int dx = -1; dx <= 1; dx++) {
+                            int nx = x + dx;
+                            int ny = y + dy;
+                            if (nx >= 0 && ny >= 0 && nx < width && ny < height &&
+                                terrain.is_generated(nx, ny)) {
+                                if (terrain[ny][nx].type == FOREST) {
+                                    if (rand() % 100 < 5) {
+                                        terrain.mut(x, y).type = FOREST;
+                                        break;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // 把当天结束时的生物和地形追加到历史记录
+    void record_day() {
+        vector<HistoryOrganism> snapshot(organisms.size());
+        for (size_t i = 0; i < organisms.size(); i++) {
+            HistoryOrganism& entry = snapshot[i];
+            entry.id = organisms[i]->getId();
+            entry.x = organisms[i]->getX();
+            entry.y = organisms[i]->getY();
+            entry.species = static_cast<unsigned char>(organisms[i]->getSpecies());
+            entry.symbol = organisms[i]->getSymbol()[0];
+        }
+        sort(snapshot.begin(), snapshot.end(),
+            [](const HistoryOrganism& a, const HistoryOrganism& b) { return a.id < b.id; });
+        history.record(day, snapshot, terrain);
+    }
+
+    // ---- 区域分解（多进程运行） ----
+
+    // 坐标是否属于本世界负责的区域
+    bool in_domain(int x, int y) const {
+        return x >= domain_x0 && x < domain_x1 && y >= domain_y0 && y < domain_y1;
+    }
+
+    // 坐标是否位于本区域外侧halo格宽的边界带内
+    bool in_halo(int x, int y, int halo) const {
+        return !in_domain(x, y) &&
+            x >= domain_x0 - halo && x < domain_x1 + halo &&
+            y >= domain_y0 - halo && y < domain_y1 + halo;
+    }
+
+    // 坐标是否位于本区域内侧halo格宽、且与其他区域相邻的边界带内
+    bool near_border(int x, int y, int halo) const {
+        return (domain_x0 > 0 && x < domain_x0 + halo) || (domain_x1 < width && x >= domain_x1 - halo) ||
+            (domain_y0 > 0 && y < domain_y0 + halo) || (domain_y1 < height && y >= domain_y1 - halo);
+    }
+
+    const Environment& get_environment() const {
+        return env;
+    }
+
+    // 各阶段的累计耗时和硬件计数器（未启用时为空）
+    const PhaseCounters* get_phase_counters() const {
+        return phase_counters.get();
+    }
+
+    // 运行指标（区域驱动写入信箱占用）
+    SimulationMetrics& get_metrics() {
+        return metrics;
+    }
+
+    // 使用其他进程广播的全局环境
+    void set_environment(const Environment& shared_env) {
+        env = shared_env;
+        season = static_cast<int>(fmod(day / 182.5, 4.0)) % 4;
+    }
+
+    // 收集边界带内的生物（作为副本发送给相邻区域）
+    void collect_border_organisms(int halo, vector<OrganismRecord>& records) const {
+        for (Organism* org : organisms) {
+            if (near_border(org->getX(), org->getY(), halo)) {
+                OrganismRecord record;
+                org->save_record(record);
+                records.push_back(record);
+            }
+        }
+    }
+
+    // 收集已离开本区域的生物并从本世界移除（交给新位置所属的进程）
+    void collect_emigrants(vector<OrganismRecord>& records) {
+        auto it = remove_if(organisms.begin(), organisms.end(),
+            [&](Organism* org) {
+                if (in_domain(org->getX(), org->getY())) {
+                    return false;
+                }
+                OrganismRecord record;
+                org->save_record(record);
+                records.push_back(record);
+                population.remove(org->getSpecies(), org->getX(), org->getY());
+                if (journal) journal->record(EVENT_DEPARTURE, org->getId());
+                sleepers.cancel(org);
+                delete org;
+                return true;
+            });
+        organisms.erase(it, organisms.end());
+    }
+
+    // 加入从其他区域迁入的生物
+    void add_organism(const OrganismRecord& record) {
+        if (Organism* org = create_organism(record)) {
+            organisms.push_back(org);
+            population.add(record.species, record.x, record.y);
+            if (journal) journal->record(EVENT_ARRIVAL, org->getId(), 0, record.species, record.x, record.y);
+        }
+    }
+
+    // 扣除其他区域的生物对本区域生物造成的能量损失（按生物编号）
+    void apply_damage(const unordered_map<unsigned long long, double>& damage) {
+        if (damage.empty()) return;
+        for (Organism* org : organisms) {
+            auto it = damage.find(org->getId());
+            if (it != damage.end()) {
+                bool alive = !org->is_dead();
+                org->lose_energy(it->second);
+                if (alive && org->is_dead()) killed.insert(org->getId());
+                replan_sleep(org);
+            }
+        }
+        remove_dead_organisms();
+    }
+
+    // 收集边界带内被修改过的地形格（未分叉的分块与原始地图一致，相邻区域可自行生成）
+    void collect_border_cells(int halo, vector<HaloCell>& cells) const {
+        for (int y = domain_y0; y < domain_y1; y++) {
+            for (int x = domain_x0; x < domain_x1; x++) {
+                if (!terrain.is_diverged(x, y)) {
+                    x |= TERRAIN_TILE_MASK; // 整个分块都未分叉
+                    continue;
+                }
+                if (near_border(x, y, halo)) {
+                    HaloCell halo_cell;
+                    halo_cell.x = x;
+                    halo_cell.y = y;
+                    halo_cell.cell = terrain.at(x, y);
+                    cells.push_back(halo_cell);
+                }
+            }
+        }
+    }
+
+    // 写入相邻区域发来的边界地形格
+    void apply_halo_cell(const HaloCell& halo_cell) {
+        water_routing.note_change(halo_cell.x, halo_cell.y, terrain.at(halo_cell.x, halo_cell.y), halo_cell.cell);
+        terrain.set(halo_cell.x, halo_cell.y, halo_cell.cell);
+    }
+
+    // 复制界面所需的数据（视口、统计和选中的生物）
+    void capture_snapshot(WorldSnapshot& snapshot) const {
+        snapshot.width = width;
+        snapshot.height = height;
+        snapshot.day = day;
+        snapshot.max_days = max_days;
+        snapshot.season = season;
+        snapshot.env = env;
+        snapshot.weather_cells_x = weather.get_cells_x();
+        snapshot.weather_cells_y = weather.get_cells_y();
+        snapshot.weather_peak = weather.peak_precipitation();
+        snapshot.weather_cloud = weather.cloud_cover();
+        snapshot.messages.assign(messages.begin(), messages.end());
+
+        snapshot.viewport_x = viewport_x;
+        snapshot.viewport_y = viewport_y;
+        snapshot.viewport_width = viewport_width;
+        snapshot.viewport_height = viewport_height;
+        snapshot.organism_count = organisms.size();
+        snapshot.sleeping_count = sleepers.size();
+        snapshot.generated_tiles = terrain.generated_tile_count();
+        snapshot.tile_count = terrain.tile_count();
+        snapshot.owned_tiles = terrain.owned_tile_count();
+        snapshot.owned_bytes = terrain.owned_bytes();
+        snapshot.depression_cells = water_routing.depression_cells();
+        snapshot.record_history = record_history;
+        snapshot.history_first_day = history.get_first_day();
+        snapshot.history_last_day = history.get_last_day();
+        snapshot.history_keyframes = history.keyframe_count();
+        snapshot.history_bytes = history.memory_bytes();
+        snapshot.view_day = view_day;
+        snapshot.journal = journal != nullptr;
+        if (journal) {
+            snapshot.journal_events = journal->get_event_count();
+            snapshot.journal_raw_bytes = journal->get_raw_bytes();
+            snapshot.journal_written_bytes = journal->get_written_bytes();
+        }
+        snapshot.seed_count = seed_bank.seed_count();
+        snapshot.seeded_cells = seed_bank.seeded_cells();
+        snapshot.footprint = memory_footprint();
+        snapshot.memory_budget = memory_budget;
+        snapshot.resident_bytes = resident_memory_bytes();
+        snapshot.density_enabled = density_field.get_cells_x() > 0;
+        if (snapshot.density_enabled) {
+            snapshot.focus_area_count = focus_areas.size();
+            snapshot.coarse_cells = density_field.coarse_cell_count();
+            snapshot.density_cells = static_cast<size_t>(density_field.get_cells_x()) * density_field.get_cells_y();
+            snapshot.density_total = density_field.total();
+        }
+        snapshot.epidemic_peak = epidemic.peak();
+
+        // 各物种数量和患病个体（取自种群汇总表）
+        for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+            snapshot.species_counts[sp] = static_cast<int>(population_tables.total(sp));
+        }
+        snapshot.infected = static_cast<int>(population_tables.get_infected());
+        capture_region_population(snapshot, viewport_x, viewport_y, viewport_x + viewport_width, viewport_y + viewport_height);
+
+        if (zoom > 0) {
+            capture_overview(snapshot);
+            return;
+        }
+        snapshot.view_scale = 1;
+
+        // 回看时从历史记录重建那一天的地形和生物
+        HistorySnapshot past;
+        bool viewing_past = view_day >= 0 && history.reconstruct(view_day, past);
+        auto cell_type = [&](int x, int y) -> TerrainType {
+            unsigned char type;
+            if (!viewing_past) return terrain[y][x].type;
+            if (history.snapshot_type(past, x, y, type)) return static_cast<TerrainType>(type);
+            return terrain.peek(x, y).type; // 当时尚未生成的分块
+        };
+
+        // 视口内的地形
+        size_t cells = static_cast<size_t>(viewport_width) * viewport_height;
+        snapshot.cell_types.assign(cells, -1);
+        snapshot.cell_symbols.assign(cells, ' ');
+        for (int y = 0; y < viewport_height; y++) {
+            for (int x = 0; x < viewport_width; x++) {
+                int world_x = viewport_x + x;
+                int world_y = viewport_y + y;
+                if (world_x < width && world_y < height) {
+                    snapshot.cell_types[y * viewport_width + x] = static_cast<signed char>(cell_type(world_x, world_y));
+                }
+            }
+        }
+
+        // 视口内的生物（同一格有多个时显示最后一个）
+        auto place_symbol = [&](int world_x, int world_y, char symbol) {
+            int x = world_x - viewport_x;
+            int y = world_y - viewport_y;
+            if (x >= 0 && y >= 0 && x < viewport_width && y < viewport_height) {
+                snapshot.cell_symbols[y * viewport_width + x] = symbol;
+            }
+        };
+        if (viewing_past) {
+            for (const HistoryOrganism& org : past.organisms) {
+                place_symbol(org.x, org.y, org.symbol);
+            }
+        }
+        else {
+            for (const Organism* org : organisms) {
+                place_symbol(org->getX(), org->getY(), org->getSymbol()[0]);
+            }
+        }
+
+        // 选中的生物
+        snapshot.show_selection = show_history && selected_x != -1 && selected_y != -1;
+        snapshot.highlight_x = show_history ? selected_x - viewport_x : -1;
+        snapshot.highlight_y = show_history ? selected_y - viewport_y : -1;
+        snapshot.selection_found = false;
+        if (snapshot.show_selection) {
+            for (const Organism* org : organisms) {
+                if (org->getX() == selected_x && org->getY() == selected_y) {
+                    const auto& prev = org->get_previous_state();
+                    SelectedOrganism& selected = snapshot.selected;
+                    selected.name = org->getName();
+                    selected.x = selected_x;
+                    selected.y = selected_y;
+                    selected.energy = org->getEnergy();
+                    selected.age = prev.age;
+                    selected.status = prev.status;
+                    selected.previous_x = prev.x;
+                    selected.previous_y = prev.y;
+                    selected.previous_energy = prev.energy;
+                    snapshot.selection_found = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // 视口所显示区域内的个体数量和平均能量
+    void capture_region_population(WorldSnapshot& snapshot, int x0, int y0, int x1, int y1) const {
+        snapshot.region_count = population_tables.count(0, SPECIES_COUNT - 1, x0, y0, x1, y1);
+        double energy = population_tables.total_energy(0, SPECIES_COUNT - 1, x0, y0, x1, y1);
+        snapshot.region_energy = snapshot.region_count > 0 ? energy / snapshot.region_count : 0.0;
+    }
+
+    // 概览地图：视口的每格取数量汇总第zoom-1级的一格，以视口中心为中心（总是显示当前状态）
+    // 每格显示数量最多的动物，没有动物时显示数量最多的植物，底色为该格的主要地形
+    void capture_overview(WorldSnapshot& snapshot) const {
+        int level = zoom - 1;
+        int shift = population.level_shift(level);
+        int cells_x = population.cells_x(level), cells_y = population.cells_y(level);
+        int origin_x = max(0, min(cells_x - viewport_width, ((viewport_x + viewport_width / 2) >> shift) - viewport_width / 2));
+        int origin_y = max(0, min(cells_y - viewport_height, ((viewport_y + viewport_height / 2) >> shift) - viewport_height / 2));
+        population.refresh_terrain(terrain, day);
+
+        size_t cells = static_cast<size_t>(viewport_width) * viewport_height;
+        snapshot.cell_types.assign(cells, -1);
+        snapshot.cell_symbols.assign(cells, ' ');
+        snapshot.view_scale = 1 << shift;
+        capture_region_population(snapshot, origin_x << shift, origin_y << shift,
+            (origin_x + viewport_width) << shift, (origin_y + viewport_height) << shift);
+        snapshot.show_selection = false;
+        snapshot.highlight_x = snapshot.highlight_y = -1;
+        for (int y = 0; y < viewport_height && origin_y + y < cells_y; y++) {
+            for (int x = 0; x < viewport_width && origin_x + x < cells_x; x++) {
+                int cx = origin_x + x, cy = origin_y + y;
+                size_t index = static_cast<size_t>(y) * viewport_width + x;
+                snapshot.cell_types[index] = static_cast<signed char>(population.terrain_at(level, cx, cy));
+
+                const unsigned int* counts = population.counts(level, cx, cy);
+                auto dominant = [counts](int first, int last) {
+                    int best = -1;
+                    for (int sp = first; sp <= last; sp++) {
+                        if (counts[sp] > 0 && (best < 0 || counts[sp] > counts[best])) best = sp;
+                    }
+                    return best;
+                };
+                int best = dominant(SPECIES_AQUATIC_PLANT + 1, SPECIES_COUNT - 1);
+                if (best < 0) best = dominant(SPECIES_PLANT, SPECIES_AQUATIC_PLANT);
+                if (best >= 0) snapshot.cell_symbols[index] = SPECIES_SYMBOLS[best];
+            }
+        }
+    }
+
+    // 交互界面的绘制线程运行期间，提示改由快照显示
+    void set_message_hold(bool hold) {
+        hold_messages = hold;
+    }
+
+    // 显示当前世界状态（在当前线程直接绘制）
+    void display() const {
+        WorldSnapshot snapshot;
+        capture_snapshot(snapshot);
+        render_snapshot(snapshot);
+    }
+
+    // 调整环境参数
+    void adjust_environment() {
+        SetColor(COLOR_HIGHLIGHTA);
+        cout << "\n调整环境参数:\n";
+        SetColor(COLOR_DEFAULT);
+
+        cout << "1. 温度 (" << env.temperature << "°C): ";
+        cin >> env.temperature;
+        cout << "2. 湿度 (" << env.humidity << "%): ";
+        cin >> env.humidity;
+        cout << "3. 灾难概率 (" << env.disaster_chance * 100 << "%): ";
+        cin >> env.disaster_chance;
+        cout << "4. 污染 (" << env.pollution * 100 << "%): ";
+        cin >> env.pollution;
+        cout << "5. 降雨量 (" << env.rainfall << "mm): ";
+        cin >> env.rainfall;
+    }
+
+    // 显示物种开销排名（未启用时从现在开始统计）
+    void show_profile() {
+        if (!profiler) {
+            profiler.reset(new SpeciesProfiler());
+            cout << "\n已开始统计物种开销，模拟几天后再按P查看排名\n";
+            return;
+        }
+        cout << "\n";
+        profiler->write_report(cout);
+    }
+
+    // 将当前视口设为关注区域（已是关注区域时取消）
+    void toggle_focus_viewport() {
+        FocusArea area = { viewport_x, viewport_y, viewport_x + viewport_width, viewport_y + viewport_height };
+        auto it = find_if(focus_areas.begin(), focus_areas.end(),
+            [&](const FocusArea& other) {
+                return other.x0 == area.x0 && other.y0 == area.y0 && other.x1 == area.x1 && other.y1 == area.y1;
+            });
+        if (it != focus_areas.end()) {
+            focus_areas.erase(it);
+        }
+        else {
+            focus_areas.push_back(area);
+        }
+        apply_focus();
+        rebuild_population_tables();
+    }
+
+    // 移动视口（概览地图上按格移动，一格对应多个世界格）
+    void move_viewport(int dx, int dy) {
+        int scale = zoom > 0 ? 1 << population.level_shift(zoom - 1) : 1;
+        viewport_x = max(0, min(width - viewport_width, viewport_x + dx * scale));
+        viewport_y = max(0, min(height - viewport_height, viewport_y + dy * scale));
+        show_history = false; // 移动视口时关闭历史显示
+    }
+
+    // 缩放概览地图（正数缩小，负数放大），最远缩放到整个世界都能放进视口为止
+    void zoom_view(int steps) {
+        if (!population.enabled()) return;
+        int max_zoom = 1;
+        while (max_zoom < population.level_count() &&
+            (population.cells_x(max_zoom - 1) > viewport_width || population.cells_y(max_zoom - 1) > viewport_height)) {
+            max_zoom++;
+        }
+        zoom = max(0, min(max_zoom, zoom + steps));
+        show_history = false;
+    }
+
+    // 在历史中前后移动回看的日期（移动到最新一天时回到当前状态）
+    void scrub_history(int days) {
+        if (history.empty()) return;
+        int target = (view_day < 0 ? history.get_last_day() : view_day) + days;
+        target = max(history.get_first_day(), min(history.get_last_day(), target));
+        view_day = target == history.get_last_day() ? -1 : target;
+    }
+
+    void stop_scrubbing() {
+        view_day = -1;
+    }
+
+    // 选择生物查看历史
+    void select_organism(int x, int y) {
+        selected_x = viewport_x + x;
+        selected_y = viewport_y + y;
+        show_history = true;
+    }
+
+    // 获取生物数量
+    size_t get_organism_count() const {
+        return organisms.size();
+    }
+
+    // 获取当前天数
+    int get_day() const {
+        return day;
+    }
+
+    // 获取最大模拟天数
+    int get_max_days() const {
+        return max_days;
+    }
+
+    // 获取实际使用的工作线程数（未指定时为硬件线程数）
+    int get_worker_threads() const {
+        return worker_threads;
+    }
+
+    // 获取地形（可用于创建共享同一原始地图的其他世界）
+    const TerrainMap& get_terrain() const {
+        return terrain;
+    }
+
+    // 获取生成时的原始地图
+    const TerrainMap& get_pristine_terrain() const {
+        return pristine_terrain;
+    }
+};
+
+// ---- 多进程区域分解 ----
+// 世界被划分为ranks个矩形子区域，每个进程运行自己的World并只负责其中一个区域。
+// 每天通过POSIX共享内存交换：全局环境（0号进程广播）、边界带内的生物副本和地形格、
+// 跨区域的捕食伤害，以及离开本区域的生物（交给新位置所属的进程）。
+
+const int DOMAIN_MAX_RANKS = 64;          // 最大进程数
+const int DOMAIN_HALO = 16;               // 边界带宽度（格），覆盖大多数生物一天的觅食和移动范围
+const int DOMAIN_MAX_GHOSTS = 16384;      // 每个进程每天发布的边界生物上限（超出部分不可见）
+const int DOMAIN_MAX_MIGRANTS = 4096;     // 每个进程每天可接收的迁入生物上限（超出的次日再交接）
+const int DOMAIN_MAX_DAMAGE = 16384;      // 每个进程每天可接收的伤害通知上限（超出部分丢弃）
+const int DOMAIN_MAX_HALO_CELLS = 65536;  // 每个进程每天发布的边界地形格上限（超出部分不同步）
+
+#ifndef _WIN32
+// 其他进程的生物对本进程生物造成的能量损失
+struct DamageNotice {
+    unsigned long long id;
+    double amount;
+};
+
+// 每个进程在共享内存中的信箱
+// ghosts/halo_cells由本进程写入、相邻进程读取；migrants/damage由其他进程写入、本进程读取
+struct DomainMailbox {
+    int x0, y0, x1, y1;       // 区域范围
+    long long population;     // 当天结束时的生物数量
+    int ghost_count;
+    int halo_cell_count;
+    atomic<int> migrant_count; // 多个进程并发写入，用原子计数分配槽位
+    atomic<int> damage_count;
+    OrganismRecord ghosts[DOMAIN_MAX_GHOSTS];
+    HaloCell halo_cells[DOMAIN_MAX_HALO_CELLS];
+    OrganismRecord migrants[DOMAIN_MAX_MIGRANTS];
+    DamageNotice damage[DOMAIN_MAX_DAMAGE];
+};
+
+// 共享内存头部，之后紧跟ranks个信箱
+struct DomainShared {
+    pthread_barrier_t barrier; // 进程间共享的屏障，划分每天的各个阶段
+    int ranks;
+    int grid_x, grid_y;        // 区域网格
+    int disaster_type;         // 0号进程广播的当天灾难
+    Environment env;           // 0号进程广播的全局环境
+    atomic<int> aborted;       // 有进程无法开始运行（如预计内存超出预算）
+
+    DomainMailbox& mailbox(int rank) {
+        return reinterpret_cast<DomainMailbox*>(this + 1)[rank];
+    }
+};
+
+// 计算某个网格坐标的区域范围（均匀划分）
+void domain_bounds(const WorldConfig& config, int grid_x, int grid_y, int gx, int gy,
+    int& x0, int& y0, int& x1, int& y1) {
+    x0 = static_cast<int>(static_cast<long long>(config.width) * gx / grid_x);
+    x1 = static_cast<int>(static_cast<long long>(config.width) * (gx + 1) / grid_x);
+    y0 = static_cast<int>(static_cast<long long>(config.height) * gy / grid_y);
+    y1 = static_cast<int>(static_cast<long long>(config.height) * (gy + 1) / grid_y);
+}
+
+// 坐标所属的进程
+int domain_owner(DomainShared* shared, int x, int y) {
+    for (int r = 0; r < shared->ranks; r++) {
+        const DomainMailbox& box = shared->mailbox(r);
+        if (x >= box.x0 && x < box.x1 && y >= box.y0 && y < box.y1) {
+            return r;
+        }
+    }
+    return 0;
+}
+
+// 单个进程的主循环（在fork出的子进程中运行）
+int run_domain_rank(const WorldConfig& base, int rank, DomainShared* shared) {
+    WorldConfig config = base;
+    config.rank = rank;
+    domain_bounds(base, shared->grid_x, shared->grid_y, rank % shared->grid_x, rank / shared->grid_x,
+        config.domain_x0, config.domain_y0, config.domain_x1, config.domain_y1);
+    organism_id_base = static_cast<unsigned long long>(rank) << 48; // 编号在所有进程间唯一
+    if (config.threads == 0) {
+        // 各进程平分CPU核
+        config.threads = max(1, static_cast<int>(thread::hardware_concurrency()) / shared->ranks);
+    }
+
+    DomainMailbox& own = shared->mailbox(rank);
+    own.x0 = config.domain_x0;
+    own.y0 = config.domain_y0;
+    own.x1 = config.domain_x1;
+    own.y1 = config.domain_y1;
+
+    World world(config);
+    if (!world.check_memory_budget()) shared->aborted = 1;
+    SimulationMetrics& metrics = world.get_metrics();
+    metrics.pool_capacity[POOL_MAILBOX_GHOSTS] = DOMAIN_MAX_GHOSTS;
+    metrics.pool_capacity[POOL_MAILBOX_HALO_CELLS] = DOMAIN_MAX_HALO_CELLS;
+    metrics.pool_capacity[POOL_MAILBOX_MIGRANTS] = DOMAIN_MAX_MIGRANTS;
+    metrics.pool_capacity[POOL_MAILBOX_DAMAGE] = DOMAIN_MAX_DAMAGE;
+    pthread_barrier_wait(&shared->barrier); // 所有区域范围已发布
+    if (shared->aborted) return 1;
+
+    // 相邻进程：扩展边界带后与本区域相交的区域
+    vector<int> neighbours;
+    for (int r = 0; r < shared->ranks; r++) {
+        const DomainMailbox& box = shared->mailbox(r);
+        if (r != rank &&
+            box.x0 < own.x1 + DOMAIN_HALO && box.x1 > own.x0 - DOMAIN_HALO &&
+            box.y0 < own.y1 + DOMAIN_HALO && box.y1 > own.y0 - DOMAIN_HALO) {
+            neighbours.push_back(r);
+        }
+    }
+
+    vector<OrganismRecord> records;
+    vector<HaloCell> cells;
+    vector<Organism*> ghosts;
+    vector<double> ghost_energy; // 副本在本进程行动前的能量
+    vector<int> ghost_owner;
+    unordered_map<unsigned long long, double> damage;
+
+    for (int d = 0; d < config.max_days; d++) {
+        // 1. 0号进程推进并广播全局环境
+        world.begin_day();
+        if (rank == 0) {
+            shared->disaster_type = world.advance_environment();
+            shared->env = world.get_environment();
+        }
+        pthread_barrier_wait(&shared->barrier);
+
+        // 2. 作用环境，发布边界带内的生物和地形
+        if (rank != 0) {
+            world.set_environment(shared->env);
+        }
+        world.apply_environment(shared->disaster_type);
+
+        records.clear();
+        world.collect_border_organisms(DOMAIN_HALO, records);
+        own.ghost_count = min(static_cast<int>(records.size()), DOMAIN_MAX_GHOSTS);
+        copy(records.begin(), records.begin() + own.ghost_count, own.ghosts);
+
+        cells.clear();
+        world.collect_border_cells(DOMAIN_HALO, cells);
+        own.halo_cell_count = min(static_cast<int>(cells.size()), DOMAIN_MAX_HALO_CELLS);
+        copy(cells.begin(), cells.begin() + own.halo_cell_count, own.halo_cells);
+        metrics.pool_used[POOL_MAILBOX_GHOSTS] = own.ghost_count;
+        metrics.pool_used[POOL_MAILBOX_HALO_CELLS] = own.halo_cell_count;
+        pthread_barrier_wait(&shared->barrier);
+
+        // 3. 接收相邻区域的边界数据，运行本区域的生物
+        for (int r : neighbours) {
+            const DomainMailbox& box = shared->mailbox(r);
+            for (int i = 0; i < box.halo_cell_count; i++) {
+                if (world.in_halo(box.halo_cells[i].x, box.halo_cells[i].y, DOMAIN_HALO)) {
+                    world.apply_halo_cell(box.halo_cells[i]);
+                }
+            }
+            for (int i = 0; i < box.ghost_count; i++) {
+                if (world.in_halo(box.ghosts[i].x, box.ghosts[i].y, DOMAIN_HALO)) {
+                    if (Organism* ghost = create_organism(box.ghosts[i])) {
+                        ghosts.push_back(ghost);
+                        ghost_energy.push_back(ghost->getEnergy());
+                        ghost_owner.push_back(r);
+                    }
+                }
+            }
+        }
+
+        world.run_organisms(&ghosts);
+
+        // 副本被捕食造成的能量损失通知其所属进程
+        for (size_t i = 0; i < ghosts.size(); i++) {
+            double amount = ghost_energy[i] - ghosts[i]->getEnergy();
+            if (amount > 0) {
+                DomainMailbox& box = shared->mailbox(ghost_owner[i]);
+                int slot = box.damage_count.fetch_add(1);
+                if (slot < DOMAIN_MAX_DAMAGE) {
+                    box.damage[slot].id = ghosts[i]->getId();
+                    box.damage[slot].amount = amount;
+                }
+            }
+            delete ghosts[i];
+        }
+        ghosts.clear();
+        ghost_energy.clear();
+        ghost_owner.clear();
+
+        // 离开本区域的生物交给新位置所属的进程
+        records.clear();
+        world.collect_emigrants(records);
+        for (const OrganismRecord& record : records) {
+            DomainMailbox& box = shared->mailbox(domain_owner(shared, record.x, record.y));
+            int slot = box.migrant_count.fetch_add(1);
+            if (slot < DOMAIN_MAX_MIGRANTS) {
+                box.migrants[slot] = record;
+            }
+            else {
+                world.add_organism(record); // 对方信箱已满，留在本进程次日再交接
+            }
+        }
+        pthread_barrier_wait(&shared->barrier);
+
+        // 4. 处理收到的伤害通知和迁入生物
+        damage.clear();
+        int damage_count = min(own.damage_count.load(), DOMAIN_MAX_DAMAGE);
+        metrics.pool_used[POOL_MAILBOX_DAMAGE] = damage_count;
+        for (int i = 0; i < damage_count; i++) {
+            damage[own.damage[i].id] += own.damage[i].amount;
+        }
+        own.damage_count = 0;
+        world.apply_damage(damage);
+
+        // 按编号排序，使迁入顺序与各进程写入信箱的先后无关（结果可复现）
+        int migrant_count = min(own.migrant_count.load(), DOMAIN_MAX_MIGRANTS);
+        metrics.pool_used[POOL_MAILBOX_MIGRANTS] = migrant_count;
+        records.assign(own.migrants, own.migrants + migrant_count);
+        sort(records.begin(), records.end(),
+            [](const OrganismRecord& a, const OrganismRecord& b) { return a.id < b.id; });
+        for (const OrganismRecord& record : records) {
+            world.add_organism(record);
+        }
+        own.migrant_count = 0;
+
+        world.end_day();
+        own.population = static_cast<long long>(world.get_organism_count());
+        pthread_barrier_wait(&shared->barrier);
+
+        // 0号进程汇总并定期输出
+        if (rank == 0 && (world.get_day() % 30 == 0 || d == config.max_days - 1)) {
+            long long total = 0;
+            for (int r = 0; r < shared->ranks; r++) {
+                total += shared->mailbox(r).population;
+            }
+            cout << "第" << world.get_day() << "天  生物总数: " << total << "  (各进程:";
+            for (int r = 0; r < shared->ranks; r++) {
+                cout << " " << shared->mailbox(r).population;
+            }
+            cout << ")" << endl;
+        }
+    }
+    return 0;
+}
+
+// 在本机启动config.ranks个进程，各自负责世界的一个矩形子区域（无界面运行）
+int launch_domain_ranks(WorldConfig config) {
+    // 所有进程必须使用同一地形种子
+    if (config.seed == 0) {
+        config.seed = static_cast<unsigned int>(time(0));
+    }
+
+    // 选择尽量接近正方形的区域网格
+    int grid_y = static_cast<int>(sqrt(static_cast<double>(config.ranks)));
+    while (config.ranks % grid_y != 0) grid_y--;
+    int grid_x = config.ranks / grid_y;
+    if (config.width / grid_x < 1 || config.height / grid_y < 1) {
+        cout << "世界太小，无法划分为" << config.ranks << "个区域" << endl;
+        return 1;
+    }
+
+    // 创建共享内存后立即删除名字，映射由fork出的子进程继承，进程退出后自动释放
+    size_t bytes = sizeof(DomainShared) + config.ranks * sizeof(DomainMailbox);
+    string name = "/ecosystem-" + to_string(getpid());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        cout << "无法创建共享内存: " << strerror(errno) << endl;
+        return 1;
+    }
+    shm_unlink(name.c_str());
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        cout << "无法分配共享内存: " << strerror(errno) << endl;
+        close(fd);
+        return 1;
+    }
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        cout << "无法映射共享内存: " << strerror(errno) << endl;
+        return 1;
+    }
+
+    DomainShared* shared = static_cast<DomainShared*>(memory);
+    shared->ranks = config.ranks;
+    shared->grid_x = grid_x;
+    shared->grid_y = grid_y;
+    shared->disaster_type = -1;
+    new (&shared->aborted) atomic<int>(0);
+    for (int r = 0; r < config.ranks; r++) {
+        new (&shared->mailbox(r).migrant_count) atomic<int>(0);
+        new (&shared->mailbox(r).damage_count) atomic<int>(0);
+    }
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(&shared->barrier, &attr, config.ranks);
+    pthread_barrierattr_destroy(&attr);
+
+    cout << "启动" << config.ranks << "个进程 (" << grid_x << "x" << grid_y << "区域)，世界大小 "
+        << config.width << "x" << config.height << "，种子 " << config.seed << endl;
+    cout.flush();
+
+    vector<pid_t> children;
+    for (int r = 0; r < config.ranks; r++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int status = run_domain_rank(config, r, shared);
+            cout.flush();
+            _exit(status);
+        }
+        if (pid < 0) {
+            cout << "无法启动进程: " << strerror(errno) << endl;
+            for (pid_t child : children) kill(child, SIGTERM);
+            break;
+        }
+        children.push_back(pid);
+    }
+
+    // 任一进程异常退出时结束其余进程（它们会一直等在屏障上）
+    bool failed = children.size() != static_cast<size_t>(config.ranks);
+    for (size_t remaining = children.size(); remaining > 0; remaining--) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) break;
+        if (!failed && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+            cout << "进程 " << pid << " 异常退出，终止其余进程" << endl;
+            failed = true;
+            for (pid_t child : children) {
+                if (child != pid) kill(child, SIGTERM);
+            }
+        }
+    }
+
+    pthread_barrier_destroy(&shared->barrier);
+    munmap(memory, bytes);
+    return failed ? 1 : 0;
+}
+#endif
+
+// 显示欢迎界面
+void display_welcome(const WorldConfig& config) {
+    SetColor(COLOR_TITLE);
+    cout << "==================================================" << endl;
+    cout << "        生态系统模拟器 - 复杂生物网络 (中文版)      " << endl;
+    cout << "==================================================" << endl;
+    SetColor(COLOR_DEFAULT);
+
+    cout << "这是一个模拟自然界中复杂生物网络的程序，包含多种生物" << endl;
+    cout << "种群和复杂的生态关系，如食物链、共生和寄生关系。" << endl;
+
+    SetColor(COLOR_STATS);
+    cout << "\n模拟规则:" << endl;
+    SetColor(COLOR_DEFAULT);
+    cout << "- 植物通过光合作用获取能量并繁殖" << endl;
+    cout << "- 食草动物吃植物，食肉动物吃食草动物" << endl;
+    cout << "- 杂食动物既吃植物又吃小动物" << endl;
+    cout << "- 昆虫吃植物和腐肉，分解者分解死亡生物" << endl;
+    cout << "- 顶级掠食者捕食其他动物" << endl;
+    cout << "- 寄生生物依附在其他生物身上获取能量" << endl;
+    cout << "- 环境因素（温度、湿度、污染）影响所有生物" << endl;
+    cout << "- 季节变化影响环境条件" << endl;
+    cout << "- 地形影响生物分布和行为" << endl;
+    cout << "- 天气系统影响环境（晴天、雨天、雪天、暴风雨、干旱）" << endl;
+    cout << "- 积水、积雪和干旱会影响生物的生存和繁衍" << endl;
+
+    SetColor(COLOR_HIGHLIGHTA);
+    cout << "\n本次模拟将持续" << config.max_days << "天，世界大小 "
+        << config.width << "x" << config.height << endl;
+    SetColor(COLOR_STATS);
+    cout << "\n操作说明:" << endl;
+    SetColor(COLOR_DEFAULT);
+    cout << "  S - 模拟一天" << endl;
+    cout << "  A - 调整环境参数" << endl;
+    cout << "  R - 重置模拟" << endl;
+    cout << "  Q - 退出程序" << endl;
+    cout << "  方向键 - 移动视口" << endl;
+    cout << "  C - 选择生物查看状态变化" << endl;
+    cout << "  F - 将当前视口设为/取消关注区域（区域外以密度场模拟）" << endl;
+
+    SetColor(COLOR_TITLE);
+    cout << "==================================================" << endl;
+    SetColor(COLOR_DEFAULT);
+    cout << "按任意键开始模拟..." << endl;
+    _getch();
+}
+
+// 回放得到的一个生物
+// 日志不记录移动，检查点中的位置和能量到下一个事件时就已过时，所以回放只跟踪物种
+struct ReplayOrganism {
+    int species;
+};
+
+// 日志文件中一个完整的数据块
+struct JournalBlockView {
+    unsigned char kind;
+    int day;
+    unsigned long long count;
+    const unsigned char* begin; // 载荷
+    const unsigned char* end;
+};
+
+// 读取日志文件并切分为数据块，只保留最后一次运行（界面中重置世界会从新的第0天检查点开始）
+// 末尾不完整的数据块（模拟中途被终止）被忽略，truncated表示是否有这样的数据块。失败时返回false
+bool read_journal_blocks(const string& path, vector<unsigned char>& data, vector<JournalBlockView>& blocks, bool& truncated) {
+    ifstream in(path.c_str(), ios::binary);
+    if (!in) return false;
+    data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    const unsigned char* p = data.data();
+    const unsigned char* end = p + data.size();
+    unsigned int header[5];
+    if (data.size() < sizeof(header)) return false;
+    memcpy(header, p, sizeof(header));
+    if (header[0] != JOURNAL_MAGIC) return false;
+    p += sizeof(header);
+
+    blocks.clear();
+    truncated = false;
+    while (p < end) {
+        JournalBlockView block;
+        unsigned long long day, size;
+        block.kind = *p++;
+        if (!journal_get_varint(p, end, day) || !journal_get_varint(p, end, block.count) ||
+            !journal_get_varint(p, end, size) || size > static_cast<unsigned long long>(end - p)) {
+            truncated = true;
+            break;
+        }
+        if (block.kind == 2 && day == 0) blocks.clear(); // 新的一次运行
+        block.day = static_cast<int>(day);
+        block.begin = p;
+        block.end = p + size;
+        blocks.push_back(block);
+        p += size;
+    }
+    return true;
+}
+
+// 日志中最后一次运行记录到的最后一天（没有数据块时返回-1）
+int journal_last_day(const vector<JournalBlockView>& blocks) {
+    int last = -1;
+    for (const JournalBlockView& block : blocks) last = max(last, block.day);
+    return last;
+}
+
+// 把日志的数据块回放到target_day这一天结束时：从不晚于该日的最近检查点出发，
+// 依次应用之后的出生、迁入、死亡和迁出事件（不运行任何行为代码）。数据块内容损坏时返回false
+bool replay_journal_blocks(const vector<JournalBlockView>& blocks, int target_day, map<unsigned long long, ReplayOrganism>& population,
+    vector<array<int, DEATH_CAUSE_COUNT>>& deaths, vector<int>& births, int& checkpoint_day) {
+    size_t start = blocks.size();
+    for (size_t b = 0; b < blocks.size(); b++) {
+        if (blocks[b].kind == 2 && blocks[b].day <= target_day &&
+            (start == blocks.size() || blocks[b].day >= blocks[start].day)) {
+            start = b;
+        }
+    }
+    if (start == blocks.size()) return false;
+
+    checkpoint_day = blocks[start].day;
+    population.clear();
+    deaths.assign(target_day - checkpoint_day + 1, array<int, DEATH_CAUSE_COUNT>());
+    births.assign(target_day - checkpoint_day + 1, 0);
+
+    for (size_t b = start; b < blocks.size(); b++) {
+        const JournalBlockView& block = blocks[b];
+        if (block.day > target_day) break;
+        if (block.kind == 2 && b != start) continue; // 只使用起始检查点
+        const unsigned char* p = block.begin;
+        const unsigned char* end = block.end;
+        unsigned long long prev_id = 0, prev_other = 0;
+        for (unsigned long long i = 0; i < block.count; i++) {
+            long long delta = 0;
+            unsigned long long x = 0, y = 0, value = 0;
+            if (block.kind == 2) {
+                // 检查点：[编号差][物种][x][y][年龄][能量]
+                ReplayOrganism org;
+                if (!journal_get_signed(p, end, delta) || p >= end) return false;
+                unsigned long long id = prev_id + delta;
+                org.species = *p++;
+                if (!journal_get_varint(p, end, x) || !journal_get_varint(p, end, y) ||
+                    !journal_get_varint(p, end, value) || !journal_get_varint(p, end, value)) {
+                    return false;
+                }
+                population[id] = org;
+                prev_id = id;
+                continue;
+            }
+
+            // 事件：[类型][细节][编号差][关联编号差]，出生和迁入后跟[x][y]
+            if (end - p < 2) return false;
+            unsigned char type = *p++;
+            unsigned char detail = *p++;
+            if (!journal_get_signed(p, end, delta)) return false;
+            unsigned long long id = prev_id + delta;
+            if (!journal_get_signed(p, end, delta)) return false;
+            unsigned long long other = prev_other + delta;
+            prev_id = id;
+            prev_other = other;
+            int offset = block.day - checkpoint_day;
+            switch (type) {
+            case EVENT_BIRTH:
+            case EVENT_ARRIVAL: {
+                if (!journal_get_varint(p, end, x) || !journal_get_varint(p, end, y)) return false;
+                ReplayOrganism org;
+                org.species = detail;
+                population[id] = org;
+                if (type == EVENT_BIRTH) births[offset]++;
+                break;
+            }
+            case EVENT_DEPARTURE:
+                population.erase(id);
+                break;
+            case EVENT_DEATH:
+                population.erase(id);
+                if (detail < DEATH_CAUSE_COUNT) deaths[offset][detail]++;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+// 回放工具：重建target_day这一天结束时的种群，输出各物种数量和检查点之后每天的出生与死因
+// target_day为负数时回放到日志记录的最后一天（多进程时取各进程都记录到的最后一天）
+// 多进程运行时各进程的日志为 path.rankN，分别回放后合并
+int replay_journal(const string& path, int target_day) {
+    vector<string> files;
+    if (ifstream(path.c_str(), ios::binary)) {
+        files.push_back(path);
+    }
+    else {
+        for (int r = 0; r < DOMAIN_MAX_RANKS; r++) {
+            string name = path + ".rank" + to_string(r);
+            if (!ifstream(name.c_str(), ios::binary)) break;
+            files.push_back(name);
+        }
+    }
+    if (files.empty()) {
+        cout << "无法打开日志文件: " << path << endl;
+        return 1;
+    }
+
+    vector<vector<unsigned char>> data(files.size());
+    vector<vector<JournalBlockView>> blocks(files.size());
+    int last_day = -1;
+    for (size_t f = 0; f < files.size(); f++) {
+        bool truncated = false;
+        if (!read_journal_blocks(files[f], data[f], blocks[f], truncated)) {
+            cout << "无法读取日志文件: " << files[f] << endl;
+            return 1;
+        }
+        if (truncated) cout << "日志文件末尾的数据块不完整，已忽略: " << files[f] << endl;
+        int file_last = journal_last_day(blocks[f]);
+        last_day = f == 0 ? file_last : min(last_day, file_last);
+    }
+    if (target_day < 0) target_day = last_day;
+
+    map<unsigned long long, ReplayOrganism> population;
+    vector<array<int, DEATH_CAUSE_COUNT>> deaths;
+    vector<int> births;
+    int checkpoint_day = -1;
+    for (size_t f = 0; f < files.size(); f++) {
+        const string& name = files[f];
+        map<unsigned long long, ReplayOrganism> part;
+        vector<array<int, DEATH_CAUSE_COUNT>> part_deaths;
+        vector<int> part_births;
+        int part_checkpoint;
+        if (target_day < 0 || !replay_journal_blocks(blocks[f], target_day, part, part_deaths, part_births, part_checkpoint)) {
+            cout << "日志文件损坏或没有不晚于第" << target_day << "天的检查点: " << name << endl;
+            return 1;
+        }
+        if (checkpoint_day < 0) {
+            checkpoint_day = part_checkpoint;
+            deaths.assign(part_deaths.size(), array<int, DEATH_CAUSE_COUNT>());
+            births.assign(part_births.size(), 0);
+        }
+        if (part_checkpoint != checkpoint_day) {
+            cout << "各进程的日志检查点不一致: " << name << endl;
+            return 1;
+        }
+        population.insert(part.begin(), part.end());
+        for (size_t d = 0; d < deaths.size(); d++) {
+            births[d] += part_births[d];
+            for (int c = 0; c < DEATH_CAUSE_COUNT; c++) deaths[d][c] += part_deaths[d][c];
+        }
+    }
+
+    cout << "从第" << checkpoint_day << "天的检查点回放到第" << target_day << "天 ("
+        << files.size() << "个日志文件)" << endl;
+    cout << setw(6) << "天" << setw(8) << "出生";
+    for (int c = 0; c < DEATH_CAUSE_COUNT; c++) cout << setw(8) << DEATH_CAUSE_NAMES[c];
+    cout << endl;
+    for (size_t d = 1; d < deaths.size(); d++) {
+        cout << setw(6) << checkpoint_day + d << setw(8) << births[d];
+        for (int c = 0; c < DEATH_CAUSE_COUNT; c++) cout << setw(8) << deaths[d][c];
+        cout << endl;
+    }
+
+    int counts[SPECIES_COUNT] = { 0 };
+    for (const auto& entry : population) {
+        if (entry.second.species < SPECIES_COUNT) counts[entry.second.species]++;
+    }
+    cout << "第" << target_day << "天结束时生物总数: " << population.size() << endl;
+    for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+        if (counts[sp] > 0) cout << "  " << SPECIES_NAMES[sp] << ": " << counts[sp] << endl;
+    }
+    return 0;
+}
+
+#ifndef _WIN32
+// 在序列锁保护下读取结果文件头中的计数（写入进行中或读取期间被修改时重读）
+void read_results_counts(const ResultsHeader* header, long long& count, long long& capacity) {
+    while (true) {
+        unsigned int before = header->sequence.load(memory_order_acquire);
+        if (before & 1) continue;
+        count = header->count.load(memory_order_relaxed);
+        capacity = header->capacity.load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (header->sequence.load(memory_order_relaxed) == before) return;
+    }
+}
+
+// 跟踪读取结果文件（在另一个进程中运行）：直接在映射上读取新提交的记录并逐天输出，
+// 文件扩大时重新映射，模拟结束且全部记录读完后退出
+int tail_results(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cout << "无法打开结果文件: " << path << endl;
+        return 1;
+    }
+
+    char* base = nullptr;
+    size_t mapped = 0;
+    long long shown = 0;
+    while (true) {
+        struct stat info;
+        if (fstat(fd, &info) != 0) break;
+        size_t size = static_cast<size_t>(info.st_size);
+        if (size != mapped && size >= static_cast<size_t>(RESULTS_HEADER_BYTES)) {
+            void* memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (memory == MAP_FAILED) break;
+            if (base) munmap(base, mapped);
+            base = static_cast<char*>(memory);
+            mapped = size;
+        }
+        const ResultsHeader* header = reinterpret_cast<const ResultsHeader*>(base);
+        if (!base || header->magic == 0) { // 写入者尚未写好文件头
+            usleep(100000);
+            continue;
+        }
+        if (header->magic != RESULTS_MAGIC || header->version != RESULTS_VERSION) {
+            cout << "不是结果文件或版本不符: " << path << endl;
+            break;
+        }
+
+        long long count, capacity;
+        read_results_counts(header, count, capacity);
+        if (RESULTS_HEADER_BYTES + static_cast<size_t>(capacity) * header->record_bytes <= mapped) {
+            for (; shown < count; shown++) {
+                const char* slot = base + RESULTS_HEADER_BYTES + static_cast<size_t>(shown) * header->record_bytes;
+                const ResultsDay* record = reinterpret_cast<const ResultsDay*>(slot);
+                if (record->commit.load(memory_order_acquire) != shown + 1) break;
+
+                int plants = 0, animals = 0;
+                for (int sp = 0; sp < SPECIES_COUNT; sp++) {
+                    (sp <= SPECIES_AQUATIC_PLANT ? plants : animals) += record->population[sp];
+                }
+                const unsigned short* raster = reinterpret_cast<const unsigned short*>(slot + sizeof(ResultsDay));
+                int cells = header->raster_size * header->raster_size;
+                unsigned short plant_peak = *max_element(raster, raster + cells);
+                unsigned short animal_peak = *max_element(raster + cells, raster + 2 * cells);
+                cout << "第" << record->day << "天  植物 " << plants << "  动物 " << animals
+                    << "  密度场 " << fixed << setprecision(0) << record->density_population
+                    << "  温度 " << setprecision(1) << record->temperature << "°C  降雨 " << record->rainfall
+                    << "mm  患病 " << record->infected << "  休眠 " << record->sleeping
+                    << "  种子 " << setprecision(0) << record->seeds
+                    << "  栅格峰值 " << plant_peak << "/" << animal_peak << endl;
+            }
+        }
+        if (header->finished.load(memory_order_acquire) && shown >= count) break;
+        usleep(200000);
+    }
+    if (base) munmap(base, mapped);
+    close(fd);
+    return 0;
+}
+#endif
+
+// 基准测试：无界面运行到最大天数（或生物灭绝），报告总耗时和各阶段的耗时与硬件计数器
+int run_benchmark(const WorldConfig& config) {
+    ofstream file;
+    ostream* out = &cout;
+    if (config.bench_path != "-") {
+        file.open(config.bench_path);
+        if (!file) {
+            cout << "无法创建基准测试报告: " << config.bench_path << endl;
+            return 1;
+        }
+        out = &file;
+    }
+
+    World world(config);
+    if (!world.check_memory_budget()) return 1;
+    auto start = chrono::steady_clock::now();
+    while (world.get_day() < world.get_max_days() && world.get_organism_count() > 0) {
+        world.simulate_day();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    *out << "world " << config.width << "x" << config.height << "  seed " << config.seed
+        << "  threads " << world.get_worker_threads() << "  days " << world.get_day()
+        << "  organisms " << world.get_organism_count() << "\n";
+    *out << "total " << fixed << setprecision(3) << seconds << " s  "
+        << setprecision(2) << (seconds > 0 ? world.get_day() / seconds : 0.0) << " days/s  "
+        << setprecision(3) << (world.get_day() > 0 ? 1000.0 * seconds / world.get_day() : 0.0) << " ms/day\n";
+    world.get_phase_counters()->write_report(*out);
+    world.write_memory_report(*out);
+    out->flush();
+    return 0;
+}
+
+// 解析命令行参数
+// 支持: --width N --height N --days N --seed N --ranks N --threads N --weather-cell N --focus x0,y0,x1,y1（可重复）
+//       --journal 文件 --replay 文件 --replay-day N --results 文件 --tail 文件 --metrics 端口 --bench 报告文件
+//       --profile 报告文件 --memory-budget MB --scenario 场景文件
+//       --frames 文件名前缀 --frame-layers 图层,... --frame-stride N --frame-scale N --frame-format ppm|png
+// 场景文件按在参数中的位置生效，之后的参数可以覆盖其中的世界设置
+bool parse_arguments(int argc, char* argv[], WorldConfig& config) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            cout << "参数缺少取值: " << arg << endl;
+            return false;
+        }
+        long value = strtol(argv[++i], nullptr, 10);
+        if (arg == "--width") config.width = static_cast<int>(value);
+        else if (arg == "--height") config.height = static_cast<int>(value);
+        else if (arg == "--days") config.max_days = static_cast<int>(value);
+        else if (arg == "--seed") config.seed = static_cast<unsigned int>(value);
+        else if (arg == "--ranks") config.ranks = static_cast<int>(value);
+        else if (arg == "--threads") config.threads = static_cast<int>(value);
+        else if (arg == "--weather-cell") config.weather_cell = static_cast<int>(value);
+        else if (arg == "--journal") config.journal_path = argv[i];
+        else if (arg == "--replay") config.replay_path = argv[i];
+        else if (arg == "--replay-day") config.replay_day = static_cast<int>(value);
+        else if (arg == "--results") config.results_path = argv[i];
+        else if (arg == "--tail") config.tail_path = argv[i];
+        else if (arg == "--metrics") config.metrics_port = static_cast<int>(value);
+        else if (arg == "--bench") config.bench_path = argv[i];
+        else if (arg == "--profile") config.profile_path = argv[i];
+        else if (arg == "--memory-budget") config.memory_budget = static_cast<long long>(value) * 1024 * 1024;
+        else if (arg == "--frames") config.frames_path = argv[i];
+        else if (arg == "--frame-stride") config.frame_stride = static_cast<int>(value);
+        else if (arg == "--frame-scale") config.frame_scale = static_cast<int>(value);
+        else if (arg == "--frame-format") {
+            string format = argv[i];
+            if (format != "ppm" && format != "png") {
+                cout << "图像格式应为 ppm 或 png: " << format << endl;
+                return false;
+            }
+            config.frame_png = format == "png";
+        }
+        else if (arg == "--frame-layers") {
+            config.frame_layers.clear();
+            stringstream names(argv[i]);
+            string name;
+            while (getline(names, name, ',')) {
+                int layer = frame_layer_index(name);
+                if (layer < 0) {
+                    cout << "未知图层: " << name << "（可用 terrain, water, drought, population 或物种名）" << endl;
+                    return false;
+                }
+                config.frame_layers.push_back(layer);
+            }
+        }
+        else if (arg == "--scenario") {
+            string error;
+            if (!load_scenario(argv[i], config, error)) {
+                cout << "场景文件 " << argv[i] << " 有误: " << error << endl;
+                return false;
+            }
+        }
+        else if (arg == "--focus") {
+            FocusArea area;
+            if (sscanf(argv[i], "%d,%d,%d,%d", &area.x0, &area.y0, &area.x1, &area.y1) != 4 ||
+                area.x0 >= area.x1 || area.y0 >= area.y1) {
+                cout << "关注区域格式应为 x0,y0,x1,y1: " << argv[i] << endl;
+                return false;
+            }
+            config.focus_areas.push_back(area);
+        }
+        else {
+            cout << "未知参数: " << arg << endl;
+            return false;
+        }
+    }
+
+    if (config.width < 1 || config.width > MAX_WORLD_SIZE ||
+        config.height < 1 || config.height > MAX_WORLD_SIZE) {
+        cout << "世界尺寸必须在1到" << MAX_WORLD_SIZE << "之间" << endl;
+        return false;
+    }
+    if (config.max_days < 1) {
+        cout << "模拟天数必须大于0" << endl;
+        return false;
+    }
+    if (config.ranks < 1 || config.ranks > DOMAIN_MAX_RANKS) {
+        cout << "进程数必须在1到" << DOMAIN_MAX_RANKS << "之间" << endl;
+        return false;
+    }
+    if (config.threads < 0) {
+        cout << "线程数不能为负数" << endl;
+        return false;
+    }
+    if (config.weather_cell < 4 || config.weather_cell > 256) {
+        cout << "天气格边长必须在4到256之间" << endl;
+        return false;
+    }
+    if (config.metrics_port < 0 || config.metrics_port + config.ranks - 1 > 65535) {
+        cout << "指标端口必须在1到65535之间（多进程时使用 端口+进程序号）" << endl;
+        return false;
+    }
+    if (config.memory_budget < 0) {
+        cout << "内存预算不能为负数" << endl;
+        return false;
+    }
+    if (config.frame_stride < 1 || config.frame_scale < 1) {
+        cout << "图像帧的间隔和缩小倍数必须大于0" << endl;
+        return false;
+    }
+    if (!config.frames_path.empty() && config.frame_layers.empty()) {
+        cout << "至少需要导出一个图层" << endl;
+        return false;
+    }
+    if (config.ranks > 1 && !config.bench_path.empty()) {
+        cout << "基准测试只支持单进程" << endl;
+        return false;
+    }
+    if (config.ranks > 1 && !config.focus_areas.empty()) {
+        cout << "多进程模式暂不支持关注区域" << endl;
+        return false;
+    }
+    return true;
+}
+
+// 主函数
+int main(int argc, char* argv[]) {
+    // 设置控制台支持中文
+    SetConsoleToGB2312();
+
+    WorldConfig config;
+    if (!parse_arguments(argc, argv, config)) {
+        cout << "用法: EcosystemSimulation [--width N] [--height N] [--days N] [--seed N] [--ranks N] [--threads N] [--weather-cell N] [--focus x0,y0,x1,y1]"
+            << " [--journal 文件] [--replay 文件 [--replay-day N]] [--results 文件] [--tail 文件] [--metrics 端口] [--bench 报告文件] [--profile 报告文件] [--memory-budget MB] [--scenario 场景文件]"
+            << " [--frames 文件名前缀 [--frame-layers 图层,...] [--frame-stride N] [--frame-scale N] [--frame-format ppm|png]]" << endl;
+        return 1;
+    }
+
+    // 回放事件日志（不运行模拟）
+    if (!config.replay_path.empty()) {
+        return replay_journal(config.replay_path, config.replay_day);
+    }
+
+    // 跟踪读取另一个进程正在写入的结果文件
+    if (!config.tail_path.empty()) {
+#ifdef _WIN32
+        cout << "结果文件仅支持Linux" << endl;
+        return 1;
+#else
+        return tail_results(config.tail_path);
+#endif
+    }
+
+    // 多进程区域分解模式（无界面）
+    if (config.ranks > 1) {
+#ifdef _WIN32
+        cout << "多进程模式仅支持Linux" << endl;
+        return 1;
+#else
+        return launch_domain_ranks(config);
+#endif
+    }
+
+    // 基准测试（无界面）
+    if (!config.bench_path.empty()) {
+        return run_benchmark(config);
+    }
+
+    // 显示欢迎界面
+    display_welcome(config);
+
+    World world(config);
+    if (!world.check_memory_budget()) return 1;
+
+    // 界面由绘制线程按帧率绘制，主线程只处理按键和推进模拟
+    RenderThread renderer;
+    world.set_message_hold(true);
+    WorldSnapshot snapshot;
+    snapshot.show_prompt = true;
+    bool playing = false;
+    int play_speed = PLAY_DEFAULT_SPEED;
+    auto next_day = chrono::steady_clock::now();
+    bool changed = true; // 世界或界面状态已改变，需要发布新的快照
+
+    while (true) {
+        if (changed) {
+            snapshot.playing = playing;
+            snapshot.play_speed = play_speed;
+            world.capture_snapshot(snapshot);
+            renderer.publish(snapshot);
+            changed = false;
+        }
+
+        // 检查是否达到最大天数
+        if (world.get_day() >= world.get_max_days()) {
+            renderer.stop();
+            world.display();
+            SetColor(COLOR_HIGHLIGHTA);
+            cout << "\n模拟完成！已到达" << world.get_max_days() << "天。" << endl;
+            SetColor(COLOR_DEFAULT);
+            cout << "按任意键退出..." << endl;
+            _getch();
+            break;
+        }
+
+        // 连续运行时按速度推进，期间不等待按键
+        if (playing && !_kbhit()) {
+            auto now = chrono::steady_clock::now();
+            if (now < next_day) {
+                this_thread::sleep_for(min(next_day - now, chrono::steady_clock::duration(chrono::milliseconds(10))));
+                continue;
+            }
+            next_day = max(next_day, now - chrono::seconds(1)) + chrono::microseconds(1000000 / play_speed);
+            world.simulate_day();
+        }
+        else {
+            char choice;
+            choice = _getch();
+
+            if (toupper(choice) == 'Q') break;
+
+            if (toupper(choice) == 'A') {
+                renderer.pause();
+                world.adjust_environment();
+                renderer.resume();
+            }
+            else if (toupper(choice) == 'R') {
+                // 重置世界
+                world.reset();
+            }
+            else if (toupper(choice) == 'S') {
+                world.simulate_day();
+            }
+            else if (toupper(choice) == 'G') {
+                playing = !playing;
+                next_day = chrono::steady_clock::now();
+            }
+            else if (choice == '+' || choice == '=') {
+                play_speed = min(PLAY_MAX_SPEED, play_speed * 2);
+            }
+            else if (choice == '-') {
+                play_speed = max(1, play_speed / 2);
+            }
+            else if (toupper(choice) == 'F') {
+                world.toggle_focus_viewport();
+            }
+            else if (choice == '[') {
+                world.zoom_view(-1);
+            }
+            else if (choice == ']') {
+                world.zoom_view(1);
+            }
+            else if (choice == ',') {
+                world.scrub_history(-1);
+            }
+            else if (choice == '.') {
+                world.scrub_history(1);
+            }
+            else if (choice == '<') {
+                world.scrub_history(-10);
+            }
+            else if (choice == '>') {
+                world.scrub_history(10);
+            }
+            else if (toupper(choice) == 'L') {
+                world.stop_scrubbing();
+            }
+            else if (toupper(choice) == 'P') {
+                renderer.pause();
+                world.show_profile();
+                cout << "按任意键继续..." << endl;
+                _getch();
+                renderer.resume();
+            }
+            else if (toupper(choice) == 'C') {
+                renderer.pause();
+                int sel_x, sel_y;
+                cout << "\n输入要查看的生物坐标 (相对于视口): ";
+                cin >> sel_x >> sel_y;
+                world.select_organism(sel_x, sel_y);
+                renderer.resume();
+            }
+            else if (choice == -32) { // 扩展键
+                choice = _getch(); // 获取第二个键值
+                switch (choice) {
+                case 72: world.move_viewport(0, -10); break; // 上
+                case 80: world.move_viewport(0, 10); break;  // 下
+                case 75: world.move_viewport(-10, 0); break; // 左
+                case 77: world.move_viewport(10, 0); break;  // 右
+                }
+            }
+        }
+
+        changed = true;
+
+        // 如果所有生物灭绝，结束模拟
+        if (world.get_organism_count() == 0) {
+            renderer.stop();
+            world.display();
+            SetColor(COLOR_WARNING);
+            cout << "\n所有生物已灭绝，模拟结束!\n";
+            SetColor(COLOR_DEFAULT);
+            break;
+        }
+    }
+    renderer.stop();
+
+    SetColor(COLOR_TITLE);
+    cout << "\n感谢使用生态系统模拟器!\n";
+    SetColor(COLOR_DEFAULT);
+    return 0;
 }
\ No newline at end of file